@@ -166,7 +166,7 @@ struct activity pcsw_act = {
 /* Interrupts statistics. Switch: -I */
 struct activity irq_act = {
 	.id		= A_IRQ,
-	.options	= AO_COUNTED + AO_MATRIX + AO_PERSISTENT,
+	.options	= AO_COUNTED + AO_MATRIX + AO_PERSISTENT + AO_SPARSE,
 	.magic		= ACTIVITY_MAGIC_BASE + 2,
 	.group		= G_INT,
 #ifdef SOURCE_SADC
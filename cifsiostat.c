@@ -25,6 +25,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <sys/utsname.h>
 #include <ctype.h>
@@ -53,6 +54,12 @@ extern int __env;
 
 unsigned long long uptime_cs[2] = {0, 0};
 struct io_cifs *cifs_list = NULL;
+struct io_cifs *cifs_htab[CIFS_HASH_SIZE];
+
+/* File descriptor kept open on CIFSSTATS and buffer used to read it */
+int cifs_fd = -1;
+char *cifs_buf = NULL;
+size_t cifs_buf_size = 0;
 
 int cpu_nr = 0;		/* Nb of processors on the machine */
 uint64_t flags = 0;	/* Flag for common options and system state */
@@ -132,6 +139,22 @@ void set_cifs_nonexistent(struct io_cifs *clist)
 	}
 }
 
+/*
+ ***************************************************************************
+ * Compute the bucket of a cifs name in the hash table of cifs filesystems.
+ *
+ * IN:
+ * @name	cifs name.
+ *
+ * RETURNS:
+ * Bucket number.
+ ***************************************************************************
+ */
+unsigned int hash_cifs_name(char *name)
+{
+	return hash_str(name, strlen(name)) & (CIFS_HASH_SIZE - 1);
+}
+
 /*
  ***************************************************************************
  * Check if a cifs filesystem is present in the list, and add it if requested.
@@ -150,33 +173,30 @@ void set_cifs_nonexistent(struct io_cifs *clist)
 struct io_cifs *add_list_cifs(struct io_cifs **clist, char *name)
 {
 	struct io_cifs *c, *cs;
+	unsigned int h;
 	int i;
 
 	if (strnlen(name, MAX_NAME_LEN) == MAX_NAME_LEN)
 		/* cifs name is too long */
 		return NULL;
 
-	while (*clist != NULL) {
-
-		c = *clist;
-		if ((i = strcmp(c->name, name)) == 0) {
+	/* Look for the cifs in the hash table */
+	h = hash_cifs_name(name);
+	for (c = cifs_htab[h]; c != NULL; c = c->hnext) {
+		if (!strcmp(c->name, name)) {
 			/* cifs found in list */
 			c->exist = TRUE;
 			return c;
 		}
-		if (i > 0)
-			/*
-			 * If no group defined and we don't use /proc/diskstats,
-			 * insert current device in alphabetical order.
-			 * NB: Using /proc/diskstats ("iostat -p ALL") is a bit better than
-			 * using alphabetical order because sda10 comes after sda9...
-			 */
-			break;
-
-		clist = &(c->next);
 	}
 
-	/* cifs not found */
+	/*
+	 * cifs not found: Insert it in alphabetical order.
+	 * The list is walked only when a new cifs is mounted.
+	 */
+	while ((*clist != NULL) && (strcmp((*clist)->name, name) < 0)) {
+		clist = &((*clist)->next);
+	}
 	cs = *clist;
 
 	/* Add cifs to the list */
@@ -198,9 +218,109 @@ struct io_cifs *add_list_cifs(struct io_cifs **clist, char *name)
 	c->exist = TRUE;
 	c->next = cs;
 
+	/* Index cifs by name */
+	c->hnext = cifs_htab[h];
+	cifs_htab[h] = c;
+
 	return c;
 }
 
+/*
+ ***************************************************************************
+ * Read the whole contents of /proc/fs/cifs/Stats into a buffer.
+ * The file is opened once and then re-read from the start with pread()
+ * at each sample.
+ *
+ * RETURNS:
+ * Number of bytes read, or -1 if the file couldn't be read.
+ ***************************************************************************
+ */
+ssize_t read_cifs_file(void)
+{
+	size_t len = 0;
+	ssize_t n;
+
+#ifdef TEST
+	/* Test root directory changes between samples: Reopen the file */
+	if (cifs_fd >= 0) {
+		close(cifs_fd);
+		cifs_fd = -1;
+	}
+#endif
+	if ((cifs_fd < 0) && ((cifs_fd = open(CIFSSTATS, O_RDONLY)) < 0))
+		return -1;
+
+	if (!cifs_buf_size) {
+		SREALLOC(cifs_buf, char, CIFS_BUF_SIZE);
+		cifs_buf_size = CIFS_BUF_SIZE;
+	}
+
+	while ((n = pread(cifs_fd, cifs_buf + len, cifs_buf_size - len - 1, len)) > 0) {
+		len += n;
+		if (len == cifs_buf_size - 1) {
+			/* Buffer is full: Double its size */
+			cifs_buf_size *= 2;
+			SREALLOC(cifs_buf, char, cifs_buf_size);
+		}
+	}
+
+	if ((n < 0) || !len) {
+		/*
+		 * Close the file so that it is opened again next time:
+		 * cifs module may have been unloaded then reloaded.
+		 */
+		close(cifs_fd);
+		cifs_fd = -1;
+		if (n < 0)
+			return -1;
+	}
+	cifs_buf[len] = '\0';
+
+	return len;
+}
+
+/*
+ ***************************************************************************
+ * Match a label then read the number following it in a line of
+ * /proc/fs/cifs/Stats. A space in the label matches any number of spaces
+ * in the line (including none).
+ *
+ * IN:
+ * @p		Address of pointer on current position in the line.
+ * @label	Label to match.
+ *
+ * OUT:
+ * @p		Position in the line after the number.
+ * @val		Number read.
+ *
+ * RETURNS:
+ * 1 if the label was matched and the number read, and 0 otherwise.
+ ***************************************************************************
+ */
+int get_cifs_value(char **p, char *label, unsigned long long *val)
+{
+	char *s = *p;
+
+	for (; *label; label++) {
+		if (*label == ' ') {
+			while (isspace((unsigned char) *s)) {
+				s++;
+			}
+		}
+		else if (*s++ != *label)
+			return 0;
+	}
+	while (isspace((unsigned char) *s)) {
+		s++;
+	}
+	if (!isdigit((unsigned char) *s))
+		return 0;
+
+	*val = strtoull(s, p, 10);
+
+	return 1;
+}
+
 /*
  ***************************************************************************
  * Read CIFS-mount directories stats from /proc/fs/cifs/Stats.
@@ -214,28 +334,40 @@ struct io_cifs *add_list_cifs(struct io_cifs **clist, char *name)
  */
 int read_cifs_stat(int curr)
 {
-	FILE *fp;
-	char line[1024];
-	char aux[32];
+	char *line, *eol, *p, *name;
 	int start = 0;
+	ssize_t len;
 	long long unsigned aux_open;
 	long long unsigned all_open = 0;
 	char cifs_name[MAX_NAME_LEN];
-	char name_tmp[MAX_NAME_LEN];
 	struct cifs_st scifs;
 	struct io_cifs *ci;
 
-	if ((fp = fopen(CIFSSTATS, "r")) == NULL)
+	if ((len = read_cifs_file()) < 0)
 		return 1;
 
-	sprintf(aux, "%%*d) %%%ds", MAX_NAME_LEN - 1);
-
 	memset(&scifs, 0, CIFS_ST_SIZE);
 
-	while (fgets(line, sizeof(line), fp) != NULL) {
+	/* Parse the buffer in a single pass, one line at a time */
+	for (line = cifs_buf; line < cifs_buf + len; line = eol + 1) {
+
+		if ((eol = strchr(line, '\n')) == NULL) {
+			eol = line + strlen(line);
+		}
+		*eol = '\0';
+
+		/* Read CIFS directory name ("<n>) <name>") */
+		if (isdigit((unsigned char) line[0])) {
+			for (p = line; isdigit((unsigned char) *p); p++);
+			if (*p++ != ')')
+				continue;
+			while (isspace((unsigned char) *p)) {
+				p++;
+			}
+			for (name = p; *p && !isspace((unsigned char) *p); p++);
+			if (p == name)
+				continue;
 
-		/* Read CIFS directory name */
-		if (isdigit((unsigned char) line[0]) && sscanf(line, aux, name_tmp) == 1) {
 			if (start) {
 				scifs.fopens = all_open;
 				ci = add_list_cifs(&cifs_list, cifs_name);
@@ -247,47 +379,64 @@ int read_cifs_stat(int curr)
 			else {
 				start = 1;
 			}
-			snprintf(cifs_name, sizeof(cifs_name), "%s", name_tmp);
+			snprintf(cifs_name, sizeof(cifs_name), "%.*s", (int) (p - name), name);
 			memset(&scifs, 0, CIFS_ST_SIZE);
+			continue;
 		}
-		else {
-			if (!strncmp(line, "Reads:", 6)) {
-				/*
-				 * SMB1 format: Reads: %llu Bytes: %llu
-				 * SMB2 format: Reads: %llu sent %llu failed
-				 * If this is SMB2 format then only the first variable (rd_ops) will be set.
-				 */
-				sscanf(line, "Reads: %llu Bytes: %llu", &scifs.rd_ops, &scifs.rd_bytes);
+
+		p = line;
+		switch (line[0]) {
+
+		case 'R':
+			/*
+			 * SMB1 format: Reads: %llu Bytes: %llu
+			 * SMB2 format: Reads: %llu sent %llu failed
+			 * If this is SMB2 format then only the first variable (rd_ops) will be set.
+			 */
+			if (get_cifs_value(&p, "Reads:", &scifs.rd_ops)) {
+				get_cifs_value(&p, " Bytes:", &scifs.rd_bytes);
 			}
-			else if (!strncmp(line, "Bytes read:", 11)) {
-				sscanf(line, "Bytes read: %llu  Bytes written: %llu",
-				       &scifs.rd_bytes, &scifs.wr_bytes);
+			break;
+
+		case 'B':
+			if (get_cifs_value(&p, "Bytes read:", &scifs.rd_bytes)) {
+				get_cifs_value(&p, " Bytes written:", &scifs.wr_bytes);
 			}
-			else if (!strncmp(line, "Writes:", 7)) {
-				/*
-				 * SMB1 format: Writes: %llu Bytes: %llu
-				 * SMB2 format: Writes: %llu sent %llu failed
-				 * If this is SMB2 format then only the first variable (wr_ops) will be set.
-				 */
-				sscanf(line, "Writes: %llu Bytes: %llu", &scifs.wr_ops, &scifs.wr_bytes);
+			break;
+
+		case 'W':
+			/*
+			 * SMB1 format: Writes: %llu Bytes: %llu
+			 * SMB2 format: Writes: %llu sent %llu failed
+			 * If this is SMB2 format then only the first variable (wr_ops) will be set.
+			 */
+			if (get_cifs_value(&p, "Writes:", &scifs.wr_ops)) {
+				get_cifs_value(&p, " Bytes:", &scifs.wr_bytes);
 			}
-			else if (!strncmp(line, "Opens:", 6)) {
-				sscanf(line, "Opens: %llu Closes:%llu Deletes: %llu",
-				       &aux_open, &scifs.fcloses, &scifs.fdeletes);
+			break;
+
+		case 'O':
+			if (get_cifs_value(&p, "Opens:", &aux_open)) {
 				all_open += aux_open;
+				if (get_cifs_value(&p, " Closes:", &scifs.fcloses)) {
+					get_cifs_value(&p, " Deletes:", &scifs.fdeletes);
+				}
 			}
-			else if (!strncmp(line, "Posix Opens:", 12)) {
-				sscanf(line, "Posix Opens: %llu", &aux_open);
+			else if (get_cifs_value(&p, "Open files:", &all_open) &&
+				 get_cifs_value(&p, " total (local),", &aux_open)) {
 				all_open += aux_open;
 			}
-			else if (!strncmp(line, "Open files:", 11)) {
-				sscanf(line, "Open files: %llu total (local), %llu",
-				       &all_open, &aux_open);
+			break;
+
+		case 'P':
+			if (get_cifs_value(&p, "Posix Opens:", &aux_open)) {
 				all_open += aux_open;
 			}
-			else if (!strncmp(line, "Closes:", 7)) {
-				sscanf(line, "Closes: %llu", &scifs.fcloses);
-			}
+			break;
+
+		case 'C':
+			get_cifs_value(&p, "Closes:", &scifs.fcloses);
+			break;
 		}
 	}
 
@@ -299,7 +448,6 @@ int read_cifs_stat(int curr)
 		}
 	}
 
-	fclose(fp);
 	return 0;
 }
 
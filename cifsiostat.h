@@ -11,6 +11,11 @@
 
 #define CIFSSTATS  PRE "/proc/fs/cifs/Stats"
 
+/* Size of the hash table of CIFS filesystems (must be a power of 2) */
+#define CIFS_HASH_SIZE		1024
+/* Initial size of the buffer used to read CIFSSTATS */
+#define CIFS_BUF_SIZE		8192
+
 /* I_: cifsiostat - D_: Display - F_: Flag */
 #define I_D_TIMESTAMP		0x001
 #define I_D_KILOBYTES		0x002
@@ -45,6 +50,8 @@ struct io_cifs {
 	int exist;
 	struct cifs_st *cifs_stats[2];
 	struct io_cifs *next;
+	/* Next cifs in the same bucket of the hash table */
+	struct io_cifs *hnext;
 };
 
 #define IO_CIFS_SIZE	(sizeof(struct io_cifs))
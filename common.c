@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <inttypes.h>
+#include <math.h>
 #include <time.h>
 #include <errno.h>
 #include <unistd.h>	/* For STDOUT_FILENO, among others */
@@ -934,6 +935,50 @@ char *strtolower(char *str)
 	return(str);
 }
 
+/*
+ ***************************************************************************
+ * Compute the hash value of a string (FNV-1a hash). Used to look up
+ * strings (names of devices, filesystems, tasks, etc.) in hash tables.
+ *
+ * IN:
+ * @str		String (not necessarily null-terminated).
+ * @len		Length of the string.
+ *
+ * RETURNS:
+ * Hash value. The number of buckets of the hash table should be a power
+ * of 2, the bucket being then the lowest bits of this value.
+ ***************************************************************************
+*/
+unsigned int hash_str(const char *str, size_t len)
+{
+	unsigned int hash = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ (unsigned char) str[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+/*
+ ***************************************************************************
+ * Compute the hash value of a device number. Used to look up devices in
+ * hash tables.
+ *
+ * IN:
+ * @major	Major number of the device.
+ * @minor	Minor number of the device.
+ *
+ * RETURNS:
+ * Hash value.
+ ***************************************************************************
+*/
+unsigned int hash_dev(unsigned int major, unsigned int minor)
+{
+	return major * 31 + minor;
+}
+
 /*
  ***************************************************************************
  * Get persistent type name directory from type.
@@ -1212,9 +1257,35 @@ char *get_devname(unsigned int major, unsigned int minor)
 	return (buf);
 }
 
+/* Device names already computed by get_device_name() */
+static struct dev_name_entry *dev_name_htab[DEV_NAME_HASH_SIZE];
+
 /*
  * **************************************************************************
- * Get device name (whether pretty-printed, persistent or not).
+ * Remove all the entries from the device name cache.
+ * To be called when a device has been added or removed, since its major
+ * and minor numbers may then have been given to another device.
+ ***************************************************************************
+ */
+void flush_device_name_cache(void)
+{
+	struct dev_name_entry *dn, *dnn;
+	int i;
+
+	for (i = 0; i < DEV_NAME_HASH_SIZE; i++) {
+		for (dn = dev_name_htab[i]; dn != NULL; dn = dnn) {
+			dnn = dn->next;
+			free(dn->dflt_name);
+			free(dn);
+		}
+		dev_name_htab[i] = NULL;
+	}
+}
+
+/*
+ * **************************************************************************
+ * Compute device name (whether pretty-printed, persistent or not).
+ * This is the uncached part of get_device_name().
  *
  * IN:
  * @major		Major number of the device.
@@ -1226,18 +1297,19 @@ char *get_devname(unsigned int major, unsigned int minor)
  * @use_stable_id	Display stable-across-reboots name.
  * @dflt_name		Device name to use by default (if existent).
  *
- * RETURNS:
- * The name of the device.
+ * OUT:
+ * @dname		Name of the device.
+ * @size		Size of @dname buffer.
  ***************************************************************************
  */
-char *get_device_name(unsigned int major, unsigned int minor, unsigned long long wwn[],
-		      unsigned int part_nr, unsigned int disp_devmap_name,
-		      unsigned int disp_persist_name, unsigned int use_stable_id,
-		      char *dflt_name)
+void compute_device_name(unsigned int major, unsigned int minor, unsigned long long wwn[],
+			 unsigned int part_nr, unsigned int disp_devmap_name,
+			 unsigned int disp_persist_name, unsigned int use_stable_id,
+			 char *dflt_name, char *dname, size_t size)
 {
 	static unsigned int dm_major = 0;
 	char *dev_name = NULL, *persist_dev_name = NULL, *bang;
-	static char sid[64], dname[MAX_NAME_LEN];
+	char sid[64];
 
 	if (disp_persist_name) {
 		persist_dev_name = get_persistent_name_from_pretty(get_devname(major, minor));
@@ -1278,7 +1350,7 @@ char *get_device_name(unsigned int major, unsigned int minor, unsigned long long
 		}
 	}
 
-	snprintf(dname, sizeof(dname), "%s", dev_name);
+	snprintf(dname, size, "%s", dev_name);
 
 	while ((bang = strchr(dname, '!'))) {
 		/*
@@ -1288,8 +1360,93 @@ char *get_device_name(unsigned int major, unsigned int minor, unsigned long long
 		 */
 		*bang = '/';
 	}
+}
+
+/*
+ * **************************************************************************
+ * Get device name (whether pretty-printed, persistent or not).
+ * Names are computed only once for a given device and display mode,
+ * and then saved in a cache, since this may require reading numerous
+ * symbolic links (e.g. to find the persistent name of a device).
+ *
+ * IN:
+ * @major		Major number of the device.
+ * @minor		Minor number of the device.
+ * @wwn			WWN identifier of the device (0 if unknown).
+ * @part_nr		Partition number (0 if unknown).
+ * @disp_devmap_name	Display device mapper name.
+ * @disp_persist_name	Display persistent name of the device.
+ * @use_stable_id	Display stable-across-reboots name.
+ * @dflt_name		Device name to use by default (if existent).
+ *
+ * RETURNS:
+ * The name of the device.
+ ***************************************************************************
+ */
+char *get_device_name(unsigned int major, unsigned int minor, unsigned long long wwn[],
+		      unsigned int part_nr, unsigned int disp_devmap_name,
+		      unsigned int disp_persist_name, unsigned int use_stable_id,
+		      char *dflt_name)
+{
+	struct dev_name_entry *dn;
+	unsigned long long w0 = 0, w1 = 0;
+	unsigned int mode, h;
+
+	if (use_stable_id && (wwn[0] != 0)) {
+		w0 = wwn[0];
+		w1 = wwn[1];
+	}
+	else {
+		/* WWN and partition number are not used to compute the name */
+		use_stable_id = FALSE;
+		part_nr = 0;
+	}
+	mode = (disp_devmap_name ? 0x01 : 0) | (disp_persist_name ? 0x02 : 0) |
+	       (use_stable_id ? 0x04 : 0) | (dflt_name ? 0x08 : 0);
+
+	h = hash_dev(major, minor) & (DEV_NAME_HASH_SIZE - 1);
+
+	for (dn = dev_name_htab[h]; dn != NULL; dn = dn->next) {
+		if ((dn->major == major) && (dn->minor == minor) &&
+		    (dn->mode == mode) && (dn->part_nr == part_nr) &&
+		    (dn->wwn[0] == w0) && (dn->wwn[1] == w1))
+			break;
+	}
 
-	return dname;
+	if (dn != NULL) {
+		if (!dflt_name || !strcmp(dn->dflt_name, dflt_name))
+			return dn->name;
+
+		/* Default name has changed: Name has to be computed again */
+		free(dn->dflt_name);
+	}
+	else {
+		/* Add a new entry to the cache */
+		if ((dn = (struct dev_name_entry *) malloc(sizeof(struct dev_name_entry))) == NULL) {
+			perror("malloc");
+			exit(4);
+		}
+		dn->major = major;
+		dn->minor = minor;
+		dn->part_nr = part_nr;
+		dn->mode = mode;
+		dn->wwn[0] = w0;
+		dn->wwn[1] = w1;
+		dn->next = dev_name_htab[h];
+		dev_name_htab[h] = dn;
+	}
+
+	dn->dflt_name = NULL;
+	if (dflt_name && ((dn->dflt_name = strdup(dflt_name)) == NULL)) {
+		perror("strdup");
+		exit(4);
+	}
+
+	compute_device_name(major, minor, wwn, part_nr, disp_devmap_name,
+			    disp_persist_name, use_stable_id, dflt_name,
+			    dn->name, sizeof(dn->name));
+
+	return dn->name;
 }
 
 /*
@@ -1384,6 +1541,179 @@ void init_colors(void)
 	}
 }
 
+/*
+ ***************************************************************************
+ * Make stdout fully buffered, using a buffer large enough to contain a
+ * whole report, so that the report can be written with a single write()
+ * system call when stdout is flushed.
+ * Note: With musl-c, the behavior of this function is undefined except
+ * when it is the first operation on the stream.
+ *
+ * IN:
+ * @size	Size of the buffer.
+ ***************************************************************************
+ */
+void init_output_buffer(size_t size)
+{
+	static char *obuf = NULL;
+
+	if (size < BUFSIZ) {
+		size = BUFSIZ;
+	}
+	if ((obuf = (char *) malloc(size)) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	setvbuf(stdout, obuf, _IOFBF, size);
+}
+
+/*
+ ***************************************************************************
+ * Format a "double" value exactly like printf("%*.*f") would (or
+ * printf("%+*.*f") if @plus is TRUE), but without going through printf's
+ * format string parsing and varargs handling.
+ * Only the most common cases (values below 1e7 with up to 2 decimal places)
+ * are handled here. Other ones, and values too close to a tie for their
+ * rounding to be decided safely, are formatted by snprintf().
+ *
+ * IN:
+ * @val		Value to format.
+ * @wi		Output width.
+ * @wd		Number of decimal places.
+ * @plus	TRUE if a '+' sign should be displayed for positive values.
+ *
+ * OUT:
+ * @buf		Formatted string.
+ *
+ * RETURNS:
+ * Length of the formatted string.
+ ***************************************************************************
+ */
+static int format_fixed(char *buf, size_t size, double val, int wi, int wd,
+			int plus)
+{
+	static const double p10[] = {1.0, 10.0, 100.0};
+	char tmp[32], *p = tmp + sizeof(tmp);
+	double aval, scaled, frac;
+	uint64_t r;
+	int i, len, neg;
+
+	neg = signbit(val) != 0;
+	aval = neg ? -val : val;
+
+	/* NB: NaN values fail the comparison */
+	if ((wd < 0) || (wd > 2) || (wi < 0) || (wi >= (int) size) ||
+	    !(aval < 1.0e7))
+		goto fallback;
+
+	/*
+	 * The error on @scaled is less than 1e-6 here: Let snprintf()
+	 * decide how to round values which are too close to a tie.
+	 */
+	scaled = aval * p10[wd];
+	r = (uint64_t) scaled;
+	frac = scaled - (double) r;
+	if ((frac > 0.5 - 1e-5) && (frac < 0.5 + 1e-5))
+		goto fallback;
+	if (frac > 0.5) {
+		r++;
+	}
+
+	/* Write digits from right to left */
+	for (i = 0; i < wd; i++) {
+		*--p = '0' + r % 10;
+		r /= 10;
+	}
+	if (wd) {
+		*--p = '.';
+	}
+	do {
+		*--p = '0' + r % 10;
+		r /= 10;
+	}
+	while (r);
+
+	if (neg) {
+		*--p = '-';
+	}
+	else if (plus) {
+		*--p = '+';
+	}
+
+	len = tmp + sizeof(tmp) - p;
+	i = (wi > len) ? wi - len : 0;
+	memset(buf, ' ', i);
+	memcpy(buf + i, p, len);
+	buf[i + len] = '\0';
+
+	return i + len;
+
+fallback:
+	return snprintf(buf, size, plus ? "%+*.*f" : "%*.*f", wi, wd, val);
+}
+
+/*
+ ***************************************************************************
+ * Print a "double" value preceded by a space, like printf(" %*.*f") (or
+ * printf(" %+*.*f") if @plus is TRUE) would do.
+ *
+ * IN:
+ * @val		Value to print.
+ * @wi		Output width.
+ * @wd		Number of decimal places.
+ * @plus	TRUE if a '+' sign should be displayed for positive values.
+ ***************************************************************************
+ */
+static void print_fixed(double val, int wi, int wd, int plus)
+{
+	char buf[128];
+	int len;
+
+	buf[0] = ' ';
+	len = format_fixed(buf + 1, sizeof(buf) - 1, val, wi, wd, plus);
+	if (len >= (int) sizeof(buf) - 1) {
+		/* Output has been truncated */
+		printf(plus ? " %+*.*f" : " %*.*f", wi, wd, val);
+		return;
+	}
+	fwrite(buf, 1, len + 1, stdout);
+}
+
+/*
+ ***************************************************************************
+ * Print a 64 bit unsigned value preceded by a space, like
+ * printf(" %*"PRIu64) would do.
+ *
+ * IN:
+ * @val		Value to print.
+ * @wi		Output width.
+ ***************************************************************************
+ */
+static void print_u64(uint64_t val, int wi)
+{
+	char buf[64], *p = buf + sizeof(buf);
+	int len;
+
+	if (wi >= (int) sizeof(buf) - 1) {
+		printf(" %*"PRIu64, wi, val);
+		return;
+	}
+
+	do {
+		*--p = '0' + val % 10;
+		val /= 10;
+	}
+	while (val);
+
+	len = buf + sizeof(buf) - p;
+	while (len < wi) {
+		*--p = ' ';
+		len++;
+	}
+	*--p = ' ';
+	fwrite(p, 1, len + 1, stdout);
+}
+
 /*
  ***************************************************************************
  * Print a value in human readable format. Such a value is a decimal number
@@ -1410,14 +1740,14 @@ void cprintf_unit(int unit, int wi, double dval)
 		dval /= 1024;
 		unit++;
 	}
-	printf(" %*.*f", wi - 1, dplaces_nr ? 1 : 0, dval);
-	printf("%s", sc_normal);
+	print_fixed(dval, wi - 1, dplaces_nr ? 1 : 0, FALSE);
+	fputs(sc_normal, stdout);
 
 	/* Display unit */
 	if (unit >= NR_UNITS) {
 		unit = NR_UNITS - 1;
 	}
-	printf("%c", units[unit]);
+	putchar(units[unit]);
 }
 
 /*
@@ -1441,14 +1771,14 @@ void cprintf_u64(int unit, int num, int wi, ...)
 	for (i = 0; i < num; i++) {
 		val = va_arg(args, unsigned long long);
 		if (!val) {
-			printf("%s", sc_zero_int_stat);
+			fputs(sc_zero_int_stat, stdout);
 		}
 		else {
-			printf("%s", sc_int_stat);
+			fputs(sc_int_stat, stdout);
 		}
 		if (unit < 0) {
-			printf(" %*"PRIu64, wi, val);
-			printf("%s", sc_normal);
+			print_u64(val, wi);
+			fputs(sc_normal, stdout);
 		}
 		else {
 			cprintf_unit(unit, wi, (double) val);
@@ -1477,9 +1807,9 @@ void cprintf_x(int num, int wi, ...)
 
 	for (i = 0; i < num; i++) {
 		val = va_arg(args, unsigned int);
-		printf("%s", sc_int_stat);
+		fputs(sc_int_stat, stdout);
 		printf(" %*x", wi, val);
-		printf("%s", sc_normal);
+		fputs(sc_normal, stdout);
 	}
 
 	va_end(args);
@@ -1523,26 +1853,21 @@ void cprintf_f(int unit, int sign, int num, int wi, int wd, ...)
 		val = va_arg(args, double);
 		if (((wd > 0) && (val < lim) && (val > (lim * -1))) ||
 		    ((wd == 0) && (val <= 0.5) && (val >= -0.5))) {	/* "Round half to even" law */
-			printf("%s", sc_zero_int_stat);
+			fputs(sc_zero_int_stat, stdout);
 		}
 		else if (sign && (val <= -10.0)) {
-			printf("%s", sc_percent_xtreme);
+			fputs(sc_percent_xtreme, stdout);
 		}
 		else if (sign && (val <= -5.0)) {
-			printf("%s", sc_percent_warn);
+			fputs(sc_percent_warn, stdout);
 		}
 		else {
-			printf("%s", sc_int_stat);
+			fputs(sc_int_stat, stdout);
 		}
 
 		if (unit < 0) {
-			if (sign) {
-				printf(" %+*.*f", wi, wd, val);
-			}
-			else {
-				printf(" %*.*f", wi, wd, val);
-			}
-			printf("%s", sc_normal);
+			print_fixed(val, wi, wd, sign);
+			fputs(sc_normal, stdout);
 		}
 		else {
 			cprintf_unit(unit, wi, val);
@@ -1607,33 +1932,33 @@ void cprintf_xpc(int human, int xtrem, int num, int wi, int wd, ...)
 	for (i = 0; i < num; i++) {
 		val = va_arg(args, double);
 		if ((xtrem == XHIGH) && (val >= PERCENT_LIMIT_XHIGH)) {
-			printf("%s", sc_percent_xtreme);
+			fputs(sc_percent_xtreme, stdout);
 		}
 		else if ((xtrem == XHIGH) && (val >= PERCENT_LIMIT_HIGH)) {
-			printf("%s", sc_percent_warn);
+			fputs(sc_percent_warn, stdout);
 		}
 		else if ((xtrem == XLOW) && (val <= PERCENT_LIMIT_XLOW)) {
-			printf("%s", sc_percent_xtreme);
+			fputs(sc_percent_xtreme, stdout);
 		}
 		else if ((xtrem == XLOW0) && (val <= PERCENT_LIMIT_XLOW) && (val >= lim)) {
-			printf("%s", sc_percent_xtreme);
+			fputs(sc_percent_xtreme, stdout);
 		}
 		else if ((xtrem == XLOW) && (val <= PERCENT_LIMIT_LOW)) {
-			printf("%s", sc_percent_warn);
+			fputs(sc_percent_warn, stdout);
 		}
 		else if ((xtrem == XLOW0) && (val <= PERCENT_LIMIT_LOW) && (val >= lim)) {
-			printf("%s", sc_percent_warn);
+			fputs(sc_percent_warn, stdout);
 		}
 		else if (((wd > 0) && (val < lim)) ||
 			 ((wd == 0) && (val <= 0.5))) {	/* "Round half to even" law */
-			printf("%s", sc_zero_int_stat);
+			fputs(sc_zero_int_stat, stdout);
 		}
 		else {
-			printf("%s", sc_int_stat);
+			fputs(sc_int_stat, stdout);
 		}
-		printf(" %*.*f", wi, wd, val);
-		printf("%s", sc_normal);
-		if (human > 0) printf("%%");
+		print_fixed(val, wi, wd, FALSE);
+		fputs(sc_normal, stdout);
+		if (human > 0) putchar('%');
 	}
 
 	va_end(args);
@@ -1653,14 +1978,14 @@ void cprintf_xpc(int human, int xtrem, int num, int wi, int wd, ...)
 */
 void cprintf_in(int type, char *format, char *item_string, int item_int)
 {
-	printf("%s", sc_item_name);
+	fputs(sc_item_name, stdout);
 	if (type) {
 		printf(format, item_string);
 	}
 	else {
 		printf(format, item_int);
 	}
-	printf("%s", sc_normal);
+	fputs(sc_normal, stdout);
 }
 
 /*
@@ -1676,21 +2001,21 @@ void cprintf_in(int type, char *format, char *item_string, int item_int)
 void cprintf_s(int type, char *format, char *string)
 {
 	if (type == IS_STR) {
-		printf("%s", sc_int_stat);
+		fputs(sc_int_stat, stdout);
 	}
 	else if (type == IS_ZERO) {
-		printf("%s", sc_zero_int_stat);
+		fputs(sc_zero_int_stat, stdout);
 	}
 	/* IS_RESTART and IS_DEBUG are the same value */
 	else if (type == IS_RESTART) {
-		printf("%s", sc_sa_restart);
+		fputs(sc_sa_restart, stdout);
 	}
 	else {
 		/* IS_COMMENT */
-		printf("%s", sc_sa_comment);
+		fputs(sc_sa_comment, stdout);
 	}
 	printf(format, string);
-	printf("%s", sc_normal);
+	fputs(sc_normal, stdout);
 }
 
 /*
@@ -1706,15 +2031,15 @@ void cprintf_s(int type, char *format, char *string)
 void cprintf_tr(int trend, char *format, char *tstring)
 {
 	if (trend) {
-		printf("%s", sc_trend_pos);
+		fputs(sc_trend_pos, stdout);
 	}
 	else {
-		printf("%s", sc_trend_neg);
+		fputs(sc_trend_neg, stdout);
 	}
 
 	printf(format, tstring);
 
-	printf("%s", sc_normal);
+	fputs(sc_normal, stdout);
 }
 
 /*
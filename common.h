@@ -118,6 +118,9 @@ enum {
 #define MAX_PF_NAME		1024
 #define MAX_NAME_LEN		256
 
+/* Number of buckets in the hash table used to cache device names. Must be a power of 2 */
+#define DEV_NAME_HASH_SIZE	256
+
 #define IGNORE_VIRTUAL_DEVICES	FALSE
 #define ACCEPT_VIRTUAL_DEVICES	TRUE
 #define LOCAL_TIME		FALSE
@@ -319,6 +322,23 @@ struct ext_disk_stats {
 	double arqsz;
 };
 
+/*
+ * Device name cached by get_device_name().
+ * The name depends on the device identification numbers and on
+ * the way it should be displayed (@mode). When a default name
+ * has been given, it is saved too to check that it hasn't changed.
+ */
+struct dev_name_entry {
+	unsigned long long	 wwn[2];
+	unsigned int		 major;
+	unsigned int		 minor;
+	unsigned int		 part_nr;
+	unsigned int		 mode;
+	struct dev_name_entry	*next;
+	char			*dflt_name;
+	char			 name[MAX_NAME_LEN];
+};
+
 /*
  ***************************************************************************
  * Functions prototypes
@@ -374,6 +394,11 @@ char *device_name
 	(char *);
 char *escape_bs_char
 	(const char []);
+void compute_device_name
+	(unsigned int, unsigned int, unsigned long long [], unsigned int,
+	 unsigned int, unsigned int, unsigned int, char *, char *, size_t);
+void flush_device_name_cache
+	(void);
 char *get_device_name
 	(unsigned int, unsigned int, unsigned long long [],
 	 unsigned int, unsigned int, unsigned int, unsigned int, char *);
@@ -391,8 +416,14 @@ int get_sysfs_dev_nr
 	(int);
 int get_win_height
 	(void);
+unsigned int hash_dev
+	(unsigned int, unsigned int);
+unsigned int hash_str
+	(const char *, size_t);
 void init_colors
 	(void);
+void init_output_buffer
+	(size_t);
 double ll_sp_value
 	(unsigned long long, unsigned long long, unsigned long long);
 int is_iso_time_fmt
@@ -99,6 +99,7 @@ int get_sys_cpu_nr(int highest)
  * number of online processors.
  * A value of 0 means one processor and non SMP kernel.
  * A value of N (!=0) means N processor(s) (0 .. N-1) with SMP kernel.
+ * A value of -1 means that /proc/stat cannot be opened (errno is then set).
  ***************************************************************************
  */
 int get_proc_cpu_nr(void)
@@ -107,10 +108,8 @@ int get_proc_cpu_nr(void)
 	char line[256];
 	int cpu_id, max_cpu = -1;
 
-	if ((fp = fopen(STAT, "r")) == NULL) {
-		fprintf(stderr, _("Cannot open %s: %s\n"), STAT, strerror(errno));
-		exit(1);
-	}
+	if ((fp = fopen(STAT, "r")) == NULL)
+		return -1;
 
 	while (fgets(line, sizeof(line), fp) != NULL) {
 
@@ -128,6 +127,41 @@ int get_proc_cpu_nr(void)
 	return max_cpu + 1;
 }
 
+/*
+ ***************************************************************************
+ * Count the number of processors on the machine, or look for the
+ * highest processor number. Same as get_cpu_nr() but doesn't exit on
+ * error.
+ *
+ * IN:
+ * @max_nr_cpus	Maximum number of proc that sysstat can handle.
+ * @highest	If set to TRUE, then look for the highest processor number.
+ *
+ * RETURNS:
+ * Same values as get_cpu_nr(), or -1 if /proc/stat cannot be opened
+ * (errno is then set), or -2 if there are more than @max_nr_cpus
+ * processors.
+ *
+ * USED BY:
+ * libsysstat
+ ***************************************************************************
+ */
+__nr_t __get_cpu_nr(unsigned int max_nr_cpus, int highest)
+{
+	__nr_t cpu_nr;
+
+	if ((cpu_nr = get_sys_cpu_nr(highest)) == 0) {
+		/* /sys may be not mounted. Use /proc/stat instead */
+		if ((cpu_nr = get_proc_cpu_nr()) < 0)
+			return -1;
+	}
+
+	if (cpu_nr > max_nr_cpus)
+		return -2;
+
+	return cpu_nr;
+}
+
 /*
  ***************************************************************************
  * Count the number of processors on the machine, or look for the
@@ -156,12 +190,11 @@ __nr_t get_cpu_nr(unsigned int max_nr_cpus, int highest)
 {
 	__nr_t cpu_nr;
 
-	if ((cpu_nr = get_sys_cpu_nr(highest)) == 0) {
-		/* /sys may be not mounted. Use /proc/stat instead */
-		cpu_nr = get_proc_cpu_nr();
+	if ((cpu_nr = __get_cpu_nr(max_nr_cpus, highest)) == -1) {
+		fprintf(stderr, _("Cannot open %s: %s\n"), STAT, strerror(errno));
+		exit(1);
 	}
-
-	if (cpu_nr > max_nr_cpus) {
+	if (cpu_nr == -2) {
 		fprintf(stderr, _("Cannot handle so many processors!\n"));
 		exit(1);
 	}
@@ -215,9 +248,6 @@ __nr_t get_irqcpu_nr(char *file, int max_nr_irqcpu, int cpu_nr)
 	return irq;
 }
 
-#ifdef SOURCE_SADC
-/*---------------- BEGIN: FUNCTIONS USED BY SADC ONLY ---------------------*/
-
 /*
  ***************************************************************************
  * Find number of devices and partitions available in /proc/diskstats.
@@ -270,6 +300,9 @@ __nr_t get_diskstats_dev_nr(int count_part, int only_used_dev)
 	return dev;
 }
 
+#ifdef SOURCE_SADC
+/*---------------- BEGIN: FUNCTIONS USED BY SADC ONLY ---------------------*/
+
 /*
  ***************************************************************************
  * Find number of serial lines that support tx/rx accounting
@@ -15,6 +15,8 @@
  ***************************************************************************
  */
 
+__nr_t __get_cpu_nr
+	(unsigned int, int);
 __nr_t get_cpu_nr
 	(unsigned int, int);
 __nr_t get_irqcpu_nr
@@ -60,6 +60,15 @@ struct stats_cpu *st_cpu[2];
 unsigned long long uptime_cs[2] = {0, 0};
 unsigned long long tot_jiffies[2] = {0, 0};
 struct io_device *dev_list = NULL;
+/* Last element of the list (pointer on its next field) */
+struct io_device **dev_list_end = &dev_list;
+/* Devices from the list indexed by name and by major:minor numbers */
+struct io_device *dev_name_htab[DEV_HASH_SIZE];
+struct io_device *dev_nr_htab[DEV_HASH_SIZE];
+
+/* Index of /proc/diskstats entries (see read_diskstats_dlist_stat()) */
+struct diskstats_entry *ds_htab[DISKSTATS_HASH_SIZE];
+int ds_indexed = FALSE;
 
 /* Number of decimal places */
 int dplaces_nr = -1;
@@ -91,15 +100,15 @@ void usage(char *progname)
 	fprintf(stderr, _("Options are:\n"
 			  "[ -c ] [ -d ] [ -h ] [ -k | -m ] [ -N ] [ -s ] [ -t ] [ -U ] [ -V ] [ -x ] [ -y ] [ -z ]\n"
 			  "[ { -f | +f } <directory> ] [ -j { ID | LABEL | PATH | UUID | ... } ]\n"
-			  "[ --compact ] [ --dec={ 0 | 1 | 2 } ] [ --human ] [ --pretty ] [ -o JSON ]\n"
-			  "[ [ -H ] -g <group_name> ] [ -p [ <device> [,...] | ALL ] ]\n"
+			  "[ --compact ] [ --dec={ 0 | 1 | 2 } ] [ --diskstats ] [ --human ] [ --pretty ]\n"
+			  "[ -o JSON ] [ [ -H ] -g <group_name> ] [ -p [ <device> [,...] | ALL ] ]\n"
 			  "[ <device> [...] | ALL ] [ --debuginfo ]\n"));
 #else
 	fprintf(stderr, _("Options are:\n"
 			  "[ -c ] [ -d ] [ -h ] [ -k | -m ] [ -N ] [ -s ] [ -t ] [ -U ] [ -V ] [ -x ] [ -y ] [ -z ]\n"
 			  "[ { -f | +f } <directory> ] [ -j { ID | LABEL | PATH | UUID | ... } ]\n"
-			  "[ --compact ] [ --dec={ 0 | 1 | 2 } ] [ --human ] [ --pretty ] [ -o JSON ]\n"
-			  "[ [ -H ] -g <group_name> ] [ -p [ <device> [,...] | ALL ] ]\n"
+			  "[ --compact ] [ --dec={ 0 | 1 | 2 } ] [ --diskstats ] [ --human ] [ --pretty ]\n"
+			  "[ -o JSON ] [ [ -H ] -g <group_name> ] [ -p [ <device> [,...] | ALL ] ]\n"
 			  "[ <device> [...] | ALL ]\n"));
 #endif
 	exit(1);
@@ -263,13 +272,76 @@ int get_major_minor_nr(char filename[], int *major, int *minor)
 	return 0;
 }
 
+/*
+ ***************************************************************************
+ * Compute the bucket of a device name in the hash table of devices.
+ *
+ * IN:
+ * @name	Device name.
+ *
+ * RETURNS:
+ * Bucket number.
+ ***************************************************************************
+ */
+unsigned int hash_dev_name(char *name)
+{
+	return hash_str(name, strlen(name)) & (DEV_HASH_SIZE - 1);
+}
+
+/*
+ ***************************************************************************
+ * Look for a device (or a group) in the list using its name.
+ *
+ * IN:
+ * @name	Device name.
+ *
+ * RETURNS:
+ * Pointer on the io_device structure, or NULL if not found.
+ ***************************************************************************
+ */
+struct io_device *lookup_device_by_name(char *name)
+{
+	struct io_device *d;
+
+	for (d = dev_name_htab[hash_dev_name(name)]; d != NULL; d = d->hnext) {
+		if (!strcmp(d->name, name))
+			return d;
+	}
+
+	return NULL;
+}
+
+/*
+ ***************************************************************************
+ * Look for a device in the list using its major and minor numbers.
+ *
+ * IN:
+ * @major	Major number of the device.
+ * @minor	Minor number of the device.
+ *
+ * RETURNS:
+ * Pointer on the io_device structure, or NULL if not found.
+ ***************************************************************************
+ */
+struct io_device *lookup_device_by_nr(int major, int minor)
+{
+	struct io_device *d;
+
+	for (d = dev_nr_htab[hash_dev(major, minor) & (DEV_HASH_SIZE - 1)]; d != NULL; d = d->mnext) {
+		if ((d->major == major) && (d->minor == minor))
+			return d;
+	}
+
+	return NULL;
+}
+
 /*
  ***************************************************************************
  * Check if a device is present in the list, and add it if requested.
  * Also look for its type (device or partition) and save it.
  *
  * IN:
- * @dlist	Address of pointer on the start of the linked list.
+ * @dlist	Address of pointer on the start of the linked list (&dev_list).
  * @name	Device name.
  * @dtype	T_PART_DEV (=2) if the device and all its partitions should
  *		also be read (option -p used), T_GROUP (=3) if it's a group
@@ -296,30 +368,31 @@ struct io_device *add_list_device(struct io_device **dlist, char *name, int dtyp
 		/* Device name is too long */
 		return NULL;
 
-	while (*dlist != NULL) {
-
-		d = *dlist;
-		if ((i = strcmp(d->name, name)) == 0) {
-			/* Device found in list */
-			if ((dtype == T_PART_DEV) && (d->dev_tp == T_DEV)) {
-				d->dev_tp = dtype;
-			}
-			d->exist = TRUE;
-			return d;
+	if ((d = lookup_device_by_name(name)) != NULL) {
+		/* Device found in list */
+		if ((dtype == T_PART_DEV) && (d->dev_tp == T_DEV)) {
+			d->dev_tp = dtype;
 		}
-		if (!GROUP_DEFINED(flags) && !DISPLAY_EVERYTHING(flags) && (i > 0))
-			/*
-			 * If no group defined and we don't use /proc/diskstats,
-			 * insert current device in alphabetical order.
-			 * NB: Using /proc/diskstats ("iostat -p ALL") is a bit better than
-			 * using alphabetical order because sda10 comes after sda9...
-			 */
-			break;
-
-		dlist = &(d->next);
+		d->exist = TRUE;
+		return d;
 	}
 
 	/* Device not found */
+	if (GROUP_DEFINED(flags) || DISPLAY_EVERYTHING(flags)) {
+		/* Add device at the end of the list */
+		dlist = dev_list_end;
+	}
+	else {
+		/*
+		 * If no group defined and we don't use /proc/diskstats,
+		 * insert current device in alphabetical order.
+		 * NB: Using /proc/diskstats ("iostat -p ALL") is a bit better than
+		 * using alphabetical order because sda10 comes after sda9...
+		 */
+		while ((*dlist != NULL) && (strcmp((*dlist)->name, name) < 0)) {
+			dlist = &((*dlist)->next);
+		}
+	}
 	ds = *dlist;
 
 	/* Add device to the list */
@@ -358,6 +431,14 @@ struct io_device *add_list_device(struct io_device **dlist, char *name, int dtyp
 	}
 	d->exist = TRUE;
 	d->next = ds;
+	if (ds == NULL) {
+		dev_list_end = &(d->next);
+	}
+
+	/* Index device by name */
+	i = hash_dev_name(d->name);
+	d->hnext = dev_name_htab[i];
+	dev_name_htab[i] = d;
 
 	if (dtype == T_GROUP) {
 		d->dev_tp = dtype;
@@ -393,6 +474,17 @@ struct io_device *add_list_device(struct io_device **dlist, char *name, int dtyp
 				d->minor = min_nr;
 			}
 		}
+
+		/* Index device by major and minor numbers */
+		i = hash_dev(d->major, d->minor) & (DEV_HASH_SIZE - 1);
+		d->mnext = dev_nr_htab[i];
+		dev_nr_htab[i] = d;
+
+		/*
+		 * A new device has appeared: Its major and minor numbers may
+		 * have belonged to another device whose name is still cached.
+		 */
+		flush_device_name_cache();
 	}
 
 	return d;
@@ -780,6 +872,81 @@ void read_sysfs_dlist_stat(int curr)
 	}
 }
 
+/*
+ ***************************************************************************
+ * Parse the statistics of a device from a line of the diskstats file.
+ *
+ * IN:
+ * @line	Line read from diskstats file, starting with the number of
+ *		reads completed (i.e. after the major and minor numbers and
+ *		the name of the device).
+ *
+ * OUT:
+ * @sdev	Structure where stats have been saved.
+ *
+ * RETURNS:
+ * 1 if extended statistics have been read, 0 if this is a partition
+ * without extended statistics, and -1 if the line couldn't be parsed.
+ ***************************************************************************
+ */
+int parse_diskstats_line(char *line, struct io_stats *sdev)
+{
+	int i;
+	unsigned int ios_pgr, tot_ticks, rq_ticks, wr_ticks, dc_ticks, fl_ticks;
+	unsigned long rd_ios, rd_merges_or_rd_sec, rd_ticks_or_wr_sec, wr_ios;
+	unsigned long wr_merges, rd_sec_or_wr_ios, wr_sec;
+	unsigned long dc_ios, dc_merges, dc_sec, fl_ios;
+
+	memset(sdev, 0, sizeof(struct io_stats));
+
+	/* rio rmerge rsect ruse wio wmerge wsect wuse running use aveq dcio dcmerge dcsect dcuse flio fltm */
+	i = sscanf(line, "%lu %lu %lu %lu %lu %lu %lu %u %u %u %u %lu %lu %lu %u %lu %u",
+		   &rd_ios, &rd_merges_or_rd_sec, &rd_sec_or_wr_ios, &rd_ticks_or_wr_sec,
+		   &wr_ios, &wr_merges, &wr_sec, &wr_ticks, &ios_pgr, &tot_ticks, &rq_ticks,
+		   &dc_ios, &dc_merges, &dc_sec, &dc_ticks,
+		   &fl_ios, &fl_ticks);
+
+	if (i >= 11) {
+		sdev->rd_ios     = rd_ios;
+		sdev->rd_merges  = rd_merges_or_rd_sec;
+		sdev->rd_sectors = rd_sec_or_wr_ios;
+		sdev->rd_ticks   = (unsigned int) rd_ticks_or_wr_sec;
+		sdev->wr_ios     = wr_ios;
+		sdev->wr_merges  = wr_merges;
+		sdev->wr_sectors = wr_sec;
+		sdev->wr_ticks   = wr_ticks;
+		sdev->ios_pgr    = ios_pgr;
+		sdev->tot_ticks  = tot_ticks;
+		sdev->rq_ticks   = rq_ticks;
+
+		if (i >= 15) {
+			/* Discard I/O */
+			sdev->dc_ios     = dc_ios;
+			sdev->dc_merges  = dc_merges;
+			sdev->dc_sectors = dc_sec;
+			sdev->dc_ticks   = dc_ticks;
+		}
+
+		if (i >= 17) {
+			/* Flush I/O */
+			sdev->fl_ios     = fl_ios;
+			sdev->fl_ticks   = fl_ticks;
+		}
+		return 1;
+	}
+	else if (i == 4) {
+		/* Partition without extended statistics */
+		sdev->rd_ios     = rd_ios;
+		sdev->rd_sectors = rd_merges_or_rd_sec;
+		sdev->wr_ios     = rd_sec_or_wr_ios;
+		sdev->wr_sectors = rd_ticks_or_wr_sec;
+		return 0;
+	}
+
+	/* Unknown entry */
+	return -1;
+}
+
 /*
  ***************************************************************************
  * Read stats from the diskstats file. Only used when "-p ALL" has been
@@ -793,76 +960,31 @@ void read_sysfs_dlist_stat(int curr)
 void read_diskstats_stat_work(int curr, char *diskstats)
 {
 	FILE *fp;
-	char line[1024], dev_name[MAX_NAME_LEN], aux[128];
+	char line[1024], dev_name[MAX_NAME_LEN], aux[32];
 	struct io_device *d;
 	struct io_stats sdev;
-	int i;
-	unsigned int ios_pgr, tot_ticks, rq_ticks, wr_ticks, dc_ticks, fl_ticks;
-	unsigned long rd_ios, rd_merges_or_rd_sec, rd_ticks_or_wr_sec, wr_ios;
-	unsigned long wr_merges, rd_sec_or_wr_ios, wr_sec;
-	unsigned long dc_ios, dc_merges, dc_sec, fl_ios;
 	unsigned int major, minor;
+	int pos, rc;
 
 	if ((fp = fopen(diskstats, "r")) == NULL)
 		return;
 
-	sprintf(aux, "%%u %%u %%%ds %%lu %%lu %%lu %%lu %%lu %%lu "
-		     "%%lu %%u %%u %%u %%u %%lu %%lu %%lu %%u %%lu %%u",
-		     MAX_NAME_LEN - 1);
+	sprintf(aux, "%%u %%u %%%ds %%n", MAX_NAME_LEN - 1);
 
 	while (fgets(line, sizeof(line), fp) != NULL) {
 
-		memset(&sdev, 0, sizeof(struct io_stats));
-
-		/* major minor name rio rmerge rsect ruse wio wmerge wsect wuse running use aveq dcio dcmerge dcsect dcuse flio fltm */
-		i = sscanf(line, aux,
-			   &major, &minor, dev_name,
-			   &rd_ios, &rd_merges_or_rd_sec, &rd_sec_or_wr_ios, &rd_ticks_or_wr_sec,
-			   &wr_ios, &wr_merges, &wr_sec, &wr_ticks, &ios_pgr, &tot_ticks, &rq_ticks,
-			   &dc_ios, &dc_merges, &dc_sec, &dc_ticks,
-			   &fl_ios, &fl_ticks);
-
-		if (i >= 14) {
-			sdev.rd_ios     = rd_ios;
-			sdev.rd_merges  = rd_merges_or_rd_sec;
-			sdev.rd_sectors = rd_sec_or_wr_ios;
-			sdev.rd_ticks   = (unsigned int) rd_ticks_or_wr_sec;
-			sdev.wr_ios     = wr_ios;
-			sdev.wr_merges  = wr_merges;
-			sdev.wr_sectors = wr_sec;
-			sdev.wr_ticks   = wr_ticks;
-			sdev.ios_pgr    = ios_pgr;
-			sdev.tot_ticks  = tot_ticks;
-			sdev.rq_ticks   = rq_ticks;
-
-			if (i >= 18) {
-				/* Discard I/O */
-				sdev.dc_ios     = dc_ios;
-				sdev.dc_merges  = dc_merges;
-				sdev.dc_sectors = dc_sec;
-				sdev.dc_ticks   = dc_ticks;
-			}
-
-			if (i >= 20) {
-				/* Flush I/O */
-				sdev.fl_ios     = fl_ios;
-				sdev.fl_ticks   = fl_ticks;
-			}
-		}
-		else if (i == 7) {
-			/* Partition without extended statistics */
-			if (DISPLAY_EXTENDED(flags))
-				continue;
+		/* major minor name */
+		if (sscanf(line, aux, &major, &minor, dev_name, &pos) < 3)
+			continue;
 
-			sdev.rd_ios     = rd_ios;
-			sdev.rd_sectors = rd_merges_or_rd_sec;
-			sdev.wr_ios     = rd_sec_or_wr_ios;
-			sdev.wr_sectors = rd_ticks_or_wr_sec;
-		}
-		else
+		if ((rc = parse_diskstats_line(line + pos, &sdev)) < 0)
 			/* Unknown entry: Ignore it */
 			continue;
 
+		if (!rc && DISPLAY_EXTENDED(flags))
+			/* Partition without extended statistics */
+			continue;
+
 		d = add_list_device(&dev_list, dev_name, 0, major, minor);
 		if (d != NULL) {
 			*d->dev_stats[curr] = sdev;
@@ -896,6 +1018,190 @@ void read_diskstats_stat(int curr)
 	}
 }
 
+/*
+ ***************************************************************************
+ * Free the index of /proc/diskstats entries.
+ ***************************************************************************
+ */
+void free_diskstats_index(void)
+{
+	struct diskstats_entry *e, *en;
+	int i;
+
+	for (i = 0; i < DISKSTATS_HASH_SIZE; i++) {
+		for (e = ds_htab[i]; e != NULL; e = en) {
+			en = e->next;
+			free(e->name);
+			free(e);
+		}
+		ds_htab[i] = NULL;
+	}
+	ds_indexed = FALSE;
+}
+
+/*
+ ***************************************************************************
+ * Look for a device in the index of /proc/diskstats entries.
+ *
+ * IN:
+ * @major	Major number of the device.
+ * @minor	Minor number of the device.
+ *
+ * RETURNS:
+ * Pointer on the entry, or NULL if the device is not in the index.
+ ***************************************************************************
+ */
+struct diskstats_entry *lookup_diskstats_entry(unsigned int major, unsigned int minor)
+{
+	struct diskstats_entry *e;
+
+	for (e = ds_htab[hash_dev(major, minor) & (DISKSTATS_HASH_SIZE - 1)]; e != NULL; e = e->next) {
+		if ((e->major == major) && (e->minor == minor))
+			return e;
+	}
+
+	return NULL;
+}
+
+/*
+ ***************************************************************************
+ * Index every entry from /proc/diskstats by its major and minor numbers,
+ * and link it to the corresponding device in the list of devices to
+ * display, if any. Called each time the list of devices has changed.
+ ***************************************************************************
+ */
+void index_diskstats(void)
+{
+	FILE *fp;
+	char line[1024], dev_name[MAX_NAME_LEN], aux[32];
+	struct diskstats_entry *e;
+	struct io_device *d;
+	unsigned int major, minor, h;
+
+	free_diskstats_index();
+
+	if ((fp = fopen(DISKSTATS, "r")) == NULL)
+		return;
+
+	sprintf(aux, "%%u %%u %%%ds", MAX_NAME_LEN - 1);
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+
+		if ((sscanf(line, aux, &major, &minor, dev_name) < 3) ||
+		    lookup_diskstats_entry(major, minor))
+			continue;
+
+		/* Look for the device in the list, by name or else by major and minor numbers */
+		d = lookup_device_by_name(dev_name);
+		if ((d == NULL) || (d->dev_tp >= T_GROUP)) {
+			d = (major != UKWN_MAJ_NR) ? lookup_device_by_nr(major, minor) : NULL;
+		}
+
+		if ((e = (struct diskstats_entry *) malloc(sizeof(struct diskstats_entry))) == NULL) {
+			perror("malloc");
+			exit(4);
+		}
+		if ((e->name = strdup(dev_name)) == NULL) {
+			perror("strdup");
+			exit(4);
+		}
+		e->major = major;
+		e->minor = minor;
+		e->dev = d;
+
+		h = hash_dev(major, minor) & (DISKSTATS_HASH_SIZE - 1);
+		e->next = ds_htab[h];
+		ds_htab[h] = e;
+	}
+	fclose(fp);
+
+	ds_indexed = TRUE;
+}
+
+/*
+ ***************************************************************************
+ * Read stats for the devices entered on the command line from a single
+ * read of /proc/diskstats, instead of reading one sysfs file per device.
+ * Devices are found using the index of /proc/diskstats entries.
+ *
+ * IN:
+ * @curr	Index in array for current sample statistics.
+ *
+ * RETURNS:
+ * 0 on success, and -1 if the index needs to be updated because a
+ * device has appeared or has been replaced with another one.
+ ***************************************************************************
+ */
+int read_diskstats_dlist_stat(int curr)
+{
+	FILE *fp;
+	char line[1024], dev_name[MAX_NAME_LEN], aux[32];
+	struct diskstats_entry *e;
+	struct io_stats sdev;
+	unsigned int major, minor;
+	int pos, rc = 0;
+
+	if (!ds_indexed)
+		return -1;
+
+	if ((fp = fopen(DISKSTATS, "r")) == NULL)
+		return -1;
+
+	sprintf(aux, "%%u %%u %%%ds %%n", MAX_NAME_LEN - 1);
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+
+		/* major minor name */
+		if (sscanf(line, aux, &major, &minor, dev_name, &pos) < 3)
+			continue;
+
+		if (((e = lookup_diskstats_entry(major, minor)) == NULL) ||
+		    strcmp(e->name, dev_name)) {
+			/* New device */
+			rc = -1;
+			break;
+		}
+
+		if ((e->dev == NULL) || e->dev->exist)
+			/* Device not to be displayed, or stats already read */
+			continue;
+
+		if (parse_diskstats_line(line + pos, &sdev) < 0)
+			continue;
+
+		*(e->dev->dev_stats[curr]) = sdev;
+		e->dev->exist = TRUE;
+	}
+	fclose(fp);
+
+	return rc;
+}
+
+/*
+ ***************************************************************************
+ * Read stats for the devices entered on the command line.
+ * With option --diskstats, /proc/diskstats is used whenever possible.
+ * sysfs is then still used to find out devices types and partitions,
+ * but only when the list of devices in /proc/diskstats has changed.
+ *
+ * IN:
+ * @curr	Index in array for current sample statistics.
+ ***************************************************************************
+ */
+void read_dlist_stat(int curr)
+{
+	if (!USE_DISKSTATS(flags) || alt_dir[0]) {
+		/* NB: No diskstats file corresponds to an alternate sysfs location */
+		read_sysfs_dlist_stat(curr);
+		return;
+	}
+
+	if (read_diskstats_dlist_stat(curr) < 0) {
+		read_sysfs_dlist_stat(curr);
+		index_diskstats();
+	}
+}
+
 /*
  ***************************************************************************
  * Add current device statistics to corresponding group.
@@ -2007,7 +2313,7 @@ void rw_io_stat_loop(long int count, struct tm *rectime)
 			read_diskstats_stat(curr);
 		}
 		else {
-			read_sysfs_dlist_stat(curr);
+			read_dlist_stat(curr);
 		}
 
 		/* Get time */
@@ -2024,6 +2330,7 @@ void rw_io_stat_loop(long int count, struct tm *rectime)
 
 		if (count) {
 			curr ^= 1;
+			fflush(stdout);
 			__pause();
 
 			if (sigint_caught) {
@@ -2134,6 +2441,12 @@ int main(int argc, char **argv)
 			opt++;
 		}
 
+		else if (!strcmp(argv[opt], "--diskstats")) {
+			/* Read stats for all the devices from /proc/diskstats */
+			flags |= I_F_DISKSTATS;
+			opt++;
+		}
+
 #ifdef TEST
 		else if (!strncmp(argv[opt], "--getenv", 8)) {
 			__env = TRUE;
@@ -2400,11 +2713,12 @@ int main(int argc, char **argv)
 	get_xtime(&rectime, 0, LOCAL_TIME);
 
 	/*
-	 * Don't buffer data if redirected to a pipe.
-	 * Note: With musl-c, the behavior of this function is undefined except
-	 * when it is the first operation on the stream.
+	 * Buffer each report so that it can be written with a single write()
+	 * system call. stdout is flushed after each report, so that data are
+	 * still not kept in the buffer if redirected to a pipe.
 	 */
-	setbuf(stdout, NULL);
+	init_output_buffer((size_t) (get_diskstats_dev_nr(CNT_PART, CNT_ALL_DEV) + IO_REPORT_XLINES) *
+			   IO_REPORT_LINE_LEN);
 
 	/* Get system name, release number and hostname */
 	__uname(&header);
@@ -16,7 +16,7 @@
 #define I_D_EVERYTHING		0x000010
 #define I_D_KILOBYTES		0x000020
 #define I_D_ALL_DIR		0x000040
-/* Unused			0x000080 */
+#define I_F_DISKSTATS		0x000080
 #define I_D_UNFILTERED		0x000100
 #define I_D_MEGABYTES		0x000200
 #define I_D_ALL_DEVICES		0x000400
@@ -53,6 +53,7 @@
 #define DISPLAY_SHORT_OUTPUT(m)		(((m) & I_D_SHORT_OUTPUT)     == I_D_SHORT_OUTPUT)
 #define USE_ALL_DIR(m)			(((m) & I_D_ALL_DIR)          == I_D_ALL_DIR)
 #define DISPLAY_COMPACT(m)		(((m) & I_D_COMPACT)          == I_D_COMPACT)
+#define USE_DISKSTATS(m)		(((m) & I_F_DISKSTATS)        == I_F_DISKSTATS)
 
 enum {
 	T_PART		= 0,
@@ -63,6 +64,25 @@ enum {
 
 #define UKWN_MAJ_NR	0
 
+/*
+ * Number of buckets in the hash table used to look up devices
+ * by their major and minor numbers in /proc/diskstats. Must be a power of 2.
+ */
+#define DISKSTATS_HASH_SIZE	1024
+
+/*
+ * Number of buckets in the hash tables used to look up devices in the
+ * list by name and by major and minor numbers. Must be a power of 2.
+ */
+#define DEV_HASH_SIZE		1024
+
+/*
+ * Size of the output buffer for one report: Estimated length of the line
+ * displayed for each device, and number of extra lines (headers, groups...).
+ */
+#define IO_REPORT_LINE_LEN	512
+#define IO_REPORT_XLINES	16
+
 /* Environment variable */
 #define ENV_POSIXLY_CORRECT	"POSIXLY_CORRECT"
 
@@ -125,6 +145,22 @@ struct io_device {
 	int minor;
 	struct io_stats *dev_stats[2];
 	struct io_device *next;
+	/* Next devices in the hash tables indexed by name and by major:minor numbers */
+	struct io_device *hnext;
+	struct io_device *mnext;
+};
+
+/*
+ * Entry of /proc/diskstats, indexed by its major and minor numbers.
+ * @dev is the corresponding device in the list of devices to display,
+ * or NULL if the device or partition is not to be displayed.
+ */
+struct diskstats_entry {
+	unsigned int major;
+	unsigned int minor;
+	char *name;
+	struct io_device *dev;
+	struct diskstats_entry *next;
 };
 
 struct ext_io_stats {
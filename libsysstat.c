@@ -0,0 +1,549 @@
+/*
+ * libsysstat.c: In-process system statistics library
+ * (C) 1999-2025 by Sebastien GODARD (sysstat <at> orange.fr)
+ *
+ ***************************************************************************
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published  by  the *
+ * Free Software Foundation; either version 2 of the License, or (at  your *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it  will  be  useful,  but *
+ * WITHOUT ANY WARRANTY; without the implied warranty  of  MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License *
+ * for more details.                                                       *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335 USA              *
+ ***************************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "libsysstat.h"
+#include "common.h"
+#include "rd_stats.h"
+#include "count.h"
+
+/* Maximum number of items that can be handled, as for sadc */
+#define LIB_MAX_NR_DISKS	(65536 * 4096)
+#define LIB_MAX_NR_IFACES	65536
+
+/*
+ * Public structures declared in libsysstat.h must have the same layout as
+ * the structures filled by the functions of rd_stats.c. Compilation fails
+ * here if their sizes differ.
+ */
+#define LIB_CHECK_SIZE(pub, priv)	\
+	typedef char pub##_check[(sizeof(struct pub) == sizeof(struct priv)) ? 1 : -1]
+
+LIB_CHECK_SIZE(sysstat_cpu, stats_cpu);
+LIB_CHECK_SIZE(sysstat_pcsw, stats_pcsw);
+LIB_CHECK_SIZE(sysstat_queue, stats_queue);
+LIB_CHECK_SIZE(sysstat_memory, stats_memory);
+LIB_CHECK_SIZE(sysstat_swap, stats_swap);
+LIB_CHECK_SIZE(sysstat_paging, stats_paging);
+LIB_CHECK_SIZE(sysstat_io, stats_io);
+LIB_CHECK_SIZE(sysstat_disk, stats_disk);
+LIB_CHECK_SIZE(sysstat_net_dev, stats_net_dev);
+typedef char sysstat_defs_check[((SYSSTAT_IFACE_LEN == MAX_IFACE_LEN) &&
+				 (SYSSTAT_DUPLEX_FULL == C_DUPLEX_FULL)) ? 1 : -1];
+
+/*
+ ***************************************************************************
+ * Same as ll_sp_value() in common.c, which is not part of the light
+ * version of the common functions linked with this library: Counters
+ * may go backward (e.g. CPU counters with dyn-tick kernels).
+ ***************************************************************************
+ */
+static double lib_sp_value(unsigned long long value1, unsigned long long value2,
+			   unsigned long long itv)
+{
+	if (value2 < value1)
+		return (double) 0;
+	else
+		return SP_VALUE(value1, value2, itv);
+}
+
+/*
+ ***************************************************************************
+ * Count items (CPU, block devices, network interfaces) for which
+ * statistics can be collected. Called again by the collection functions
+ * when the buffer they have been given is too small.
+ *
+ * IN:
+ * @ctx		Library context.
+ *
+ * OUT:
+ * @ctx		Library context with updated item numbers.
+ *
+ * RETURNS:
+ * 0 on success, -1 otherwise (errno is then set).
+ ***************************************************************************
+ */
+int sysstat_count(struct sysstat_ctx *ctx)
+{
+	__nr_t n;
+
+	if ((n = __get_cpu_nr(NR_CPUS, FALSE)) < 0) {
+		if (n == -2) {
+			/* Too many processors */
+			errno = ERANGE;
+		}
+		return -1;
+	}
+	ctx->cpu_nr = n + 1;
+
+	n = get_disk_nr(TRUE);
+	ctx->disk_nr = (n > LIB_MAX_NR_DISKS) ? LIB_MAX_NR_DISKS : n;
+
+	n = get_iface_nr();
+	ctx->iface_nr = (n > LIB_MAX_NR_IFACES) ? LIB_MAX_NR_IFACES : n;
+
+	return 0;
+}
+
+/*
+ ***************************************************************************
+ * Initialize a library context. No global variable is used: Each caller
+ * may own as many contexts as needed.
+ *
+ * OUT:
+ * @ctx		Library context.
+ *
+ * RETURNS:
+ * 0 on success, -1 otherwise (errno is then set).
+ ***************************************************************************
+ */
+int sysstat_init(struct sysstat_ctx *ctx)
+{
+	memset(ctx, 0, sizeof(struct sysstat_ctx));
+
+	return sysstat_count(ctx);
+}
+
+/*
+ ***************************************************************************
+ * Read machine uptime, independently of the number of processors.
+ *
+ * OUT:
+ * @uptime	Uptime value in hundredths of a second.
+ *
+ * RETURNS:
+ * 0 on success, -1 otherwise.
+ ***************************************************************************
+ */
+int sysstat_read_uptime(unsigned long long *uptime)
+{
+	return __read_uptime(uptime);
+}
+
+/*
+ ***************************************************************************
+ * Read CPU statistics.
+ *
+ * IN:
+ * @ctx		Library context.
+ * @st_cpu	Buffer where statistics will be saved (CPU "all" first,
+ *		then CPU 0, CPU 1, etc.).
+ * @nr_alloc	Total number of structures allocated. Value is >= 1.
+ *
+ * OUT:
+ * @st_cpu	Buffer with statistics.
+ * @ctx		Library context with updated item numbers if the buffer
+ *		was too small.
+ *
+ * RETURNS:
+ * Highest CPU number + 2 for which statistics have been read, -1 if the
+ * buffer was too small, or -2 if /proc/stat cannot be opened (errno is
+ * then set).
+ ***************************************************************************
+ */
+int sysstat_read_cpu(struct sysstat_ctx *ctx, struct sysstat_cpu *st_cpu, int nr_alloc)
+{
+	__nr_t nr_read;
+
+	if ((nr_read = __read_stat_cpu((struct stats_cpu *) st_cpu, nr_alloc)) == -1) {
+		sysstat_count(ctx);
+	}
+
+	return nr_read;
+}
+
+/*
+ ***************************************************************************
+ * Read task creation and context switch statistics.
+ *
+ * IN:
+ * @st_pcsw	Structure where stats will be saved.
+ *
+ * OUT:
+ * @st_pcsw	Structure with statistics.
+ *
+ * RETURNS:
+ * 1 on success, 0 otherwise.
+ ***************************************************************************
+ */
+int sysstat_read_pcsw(struct sysstat_pcsw *st_pcsw)
+{
+	return read_stat_pcsw((struct stats_pcsw *) st_pcsw);
+}
+
+/*
+ ***************************************************************************
+ * Read queue and load statistics.
+ *
+ * IN:
+ * @st_queue	Structure where stats will be saved.
+ *
+ * OUT:
+ * @st_queue	Structure with statistics.
+ *
+ * RETURNS:
+ * 1 on success, 0 otherwise.
+ ***************************************************************************
+ */
+int sysstat_read_queue(struct sysstat_queue *st_queue)
+{
+	return read_loadavg((struct stats_queue *) st_queue);
+}
+
+/*
+ ***************************************************************************
+ * Read memory statistics.
+ *
+ * IN:
+ * @st_memory	Structure where stats will be saved.
+ *
+ * OUT:
+ * @st_memory	Structure with statistics.
+ *
+ * RETURNS:
+ * 1 on success, 0 otherwise.
+ ***************************************************************************
+ */
+int sysstat_read_memory(struct sysstat_memory *st_memory)
+{
+	return read_meminfo((struct stats_memory *) st_memory);
+}
+
+/*
+ ***************************************************************************
+ * Read swapping statistics.
+ *
+ * IN:
+ * @st_swap	Structure where stats will be saved.
+ *
+ * OUT:
+ * @st_swap	Structure with statistics.
+ *
+ * RETURNS:
+ * 1 on success, 0 otherwise.
+ ***************************************************************************
+ */
+int sysstat_read_swap(struct sysstat_swap *st_swap)
+{
+	return read_vmstat_swap((struct stats_swap *) st_swap);
+}
+
+/*
+ ***************************************************************************
+ * Read paging statistics.
+ *
+ * IN:
+ * @st_paging	Structure where stats will be saved.
+ *
+ * OUT:
+ * @st_paging	Structure with statistics.
+ *
+ * RETURNS:
+ * 1 on success, 0 otherwise.
+ ***************************************************************************
+ */
+int sysstat_read_paging(struct sysstat_paging *st_paging)
+{
+	return read_vmstat_paging((struct stats_paging *) st_paging);
+}
+
+/*
+ ***************************************************************************
+ * Read global I/O and transfer rate statistics.
+ *
+ * IN:
+ * @st_io	Structure where stats will be saved.
+ *
+ * OUT:
+ * @st_io	Structure with statistics.
+ *
+ * RETURNS:
+ * 1 on success, 0 otherwise.
+ ***************************************************************************
+ */
+int sysstat_read_io(struct sysstat_io *st_io)
+{
+	return read_diskstats_io((struct stats_io *) st_io);
+}
+
+/*
+ ***************************************************************************
+ * Read block devices statistics.
+ *
+ * IN:
+ * @ctx		Library context.
+ * @st_disk	Buffer where stats will be saved.
+ * @nr_alloc	Total number of structures allocated. Value is >= 1.
+ * @read_part	True if disks *and* partitions should be read; False if only
+ *		disks are read.
+ *
+ * OUT:
+ * @st_disk	Buffer with statistics.
+ *
+ * @ctx		Library context with updated item numbers if the buffer
+ *		was too small.
+ *
+ * RETURNS:
+ * Number of block devices read, or -1 if the buffer was too small.
+ ***************************************************************************
+ */
+int sysstat_read_disk(struct sysstat_ctx *ctx, struct sysstat_disk *st_disk,
+		      int nr_alloc, int read_part)
+{
+	__nr_t nr_read;
+
+	if ((nr_read = read_diskstats_disk((struct stats_disk *) st_disk,
+					   nr_alloc, read_part)) < 0) {
+		sysstat_count(ctx);
+	}
+
+	return nr_read;
+}
+
+/*
+ ***************************************************************************
+ * Read network interfaces statistics, including speed and duplex
+ * information needed to compute interface utilization.
+ *
+ * IN:
+ * @ctx		Library context.
+ * @st_net_dev	Buffer where stats will be saved.
+ * @nr_alloc	Total number of structures allocated. Value is >= 1.
+ *
+ * OUT:
+ * @st_net_dev	Buffer with statistics.
+ *
+ * @ctx		Library context with updated item numbers if the buffer
+ *		was too small.
+ *
+ * RETURNS:
+ * Number of interfaces read, or -1 if the buffer was too small.
+ ***************************************************************************
+ */
+int sysstat_read_net_dev(struct sysstat_ctx *ctx, struct sysstat_net_dev *st_net_dev,
+			 int nr_alloc)
+{
+	struct stats_net_dev *st = (struct stats_net_dev *) st_net_dev;
+	__nr_t nr_read;
+
+	if ((nr_read = read_net_dev(st, nr_alloc)) > 0) {
+		read_if_info(st, nr_read);
+	}
+	else if (nr_read < 0) {
+		sysstat_count(ctx);
+	}
+
+	return nr_read;
+}
+
+/*
+ ***************************************************************************
+ * Compute time interval between two uptime values.
+ *
+ * IN:
+ * @prev_uptime	Previous uptime value (in 1/100th of a second).
+ * @curr_uptime	Current uptime value (in 1/100th of a second).
+ *
+ * RETURNS:
+ * Interval of time in 1/100th of a second (never 0).
+ ***************************************************************************
+ */
+unsigned long long sysstat_interval(unsigned long long prev_uptime,
+				    unsigned long long curr_uptime)
+{
+	unsigned long long itv;
+
+	itv = curr_uptime - prev_uptime;
+
+	if (!itv) {	/* Paranoia checking */
+		itv = 1;
+	}
+
+	return itv;
+}
+
+/*
+ ***************************************************************************
+ * Compute a per second rate from two counter values.
+ *
+ * IN:
+ * @prev	Previous counter value.
+ * @curr	Current counter value.
+ * @itv		Interval of time in 1/100th of a second.
+ *
+ * RETURNS:
+ * Rate per second, or 0 if the counter went backward.
+ ***************************************************************************
+ */
+double sysstat_rate(unsigned long long prev, unsigned long long curr,
+		    unsigned long long itv)
+{
+	return lib_sp_value(prev, curr, itv);
+}
+
+/*
+ ***************************************************************************
+ * Compute CPU utilization for one CPU (or CPU "all") the same way
+ * sar -u ALL does.
+ *
+ * IN:
+ * @scc		Current sample statistics for the CPU.
+ * @scp		Previous sample statistics for the CPU.
+ *
+ * OUT:
+ * @cu		CPU utilization percentages.
+ ***************************************************************************
+ */
+void sysstat_cpu_util(struct sysstat_cpu *scc, struct sysstat_cpu *scp,
+		      struct sysstat_cpu_util *cu)
+{
+	struct sysstat_cpu sp;
+	unsigned long long deltot_jiffies;
+
+	/* get_per_cpu_interval() may update previous values */
+	sp = *scp;
+	deltot_jiffies = get_per_cpu_interval((struct stats_cpu *) scc,
+					      (struct stats_cpu *) &sp);
+
+	memset(cu, 0, sizeof(struct sysstat_cpu_util));
+
+	if (!deltot_jiffies) {
+		/* CPU is tickless: No change in CPU values */
+		cu->idle = 100.0;
+		return;
+	}
+
+	cu->user = (scc->cpu_user - scc->cpu_guest) < (sp.cpu_user - sp.cpu_guest) ?
+		   0.0 :
+		   lib_sp_value(sp.cpu_user - sp.cpu_guest,
+			       scc->cpu_user - scc->cpu_guest, deltot_jiffies);
+	cu->nice = (scc->cpu_nice - scc->cpu_guest_nice) < (sp.cpu_nice - sp.cpu_guest_nice) ?
+		   0.0 :
+		   lib_sp_value(sp.cpu_nice - sp.cpu_guest_nice,
+			       scc->cpu_nice - scc->cpu_guest_nice, deltot_jiffies);
+	cu->system = lib_sp_value(sp.cpu_sys, scc->cpu_sys, deltot_jiffies);
+	cu->iowait = lib_sp_value(sp.cpu_iowait, scc->cpu_iowait, deltot_jiffies);
+	cu->steal  = lib_sp_value(sp.cpu_steal, scc->cpu_steal, deltot_jiffies);
+	cu->irq    = lib_sp_value(sp.cpu_hardirq, scc->cpu_hardirq, deltot_jiffies);
+	cu->soft   = lib_sp_value(sp.cpu_softirq, scc->cpu_softirq, deltot_jiffies);
+	cu->guest  = lib_sp_value(sp.cpu_guest, scc->cpu_guest, deltot_jiffies);
+	cu->gnice  = lib_sp_value(sp.cpu_guest_nice, scc->cpu_guest_nice, deltot_jiffies);
+	cu->idle   = scc->cpu_idle < sp.cpu_idle ?
+		     0.0 :
+		     lib_sp_value(sp.cpu_idle, scc->cpu_idle, deltot_jiffies);
+}
+
+/*
+ ***************************************************************************
+ * Compute memory utilization the same way sar -r does.
+ *
+ * IN:
+ * @smc		Memory statistics.
+ *
+ * OUT:
+ * @mu		Memory utilization.
+ ***************************************************************************
+ */
+void sysstat_mem_util(struct sysstat_memory *smc, struct sysstat_mem_util *mu)
+{
+	mu->kbmemused = smc->tlmkb - smc->availablekb;
+	mu->memused = smc->tlmkb ?
+		      SP_VALUE(smc->availablekb, smc->tlmkb, smc->tlmkb) : 0.0;
+	mu->commit = (smc->tlmkb + smc->tlskb) ?
+		     SP_VALUE(0, smc->comkb, smc->tlmkb + smc->tlskb) : 0.0;
+}
+
+/*
+ ***************************************************************************
+ * Compute block device rates the same way sar -d does.
+ *
+ * IN:
+ * @sdc		Current sample statistics for the device.
+ * @sdp		Previous sample statistics for the device.
+ * @itv		Interval of time in 1/100th of a second.
+ *
+ * OUT:
+ * @dr		Block device rates.
+ ***************************************************************************
+ */
+void sysstat_disk_rates(struct sysstat_disk *sdc, struct sysstat_disk *sdp,
+			unsigned long long itv, struct sysstat_disk_rates *dr)
+{
+	struct ext_disk_stats xds;
+
+	compute_ext_disk_stats((struct stats_disk *) sdc, (struct stats_disk *) sdp,
+			       itv, &xds);
+
+	dr->tps     = S_VALUE(sdp->nr_ios, sdc->nr_ios, itv);
+	dr->rkB     = S_VALUE(sdp->rd_sect, sdc->rd_sect, itv) / 2;
+	dr->wkB     = S_VALUE(sdp->wr_sect, sdc->wr_sect, itv) / 2;
+	dr->dkB     = S_VALUE(sdp->dc_sect, sdc->dc_sect, itv) / 2;
+	dr->areq_sz = xds.arqsz / 2;
+	dr->aqu_sz  = S_VALUE(sdp->rq_ticks, sdc->rq_ticks, itv) / 1000.0;
+	dr->await   = xds.await;
+	dr->util    = xds.util / 10.0;
+}
+
+/*
+ ***************************************************************************
+ * Compute network interface rates the same way sar -n DEV does.
+ *
+ * IN:
+ * @sndc	Current sample statistics for the interface.
+ * @sndp	Previous sample statistics for the interface.
+ * @itv		Interval of time in 1/100th of a second.
+ *
+ * OUT:
+ * @nr		Network interface rates.
+ ***************************************************************************
+ */
+void sysstat_net_dev_rates(struct sysstat_net_dev *sndc, struct sysstat_net_dev *sndp,
+			   unsigned long long itv, struct sysstat_net_dev_rates *nr)
+{
+	double rx, tx;
+
+	rx = S_VALUE(sndp->rx_bytes, sndc->rx_bytes, itv);
+	tx = S_VALUE(sndp->tx_bytes, sndc->tx_bytes, itv);
+
+	nr->rxpck  = S_VALUE(sndp->rx_packets, sndc->rx_packets, itv);
+	nr->txpck  = S_VALUE(sndp->tx_packets, sndc->tx_packets, itv);
+	nr->rxkB   = rx / 1024;
+	nr->txkB   = tx / 1024;
+	nr->rxcmp  = S_VALUE(sndp->rx_compressed, sndc->rx_compressed, itv);
+	nr->txcmp  = S_VALUE(sndp->tx_compressed, sndc->tx_compressed, itv);
+	nr->rxmcst = S_VALUE(sndp->multicast, sndc->multicast, itv);
+	nr->ifutil = 0.0;
+
+	/* Interface utilization (see compute_ifutil() in sa_common.c) */
+	if (sndc->speed) {
+		double speed = (double) sndc->speed * 1000000;
+
+		if (sndc->duplex == SYSSTAT_DUPLEX_FULL) {
+			nr->ifutil = (rx > tx ? rx : tx) * 800 / speed;
+		}
+		else {
+			nr->ifutil = (rx + tx) * 800 / speed;
+		}
+	}
+}
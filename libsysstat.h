@@ -0,0 +1,290 @@
+/*
+ * libsysstat.h: Include file for the sysstat in-process statistics library
+ * (C) 1999-2025 by Sebastien Godard (sysstat <at> orange.fr)
+ *
+ * libsysstat lets a program collect the same statistics as sadc without
+ * forking sadc or sar and parsing their output. All the state is kept in
+ * a caller-owned context structure and every collection call writes into
+ * caller-owned buffers, so that several independent contexts may be used
+ * at the same time, possibly from different threads.
+ *
+ * No function of the library prints a message or exits: Errors are
+ * reported with return values and errno.
+ *
+ * Typical use:
+ *	struct sysstat_ctx ctx;
+ *	struct sysstat_cpu *cpu[2];
+ *
+ *	if (sysstat_init(&ctx) < 0)
+ *		...
+ *	cpu[0] = calloc(ctx.cpu_nr, sizeof(struct sysstat_cpu));
+ *	...
+ *	sysstat_read_uptime(&uptime[curr]);
+ *	while (sysstat_read_cpu(&ctx, cpu[curr], nr_alloc) == -1) {
+ *		nr_alloc = ctx.cpu_nr;
+ *		cpu[curr] = realloc(cpu[curr], nr_alloc * sizeof(struct sysstat_cpu));
+ *	}
+ *	itv = sysstat_interval(uptime[prev], uptime[curr]);
+ *	sysstat_cpu_util(cpu[curr], cpu[prev], &util);
+ */
+
+#ifndef _LIBSYSSTAT_H
+#define _LIBSYSSTAT_H
+
+/*
+ * This file is installed with the library and is self-contained: Only
+ * sysstat_* types and functions are declared here. All the other symbols
+ * of the library are local to it.
+ */
+
+/*
+ ***************************************************************************
+ * Definitions
+ ***************************************************************************
+ */
+
+/* Size of network interface names, including the terminating null byte */
+#define SYSSTAT_IFACE_LEN	16
+
+/* Duplex modes of network interfaces */
+#define SYSSTAT_DUPLEX_HALF	1
+#define SYSSTAT_DUPLEX_FULL	2
+
+/*
+ ***************************************************************************
+ * Structures
+ ***************************************************************************
+ */
+
+/*
+ * Library context. Filled by sysstat_init() and sysstat_count().
+ * Item numbers are only hints to size buffers: A collection call
+ * returning -1 means that the buffer was too small, in which case
+ * the item numbers have been updated and the buffer should be
+ * reallocated.
+ */
+struct sysstat_ctx {
+	/* Number of CPU structures, including CPU "all" */
+	int cpu_nr;
+	/* Number of block devices (disks and partitions) */
+	int disk_nr;
+	/* Number of network interfaces */
+	int iface_nr;
+};
+
+/*
+ * Raw statistics, as read from /proc and /sys. These structures have the
+ * same layout as those used by sadc (see rd_stats.h), so that they can be
+ * filled without any copy.
+ */
+
+/* CPU statistics, in jiffies */
+struct sysstat_cpu {
+	unsigned long long cpu_user;
+	unsigned long long cpu_nice;
+	unsigned long long cpu_sys;
+	unsigned long long cpu_idle;
+	unsigned long long cpu_iowait;
+	unsigned long long cpu_steal;
+	unsigned long long cpu_hardirq;
+	unsigned long long cpu_softirq;
+	unsigned long long cpu_guest;
+	unsigned long long cpu_guest_nice;
+};
+
+/* Task creation and context switch statistics */
+struct sysstat_pcsw {
+	unsigned long long context_switch;
+	unsigned long	   processes	__attribute__ ((aligned (8)));
+};
+
+/* Queue and load statistics. Load averages are multiplied by 100 */
+struct sysstat_queue {
+	unsigned long long nr_running;
+	unsigned long long procs_blocked;
+	unsigned long long nr_threads;
+	unsigned int	   load_avg_1;
+	unsigned int	   load_avg_5;
+	unsigned int	   load_avg_15;
+};
+
+/* Memory statistics, in kB */
+struct sysstat_memory {
+	unsigned long long frmkb;	/* MemFree */
+	unsigned long long bufkb;	/* Buffers */
+	unsigned long long camkb;	/* Cached */
+	unsigned long long tlmkb;	/* MemTotal */
+	unsigned long long frskb;	/* SwapFree */
+	unsigned long long tlskb;	/* SwapTotal */
+	unsigned long long caskb;	/* SwapCached */
+	unsigned long long comkb;	/* Committed_AS */
+	unsigned long long activekb;	/* Active */
+	unsigned long long inactkb;	/* Inactive */
+	unsigned long long dirtykb;	/* Dirty */
+	unsigned long long anonpgkb;	/* AnonPages */
+	unsigned long long slabkb;	/* Slab */
+	unsigned long long kstackkb;	/* KernelStack */
+	unsigned long long pgtblkb;	/* PageTables */
+	unsigned long long vmusedkb;	/* VmallocUsed */
+	unsigned long long availablekb;	/* MemAvailable */
+	unsigned long long shmemkb;	/* Shmem */
+};
+
+/* Swapping statistics, in pages */
+struct sysstat_swap {
+	unsigned long pswpin	__attribute__ ((aligned (8)));
+	unsigned long pswpout	__attribute__ ((aligned (8)));
+};
+
+/* Paging statistics, in kB (pgpgin, pgpgout) or in pages */
+struct sysstat_paging {
+	unsigned long pgpgin		__attribute__ ((aligned (8)));
+	unsigned long pgpgout		__attribute__ ((aligned (8)));
+	unsigned long pgfault		__attribute__ ((aligned (8)));
+	unsigned long pgmajfault	__attribute__ ((aligned (8)));
+	unsigned long pgfree		__attribute__ ((aligned (8)));
+	unsigned long pgscan_kswapd	__attribute__ ((aligned (8)));
+	unsigned long pgscan_direct	__attribute__ ((aligned (8)));
+	unsigned long pgsteal		__attribute__ ((aligned (8)));
+	unsigned long pgpromote		__attribute__ ((aligned (8)));
+	unsigned long pgdemote		__attribute__ ((aligned (8)));
+};
+
+/* Global I/O statistics. Blocks are sectors of 512 bytes */
+struct sysstat_io {
+	unsigned long long dk_drive;
+	unsigned long long dk_drive_rio;
+	unsigned long long dk_drive_wio;
+	unsigned long long dk_drive_rblk;
+	unsigned long long dk_drive_wblk;
+	unsigned long long dk_drive_dio;
+	unsigned long long dk_drive_dblk;
+};
+
+/* Block device statistics. Ticks are in milliseconds */
+struct sysstat_disk {
+	unsigned long long nr_ios;
+	unsigned long long wwn[2];
+	unsigned long	   rd_sect	__attribute__ ((aligned (8)));
+	unsigned long	   wr_sect	__attribute__ ((aligned (8)));
+	unsigned long	   dc_sect	__attribute__ ((aligned (8)));
+	unsigned int	   rd_ticks	__attribute__ ((aligned (8)));
+	unsigned int	   wr_ticks;
+	unsigned int	   tot_ticks;
+	unsigned int	   rq_ticks;
+	unsigned int	   major;
+	unsigned int	   minor;
+	unsigned int	   dc_ticks;
+	unsigned int	   part_nr;
+};
+
+/* Network interface statistics. Speed is in Mb/s */
+struct sysstat_net_dev {
+	unsigned long long rx_packets;
+	unsigned long long tx_packets;
+	unsigned long long rx_bytes;
+	unsigned long long tx_bytes;
+	unsigned long long rx_compressed;
+	unsigned long long tx_compressed;
+	unsigned long long multicast;
+	unsigned int	   speed;
+	char		   interface[SYSSTAT_IFACE_LEN];
+	char		   duplex;
+};
+
+/* CPU utilization, as displayed by sar -u ALL */
+struct sysstat_cpu_util {
+	double user;
+	double nice;
+	double system;
+	double iowait;
+	double steal;
+	double irq;
+	double soft;
+	double guest;
+	double gnice;
+	double idle;
+};
+
+/* Memory utilization, as displayed by sar -r */
+struct sysstat_mem_util {
+	unsigned long long kbmemused;
+	double memused;
+	double commit;
+};
+
+/* Block device rates, as displayed by sar -d */
+struct sysstat_disk_rates {
+	double tps;
+	double rkB;
+	double wkB;
+	double dkB;
+	double areq_sz;
+	double aqu_sz;
+	double await;
+	double util;
+};
+
+/* Network interface rates, as displayed by sar -n DEV */
+struct sysstat_net_dev_rates {
+	double rxpck;
+	double txpck;
+	double rxkB;
+	double txkB;
+	double rxcmp;
+	double txcmp;
+	double rxmcst;
+	double ifutil;
+};
+
+/*
+ ***************************************************************************
+ * Prototypes
+ ***************************************************************************
+ */
+
+/* Context functions */
+int sysstat_init
+	(struct sysstat_ctx *);
+int sysstat_count
+	(struct sysstat_ctx *);
+
+/* Collection functions */
+int sysstat_read_uptime
+	(unsigned long long *);
+int sysstat_read_cpu
+	(struct sysstat_ctx *, struct sysstat_cpu *, int);
+int sysstat_read_pcsw
+	(struct sysstat_pcsw *);
+int sysstat_read_queue
+	(struct sysstat_queue *);
+int sysstat_read_memory
+	(struct sysstat_memory *);
+int sysstat_read_swap
+	(struct sysstat_swap *);
+int sysstat_read_paging
+	(struct sysstat_paging *);
+int sysstat_read_io
+	(struct sysstat_io *);
+int sysstat_read_disk
+	(struct sysstat_ctx *, struct sysstat_disk *, int, int);
+int sysstat_read_net_dev
+	(struct sysstat_ctx *, struct sysstat_net_dev *, int);
+
+/* Delta and rate functions */
+unsigned long long sysstat_interval
+	(unsigned long long, unsigned long long);
+double sysstat_rate
+	(unsigned long long, unsigned long long, unsigned long long);
+void sysstat_cpu_util
+	(struct sysstat_cpu *, struct sysstat_cpu *, struct sysstat_cpu_util *);
+void sysstat_mem_util
+	(struct sysstat_memory *, struct sysstat_mem_util *);
+void sysstat_disk_rates
+	(struct sysstat_disk *, struct sysstat_disk *, unsigned long long,
+	 struct sysstat_disk_rates *);
+void sysstat_net_dev_rates
+	(struct sysstat_net_dev *, struct sysstat_net_dev *, unsigned long long,
+	 struct sysstat_net_dev_rates *);
+
+#endif  /* _LIBSYSSTAT_H */
@@ -24,6 +24,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <dirent.h>
 #include <ctype.h>
@@ -70,8 +71,15 @@ struct stats_global_irq *st_irq[3] = {NULL, NULL, NULL};
  * Structures used to save, for each interrupt, the number
  * received by each CPU.
  */
-struct stats_irqcpu *st_irqcpu[3] = {NULL, NULL, NULL};
-struct stats_irqcpu *st_softirqcpu[3] = {NULL, NULL, NULL};
+struct stats_irqcpu st_irqcpu[3];
+struct stats_irqcpu st_softirqcpu[3];
+
+/* Columns of /proc/interrupts and /proc/softirqs files */
+struct irq_columns irq_cols, softirq_cols;
+
+/* Buffer used to read /proc/interrupts and /proc/softirqs files */
+char *irq_buf = NULL;
+size_t irq_buf_size = 0;
 
 /*
  * Number of CPU per node, e.g.:
@@ -173,6 +181,135 @@ void int_handler(int sig)
 	write(STDOUT_FILENO, "\n", 1);	/* Skip "^C" displayed on screen (SIGINT) */
 }
 
+/*
+ ***************************************************************************
+ * Allocate structures for a sparse matrix of interrupts. Matrix is only
+ * enlarged: New interrupts are empty ones.
+ *
+ * IN:
+ * @st_ic	Sparse matrix of interrupts.
+ * @ic_nr	Number of interrupts (hard or soft) per CPU.
+ ***************************************************************************
+ */
+void salloc_irqcpu(struct stats_irqcpu *st_ic, int ic_nr)
+{
+	int j;
+
+	if (ic_nr <= st_ic->ic_nr)
+		return;
+
+	SREALLOC(st_ic->irq_name, char, MAX_IRQ_LEN * ic_nr);
+	SREALLOC(st_ic->row, unsigned int, sizeof(unsigned int) * (ic_nr + 1));
+
+	/* row[0] has been set to zero when the matrix was first allocated */
+	for (j = st_ic->ic_nr; j < ic_nr; j++) {
+		IRQ_NAME(st_ic, j)[0] = '\0';
+		st_ic->row[j + 1] = st_ic->row[j];
+	}
+	st_ic->ic_nr = ic_nr;
+}
+
+/*
+ ***************************************************************************
+ * Make sure that a sparse matrix of interrupts can hold a given number of
+ * non-zero counters.
+ *
+ * IN:
+ * @st_ic	Sparse matrix of interrupts.
+ * @nz_nr	Number of non-zero counters.
+ ***************************************************************************
+ */
+void salloc_irqcpu_values(struct stats_irqcpu *st_ic, unsigned int nz_nr)
+{
+	if (nz_nr <= st_ic->nz_nr)
+		return;
+
+	if (nz_nr < 2 * st_ic->nz_nr) {
+		nz_nr = 2 * st_ic->nz_nr;
+	}
+	if (nz_nr < NR_IRQCPU_NZ_PREALLOC) {
+		nz_nr = NR_IRQCPU_NZ_PREALLOC;
+	}
+	SREALLOC(st_ic->cpu, unsigned int, sizeof(unsigned int) * nz_nr);
+	SREALLOC(st_ic->interrupt, unsigned int, sizeof(unsigned int) * nz_nr);
+	st_ic->nz_nr = nz_nr;
+}
+
+/*
+ ***************************************************************************
+ * Free structures for a sparse matrix of interrupts.
+ *
+ * IN:
+ * @st_ic	Sparse matrix of interrupts.
+ ***************************************************************************
+ */
+void sfree_irqcpu(struct stats_irqcpu *st_ic)
+{
+	free(st_ic->irq_name);
+	free(st_ic->row);
+	free(st_ic->cpu);
+	free(st_ic->interrupt);
+	memset(st_ic, 0, sizeof(struct stats_irqcpu));
+}
+
+/*
+ ***************************************************************************
+ * Free structures used to save the columns of an interrupts file.
+ *
+ * IN:
+ * @cols	Columns of /proc/interrupts or /proc/softirqs file.
+ ***************************************************************************
+ */
+void sfree_irq_columns(struct irq_columns *cols)
+{
+	free(cols->header);
+	free(cols->cpu);
+	free(cols->col);
+	memset(cols, 0, sizeof(struct irq_columns));
+}
+
+/*
+ ***************************************************************************
+ * Copy a sparse matrix of interrupts.
+ *
+ * IN:
+ * @src		Sparse matrix to copy.
+ * @ic_nr	Number of interrupts (hard or soft) per CPU.
+ *
+ * OUT:
+ * @dest	Copy of the matrix.
+ ***************************************************************************
+ */
+void copy_irqcpu(struct stats_irqcpu *dest, struct stats_irqcpu *src, int ic_nr)
+{
+	unsigned int nz = src->row[ic_nr];
+
+	salloc_irqcpu_values(dest, nz);
+
+	memcpy(dest->irq_name, src->irq_name, MAX_IRQ_LEN * ic_nr);
+	memcpy(dest->row, src->row, sizeof(unsigned int) * (ic_nr + 1));
+	if (nz) {
+		memcpy(dest->cpu, src->cpu, sizeof(unsigned int) * nz);
+		memcpy(dest->interrupt, src->interrupt, sizeof(unsigned int) * nz);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Set every counter of a sparse matrix of interrupts to zero and every
+ * interrupt to an empty one.
+ *
+ * IN:
+ * @st_ic	Sparse matrix of interrupts.
+ * @ic_nr	Number of interrupts (hard or soft) per CPU.
+ ***************************************************************************
+ */
+void reset_irqcpu(struct stats_irqcpu *st_ic, int ic_nr)
+{
+	memset(st_ic->irq_name, 0, MAX_IRQ_LEN * ic_nr);
+	memset(st_ic->row, 0, sizeof(unsigned int) * (ic_nr + 1));
+}
+
 /*
  ***************************************************************************
  * Allocate stats structures and cpu bitmap. Also do it for NUMA nodes
@@ -195,10 +332,8 @@ void salloc_mp_struct(int nr_cpus, int pos)
 		SREALLOC(st_cpu[i], struct stats_cpu, STATS_CPU_SIZE * nr_cpus);
 		SREALLOC(st_node[i], struct stats_cpu, STATS_CPU_SIZE * nr_cpus);
 		SREALLOC(st_irq[i], struct stats_global_irq, STATS_GLOBAL_IRQ_SIZE * nr_cpus);
-		SREALLOC(st_irqcpu[i], struct stats_irqcpu,
-			 STATS_IRQCPU_SIZE * nr_cpus * irqcpu_nr);
-		SREALLOC(st_softirqcpu[i], struct stats_irqcpu,
-			 STATS_IRQCPU_SIZE * nr_cpus * softirqcpu_nr);
+		salloc_irqcpu(&st_irqcpu[i], irqcpu_nr);
+		salloc_irqcpu(&st_softirqcpu[i], softirqcpu_nr);
 	}
 
 	SREALLOC(cpu_bitmap, unsigned char, (nr_cpus >> 3) + 1);
@@ -214,8 +349,6 @@ void salloc_mp_struct(int nr_cpus, int pos)
 			memset(st_cpu[i] + pos, 0, STATS_CPU_SIZE * (nr_cpus - pos));
 			memset(st_node[i] + pos, 0, STATS_CPU_SIZE * (nr_cpus - pos));
 			memset(st_irq[i] + pos, 0, STATS_GLOBAL_IRQ_SIZE * (nr_cpus - pos));
-			memset(st_irqcpu[i] + pos, 0, STATS_IRQCPU_SIZE * (nr_cpus - pos) * irqcpu_nr);
-			memset(st_softirqcpu[i] + pos, 0, STATS_IRQCPU_SIZE * (nr_cpus - pos) * softirqcpu_nr);
 		}
 	}
 	else {
@@ -237,9 +370,12 @@ void sfree_mp_struct(void)
 		free(st_cpu[i]);
 		free(st_node[i]);
 		free(st_irq[i]);
-		free(st_irqcpu[i]);
-		free(st_softirqcpu[i]);
+		sfree_irqcpu(&st_irqcpu[i]);
+		sfree_irqcpu(&st_softirqcpu[i]);
 	}
+	sfree_irq_columns(&irq_cols);
+	sfree_irq_columns(&softirq_cols);
+	free(irq_buf);
 
 	free(cpu_bitmap);
 	free(node_bitmap);
@@ -249,22 +385,20 @@ void sfree_mp_struct(void)
 
 /*
  ***************************************************************************
- * Set interrupt values for current sample to those of previous sample.
+ * Set total number of interrupts received by offline CPU for current
+ * sample to that of previous sample. Counters for each interrupt are
+ * picked up from previous sample when the sparse matrix of interrupts is
+ * built (see read_interrupts_stat()).
  *
  * IN:
- * @st_ic	Array for per-CPU interrupts statistics.
  * @c		Fist CPU to process.
  * @last	Last CPU to process.
- * @ic_nr	Number of interrupts (hard or soft) per CPU.
  * @curr	Position in array where current statistics will be saved.
  **************************************************************************
  */
-void fwd_irq_values(struct stats_irqcpu *st_ic[], unsigned int c,
-		    unsigned int last, int ic_nr, int curr)
+void fwd_irq_values(unsigned int c, unsigned int last, int curr)
 {
 	struct stats_global_irq *st_irq_i, *st_irq_j;
-	struct stats_irqcpu *p, *q;
-	int j;
 
 	while (c < last) {
 
@@ -272,15 +406,137 @@ void fwd_irq_values(struct stats_irqcpu *st_ic[], unsigned int c,
 		st_irq_j = st_irq[!curr] + c + 1;
 		st_irq_i->irq_nr = st_irq_j->irq_nr;
 
-		for (j = 0; j < ic_nr; j++) {
-			p = st_ic[curr] + c * ic_nr + j;
-			q = st_ic[!curr] + c * ic_nr + j;
-			p->interrupt = q->interrupt;
-		}
 		c++;
 	}
 }
 
+/*
+ ***************************************************************************
+ * Get the number of an interrupt received by a CPU in a sparse matrix of
+ * interrupts. CPU must be given in increasing order for a given interrupt.
+ *
+ * IN:
+ * @st_ic	Sparse matrix of interrupts.
+ * @j		Interrupt number (row in the matrix).
+ * @k		Position in the matrix where to start looking for the CPU.
+ * @cpu		CPU number (0 is for CPU 0).
+ *
+ * OUT:
+ * @k		Position where to start looking for next CPU.
+ *
+ * RETURNS:
+ * Number of interrupts received by the CPU.
+ ***************************************************************************
+ */
+unsigned int get_irqcpu_value(struct stats_irqcpu *st_ic, int j, unsigned int *k,
+			      unsigned int cpu)
+{
+	unsigned int end = st_ic->row[j + 1];
+
+	while ((*k < end) && (st_ic->cpu[*k] < cpu)) {
+		(*k)++;
+	}
+	if ((*k < end) && (st_ic->cpu[*k] == cpu))
+		return st_ic->interrupt[*k];
+
+	return 0;
+}
+
+/*
+ ***************************************************************************
+ * Init cursors used to walk the sparse matrices of interrupts for current
+ * and previous samples. For each interrupt of current sample, look for the
+ * same interrupt in previous sample. This is done once for all CPU.
+ *
+ * IN:
+ * @st_ic	Array for per-CPU interrupts statistics.
+ * @ic_nr	Number of interrupts (hard or soft) per CPU.
+ * @prev	Position in array where statistics used	as reference are.
+ * @curr	Position in array where current statistics are.
+ *
+ * RETURNS:
+ * Array of cursors (one per interrupt). Must be freed by the caller.
+ ***************************************************************************
+ */
+struct irqcpu_cursor *init_irqcpu_cursors(struct stats_irqcpu st_ic[], int ic_nr,
+					  int prev, int curr)
+{
+	struct irqcpu_cursor *cur = NULL;
+	char *p0;
+	int j, offset;
+
+	SREALLOC(cur, struct irqcpu_cursor, sizeof(struct irqcpu_cursor) * ic_nr);
+
+	for (j = 0; j < ic_nr; j++) {
+		p0 = IRQ_NAME(&st_ic[curr], j);
+		if (p0[0] == '\0')
+			/* End of the list of interrupts */
+			break;
+		offset = j;
+
+		/*
+		 * If we want stats for the time since system startup,
+		 * previous names are empty strings since previous matrix
+		 * is completely set to zero.
+		 */
+		if (strcmp(p0, IRQ_NAME(&st_ic[prev], j)) && interval) {
+			/* Check if interrupt exists elsewhere in list */
+			for (offset = 0; offset < ic_nr; offset++) {
+				if (!strcmp(p0, IRQ_NAME(&st_ic[prev], offset)))
+					/* Interrupt found at another position */
+					break;
+			}
+			if (offset == ic_nr) {
+				/*
+				 * Interrupt not found: Instead of printing "N/A",
+				 * assume that previous value for this new interrupt
+				 * was zero.
+				 */
+				offset = -1;
+			}
+		}
+
+		cur[j].qrow = offset;
+		cur[j].pk = st_ic[curr].row[j];
+		cur[j].qk = (offset < 0) ? 0 : st_ic[prev].row[offset];
+	}
+
+	return cur;
+}
+
+/*
+ ***************************************************************************
+ * Get the number of an interrupt received by a CPU since previous sample.
+ *
+ * IN:
+ * @st_ic	Array for per-CPU interrupts statistics.
+ * @cur		Cursor for current interrupt.
+ * @j		Interrupt number.
+ * @cpu		CPU number (0 is for CPU 0). Must be given in increasing order.
+ * @itv		Interval value.
+ * @prev	Position in array where statistics used	as reference are.
+ * @curr	Position in array where current statistics are.
+ *
+ * OUT:
+ * @cur		Cursor updated for next CPU.
+ *
+ * RETURNS:
+ * Number of interrupts per second.
+ ***************************************************************************
+ */
+double get_irqcpu_rate(struct stats_irqcpu st_ic[], struct irqcpu_cursor *cur, int j,
+		       unsigned int cpu, unsigned long long itv, int prev, int curr)
+{
+	unsigned int p, q = 0;
+
+	p = get_irqcpu_value(&st_ic[curr], j, &cur->pk, cpu);
+	if (cur->qrow >= 0) {
+		q = get_irqcpu_value(&st_ic[prev], cur->qrow, &cur->qk, cpu);
+	}
+
+	return S_VALUE(q, p, itv);
+}
+
 /*
  ***************************************************************************
  * Get node placement (which node each CPU belongs to, and total number of
@@ -1362,13 +1618,14 @@ void write_isumcpu_stats(int dis, unsigned long long itv, int prev, int curr,
  *		CPU bitmap for offline CPU.
  ***************************************************************************
  */
-void write_plain_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
+void write_plain_irqcpu_stats(struct stats_irqcpu st_ic[], int ic_nr, int dis,
 			      unsigned long long itv, int prev, int curr,
 			      char *prev_string, char *curr_string,
 			      const unsigned char offline_cpu_bitmap[])
 {
-	int j = ic_nr, offset, cpu, colwidth[NR_IRQS];
-	struct stats_irqcpu *p, *q, *p0, *q0;
+	int j = ic_nr, cpu, colwidth[NR_IRQS];
+	struct irqcpu_cursor *cur;
+	char *p0;
 
 	/*
 	 * Check if number of interrupts has changed.
@@ -1378,9 +1635,7 @@ void write_plain_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
 	 */
 	if (!dis && interval) {
 		for (j = 0; j < ic_nr; j++) {
-			p0 = st_ic[curr] + j;
-			q0 = st_ic[prev] + j;
-			if (strcmp(p0->irq_name, q0->irq_name))
+			if (strcmp(IRQ_NAME(&st_ic[curr], j), IRQ_NAME(&st_ic[prev], j)))
 				/*
 				 * These are two different interrupts: The header must be displayed
 				 * (maybe an interrupt has disappeared, or a new one has just been registered).
@@ -1395,24 +1650,23 @@ void write_plain_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
 		/* Print header */
 		printf("\n%-11s  CPU", prev_string);
 		for (j = 0; j < ic_nr; j++) {
-			p0 = st_ic[curr] + j;
-			if (p0->irq_name[0] == '\0')
+			p0 = IRQ_NAME(&st_ic[curr], j);
+			if (p0[0] == '\0')
 				/* End of the list of interrupts */
 				break;
-			printf(" %8s/s", p0->irq_name);
+			printf(" %8s/s", p0);
 		}
 		printf("\n");
 	}
 
 	/* Calculate column widths */
 	for (j = 0; j < ic_nr; j++) {
-		p0 = st_ic[curr] + j;
 		/*
 		 * Width is IRQ name + 2 for the trailing "/s".
 		 * Width is calculated even for "undefined" interrupts (with
 		 * an empty irq_name string) to quiet code analysis tools.
 		 */
-		colwidth[j] = strlen(p0->irq_name) + 2;
+		colwidth[j] = strlen(IRQ_NAME(&st_ic[curr], j)) + 2;
 		/*
 		 * Normal space for printing a number is 11 chars
 		 * (space + 10 digits including the period).
@@ -1422,6 +1676,8 @@ void write_plain_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
 		}
 	}
 
+	cur = init_irqcpu_cursors(st_ic, ic_nr, prev, curr);
+
 	for (cpu = 1; cpu <= cpu_nr; cpu++) {
 
 		/*
@@ -1437,51 +1693,22 @@ void write_plain_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
 		cprintf_in(IS_INT, "  %3d", "", cpu - 1);
 
 		for (j = 0; j < ic_nr; j++) {
-			p0 = st_ic[curr] + j;	/* irq_name set only for CPU#0 */
 			/*
 			 * An empty string for irq_name means it is a remaining interrupt
 			 * which is no longer used, for example because the
 			 * number of interrupts has decreased in /proc/interrupts.
 			 */
-			if (p0->irq_name[0] == '\0')
+			if (IRQ_NAME(&st_ic[curr], j)[0] == '\0')
 				/* End of the list of interrupts */
 				break;
-			q0 = st_ic[prev] + j;
-			offset = j;
-
-			/*
-			 * If we want stats for the time since system startup,
-			 * we have p0->irq_name != q0->irq_name, since q0 structure
-			 * is completely set to zero.
-			 */
-			if (strcmp(p0->irq_name, q0->irq_name) && interval) {
-				/* Check if interrupt exists elsewhere in list */
-				for (offset = 0; offset < ic_nr; offset++) {
-					q0 = st_ic[prev] + offset;
-					if (!strcmp(p0->irq_name, q0->irq_name))
-						/* Interrupt found at another position */
-						break;
-				}
-			}
-
-			p = st_ic[curr] + (cpu - 1) * ic_nr + j;
 
-			if (!strcmp(p0->irq_name, q0->irq_name) || !interval) {
-				q = st_ic[prev] + (cpu - 1) * ic_nr + offset;
-				cprintf_f(NO_UNIT, FALSE, 1, colwidth[j], 2,
-					  S_VALUE(q->interrupt, p->interrupt, itv));
-			}
-			else {
-				/*
-				 * Instead of printing "N/A", assume that previous value
-				 * for this new interrupt was zero.
-				 */
-				cprintf_f(NO_UNIT, FALSE, 1, colwidth[j], 2,
-					  S_VALUE(0, p->interrupt, itv));
-			}
+			cprintf_f(NO_UNIT, FALSE, 1, colwidth[j], 2,
+				  get_irqcpu_rate(st_ic, cur + j, j, cpu - 1, itv, prev, curr));
 		}
 		printf("\n");
 	}
+
+	free(cur);
 }
 
 /*
@@ -1502,12 +1729,13 @@ void write_plain_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
  *		CPU bitmap for offline CPU.
  ***************************************************************************
  */
-void write_json_irqcpu_stats(int tab, struct stats_irqcpu *st_ic[], int ic_nr,
+void write_json_irqcpu_stats(int tab, struct stats_irqcpu st_ic[], int ic_nr,
 			     unsigned long long itv, int prev, int curr, int type,
 			     const unsigned char offline_cpu_bitmap[])
 {
-	int j = ic_nr, offset, cpu;
-	struct stats_irqcpu *p, *q, *p0, *q0;
+	int j = ic_nr, cpu;
+	struct irqcpu_cursor *cur;
+	char *p0;
 	int nextcpu = FALSE, nextirq;
 
 	if (type == M_D_IRQ_CPU) {
@@ -1517,6 +1745,8 @@ void write_json_irqcpu_stats(int tab, struct stats_irqcpu *st_ic[], int ic_nr,
 		xprintf(tab++, "\"soft-interrupts\": [");
 	}
 
+	cur = init_irqcpu_cursors(st_ic, ic_nr, prev, curr);
+
 	for (cpu = 1; cpu <= cpu_nr; cpu++) {
 
 		/*
@@ -1537,61 +1767,31 @@ void write_json_irqcpu_stats(int tab, struct stats_irqcpu *st_ic[], int ic_nr,
 
 		for (j = 0; j < ic_nr; j++) {
 
-			p0 = st_ic[curr] + j;	/* irq_name set only for CPU#0 */
+			p0 = IRQ_NAME(&st_ic[curr], j);
 			/*
 			 * An empty string for irq_name means it is a remaining interrupt
 			 * which is no longer used, for example because the
 			 * number of interrupts has decreased in /proc/interrupts.
 			 */
-			if (p0->irq_name[0] == '\0')
+			if (p0[0] == '\0')
 				/* End of the list of interrupts */
 				break;
-			q0 = st_ic[prev] + j;
-			offset = j;
 
 			if (nextirq) {
 				printf(",\n");
 			}
 			nextirq = TRUE;
 
-			/*
-			 * If we want stats for the time since system startup,
-			 * we have p0->irq_name != q0->irq_name, since q0 structure
-			 * is completely set to zero.
-			 */
-			if (strcmp(p0->irq_name, q0->irq_name) && interval) {
-				/* Check if interrupt exists elsewhere in list */
-				for (offset = 0; offset < ic_nr; offset++) {
-					q0 = st_ic[prev] + offset;
-					if (!strcmp(p0->irq_name, q0->irq_name))
-						/* Interrupt found at another position */
-						break;
-				}
-			}
-
-			p = st_ic[curr] + (cpu - 1) * ic_nr + j;
-
-			if (!strcmp(p0->irq_name, q0->irq_name) || !interval) {
-				q = st_ic[prev] + (cpu - 1) * ic_nr + offset;
-				xprintf0(tab, "{\"name\": \"%s\", \"value\": %.2f}",
-					 p0->irq_name,
-					 S_VALUE(q->interrupt, p->interrupt, itv));
-			}
-			else {
-				/*
-				 * Instead of printing "N/A", assume that previous value
-				 * for this new interrupt was zero.
-				 */
-				xprintf0(tab, "{\"name\": \"%s\", \"value\": %.2f}",
-					 p0->irq_name,
-					 S_VALUE(0, p->interrupt, itv));
-			}
+			xprintf0(tab, "{\"name\": \"%s\", \"value\": %.2f}", p0,
+				 get_irqcpu_rate(st_ic, cur + j, j, cpu - 1, itv, prev, curr));
 		}
 		printf("\n");
 		xprintf0(--tab, "] }");
 	}
 	printf("\n");
 	xprintf0(--tab, "]");
+
+	free(cur);
 }
 
 /*
@@ -1621,7 +1821,7 @@ void write_json_irqcpu_stats(int tab, struct stats_irqcpu *st_ic[], int ic_nr,
  *		CPU bitmap for offline CPU.
  ***************************************************************************
  */
-void write_irqcpu_stats(struct stats_irqcpu *st_ic[], int ic_nr, int dis,
+void write_irqcpu_stats(struct stats_irqcpu st_ic[], int ic_nr, int dis,
 			unsigned long long itv, int prev, int curr,
 			char *prev_string, char *curr_string, int tab,
 			int *next, int type, unsigned char offline_cpu_bitmap[])
@@ -1812,12 +2012,141 @@ void read_stat_total_irq(struct stats_global_irq *st_irq)
 
 	fclose(fp);
 }
+/*
+ ***************************************************************************
+ * Parse the header line of /proc/interrupts or /proc/softirqs to see which
+ * CPUs are online, and which columns should be read (only those for
+ * selected CPU).
+ *
+ * IN:
+ * @cols	Columns of the file.
+ * @line	Header line.
+ *
+ * OUT:
+ * @cols	Columns of the file, with a copy of the header line.
+ *
+ * RETURNS:
+ * Number of online CPU found in the header line.
+ ***************************************************************************
+ */
+int parse_irq_header(struct irq_columns *cols, char *line)
+{
+	unsigned int cpu;
+	char *cp, *next = line;
+
+	SREALLOC(cols->cpu, int, sizeof(int) * cpu_nr);
+	SREALLOC(cols->col, int, sizeof(int) * cpu_nr);
+	cols->online_nr = cols->read_nr = 0;
+
+	while (((cp = strstr(next, "CPU")) != NULL) && (cols->online_nr < cpu_nr)) {
+
+		cpu = strtol(cp + 3, &next, 10);
+		if (cpu >= cpu_nr)
+			break;
+
+		if ((!USE_OPTION_P(flags) && cols->all_cpu) ||
+		    IS_CPU_SELECTED(cpu_bitmap, cpu + 1)) {
+			/* This CPU has been selected: Its column will be read */
+			cols->col[cols->read_nr++] = cols->online_nr;
+		}
+		cols->cpu[cols->online_nr++] = cpu;
+	}
+
+	if (cols->online_nr) {
+		/* Save header line so that it is parsed again only when it changes */
+		SREALLOC(cols->header, char, strlen(line) + 1);
+		strcpy(cols->header, line);
+		cols->cpu_nr = cpu_nr;
+	}
+
+	return cols->online_nr;
+}
+
+/*
+ ***************************************************************************
+ * Skip a column of numbers in a line of /proc/interrupts or /proc/softirqs.
+ * As with strtoul(), nothing is skipped if there is no number.
+ *
+ * IN:
+ * @cp		Current position in the line.
+ *
+ * RETURNS:
+ * Position after the number.
+ ***************************************************************************
+ */
+char *skip_irq_column(char *cp)
+{
+	char *next = cp;
+
+	while (*next == ' ') {
+		next++;
+	}
+	if (!isdigit((unsigned char) *next))
+		return cp;
+
+	do {
+		next++;
+	}
+	while (isdigit((unsigned char) *next));
+
+	return next;
+}
+
+/*
+ ***************************************************************************
+ * Read the whole contents of /proc/interrupts or /proc/softirqs.
+ *
+ * IN:
+ * @file	/proc file to read (interrupts or softirqs).
+ *
+ * RETURNS:
+ * Number of bytes read, or -1 if the file couldn't be read.
+ * Buffer is terminated with a null character.
+ ***************************************************************************
+ */
+ssize_t read_irq_file(char *file)
+{
+	int fd;
+	size_t len = 0;
+	ssize_t n;
+
+	if ((fd = open(file, O_RDONLY)) < 0)
+		return -1;
+
+	if (!irq_buf_size) {
+		irq_buf_size = INTERRUPTS_LINE * 64;
+		SREALLOC(irq_buf, char, irq_buf_size);
+	}
+
+	while ((n = read(fd, irq_buf + len, irq_buf_size - len - 1)) > 0) {
+		len += n;
+		if (len == irq_buf_size - 1) {
+			/* Buffer is full: Double its size */
+			irq_buf_size *= 2;
+			SREALLOC(irq_buf, char, irq_buf_size);
+		}
+	}
+	close(fd);
+
+	if (n < 0)
+		return -1;
+
+	irq_buf[len] = '\0';
+
+	return len;
+}
+
 /*
  ***************************************************************************
  * Read stats from /proc/interrupts or /proc/softirqs.
+ * Only non-zero counters are saved in the sparse matrix of interrupts.
+ * Counters for offline CPU are picked up from previous sample, so that
+ * when the CPU goes back online, values won't jump from zero.
+ * Only columns for selected CPU are read, the others are skipped.
  *
  * IN:
  * @file	/proc file to read (interrupts or softirqs).
+ * @cols	Columns of the file.
  * @ic_nr	Number of interrupts (hard or soft) per CPU.
  * @curr	Position in array where current statistics will be saved.
  *
@@ -1825,59 +2154,74 @@ void read_stat_total_irq(struct stats_global_irq *st_irq)
  * @st_ic	Array for per-CPU interrupts statistics.
  ***************************************************************************
  */
-void read_interrupts_stat(char *file, struct stats_irqcpu *st_ic[], int ic_nr, int curr)
+void read_interrupts_stat(char *file, struct irq_columns *cols,
+			  struct stats_irqcpu st_ic[], int ic_nr, int curr)
 {
-	FILE *fp;
 	struct stats_global_irq *st_irq_i;
-	struct stats_irqcpu *p;
-	char *line = NULL, *li;
+	struct stats_irqcpu *p = &st_ic[curr], *q = &st_ic[!curr];
+	char *line, *end, *eol, *li;
 	unsigned long irq = 0;
-	unsigned int cpu, c = 0;
-	int cpu_index[cpu_nr], index = 0, len;
+	unsigned int cpu, c = 0, value, nz = 0, qk, qend;
+	int index = 0, len, col, i;
+	ssize_t size;
 	char *cp, *next;
 
-	if ((fp = fopen(file, "r")) != NULL) {
+	if ((size = read_irq_file(file)) >= 0) {
 
-		SREALLOC(line, char, INTERRUPTS_LINE + 11 * cpu_nr);
+		end = irq_buf + size;
 
 		/*
-		 * Parse header line to see which CPUs are online
+		 * Look for header line to see which CPUs are online.
+		 * Parse it only if it has changed since last time.
 		 */
-		while (fgets(line, INTERRUPTS_LINE + 11 * cpu_nr, fp) != NULL) {
-
-			next = line;
-			while (((cp = strstr(next, "CPU")) != NULL) && (index < cpu_nr)) {
-
-				cpu = strtol(cp + 3, &next, 10);
-				if (cpu >= cpu_nr)
-					break;
-				cpu_index[index++] = cpu;
+		for (line = irq_buf; line < end; line = eol + 1) {
 
-				/*
-				 * Reset total number of interrupts received by a CPU
-				 * only for online CPU. Only needed for st_irq structures.
-				 */
-				st_irq_i = st_irq[curr] + cpu + 1;
-				st_irq_i->irq_nr = 0;
+			if ((eol = memchr(line, '\n', end - line)) == NULL) {
+				eol = end;
+			}
+			*eol = '\0';
 
-				/*
-				 * For offline CPU, pick up previous values so that when the
-				 * CPU goes back online, values won't jump from zero.
-				 */
-				fwd_irq_values(st_ic, c, cpu, ic_nr, curr);
-				c = cpu + 1;
+			if ((cols->header != NULL) && (cols->cpu_nr == cpu_nr) &&
+			    !strcmp(line, cols->header)) {
+				index = cols->online_nr;
+			}
+			else {
+				index = parse_irq_header(cols, line);
 			}
 			if (index)
 				/* Header line found */
 				break;
 		}
 
+		for (i = 0; i < index; i++) {
+			cpu = cols->cpu[i];
+
+			/*
+			 * Reset total number of interrupts received by a CPU
+			 * only for online CPU. Only needed for st_irq structures.
+			 */
+			st_irq_i = st_irq[curr] + cpu + 1;
+			st_irq_i->irq_nr = 0;
+
+			/*
+			 * For offline CPU, pick up previous values so that when the
+			 * CPU goes back online, values won't jump from zero.
+			 */
+			fwd_irq_values(c, cpu, curr);
+			c = cpu + 1;
+		}
+
 		/* Process possible offline CPU at the end of the list */
-		fwd_irq_values(st_ic, c, cpu_nr, ic_nr, curr);
+		fwd_irq_values(c, cpu_nr, curr);
 
 		/* Parse each line of interrupts statistics data */
-		while ((fgets(line, INTERRUPTS_LINE + 11 * cpu_nr, fp) != NULL) &&
-		       (irq < ic_nr)) {
+		for (line = index ? eol + 1 : end; (line < end) && (irq < ic_nr); line = eol + 1) {
+
+			/* Look for end of line (memchr() is usually vectorized) */
+			if ((eol = memchr(line, '\n', end - line)) == NULL) {
+				eol = end;
+			}
+			*eol = '\0';
 
 			/* Skip over "<irq>:" */
 			if ((cp = strchr(line, ':')) == NULL)
@@ -1885,8 +2229,6 @@ void read_interrupts_stat(char *file, struct stats_irqcpu *st_ic[], int ic_nr, i
 				continue;
 			cp++;
 
-			p = st_ic[curr] + irq;
-
 			/* Remove possible heading spaces in interrupt's name... */
 			li = line;
 			while (*li == ' ')
@@ -1897,37 +2239,62 @@ void read_interrupts_stat(char *file, struct stats_irqcpu *st_ic[], int ic_nr, i
 				len = MAX_IRQ_LEN - 1;
 			}
 			/* ...then save its name */
-			strncpy(p->irq_name, li, len);
-			p->irq_name[len] = '\0';
+			strncpy(IRQ_NAME(p, irq), li, len);
+			IRQ_NAME(p, irq)[len] = '\0';
+
+			/* Counters for offline CPU are those of previous sample */
+			qk = q->row[irq];
+			qend = q->row[irq + 1];
+
+			/* Make sure there is enough space for this interrupt */
+			salloc_irqcpu_values(p, nz + cols->read_nr + qend - qk);
+
+			/*
+			 * For each interrupt: Get number received by each selected CPU.
+			 * Columns for other CPU are skipped, and the end of the line
+			 * is not parsed.
+			 */
+			for (i = 0, col = 0; i < cols->read_nr; i++, col++) {
+				for (; col < cols->col[i]; col++) {
+					cp = skip_irq_column(cp);
+				}
+				cpu = cols->cpu[col];
+
+				/* Pick up values of offline CPU preceding current one */
+				for (; (qk < qend) && (q->cpu[qk] <= cpu); qk++) {
+					if (q->cpu[qk] < cpu) {
+						p->cpu[nz] = q->cpu[qk];
+						p->interrupt[nz++] = q->interrupt[qk];
+					}
+				}
 
-			/* For each interrupt: Get number received by each CPU */
-			for (cpu = 0; cpu < index; cpu++) {
-				p = st_ic[curr] + cpu_index[cpu] * ic_nr + irq;
-				st_irq_i = st_irq[curr] + cpu_index[cpu] + 1;
 				/*
-				 * No need to set (st_irqcpu + cpu * irqcpu_nr)->irq_name:
-				 * This is the same as st_irqcpu->irq_name.
-				 * Now save current interrupt value for current CPU (in
-				 * stats_irqcpu structure) and total number of interrupts
-				 * received by current CPU (in stats_global_irq structure).
+				 * Now save current interrupt value for current CPU (only
+				 * if non-zero) and total number of interrupts received
+				 * by current CPU (in stats_global_irq structure).
 				 */
-				p->interrupt = strtoul(cp, &next, 10);
-				st_irq_i->irq_nr += p->interrupt;
+				value = strtoul(cp, &next, 10);
+				if (value) {
+					p->cpu[nz] = cpu;
+					p->interrupt[nz++] = value;
+					st_irq_i = st_irq[curr] + cpu + 1;
+					st_irq_i->irq_nr += value;
+				}
 				cp = next;
 			}
-			irq++;
+			/* Offline CPU at the end of the list */
+			for (; qk < qend; qk++) {
+				p->cpu[nz] = q->cpu[qk];
+				p->interrupt[nz++] = q->interrupt[qk];
+			}
+			p->row[++irq] = nz;
 		}
-
-		fclose(fp);
-
-		free(line);
 	}
 
 	while (irq < ic_nr) {
 		/* Nb of interrupts per processor has changed */
-		p = st_ic[curr] + irq;
-		p->irq_name[0] = '\0';	/* This value means this is a dummy interrupt */
-		irq++;
+		IRQ_NAME(p, irq)[0] = '\0';	/* This value means this is a dummy interrupt */
+		p->row[++irq] = nz;
 	}
 }
 
@@ -1982,6 +2349,14 @@ void rw_mpstat_loop(int dis_hdr, int rows)
 		read_topology(cpu_nr, st_cpu_topology);
 	}
 
+	/*
+	 * Without option -P, only CPU "all" is displayed for total number
+	 * of interrupts: Values for each CPU are needed only if individual
+	 * interrupts are displayed.
+	 */
+	irq_cols.all_cpu = DISPLAY_IRQ_CPU(actflags);
+	softirq_cols.all_cpu = TRUE;
+
 	/*
 	 * Read total number of interrupts received among all CPU.
 	 * (this is the first value on the line "intr:" in the /proc/stat file).
@@ -1996,10 +2371,10 @@ void rw_mpstat_loop(int dis_hdr, int rows)
 	 */
 	if (DISPLAY_IRQ_SUM(actflags) || DISPLAY_IRQ_CPU(actflags)) {
 		/* Read this file to display int per CPU or total nr of int per CPU */
-		read_interrupts_stat(INTERRUPTS, st_irqcpu, irqcpu_nr, 0);
+		read_interrupts_stat(INTERRUPTS, &irq_cols, st_irqcpu, irqcpu_nr, 0);
 	}
 	if (DISPLAY_SOFTIRQS(actflags)) {
-		read_interrupts_stat(SOFTIRQS, st_softirqcpu, softirqcpu_nr, 0);
+		read_interrupts_stat(SOFTIRQS, &softirq_cols, st_softirqcpu, softirqcpu_nr, 0);
 	}
 
 	if (!interval) {
@@ -2008,9 +2383,9 @@ void rw_mpstat_loop(int dis_hdr, int rows)
 		memset(st_cpu[1], 0, STATS_CPU_SIZE * (cpu_nr + 1));
 		memset(st_node[1], 0, STATS_CPU_SIZE * (cpu_nr + 1));
 		memset(st_irq[1], 0, STATS_GLOBAL_IRQ_SIZE * (cpu_nr + 1));
-		memset(st_irqcpu[1], 0, STATS_IRQCPU_SIZE * (cpu_nr + 1) * irqcpu_nr);
+		reset_irqcpu(&st_irqcpu[1], irqcpu_nr);
 		if (DISPLAY_SOFTIRQS(actflags)) {
-			memset(st_softirqcpu[1], 0, STATS_IRQCPU_SIZE * (cpu_nr + 1) * softirqcpu_nr);
+			reset_irqcpu(&st_softirqcpu[1], softirqcpu_nr);
 		}
 		write_stats(0, DISP_HDR);
 		if (DISPLAY_JSON_OUTPUT(xflags)) {
@@ -2031,10 +2406,9 @@ void rw_mpstat_loop(int dis_hdr, int rows)
 	memcpy(st_cpu[2], st_cpu[0], STATS_CPU_SIZE * (cpu_nr + 1));
 	memcpy(st_node[2], st_node[0], STATS_CPU_SIZE * (cpu_nr + 1));
 	memcpy(st_irq[2], st_irq[0], STATS_GLOBAL_IRQ_SIZE * (cpu_nr + 1));
-	memcpy(st_irqcpu[2], st_irqcpu[0], STATS_IRQCPU_SIZE * (cpu_nr + 1) * irqcpu_nr);
+	copy_irqcpu(&st_irqcpu[2], &st_irqcpu[0], irqcpu_nr);
 	if (DISPLAY_SOFTIRQS(actflags)) {
-		memcpy(st_softirqcpu[2], st_softirqcpu[0],
-		       STATS_IRQCPU_SIZE * (cpu_nr + 1) * softirqcpu_nr);
+		copy_irqcpu(&st_softirqcpu[2], &st_softirqcpu[0], softirqcpu_nr);
 	}
 
 	/* Set a handler for SIGINT and SIGTERM */
@@ -2083,10 +2457,10 @@ void rw_mpstat_loop(int dis_hdr, int rows)
 		 * and compute the total number of interrupts received by each CPU.
 		 */
 		if (DISPLAY_IRQ_SUM(actflags) || DISPLAY_IRQ_CPU(actflags)) {
-			read_interrupts_stat(INTERRUPTS, st_irqcpu, irqcpu_nr, curr);
+			read_interrupts_stat(INTERRUPTS, &irq_cols, st_irqcpu, irqcpu_nr, curr);
 		}
 		if (DISPLAY_SOFTIRQS(actflags)) {
-			read_interrupts_stat(SOFTIRQS, st_softirqcpu, softirqcpu_nr, curr);
+			read_interrupts_stat(SOFTIRQS, &softirq_cols, st_softirqcpu, softirqcpu_nr, curr);
 		}
 
 		/* Write stats */
@@ -78,23 +78,66 @@
  */
 
 /*
- * stats_irqcpu->irq_name:  IRQ#-A
- * stats_irqcpu->interrupt: number of IRQ#-A for proc 0
- * stats_irqcpu->irq_name:  IRQ#-B
- * stats_irqcpu->interrupt: number of IRQ#-B for proc 0
- * ...
- * stats_irqcpu->irq_name:  (undef'd)
- * stats_irqcpu->interrupt: number of IRQ#-A for proc 1
- * stats_irqcpu->irq_name:  (undef'd)
- * stats_irqcpu->interrupt: number of IRQ#-B for proc 1
- * ...
+ * Number of each interrupt (hard or soft) received by each CPU.
+ * Most of these counters are zero on machines with many CPU, since an
+ * interrupt is usually routed to a few CPU only. So only non-zero counters
+ * are saved, in a sparse matrix using CSR (Compressed Sparse Row) format:
+ *
+ * IRQ_NAME(st_ic, j): Name of interrupt #j. An empty string means that this
+ *		       is a remaining interrupt which is no longer used.
+ * st_ic->interrupt[k]: Number of interrupt #j received by CPU st_ic->cpu[k]
+ *			for st_ic->row[j] <= k < st_ic->row[j + 1]. Counters
+ *			are sorted by increasing CPU number.
  */
 struct stats_irqcpu {
-	unsigned int interrupt;
-	char         irq_name[MAX_IRQ_LEN];
+	/* Number of interrupts for which structures have been allocated */
+	int          ic_nr;
+	/* Number of non-zero counters for which structures have been allocated */
+	unsigned int nz_nr;
+	char         *irq_name;
+	unsigned int *row;
+	unsigned int *cpu;
+	unsigned int *interrupt;
 };
 
-#define STATS_IRQCPU_SIZE      (sizeof(struct stats_irqcpu))
+#define IRQ_NAME(st_ic, j)	((st_ic)->irq_name + (j) * MAX_IRQ_LEN)
+
+/* Minimum number of non-zero counters allocated */
+#define NR_IRQCPU_NZ_PREALLOC	256
+
+/*
+ * Columns of /proc/interrupts or /proc/softirqs files. They are computed
+ * from the header line of the file, and computed again only when this line
+ * changes (e.g. because a CPU has gone offline or online).
+ */
+struct irq_columns {
+	/* TRUE if values for every CPU are needed when option -P is not used */
+	int  all_cpu;
+	/* Header line the columns have been computed from */
+	char *header;
+	/* Value of cpu_nr when the columns have been computed */
+	int  cpu_nr;
+	/* Number of online CPU (one column each) */
+	int  online_nr;
+	/* Number of columns to read, i.e. online CPU that have been selected */
+	int  read_nr;
+	/* CPU number for each online CPU (online_nr values) */
+	int  *cpu;
+	/* Column numbers to read, in increasing order (read_nr values) */
+	int  *col;
+};
+
+/*
+ * Position of the counters for the current CPU in the sparse matrices
+ * of interrupts for current and previous samples (one per interrupt).
+ * @qrow is the row of the same interrupt in the matrix for previous sample
+ * (-1 if the interrupt didn't exist).
+ */
+struct irqcpu_cursor {
+	int          qrow;
+	unsigned int pk;
+	unsigned int qk;
+};
 
 struct stats_global_irq {
 	unsigned long long irq_nr;
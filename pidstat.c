@@ -21,17 +21,24 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <dirent.h>
 #include <ctype.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <pwd.h>
 #include <sys/utsname.h>
 #include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <regex.h>
+#include <fnmatch.h>
+#include <pthread.h>
 
 #ifdef HAVE_LINUX_SCHED_H
 #include <linux/sched.h>
@@ -62,6 +69,74 @@ extern int __env;
 unsigned long long tot_jiffies[3] = {0, 0, 0};
 unsigned long long uptime_cs[3] = {0, 0, 0};
 struct st_pid *pid_list = NULL;
+/* Hash table used to look up tasks in @pid_list */
+struct st_pid *pid_htab[PID_HASH_SIZE];
+/* TRUE if tasks have been added to @pid_list since it was last sorted */
+int pid_list_unsorted = FALSE;
+/* Slabs where tasks structures and their statistics are allocated */
+struct pid_slab pid_slab = {sizeof(struct st_pid), NULL, NULL};
+struct pid_slab pstats_slab = {3 * PID_STATS_SIZE, NULL, NULL};
+/* Hash table where command names and command lines are interned */
+struct st_str *str_htab[STR_HASH_SIZE];
+pthread_mutex_t str_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Command name and command line of new tasks. Never freed */
+char pid_empty_str[] = "";
+/* Cache of user names */
+struct st_uname *uname_htab[UNAME_HASH_SIZE];
+struct pid_slab uname_slab = {sizeof(struct st_uname), NULL, NULL};
+pthread_mutex_t uname_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Patterns entered with options -C and -G, compiled only once */
+regex_t comm_regex, proc_regex;
+
+/* Tasks whose stats are to be read during current scan of /proc */
+struct st_pid **scan_tab = NULL;
+int scan_nr = 0;
+int scan_alloc = 0;
+/* Number of worker threads used to read tasks stats (option --workers) */
+int workers_nr = 0;
+/* TRUE if the processes have been read before their threads during current scan */
+int tgid_read_first = FALSE;
+/* TRUE if the size of /proc/#/fd directories is the number of open files */
+int fd_count_by_size = FALSE;
+/* Number of tasks to display and key used to rank them (option --top) */
+int top_nr = 0;
+int top_key = TOP_CPU;
+struct pid_top *top_heap = NULL;
+/* Cgroups whose stats are read (option --cgroup) */
+struct st_cgroup *cg_htab[CG_HASH_SIZE];
+/* Cgroups found during last scan, sorted by path */
+struct st_cgroup **cg_tab = NULL;
+int cg_nr = 0;
+int cg_alloc = 0;
+/* Pattern that cgroup paths must match, and maximum depth of cgroups (-1: No limit) */
+char *cg_pattern = NULL;
+int cg_depth = -1;
+/* Mount point of the cgroup v2 hierarchy */
+char *cg_root = CGROUP_ROOT;
+/* Data files where stats are saved (option -o) or read from (option -f) */
+char pid_ofile[MAX_FILE_LEN];
+char pid_ifile[MAX_FILE_LEN];
+FILE *pid_ofp = NULL, *pid_ifp = NULL;
+/* Header of the data file read with option -f */
+struct pid_file_header pid_fhdr;
+/* Taskstats generic netlink family id, or -1 if taskstats are not used */
+int taskstats_family = -1;
+
+#ifdef HAVE_LINUX_TASKSTATS_H
+/*
+ * Exited tasks saved by the listener thread (option --exited).
+ * The listener thread fills buffer #exited_idx while the other one
+ * is being displayed.
+ */
+struct st_exited *exited_tab[2] = {NULL, NULL};
+int exited_nr[2] = {0, 0};
+int exited_idx = 0;
+/* Number of exited tasks which couldn't be saved */
+unsigned long exited_lost = 0;
+/* Tasks started before this time (in seconds since the Epoch) are not saved */
+time_t exited_since = 0;
+pthread_mutex_t exited_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 struct tm ps_tstamp[3];
 char commstr[MAX_COMM_LEN];
@@ -100,7 +175,10 @@ void usage(char *progname)
 			  "[ -d ] [ -H ] [ -h ] [ -I ] [ -l ] [ -R ] [ -r ] [ -s ] [ -t ] [ -U [ <username> ] ]\n"
 			  "[ -u ] [ -V ] [ -v ] [ -w ] [ -C <command> ] [ -G <process_name> ]\n"
 			  "[ -p { <pid> [,...] | SELF | ALL } ] [ -T { TASK | CHILD | ALL } ]\n"
-			  "[ --dec={ 0 | 1 | 2 } ] [ --human ] [ -o JSON ]\n"));
+			  "[ --cgroup[=<pattern>] ] [ --cgroup-depth=<n> ]\n"
+			  "[ --dec={ 0 | 1 | 2 } ] [ --exited ] [ --human ] [ --taskstats ]\n"
+			  "[ --top=<n>[,{ CPU | RSS | IO | CSW }] ] [ --workers=<n> ] [ -o JSON ]\n"
+			  "[ -o <filename> ] [ -f <filename> ]\n"));
 	exit(1);
 }
 
@@ -141,6 +219,301 @@ void int_handler(int sig)
 	}
 }
 
+/*
+ ***************************************************************************
+ * Compile a pattern entered with option -C or -G. Exit if the pattern is
+ * not a valid regular expression: Else no task would ever be displayed.
+ *
+ * IN:
+ * @regex	Structure where the compiled pattern is to be saved.
+ * @pattern	Pattern entered on the command line.
+ ***************************************************************************
+ */
+void compile_pattern(regex_t *regex, char *pattern)
+{
+	char errbuf[256];
+	int rc;
+
+	if ((rc = regcomp(regex, pattern, REG_EXTENDED | REG_NOSUB)) != 0) {
+		regerror(rc, regex, errbuf, sizeof(errbuf));
+		fprintf(stderr, _("Invalid regular expression %s: %s\n"), pattern, errbuf);
+		exit(1);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Allocate an object from a slab. A new block of objects is allocated
+ * when there is no free object left. Objects are 8-byte aligned, even on
+ * 32-bit platforms, since they contain unsigned long long fields.
+ *
+ * IN:
+ * @slab	Slab where the object is to be allocated.
+ *
+ * RETURNS:
+ * Pointer on the object (not initialized).
+ ***************************************************************************
+ */
+void *slab_alloc(struct pid_slab *slab)
+{
+	char *blk;
+	void *obj;
+	size_t size = PID_SLAB_ALIGN(slab->size);
+	int i;
+
+	if (!slab->free) {
+		/* Block begins with a pointer on the next block */
+		if ((blk = (char *) malloc(PID_SLAB_HDR_SIZE + size * PID_SLAB_NR)) == NULL) {
+			perror("malloc");
+			exit(4);
+		}
+		*((void **) blk) = slab->blocks;
+		slab->blocks = blk;
+
+		/* Put the new objects in the free list, in ascending order */
+		for (i = PID_SLAB_NR - 1; i >= 0; i--) {
+			obj = blk + PID_SLAB_HDR_SIZE + i * size;
+			*((void **) obj) = slab->free;
+			slab->free = obj;
+		}
+	}
+
+	obj = slab->free;
+	slab->free = *((void **) obj);
+
+	return obj;
+}
+
+/*
+ ***************************************************************************
+ * Give an object back to its slab.
+ *
+ * IN:
+ * @slab	Slab where the object has been allocated.
+ * @obj		Object to free.
+ ***************************************************************************
+ */
+void slab_free(struct pid_slab *slab, void *obj)
+{
+	*((void **) obj) = slab->free;
+	slab->free = obj;
+}
+
+/*
+ ***************************************************************************
+ * Free all the blocks of objects of a slab.
+ *
+ * IN:
+ * @slab	Slab to destroy.
+ ***************************************************************************
+ */
+void slab_destroy(struct pid_slab *slab)
+{
+	void *blk;
+
+	while (slab->blocks) {
+		blk = slab->blocks;
+		slab->blocks = *((void **) blk);
+		free(blk);
+	}
+	slab->free = NULL;
+}
+
+/*
+ ***************************************************************************
+ * Allocate a string structure.
+ *
+ * IN:
+ * @str		String to save (not necessarily null-terminated).
+ * @len		Length of the string.
+ * @hash	Hash value of the string.
+ *
+ * RETURNS:
+ * Pointer on the new structure (not referenced yet).
+ ***************************************************************************
+ */
+struct st_str *new_str(const char *str, size_t len, unsigned int hash)
+{
+	struct st_str *st;
+
+	if ((st = (struct st_str *) malloc(sizeof(struct st_str) + len + 1)) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	st->next = NULL;
+	st->hash = hash;
+	st->refcnt = 0;
+	memcpy(st->s, str, len);
+	st->s[len] = '\0';
+
+	return st;
+}
+
+/*
+ ***************************************************************************
+ * Intern a command string. Tasks with the same command string (e.g. the
+ * threads of a process) share the same structure, which is freed when
+ * its last reference is released with release_str().
+ * Can be called by several worker threads at the same time.
+ *
+ * IN:
+ * @str		String to intern (not necessarily null-terminated).
+ * @len		Length of the string.
+ *
+ * RETURNS:
+ * Pointer on the interned string.
+ ***************************************************************************
+ */
+char *intern_str(const char *str, size_t len)
+{
+	struct st_str *st, **bucket;
+	unsigned int hash;
+
+	if (!len)
+		return pid_empty_str;
+
+	hash = hash_str(str, len);
+
+	pthread_mutex_lock(&str_mutex);
+
+	bucket = &str_htab[hash & (STR_HASH_SIZE - 1)];
+	for (st = *bucket; st != NULL; st = st->next) {
+		if ((st->hash == hash) && !strncmp(st->s, str, len) && !st->s[len])
+			goto found;
+	}
+
+	/* Not found: Add it to the hash table */
+	st = new_str(str, len, hash);
+	st->next = *bucket;
+	*bucket = st;
+
+found:
+	st->refcnt++;
+	pthread_mutex_unlock(&str_mutex);
+
+	return st->s;
+}
+
+/*
+ ***************************************************************************
+ * Save a command string owned by a single task. Unlike intern_str(), no
+ * lock is taken and no hash value is computed.
+ *
+ * IN:
+ * @str		String to save (not necessarily null-terminated).
+ * @len		Length of the string.
+ *
+ * RETURNS:
+ * Pointer on the saved string.
+ ***************************************************************************
+ */
+char *alloc_str(const char *str, size_t len)
+{
+	if (!len)
+		return pid_empty_str;
+
+	return new_str(str, len, 0)->s;
+}
+
+/*
+ ***************************************************************************
+ * Release a string returned by intern_str() or alloc_str(). The string is
+ * freed when there is no reference left on it.
+ * Can be called by several worker threads at the same time.
+ *
+ * IN:
+ * @str		String to release.
+ ***************************************************************************
+ */
+void release_str(char *str)
+{
+	struct st_str *st, **bucket;
+
+	if (str == pid_empty_str)
+		return;
+
+	st = STR_ENTRY(str);
+	if (!st->refcnt) {
+		/* String owned by a single task */
+		free(st);
+		return;
+	}
+
+	pthread_mutex_lock(&str_mutex);
+
+	if (!--st->refcnt) {
+		/* Remove string from its hash bucket */
+		for (bucket = &str_htab[st->hash & (STR_HASH_SIZE - 1)];
+		     *bucket != st; bucket = &((*bucket)->next));
+		*bucket = st->next;
+		free(st);
+	}
+
+	pthread_mutex_unlock(&str_mutex);
+}
+
+/*
+ ***************************************************************************
+ * Free all the interned strings still referenced (e.g. user names).
+ ***************************************************************************
+ */
+void free_str_htab(void)
+{
+	struct st_str *st;
+	int i;
+
+	for (i = 0; i < STR_HASH_SIZE; i++) {
+		while ((st = str_htab[i]) != NULL) {
+			str_htab[i] = st->next;
+			free(st);
+		}
+	}
+}
+
+/*
+ ***************************************************************************
+ * Get the name of a user. Names are saved in a cache so that the password
+ * database is read only once for each uid.
+ * Can be called by several worker threads at the same time.
+ *
+ * IN:
+ * @uid		User identification number.
+ *
+ * RETURNS:
+ * User name, or NULL if uid is unknown.
+ ***************************************************************************
+ */
+char *get_user_name(uid_t uid)
+{
+	struct st_uname *un, **bucket;
+	struct passwd *pwdent;
+
+	pthread_mutex_lock(&uname_mutex);
+
+	bucket = &uname_htab[uid & (UNAME_HASH_SIZE - 1)];
+	for (un = *bucket; un != NULL; un = un->next) {
+		if (un->uid == uid)
+			goto found;
+	}
+
+	/* Not found: Add it to the cache */
+	un = (struct st_uname *) slab_alloc(&uname_slab);
+	un->uid = uid;
+	if ((pwdent = __getpwuid(uid)) != NULL) {
+		un->name = intern_str(pwdent->pw_name, strlen(pwdent->pw_name));
+	}
+	else {
+		un->name = NULL;
+	}
+	un->next = *bucket;
+	*bucket = un;
+
+found:
+	pthread_mutex_unlock(&uname_mutex);
+
+	return un->name;
+}
+
 /*
  ***************************************************************************
  * Free unused PID structures.
@@ -152,7 +525,6 @@ void int_handler(int sig)
  */
 void sfree_pid(struct st_pid **plist, int force)
 {
-	int i;
 	struct st_pid *p;
 
 	while (*plist != NULL) {
@@ -160,12 +532,19 @@ void sfree_pid(struct st_pid **plist, int force)
 		p = *plist;
 		if (!p->exist || force) {
 			*plist = p->next;
-			for (i = 0; i < 3; i++) {
-				if (p->pstats[i]) {
-					free(p->pstats[i]);
-				}
+
+			/* Remove task from its hash bucket */
+			if (p->hnext) {
+				p->hnext->hprev = p->hprev;
 			}
-			free(p);
+			*(p->hprev) = p->hnext;
+
+			release_str(p->comm);
+			release_str(p->cmdline);
+
+			/* The three pid_stats structures are allocated together */
+			slab_free(&pstats_slab, p->pstats[0]);
+			slab_free(&pid_slab, p);
 		}
 		else {
 			plist = &(p->next);
@@ -223,6 +602,10 @@ void check_flags(void)
 	if (DISPLAY_CHILD_STATS(tskflag)) {
 		act |= P_A_CPU + P_A_MEM;
 	}
+	if (DISPLAY_CGROUP(pidflag)) {
+		/* Only CPU, memory and I/O stats are available for cgroups */
+		act &= P_A_CPU + P_A_MEM + P_A_IO;
+	}
 
 	actflag &= act;
 
@@ -232,9 +615,37 @@ void check_flags(void)
 	}
 }
 
+/*
+ ***************************************************************************
+ * Look for a task in the hash table.
+ *
+ * IN:
+ * @pid		PID number.
+ * @tgid	If PID is a TID then @tgid is its TGID number. 0 otherwise.
+ *
+ * RETURNS:
+ * Pointer on the st_pid structure of the task, or NULL if not found.
+ ***************************************************************************
+ */
+struct st_pid *lookup_pid(pid_t pid, pid_t tgid)
+{
+	struct st_pid *p;
+
+	for (p = pid_htab[PID_HASH(tgid, pid)]; p != NULL; p = p->hnext) {
+		if ((p->pid == pid) &&
+		    ((!tgid && !p->tgid) || (tgid && p->tgid && (p->tgid->pid == tgid))))
+			return p;
+	}
+
+	return NULL;
+}
+
 /*
  ***************************************************************************
  * Look for the PID in the list and store it if necessary.
+ * Tasks are looked up in a hash table keyed on (TGID, PID). New tasks
+ * are inserted at the head of the list, which is then sorted again by
+ * sort_pid_list() so that it is displayed in this order:
  *       PID ->  PID -> TGID ->  TID ->  TID ->  TID ->  PID -> NULL
  * Eg.: 1234 -> 1289 -> 1356 -> 1356 -> 1361 -> 4678 -> 1376 -> NULL
  *
@@ -252,100 +663,138 @@ void check_flags(void)
  */
 struct st_pid *add_list_pid(struct st_pid **plist, pid_t pid, pid_t tgid)
 {
-	struct st_pid *p, *ps, *tgid_p = NULL;
+	struct st_pid *p, *tgid_p = NULL, **bucket;
+	struct pid_stats *pst;
 	int i;
 
 	if (!pid)
 		return NULL;
 
-	if (!tgid) {
-		/*
-		 * Add a true PID to the list.
-		 * Add it in ascending order, not taking into account
-		 * other TIDs.
-		 */
-		while (*plist != NULL) {
+	if ((p = lookup_pid(pid, tgid)) != NULL)
+		/* PID found in list */
+		return p;
 
-			p = *plist;
-			if (!p->tgid && (p->pid == pid))
-				/* PID found in list */
-				return p;
+	if (tgid && ((tgid_p = lookup_pid(tgid, 0)) == NULL))
+		/* TGID not found: Stop now */
+		return NULL;
 
-			if (!p->tgid && (p->pid > pid))
-				/* Stop now to insert PID in list */
-				break;
+	/* Add PID to the list */
+	p = (struct st_pid *) slab_alloc(&pid_slab);
+	memset(p, 0, sizeof(struct st_pid));
 
-			plist = &(p->next);
-		}
+	pst = (struct pid_stats *) slab_alloc(&pstats_slab);
+	memset(pst, 0, 3 * PID_STATS_SIZE);
+	for (i = 0; i < 3; i++) {
+		p->pstats[i] = pst + i;
 	}
-	else {
-		int tgid_found = FALSE;
+	p->comm = p->cmdline = pid_empty_str;
+	p->pid = pid;
+	p->tgid = tgid_p;
 
-		/*
-		 * PID is a TID.
-		 * It will be inserted in ascending order immediately
-		 * following its TGID.
-		 */
-		while (*plist != NULL) {
+	/* Insert it at the head of the list. The list will be sorted later */
+	p->next = *plist;
+	*plist = p;
+	pid_list_unsorted = TRUE;
 
-			p = *plist;
-			if (p->pid == tgid) {
-				/* TGID found in list */
-				tgid_found = TRUE;
-				tgid_p = p;
-				break;
-			}
+	/* Insert it in its hash bucket */
+	bucket = &pid_htab[PID_HASH(tgid, pid)];
+	p->hnext = *bucket;
+	if (*bucket) {
+		(*bucket)->hprev = &(p->hnext);
+	}
+	p->hprev = bucket;
+	*bucket = p;
 
-			plist = &(p->next);
-		}
-		if (!tgid_found)
-			/* TGID not found: Stop now */
-			return NULL;
+	return p;
+}
 
-		plist = &(p->next);
-		while (*plist != NULL) {
+/*
+ ***************************************************************************
+ * Compare two tasks to sort the list: Processes are sorted by PID
+ * number, and threads immediately follow their thread leader, sorted by
+ * TID number.
+ *
+ * IN:
+ * @p1		First task.
+ * @p2		Second task.
+ *
+ * RETURNS:
+ * TRUE if @p1 should be displayed before @p2 (or at the same place).
+ ***************************************************************************
+ */
+int pid_le(struct st_pid *p1, struct st_pid *p2)
+{
+	pid_t k1 = p1->tgid ? p1->tgid->pid : p1->pid;
+	pid_t k2 = p2->tgid ? p2->tgid->pid : p2->pid;
 
-			p = *plist;
-			if ((p->tgid == tgid_p) && (p->pid == pid))
-				/* TID found in list */
-				return p;
+	if (k1 != k2)
+		return (k1 < k2);
 
-			if ((p->tgid == tgid_p) && (p->pid > pid))
-				/* Stop now to insert TID in list */
-				break;
-			if (p->tgid != tgid_p)
-				/* End of TID list: insert TID here */
-				break;
+	if (!p1->tgid != !p2->tgid)
+		/* Thread leader is displayed before its threads */
+		return !p1->tgid;
 
-			plist = &(p->next);
-		}
-	}
+	return (p1->pid <= p2->pid);
+}
 
-	/* PID not found */
-	ps = *plist;
+/*
+ ***************************************************************************
+ * Sort the list of tasks (merge sort) if new tasks have been added to it.
+ *
+ * IN:
+ * @plist	Pointer address on the start of the linked list.
+ ***************************************************************************
+ */
+void sort_pid_list(struct st_pid **plist)
+{
+	struct st_pid *p, *q, *e, *tail;
+	int insize, nmerges, psize, qsize, i;
 
-	/* Add PID to the list */
-	if ((*plist = (struct st_pid *) malloc(sizeof(struct st_pid))) == NULL) {
-		perror("malloc");
-		exit(4);
-	}
-	memset(*plist, 0, sizeof(struct st_pid));
+	if (!pid_list_unsorted || (*plist == NULL))
+		return;
 
-	p = *plist;
-	for (i = 0; i < 3; i++) {
-		if ((p->pstats[i] = (struct pid_stats *) malloc(sizeof(struct pid_stats))) == NULL) {
-			perror("malloc");
-			exit(4);
+	/* Bottom-up merge sort: Lists of size 1, 2, 4... are merged */
+	for (insize = 1; ; insize *= 2) {
+		p = *plist;
+		*plist = tail = NULL;
+		nmerges = 0;
+
+		while (p) {
+			nmerges++;
+			q = p;
+			for (psize = 0, i = 0; (i < insize) && q; i++, psize++) {
+				q = q->next;
+			}
+			qsize = insize;
+
+			while ((psize > 0) || ((qsize > 0) && q)) {
+				if (!psize) {
+					e = q; q = q->next; qsize--;
+				}
+				else if (!qsize || !q || pid_le(p, q)) {
+					e = p; p = p->next; psize--;
+				}
+				else {
+					e = q; q = q->next; qsize--;
+				}
+
+				if (tail) {
+					tail->next = e;
+				}
+				else {
+					*plist = e;
+				}
+				tail = e;
+			}
+			p = q;
 		}
-		memset(p->pstats[i], 0, PID_STATS_SIZE);
-	}
-	p->pid = pid;
-	p->next = ps;
-	if (tgid_p) {
-		p->tgid = tgid_p;
+		tail->next = NULL;
+
+		if (nmerges <= 1)
+			break;
 	}
 
-	return p;
+	pid_list_unsorted = FALSE;
 }
 
 /*
@@ -465,7 +914,7 @@ int read_proc_pid_stat(pid_t pid, struct st_pid *plist,
 {
 	int fd, sz, rc, commsz;
 	char filename[128];
-	static char buffer[1024 + 1];
+	char buffer[1024 + 1];
 	char *start, *end;
 	struct pid_stats *pst = plist->pstats[curr];
 
@@ -494,8 +943,22 @@ int read_proc_pid_stat(pid_t pid, struct st_pid *plist,
 	commsz = end - start;
 	if (commsz >= MAX_COMM_LEN)
 		return 1;
-	memcpy(plist->comm, start, commsz);
-	plist->comm[commsz] = '\0';
+	if (strncmp(plist->comm, start, commsz) || plist->comm[commsz]) {
+		/*
+		 * Command name has changed (or has not been read yet).
+		 * It is shared with other tasks only when command lines
+		 * or patterns entered with option -C are used: Else there
+		 * is no need to lock the hash table of interned strings.
+		 */
+		release_str(plist->comm);
+		if (DISPLAY_CMDLINE(pidflag) || COMMAND_STRING(pidflag)) {
+			plist->comm = intern_str(start, commsz);
+		}
+		else {
+			plist->comm = alloc_str(start, commsz);
+		}
+		plist->flags |= F_PID_NEWNAME;
+	}
 	start = end + 2;
 
 	rc = sscanf(start,
@@ -542,7 +1005,7 @@ int read_proc_pid_sched(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 {
 	int fd, rc = 0;
 	char filename[128];
-	static char buffer[1024 + 1];
+	char buffer[1024 + 1];
 	unsigned long long wtime = 0;
 	struct pid_stats *pst = plist->pstats[curr];
 
@@ -594,6 +1057,7 @@ int read_proc_pid_status(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 	FILE *fp;
 	char filename[128], line[256];
 	struct pid_stats *pst = plist->pstats[curr];
+	uid_t uid;
 
 	if (tgid) {
 		sprintf(filename, TASK_STATUS, tgid, pid);
@@ -609,7 +1073,10 @@ int read_proc_pid_status(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 	while (fgets(line, sizeof(line), fp) != NULL) {
 
 		if (!strncmp(line, "Uid:", 4)) {
-			sscanf(line + 5, "%u", &plist->uid);
+			if ((sscanf(line + 5, "%u", &uid) == 1) && (uid != plist->uid)) {
+				plist->uid = uid;
+				plist->flags |= F_PID_NEWUID;
+			}
 		}
 		else if (!strncmp(line, "Threads:", 8)) {
 			sscanf(line + 9, "%u", &pst->threads);
@@ -737,11 +1204,14 @@ int read_proc_pid_cmdline(pid_t pid, struct st_pid *plist, pid_t tgid)
 				line[i] = ' ';
 			}
 		}
-		snprintf(plist->cmdline, sizeof(plist->cmdline), "%s", line);
+		release_str(plist->cmdline);
+		plist->cmdline = intern_str(line, strlen(line));
+		plist->flags |= F_PID_NEWNAME;
 	}
 	else {
 		/* proc/.../cmdline was empty */
-		plist->cmdline[0] = '\0';
+		release_str(plist->cmdline);
+		plist->cmdline = pid_empty_str;
 	}
 	return 0;
 }
@@ -827,6 +1297,7 @@ int read_proc_pid_fd(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 {
 	DIR *dir;
 	struct dirent *drp;
+	struct stat st;
 	char filename[128];
 	struct pid_stats *pst = plist->pstats[curr];
 
@@ -837,6 +1308,13 @@ int read_proc_pid_fd(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 		sprintf(filename, PID_FD, pid);
 	}
 
+	if (fd_count_by_size && !stat(filename, &st) && !access(filename, R_OK)) {
+		/* No need to read the whole directory */
+		pst->fd_nr = (unsigned int) st.st_size;
+		plist->flags &= ~F_NO_PID_FD;
+		return 0;
+	}
+
 	if ((dir = opendir(filename)) == NULL) {
 		/* Cannot read fd directory */
 		plist->flags |= F_NO_PID_FD;
@@ -861,842 +1339,2435 @@ int read_proc_pid_fd(pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 
 /*
  ***************************************************************************
- * Read various stats for given PID.
- *
- * IN:
- * @pid		Process whose stats are to be read.
- * @plist	Pointer on the linked list where PID is saved.
- * @tgid	If !=0, thread whose stats are to be read.
- * @curr	Index in array for current sample statistics.
- *
- * OUT:
- * @thread_nr	Number of threads of the process.
- *
- * RETURNS:
- * 0 if stats have been successfully read, and 1 otherwise.
+ * Check whether the size of /proc/#/fd directories is the number of open
+ * files (Linux 6.2 and later), in which case read_proc_pid_fd() doesn't
+ * need to read them. This is checked on pidstat's own fd directory.
  ***************************************************************************
  */
-int read_pid_stats(pid_t pid, struct st_pid *plist, unsigned int *thread_nr,
-		   pid_t tgid, int curr)
+void check_fd_count_by_size(void)
 {
-	if (read_proc_pid_stat(pid, plist, thread_nr, tgid, curr))
-		return 1;
+	DIR *dir;
+	struct dirent *drp;
+	struct stat st;
+	char filename[128];
+	long nr = 0;
 
-	/*
-	 * No need to test the return code here: Not finding
-	 * the schedstat files shouldn't make pidstat stop.
-	 */
-	read_proc_pid_sched(pid, plist, tgid, curr);
+	sprintf(filename, PID_FD, (unsigned int) getpid());
 
-	if (DISPLAY_CMDLINE(pidflag) && !plist->cmdline[0]) {
-		if (read_proc_pid_cmdline(pid, plist, tgid))
-			return 1;
-	}
+	if (stat(filename, &st) < 0)
+		return;
 
-	if (read_proc_pid_status(pid, plist, tgid, curr))
-		return 1;
+	if ((dir = opendir(filename)) == NULL)
+		return;
 
-	if (DISPLAY_STACK(actflag)) {
-		if (read_proc_pid_smap(pid, plist, tgid, curr))
-			return 1;
+	while ((drp = readdir(dir)) != NULL) {
+		if (isdigit(drp->d_name[0])) {
+			nr++;
+		}
 	}
 
-	if (DISPLAY_KTAB(actflag)) {
-		if (read_proc_pid_fd(pid, plist, tgid, curr))
-			return 1;
-	}
+	closedir(dir);
 
-	if (DISPLAY_IO(actflag))
-		/* Assume that /proc/#/task/#/io exists! */
-		return (read_proc_pid_io(pid, plist, tgid, curr));
+	/* The directory stream itself was not open when stat() was called */
+	fd_count_by_size = (st.st_size > 0) && (st.st_size + 1 == nr);
+}
+
+#ifdef HAVE_LINUX_TASKSTATS_H
+/*
+ ***************************************************************************
+ * Add an attribute to a generic netlink message.
+ *
+ * IN:
+ * @msg		Netlink message.
+ * @type	Attribute type.
+ * @data	Attribute data.
+ * @len		Length of attribute data.
+ ***************************************************************************
+ */
+void nl_add_attr(struct nl_msg *msg, int type, const void *data, int len)
+{
+	struct nlattr *na;
+
+	na = (struct nlattr *) ((char *) msg + NLMSG_ALIGN(msg->n.nlmsg_len));
+	na->nla_type = type;
+	na->nla_len = NLA_HDRLEN + len;
+	memcpy((char *) na + NLA_HDRLEN, data, len);
+	msg->n.nlmsg_len = NLMSG_ALIGN(msg->n.nlmsg_len) + NLA_ALIGN(na->nla_len);
+}
+
+/*
+ ***************************************************************************
+ * Send a generic netlink request.
+ *
+ * IN:
+ * @fd		Netlink socket.
+ * @family	Generic netlink family.
+ * @cmd		Command.
+ * @flags	Netlink flags (e.g. NLM_F_ACK) to add to NLM_F_REQUEST.
+ * @type	Type of the attribute to send with the command.
+ * @data	Attribute data.
+ * @len		Length of attribute data.
+ *
+ * RETURNS:
+ * 0 on success, and -1 otherwise (errno is then set).
+ ***************************************************************************
+ */
+int nl_send(int fd, int family, int cmd, int flags, int type, const void *data, int len)
+{
+	struct nl_msg req;
+	struct sockaddr_nl nladdr;
+
+	memset(&req, 0, NL_MSG_HDR_SIZE);
+	req.n.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+	req.n.nlmsg_type = family;
+	req.n.nlmsg_flags = NLM_F_REQUEST | flags;
+	req.n.nlmsg_pid = 0;
+	req.g.cmd = cmd;
+	req.g.version = 1;
+	nl_add_attr(&req, type, data, len);
+
+	memset(&nladdr, 0, sizeof(nladdr));
+	nladdr.nl_family = AF_NETLINK;
+
+	if (sendto(fd, &req, req.n.nlmsg_len, 0,
+		   (struct sockaddr *) &nladdr, sizeof(nladdr)) < 0)
+		return -1;
 
 	return 0;
 }
 
 /*
  ***************************************************************************
- * Read stats for threads in /proc/#/task directory.
+ * Send a generic netlink request and read the answer.
  *
  * IN:
- * @pid		Process number whose threads stats are to be read.
- * @plist	Pointer on the linked list where PID is saved.
- * @curr	Index in array for current sample statistics.
+ * @fd		Netlink socket.
+ * @family	Generic netlink family.
+ * @cmd		Command.
+ * @type	Type of the attribute to send with the command.
+ * @data	Attribute data.
+ * @len		Length of attribute data.
+ *
+ * OUT:
+ * @ans		Answer.
+ *
+ * RETURNS:
+ * Length of the answer payload (attributes), or -1 on error (errno is then
+ * set, e.g. to EPERM if pidstat is not privileged enough).
  ***************************************************************************
  */
-void read_task_stats(pid_t pid, struct st_pid *plist, int curr)
+int nl_request(int fd, int family, int cmd, int type, const void *data, int len,
+	       struct nl_msg *ans)
 {
-	DIR *dir;
-	pid_t tid;
-	struct dirent *drp;
-	char filename[128];
-	unsigned int thr_nr;
-	struct st_pid *tlist;
+	int sz;
 
-	/* Open /proc/#/task directory */
-	sprintf(filename, PROC_TASK, pid);
-	if ((dir = __opendir(filename)) == NULL)
-		return;
+	if (nl_send(fd, family, cmd, 0, type, data, len) < 0)
+		return -1;
 
-	while ((drp = __readdir(dir)) != NULL) {
+	do {
+		sz = recv(fd, ans, sizeof(struct nl_msg), 0);
+	}
+	while ((sz < 0) && (errno == EINTR));
 
-		if (!isdigit(drp->d_name[0])) {
-			continue;
-		}
+	if ((sz < 0) || !NLMSG_OK(&ans->n, sz))
+		return -1;
 
-		tid = atoi(drp->d_name);
+	if (ans->n.nlmsg_type == NLMSG_ERROR) {
+		struct nlmsgerr *err = (struct nlmsgerr *) NLMSG_DATA(&ans->n);
 
-		tlist = add_list_pid(&pid_list, tid, pid);
-		if (!tlist)
-			continue;
-		tlist->exist = TRUE;
+		errno = err->error ? -err->error : EINVAL;
+		return -1;
+	}
 
-		if (read_pid_stats(tid, tlist, &thr_nr, pid, curr)) {
-			/* Thread doesn't exist */
-			tlist->exist = FALSE;
-		}
+	return (NLMSG_PAYLOAD(&ans->n, 0) - GENL_HDRLEN);
+}
+
+/*
+ ***************************************************************************
+ * Open a generic netlink socket used to get taskstats.
+ *
+ * RETURNS:
+ * Socket file descriptor, or -1 on error.
+ ***************************************************************************
+ */
+int taskstats_open(void)
+{
+	int fd;
+	struct sockaddr_nl nladdr;
+
+	if ((fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC)) < 0)
+		return -1;
+
+	memset(&nladdr, 0, sizeof(nladdr));
+	nladdr.nl_family = AF_NETLINK;
+	if (bind(fd, (struct sockaddr *) &nladdr, sizeof(nladdr)) < 0) {
+		close(fd);
+		return -1;
 	}
 
-	__closedir(dir);
+	return fd;
 }
 
 /*
  ***************************************************************************
- * Read various stats.
+ * Look for the stats of a task in the attributes of a taskstats message.
  *
  * IN:
- * @curr	Index in array for current sample statistics.
+ * @na		First attribute of the message.
+ * @len		Length of the attributes.
+ *
+ * OUT:
+ * @ts		Taskstats structure.
+ *
+ * RETURNS:
+ * 0 if stats have been found, and -1 otherwise.
  ***************************************************************************
  */
-void read_stats(int curr)
+int parse_taskstats(struct nlattr *na, int len, struct taskstats *ts)
 {
-	unsigned int thr_nr;
-	pid_t pid;
-	struct st_pid *plist;
-	struct stats_cpu *st_cpu;
+	struct nlattr *nna;
+	int nlen;
 
-	/*
-	 * Allocate two structures for CPU statistics.
-	 * No need to init them (done by read_stat_cpu() function).
-	 */
-	if ((st_cpu = (struct stats_cpu *) malloc(STATS_CPU_SIZE * 2)) == NULL) {
-		perror("malloc");
-		exit(4);
-	}
-	/* Read statistics for CPUs "all" */
-	read_stat_cpu(st_cpu, 1);
+	/* Look for TASKSTATS_TYPE_AGGR_PID, then for TASKSTATS_TYPE_STATS */
+	for (; len >= NLA_HDRLEN;
+	     len -= NLA_ALIGN(na->nla_len),
+	     na = (struct nlattr *) ((char *) na + NLA_ALIGN(na->nla_len))) {
 
-	/*
-	 * Compute the total number of jiffies spent by all processors.
-	 * NB: Don't add cpu_guest/cpu_guest_nice because cpu_user/cpu_nice
-	 * already include them.
-	 */
-	tot_jiffies[curr] = st_cpu->cpu_user + st_cpu->cpu_nice +
-			    st_cpu->cpu_sys + st_cpu->cpu_idle +
-			    st_cpu->cpu_iowait + st_cpu->cpu_hardirq +
-			    st_cpu->cpu_steal + st_cpu->cpu_softirq;
-	free(st_cpu);
+		if ((na->nla_len < NLA_HDRLEN) || (na->nla_len > len))
+			break;
+		if (na->nla_type != TASKSTATS_TYPE_AGGR_PID)
+			continue;
 
-	if (DISPLAY_ALL_PID(pidflag)) {
-		DIR *dir;
-		struct dirent *drp;
+		nlen = na->nla_len - NLA_HDRLEN;
+		for (nna = (struct nlattr *) ((char *) na + NLA_HDRLEN); nlen >= NLA_HDRLEN;
+		     nlen -= NLA_ALIGN(nna->nla_len),
+		     nna = (struct nlattr *) ((char *) nna + NLA_ALIGN(nna->nla_len))) {
 
-		/* Open /proc directory */
-		if ((dir = __opendir(PROC)) == NULL) {
-			perror("opendir");
-			exit(4);
+			if ((nna->nla_len < NLA_HDRLEN) || (nna->nla_len > nlen))
+				break;
+			if (nna->nla_type != TASKSTATS_TYPE_STATS)
+				continue;
+
+			/* Older kernels may return a smaller structure */
+			memset(ts, 0, sizeof(struct taskstats));
+			memcpy(ts, (char *) nna + NLA_HDRLEN,
+			       MINIMUM(nna->nla_len - NLA_HDRLEN, sizeof(struct taskstats)));
+			return 0;
 		}
+	}
 
-		/* Get directory entries */
-		while ((drp = __readdir(dir)) != NULL) {
+	return -1;
+}
 
-			if (!isdigit(drp->d_name[0])) {
-				continue;
-			}
+/*
+ ***************************************************************************
+ * Read taskstats for given task.
+ *
+ * IN:
+ * @fd		Netlink socket.
+ * @pid		Task whose stats are to be read.
+ *
+ * OUT:
+ * @ts		Taskstats structure.
+ *
+ * RETURNS:
+ * 0 if stats have been successfully read, and -1 otherwise.
+ ***************************************************************************
+ */
+int read_taskstats(int fd, pid_t pid, struct taskstats *ts)
+{
+	struct nl_msg ans;
+	__u32 id = (__u32) pid;
+	int len;
 
-			pid = atoi(drp->d_name);
+	if ((len = nl_request(fd, taskstats_family, TASKSTATS_CMD_GET,
+			      TASKSTATS_CMD_ATTR_PID, &id, sizeof(id), &ans)) < 0)
+		return -1;
 
-			plist = add_list_pid(&pid_list, pid, 0);
-			if (!plist)
-				continue;
-			plist->exist = TRUE;
+	return parse_taskstats((struct nlattr *) ans.buf, len, ts);
+}
+
+/*
+ ***************************************************************************
+ * Get the id of the taskstats generic netlink family.
+ *
+ * IN:
+ * @fd		Netlink socket.
+ *
+ * RETURNS:
+ * Family id, or -1 if it cannot be found.
+ ***************************************************************************
+ */
+int get_taskstats_family(int fd)
+{
+	struct nl_msg ans;
+	struct nlattr *na;
+	int len;
 
-			if (read_pid_stats(pid, plist, &thr_nr, 0, curr)) {
-				/* PID has terminated */
-				plist->exist = FALSE;
+	if ((len = nl_request(fd, GENL_ID_CTRL, CTRL_CMD_GETFAMILY, CTRL_ATTR_FAMILY_NAME,
+			      TASKSTATS_GENL_NAME, strlen(TASKSTATS_GENL_NAME) + 1, &ans)) < 0)
+		return -1;
 
-			} else if (DISPLAY_TID(pidflag)) {
-				/* Read stats for threads in task subdirectory */
-				read_task_stats(pid, plist, curr);
-			}
-		}
+	for (na = (struct nlattr *) ans.buf; len >= NLA_HDRLEN;
+	     len -= NLA_ALIGN(na->nla_len),
+	     na = (struct nlattr *) ((char *) na + NLA_ALIGN(na->nla_len))) {
 
-		/* Close /proc directory */
-		__closedir(dir);
+		if ((na->nla_len < NLA_HDRLEN) || (na->nla_len > len))
+			break;
+		if (na->nla_type == CTRL_ATTR_FAMILY_ID)
+			return *((__u16 *) ((char *) na + NLA_HDRLEN));
 	}
 
-	else {
-		/* Read stats for each PID in the list */
-		for (plist = pid_list; plist != NULL; plist = plist->next) {
+	return -1;
+}
 
-			if (plist->tgid)
-				/*
-				 * Ignore TIDs.
-				 * The user can only enter PIDs on the command line.
-				 * If there is a TID then this is because the user has
-				 * used option -t, and the TID has been inserted in the
-				 * list by read_task_stats() function below.
-				 */
-				continue;
+/*
+ ***************************************************************************
+ * Look for the taskstats generic netlink family, and check that taskstats
+ * can be read (this needs CAP_NET_ADMIN). If not, stats will be read
+ * from /proc.
+ ***************************************************************************
+ */
+void taskstats_init(void)
+{
+	struct taskstats ts;
+	int fd;
 
-			if (read_pid_stats(plist->pid, plist, &thr_nr, 0, curr)) {
-				/* PID has terminated */
-				plist->exist = FALSE;
-			}
-			else {
-				plist->exist = TRUE;
+	if ((fd = taskstats_open()) < 0)
+		return;
 
-				if (DISPLAY_TID(pidflag)) {
-					read_task_stats(plist->pid, plist, curr);
-				}
-			}
-		}
+	if (((taskstats_family = get_taskstats_family(fd)) >= 0) &&
+	    !read_taskstats(fd, getpid(), &ts)) {
+		close(fd);
+		return;
 	}
 
-	/* Free unused PID structures */
-	sfree_pid(&pid_list, FALSE);
+	close(fd);
+	taskstats_family = -1;
 }
 
 /*
  ***************************************************************************
- * Get current PID to display.
- * First, check that PID exists. *Then* check that it's an active process
- * and/or that the string (entered on the command line with option -C)
- * is found in command name, or that the process string (entered on the
- * command line with option -G) is found either in its command name (in case
- * PID is a process) or in command name of its thread leader (in case
- * PID is a thread).
+ * Fill stats for given task with values read from taskstats.
+ * This replaces the reading of /proc/#[/task/##]/schedstat and status
+ * files, and of /proc/#/task/##/io file for threads (taskstats I/O
+ * counters are per-thread, whereas /proc/#/io counters are for the
+ * whole process).
  *
  * IN:
- * @prev	Index in array where stats used as reference are.
- * @curr	Index in array for current sample statistics.
- * @activity	Current activity to display (CPU, memory...).
- * 		Can be more than one if stats are displayed on one line.
- * @pflag	Flag indicating whether stats are to be displayed for
- * 		individual tasks or for all their children.
+ * @fd		Netlink socket.
+ * @pid		Process whose stats are to be read.
  * @plist	Pointer on the linked list where PID is saved.
+ * @tgid	If != 0, thread whose stats are to be read.
+ * @curr	Index in array for current sample statistics.
  *
  * RETURNS:
- *  0 if PID no longer exists.
- * -1 if PID exists but should not be displayed.
- *  1 if PID can be displayed.
+ * 0 if stats have been successfully read, and 1 otherwise.
  ***************************************************************************
  */
-int get_pid_to_display(int prev, int curr, unsigned int activity, unsigned int pflag,
-		       struct st_pid *plist)
+int read_pid_taskstats(int fd, pid_t pid, struct st_pid *plist, pid_t tgid, int curr)
 {
-	int rc;
-	char *pc;
-	regex_t regex;
-	struct pid_stats *pstc = plist->pstats[curr], *pstp = plist->pstats[prev];
+	struct taskstats ts;
+	struct pid_stats *pst = plist->pstats[curr];
 
-	if (!plist->exist)
-		/* PID no longer exists */
-		return 0;
+	if (read_taskstats(fd, pid, &ts) < 0)
+		return 1;
 
-	if (!plist->tgid) {
-		/* This is group leader: Set it as not displayed by default */
-		plist->flags &= ~F_PID_DISPLAYED;
+	if (ts.ac_uid != plist->uid) {
+		plist->uid = ts.ac_uid;
+		plist->flags |= F_PID_NEWUID;
 	}
+	pst->nvcsw = ts.nvcsw;
+	pst->nivcsw = ts.nivcsw;
 
-	if ((DISPLAY_ALL_PID(pidflag) || DISPLAY_TID(pidflag)) &&
-		DISPLAY_ACTIVE_PID(pidflag)) {
-		int isActive = FALSE;
+	/* Convert ns to jiffies */
+	pst->wtime = ts.cpu_delay_total * HZ / 1000000000;
 
-		/* Check that it's an "active" process */
-		if (DISPLAY_CPU(activity)) {
-			/* User time already includes guest time */
-			if ((pstc->utime != pstp->utime) ||
-			    (pstc->stime != pstp->stime)) {
-				isActive = TRUE;
-			}
-			else {
-				/*
-				 * Process is not active but if we are showing
-				 * child stats then we need to look there.
-				 */
-				if (DISPLAY_CHILD_STATS(pflag)) {
-					/* User time already includes guest time */
-					if ((pstc->cutime != pstp->cutime) ||
-					    (pstc->cstime != pstp->cstime)) {
-						isActive = TRUE;
-					}
-				}
-			}
-		}
+	if (tgid) {
+		pst->read_bytes = ts.read_bytes;
+		pst->write_bytes = ts.write_bytes;
+		pst->cancelled_write_bytes = ts.cancelled_write_bytes;
+		plist->flags &= ~F_NO_PID_IO;
+	}
 
-		if (DISPLAY_MEM(activity) && !isActive) {
-			if ((pstc->minflt != pstp->minflt) ||
-			    (pstc->majflt != pstp->majflt)) {
-				isActive = TRUE;
-			}
-			else {
-				if (DISPLAY_TASK_STATS(pflag)) {
-					if ((pstc->vsz != pstp->vsz) ||
-					    (pstc->rss != pstp->rss)) {
-						isActive = TRUE;
-					}
-				}
-				else if (DISPLAY_CHILD_STATS(pflag)) {
-					if ((pstc->cminflt != pstp->cminflt) ||
-					    (pstc->cmajflt != pstp->cmajflt)) {
-						isActive = TRUE;
-					}
-				}
-			}
-		}
+	return 0;
+}
 
-		if (DISPLAY_STACK(activity) && !isActive) {
-			if ((pstc->stack_size != pstp->stack_size) ||
-			    (pstc->stack_ref != pstp->stack_ref)) {
-				isActive = TRUE;
-			}
-		}
+/*
+ ***************************************************************************
+ * Save the final stats of a task which has exited. Only tasks started
+ * after previous sample are saved: The stats of the other ones have
+ * already been (at least partially) displayed.
+ *
+ * IN:
+ * @ts		Taskstats structure sent when the task exited.
+ ***************************************************************************
+ */
+void save_exited_task(struct taskstats *ts)
+{
+	struct st_exited *ex;
 
-		if (DISPLAY_IO(activity) && !isActive) {
-			if (pstc->blkio_swapin_delays !=
-			     pstp->blkio_swapin_delays) {
-				isActive = TRUE;
-			}
-			if (!(NO_PID_IO(plist->flags)) && !isActive) {
-				/* /proc/#/io file should exist to check I/O stats */
-				if ((pstc->read_bytes  != pstp->read_bytes)  ||
-				    (pstc->write_bytes != pstp->write_bytes) ||
-				    (pstc->cancelled_write_bytes !=
-				     pstp->cancelled_write_bytes)) {
-					isActive = TRUE;
-				}
-			}
-		}
+#if TASKSTATS_VERSION >= 12
+	/* TGID is not sent by older kernels */
+	if (ts->ac_tgid) {
+		if (ts->ac_tgid == (__u32) getpid())
+			/* Ignore pidstat's own worker threads */
+			return;
+		if (!DISPLAY_TID(pidflag) && (ts->ac_tgid != ts->ac_pid))
+			/* Threads are displayed only with option -t */
+			return;
+	}
+#endif
 
-		if (DISPLAY_CTXSW(activity) && !isActive) {
-			if ((pstc->nvcsw  != pstp->nvcsw) ||
-			    (pstc->nivcsw != pstp->nivcsw)) {
-				isActive = TRUE;
-			}
+	pthread_mutex_lock(&exited_mutex);
+
+	if ((time_t) ts->ac_btime >= exited_since) {
+		if (exited_nr[exited_idx] < MAX_EXITED_TASKS) {
+			ex = &exited_tab[exited_idx][exited_nr[exited_idx]++];
+
+			ex->utime = ts->ac_utime;
+			ex->stime = ts->ac_stime;
+			ex->minflt = ts->ac_minflt;
+			ex->majflt = ts->ac_majflt;
+			ex->hiwater_rss = ts->hiwater_rss;
+			ex->read_bytes = ts->read_bytes;
+			ex->write_bytes = ts->write_bytes;
+			ex->pid = ts->ac_pid;
+			ex->ppid = ts->ac_ppid;
+			ex->uid = ts->ac_uid;
+			strncpy(ex->comm, ts->ac_comm, sizeof(ex->comm));
+			ex->comm[sizeof(ex->comm) - 1] = '\0';
 		}
-
-		if (DISPLAY_RT(activity) && !isActive) {
-			if ((pstc->priority != pstp->priority) ||
-			    (pstc->policy != pstp->policy)) {
-				isActive = TRUE;
-			}
+		else {
+			/* Buffer is full */
+			exited_lost++;
 		}
+	}
 
-		if (DISPLAY_KTAB(activity) && !isActive &&
-			!(NO_PID_FD(plist->flags))) {	/* /proc/#/fd directory should be readable */
-			if ((pstc->threads != pstp->threads) ||
-			    (pstc->fd_nr != pstp->fd_nr)) {
-				isActive = TRUE;
+	pthread_mutex_unlock(&exited_mutex);
+}
+
+/*
+ ***************************************************************************
+ * Listener thread: Get exit events sent by taskstats and save them.
+ *
+ * IN:
+ * @arg		Netlink socket registered for exit events.
+ *
+ * RETURNS:
+ * NULL.
+ ***************************************************************************
+ */
+void *exited_listener(void *arg)
+{
+	struct nl_msg msg;
+	struct taskstats ts;
+	int fd = (int) (long) arg;
+	int sz;
+
+	while (TRUE) {
+		if ((sz = recv(fd, &msg, sizeof(msg), 0)) < 0) {
+			if (errno == ENOBUFS) {
+				/* Socket receive buffer overrun: Exit events have been lost */
+				pthread_mutex_lock(&exited_mutex);
+				exited_lost++;
+				pthread_mutex_unlock(&exited_mutex);
 			}
+			else if (errno != EINTR)
+				break;
+			continue;
 		}
 
-		/* If PID isn't active for any of the activities then return */
-		if (!isActive)
-			return -1;
-	}
+		if ((sz < (int) NL_MSG_HDR_SIZE) || (msg.n.nlmsg_type < NLMSG_MIN_TYPE))
+			continue;
 
-	if (COMMAND_STRING(pidflag)) {
-		if (regcomp(&regex, commstr, REG_EXTENDED | REG_NOSUB) != 0)
-			/* Error in preparing regex structure */
-			return -1;
+		/* Message may have been truncated, but stats for the task come first */
+		if (!parse_taskstats((struct nlattr *) msg.buf,
+				     MINIMUM(msg.n.nlmsg_len, (__u32) sz) - NL_MSG_HDR_SIZE, &ts)) {
+			save_exited_task(&ts);
+		}
+	}
 
-		pc = get_tcmd(plist);	/* Get pointer on task's command string */
-		rc = regexec(&regex, pc, 0, NULL, 0);
-		regfree(&regex);
+	close(fd);
+	return NULL;
+}
 
-		if (rc)
-			/* regex pattern not found in command name */
-			return -1;
+/*
+ ***************************************************************************
+ * Register for taskstats exit events on every CPU, then start the thread
+ * which will listen to them (option --exited). This needs the
+ * CAP_NET_ADMIN capability.
+ ***************************************************************************
+ */
+void exited_init(void)
+{
+	char cpumask[128];
+	struct nl_msg ans;
+	struct nlmsgerr *err;
+	pthread_t tid;
+	sigset_t set, oset;
+	FILE *fp;
+	int fd, family, sz, rc = -1;
+	int rcvbuf = EXITED_RCVBUF_SIZE;
+
+	/* Get the list of possible CPUs, e.g. "0-7" */
+	strcpy(cpumask, "0");
+	if ((fp = fopen(CPU_POSSIBLE, "r")) != NULL) {
+		if (fgets(cpumask, sizeof(cpumask), fp) != NULL) {
+			cpumask[strcspn(cpumask, "\n")] = '\0';
+		}
+		fclose(fp);
 	}
 
-	if (PROCESS_STRING(pidflag)) {
-		if (!plist->tgid) {
-			/* This PID is a process ("thread group leader") */
-			if (regcomp(&regex, procstr, REG_EXTENDED | REG_NOSUB) != 0)
-				/* Error in preparing regex structure */
-				return -1;
-
-			pc = get_tcmd(plist);	/* Get pointer on task's command string */
-			rc = regexec(&regex, pc, 0, NULL, 0);
-			regfree(&regex);
+	if ((fd = taskstats_open()) < 0)
+		goto fail;
 
-			if (rc)
-				/* regex pattern not found in command name */
-				return -1;
+	if (((family = get_taskstats_family(fd)) < 0) ||
+	    (nl_send(fd, family, TASKSTATS_CMD_GET, NLM_F_ACK, TASKSTATS_CMD_ATTR_REGISTER_CPUMASK,
+		     cpumask, strlen(cpumask) + 1) < 0))
+		goto fail;
 
+	/* Wait for the acknowledgment. Exit events may be received before it */
+	while ((sz = recv(fd, &ans, sizeof(ans), 0)) >= 0 || (errno == EINTR)) {
+		if ((sz >= (int) NLMSG_LENGTH(sizeof(struct nlmsgerr))) &&
+		    (ans.n.nlmsg_type == NLMSG_ERROR)) {
+			err = (struct nlmsgerr *) NLMSG_DATA(&ans.n);
+			errno = -err->error;
+			rc = err->error;
+			break;
 		}
-		else if (!IS_PID_DISPLAYED(plist->tgid->flags))
-			/* This pid is a thread and is not part of a process to display */
-			return -1;
 	}
+	if (rc)
+		goto fail;
 
-	if (USER_STRING(pidflag)) {
-		struct passwd *pwdent;
+	/* Exit events may be numerous: Don't lose them too easily */
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
 
-		if ((pwdent = __getpwuid(plist->uid)) != NULL) {
-			if (strcmp(pwdent->pw_name, userstr))
-				/* This PID doesn't belong to user */
-				return -1;
-		}
-	}
+	SREALLOC(exited_tab[0], struct st_exited, MAX_EXITED_TASKS * sizeof(struct st_exited));
+	SREALLOC(exited_tab[1], struct st_exited, MAX_EXITED_TASKS * sizeof(struct st_exited));
+	exited_since = time(NULL);
 
-	plist->flags |= F_PID_DISPLAYED;
-	return 1;
+	/* Signals must be handled by main thread */
+	sigfillset(&set);
+	pthread_sigmask(SIG_BLOCK, &set, &oset);
+	if ((errno = pthread_create(&tid, NULL, exited_listener, (void *) (long) fd)) != 0)
+		goto fail;
+	pthread_detach(tid);
+	pthread_sigmask(SIG_SETMASK, &oset, NULL);
+
+	return;
+
+fail:
+	fprintf(stderr, _("Cannot get taskstats exit events: %s\n"), strerror(errno));
+	exit(1);
 }
 
 /*
  ***************************************************************************
- * Display UID/username, PID and TID.
+ * Display the final stats of the tasks started and terminated during the
+ * interval of time (option --exited).
  *
  * IN:
- * @plist	Pointer on the linked list where PID is saved.
- * @c		No-op character.
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @curr_string	Timestamp of the current sample.
  ***************************************************************************
  */
-void __print_line_id(struct st_pid *plist, char c)
+void write_exited_stats(int prev, int curr, char *curr_string)
 {
-	char format[32];
-	struct passwd *pwdent;
+	struct st_exited *ex;
+	char *name;
+	unsigned long long itv;
+	unsigned long lost;
+	double rbytes, wbytes;
+	int i, idx, nr, hdr = TRUE;
 
-	if (DISPLAY_USERNAME(pidflag) && ((pwdent = __getpwuid(plist->uid)) != NULL)) {
-		cprintf_in(IS_STR, " %8s", pwdent->pw_name, 0);
-	}
-	else {
-		cprintf_in(IS_INT, " %5d", "", plist->uid);
-	}
+	/*
+	 * Get the exited tasks saved during the interval, and let the
+	 * listener thread fill the other buffer.
+	 */
+	pthread_mutex_lock(&exited_mutex);
+	idx = exited_idx;
+	nr = exited_nr[idx];
+	exited_idx ^= 1;
+	exited_nr[exited_idx] = 0;
+	lost = exited_lost;
+	exited_lost = 0;
+	exited_since = mktime(&ps_tstamp[curr]);
+	pthread_mutex_unlock(&exited_mutex);
 
-	if (DISPLAY_TID(pidflag)) {
-		if (plist->tgid) {
-			/* This is a TID */
-			if (IS_PID_DISPLAYED(plist->tgid->flags)) {
-				/*
-				 * Its TGID has previously been displayed.
-				 * We can just display a dash for the TGID then
-				 * the TID number, i.e. "   -     <TID> "
-				 */
-				sprintf(format, "         %c %%9u", c);
+	itv = get_interval(uptime_cs[prev], uptime_cs[curr]);
+
+	for (i = 0; i < nr; i++) {
+		ex = &exited_tab[idx][i];
+
+		if (!DISPLAY_ALL_PID(pidflag) && (lookup_pid(ex->ppid, 0) == NULL))
+			/* Only children of the selected processes are displayed */
+			continue;
+
+		if (COMMAND_STRING(pidflag) &&
+		    regexec(&comm_regex, ex->comm, 0, NULL, 0))
+			continue;
+
+		if (PROCESS_STRING(pidflag) &&
+		    regexec(&proc_regex, ex->comm, 0, NULL, 0))
+			continue;
+
+		name = get_user_name(ex->uid);
+		if (USER_STRING(pidflag) && (name != NULL) && strcmp(name, userstr))
+			continue;
+
+		if (hdr) {
+			printf("\n%-11s", curr_string);
+			if (DISPLAY_USERNAME(pidflag)) {
+				printf("     USER");
 			}
 			else {
-				/*
-				 * Its TGID didn't meet the conditions to be displayed.
-				 * So we have to specify to which TGID the current TID is
-				 * linked, i.e. " <TGID>   <TID> "
-				 */
-				strcpy(format, " %9u");
-				cprintf_in(IS_INT, format, "", plist->tgid->pid);
+				printf("   UID");
 			}
+			printf("       PID      PPID    %%usr %%system    %%CPU    minflt    majflt"
+			       "    maxRSS     kB_rd     kB_wr  Exited\n");
+			hdr = FALSE;
+		}
+
+		printf("%-11s", curr_string);
+		if (DISPLAY_USERNAME(pidflag) && (name != NULL)) {
+			cprintf_in(IS_STR, " %8s", name, 0);
 		}
 		else {
-			/* This is a PID (TGID) */
-			sprintf(format, " %%9u         %c", c);
+			cprintf_in(IS_INT, " %5d", "", ex->uid);
 		}
-	}
-	else {
-		strcpy(format, " %9u");
+		cprintf_in(IS_INT, " %9u", "", ex->pid);
+		cprintf_in(IS_INT, " %9u", "", ex->ppid);
+
+		/* CPU times are in microseconds */
+		cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 3, 7, 2,
+			    SP_VALUE(0, ex->utime, itv * 10000),
+			    SP_VALUE(0, ex->stime, itv * 10000),
+			    IRIX_MODE_OFF(pidflag) ?
+			    SP_VALUE(0, ex->utime + ex->stime, itv * 10000 * cpu_nr) :
+			    SP_VALUE(0, ex->utime + ex->stime, itv * 10000));
+
+		cprintf_u64(NO_UNIT, 2, 9, ex->minflt, ex->majflt);
+		cprintf_u64(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, 1, 9,
+			    ex->hiwater_rss);
+
+		rbytes = (double) ex->read_bytes;
+		wbytes = (double) ex->write_bytes;
+		if (!DISPLAY_UNIT(pidflag)) {
+			rbytes /= 1024;
+			wbytes /= 1024;
+		}
+		cprintf_f(DISPLAY_UNIT(pidflag) ? UNIT_BYTE : NO_UNIT, FALSE, 2, 9, 2,
+			  rbytes, wbytes);
+
+		cprintf_s(IS_STR, "  %s", ex->comm);
+		printf("\n");
 	}
 
-	cprintf_in(IS_INT, format, "", plist->pid);
+	if (lost) {
+		printf(_("%-11s Exit events lost: %lu\n"), curr_string, lost);
+	}
 }
+#endif /* HAVE_LINUX_TASKSTATS_H */
 
 /*
  ***************************************************************************
- * Display timestamp, PID and TID.
+ * Check that a task matches the patterns entered with options -C and -G.
+ * Threads are checked against option -G when their process is displayed.
  *
  * IN:
- * @timestamp	Current timestamp.
  * @plist	Pointer on the linked list where PID is saved.
+ *
+ * RETURNS:
+ * TRUE if the task matches the patterns, and FALSE otherwise.
  ***************************************************************************
  */
-void print_line_id(char *timestamp, struct st_pid *plist)
+int match_comm_filters(struct st_pid *plist)
 {
-	printf("%-11s", timestamp);
-	__print_line_id(plist, '-');
+	char *pc;
+
+	/* Get pointer on task's command string */
+	pc = get_tcmd(plist);
+
+	if (COMMAND_STRING(pidflag) &&
+	    regexec(&comm_regex, pc, 0, NULL, 0))
+		/* regex pattern not found in command name */
+		return FALSE;
+
+	if (PROCESS_STRING(pidflag) && !plist->tgid &&
+	    regexec(&proc_regex, pc, 0, NULL, 0))
+		/* regex pattern not found in process name */
+		return FALSE;
+
+	return TRUE;
 }
 
 /*
- * **************************************************************************
- * Display UID/username, PID and TID in JSON format.
+ ***************************************************************************
+ * Check that a task belongs to the user entered with option -U.
  *
  * IN:
- * @tab		Number of tabs to print.
  * @plist	Pointer on the linked list where PID is saved.
+ *
+ * RETURNS:
+ * TRUE if the task belongs to the user (or if its uid is unknown), and
+ * FALSE otherwise.
  ***************************************************************************
  */
-void print_json_line_id(int tab, struct st_pid *plist)
+int match_user_filter(struct st_pid *plist)
 {
-	char format[32];
-	struct passwd *pwdent;
+	char *name;
 
-	xprintf0(tab, "{\"");
+	if (!USER_STRING(pidflag))
+		return TRUE;
 
-	if (DISPLAY_USERNAME(pidflag)) {
-		printf("USER");
+	name = get_user_name(plist->uid);
+
+	return (!name || !strcmp(name, userstr));
+}
+
+/*
+ ***************************************************************************
+ * Read various stats for given PID.
+ *
+ * IN:
+ * @pid		Process whose stats are to be read.
+ * @plist	Pointer on the linked list where PID is saved.
+ * @tgid	If !=0, thread whose stats are to be read.
+ * @curr	Index in array for current sample statistics.
+ * @ts_fd	Netlink socket used to read taskstats, or -1 if stats are
+ *		to be read only from /proc.
+ *
+ * OUT:
+ * @thread_nr	Number of threads of the process.
+ *
+ * RETURNS:
+ * 0 if stats have been successfully read, and 1 otherwise.
+ ***************************************************************************
+ */
+int read_pid_stats(pid_t pid, struct st_pid *plist, unsigned int *thread_nr,
+		   pid_t tgid, int curr, int ts_fd)
+{
+	int ts_read = FALSE;
+
+	/*
+	 * Only some files are read for rejected tasks. If the task was
+	 * rejected at previous sample, its previous stats are incomplete.
+	 */
+	if (IS_PID_REJECTED(plist->flags)) {
+		plist->flags |= F_PID_PREV_REJECTED;
 	}
 	else {
-		printf("UID");
+		plist->flags &= ~F_PID_PREV_REJECTED;
 	}
-	printf("\": \"");
+	plist->flags &= ~F_PID_REJECTED;
+
+	if (read_proc_pid_stat(pid, plist, thread_nr, tgid, curr))
+		return 1;
 
-	if (DISPLAY_USERNAME(pidflag) && ((pwdent = __getpwuid(plist->uid)) != NULL)) {
-		printf("%s", pwdent->pw_name);
+	if (DISPLAY_CMDLINE(pidflag) && !plist->cmdline[0]) {
+		if (read_proc_pid_cmdline(pid, plist, tgid))
+			return 1;
 	}
-	else {
-		printf("%d", plist->uid);
+
+	/* Don't read other files if the task will not be displayed */
+	if (!match_comm_filters(plist)) {
+		plist->flags |= F_PID_REJECTED;
+		return 0;
 	}
-	printf("\", \"");
 
-	if (DISPLAY_TID(pidflag)) {
-		printf("TGID");
+#ifdef HAVE_LINUX_TASKSTATS_H
+	if (ts_fd >= 0) {
+		/* Fall back to /proc files if taskstats cannot be read */
+		ts_read = !read_pid_taskstats(ts_fd, pid, plist, tgid, curr);
 	}
-	else {
-		printf("PID");
+#endif
+
+	/* Number of threads is not part of taskstats */
+	if (!ts_read || DISPLAY_KTAB(actflag)) {
+		if (read_proc_pid_status(pid, plist, tgid, curr))
+			return 1;
 	}
-	printf("\": \"");
 
-	strcpy(format, "%u");
-	if (DISPLAY_TID(pidflag)) {
-		if (plist->tgid) {
-			/* This is a TID */
-			printf("%u\", \"TID\": \"", plist->tgid->pid);
-		}
-		else {
-			/* This is a PID (TGID) */
-			strcpy(format, "%u\", \"TID\": \"");
+	/* Task's uid is now known */
+	if (!match_user_filter(plist)) {
+		plist->flags |= F_PID_REJECTED;
+		return 0;
+	}
+
+	if (!ts_read) {
+		/*
+		 * No need to test the return code here: Not finding
+		 * the schedstat files shouldn't make pidstat stop.
+		 */
+		read_proc_pid_sched(pid, plist, tgid, curr);
+	}
+
+	if (DISPLAY_STACK(actflag)) {
+		if (tgid && tgid_read_first && plist->tgid->exist &&
+		    !IS_PID_REJECTED(plist->tgid->flags)) {
+			/*
+			 * Threads share the address space of their process:
+			 * Their smaps file is the same, and may be huge.
+			 */
+			plist->pstats[curr]->stack_size = plist->tgid->pstats[curr]->stack_size;
+			plist->pstats[curr]->stack_ref = plist->tgid->pstats[curr]->stack_ref;
 		}
+		else if (read_proc_pid_smap(pid, plist, tgid, curr))
+			return 1;
 	}
 
-	printf(format, plist->pid);
-	printf("\", ");
+	if (DISPLAY_KTAB(actflag)) {
+		if (read_proc_pid_fd(pid, plist, tgid, curr))
+			return 1;
+	}
+
+	/* I/O stats are also needed to rank tasks with --top=<n>,IO */
+	if ((DISPLAY_IO(actflag) || (top_nr && (top_key == TOP_IO))) &&
+	    !(ts_read && tgid))
+		/* Assume that /proc/#/task/#/io exists! */
+		return (read_proc_pid_io(pid, plist, tgid, curr));
+
+	return 0;
 }
 
 /*
- * **************************************************************************
- * Display CPU statistics data for current task.
+ ***************************************************************************
+ * Add a task to the list of tasks whose stats are to be read during
+ * current scan.
  *
  * IN:
- * @disp_avg	TRUE if average stats are displayed.
- * @pstc	Pointer on current statistics data sample for current process.
- * @pstp	Pointer on previous statistics data sampe for current process.
- * @itv		Interval of time in 1/100th of a second.
- * @deltot_jiffies
- *		Number of jiffies spent on the interval by all processors.
+ * @plist	Pointer on the linked list where PID is saved.
  ***************************************************************************
  */
-void write_plain_pid_task_cpu_data(int disp_avg,
-				   struct pid_stats *pstc, struct pid_stats *pstp,
-				   unsigned long long itv,
-				   unsigned long long deltot_jiffies)
+void add_scan_task(struct st_pid *plist)
 {
-	cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 5, 7, 2,
-		    (pstc->utime - pstc->gtime) < (pstp->utime - pstp->gtime) ||
-		    (pstc->utime < pstc->gtime) || (pstp->utime < pstp->gtime) ?
-		    0.0 :
-		    SP_VALUE(pstp->utime - pstp->gtime,
-			     pstc->utime - pstc->gtime, itv * HZ / 100),
-		    SP_VALUE(pstp->stime, pstc->stime, itv * HZ / 100),
-		    SP_VALUE(pstp->gtime, pstc->gtime, itv * HZ / 100),
-		    SP_VALUE(pstp->wtime, pstc->wtime, itv * HZ / 100),
-		    /* User time already includes guest time */
-		    IRIX_MODE_OFF(pidflag) ?
-		    SP_VALUE(pstp->utime + pstp->stime,
-			     pstc->utime + pstc->stime, deltot_jiffies) :
-			     SP_VALUE(pstp->utime + pstp->stime,
-				      pstc->utime + pstc->stime, itv * HZ / 100));
-
-	if (!disp_avg) {
-		cprintf_in(IS_INT, "   %3d", "", pstc->processor);
-	}
-	else {
-		cprintf_in(IS_STR, "%s", "     -", 0);
+	if (scan_nr >= scan_alloc) {
+		scan_alloc = scan_alloc ? scan_alloc * 2 : 1024;
+		SREALLOC(scan_tab, struct st_pid *, scan_alloc * sizeof(struct st_pid *));
 	}
+	scan_tab[scan_nr++] = plist;
 }
 
 /*
- * **************************************************************************
- * Display memory statistics data for current task.
+ ***************************************************************************
+ * Add threads found in /proc/#/task directory to the list of tasks whose
+ * stats are to be read.
  *
  * IN:
- * @disp_avg	TRUE if average stats are displayed.
- * @plist	Pointer on current process in list.
- * @pstc	Pointer on current statistics data sample for current process.
- * @pstp	Pointer on previous statistics data sampe for current process.
- * @itv		Interval of time in 1/100th of a second.
+ * @pid		Process number whose threads stats are to be read.
  ***************************************************************************
  */
-void write_plain_pid_task_memory_data(int disp_avg, struct st_pid *plist,
-				      struct pid_stats *pstc, struct pid_stats *pstp,
-				      unsigned long long itv)
+void add_scan_threads(pid_t pid)
 {
-	cprintf_f(NO_UNIT, FALSE, 2, 9, 2,
-		  S_VALUE(pstp->minflt, pstc->minflt, itv),
-		  S_VALUE(pstp->majflt, pstc->majflt, itv));
+	DIR *dir;
+	pid_t tid;
+	struct dirent *drp;
+	char filename[128];
+	struct st_pid *tlist;
 
-	if (disp_avg) {
-		cprintf_f(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, FALSE, 2, 7, 0,
-			  (double) plist->total_vsz / plist->rt_asum_count,
-			  (double) plist->total_rss / plist->rt_asum_count);
+	/* Open /proc/#/task directory */
+	sprintf(filename, PROC_TASK, pid);
+	if ((dir = __opendir(filename)) == NULL)
+		return;
 
-		cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 1, 6, 2,
-			    tlmkb ?
-			    SP_VALUE(0, plist->total_rss / plist->rt_asum_count, tlmkb)
-			    : 0.0);
-	}
-	else {
-		cprintf_u64(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, 2, 7,
-			    (unsigned long long) pstc->vsz,
-			    (unsigned long long) pstc->rss);
+	while ((drp = __readdir(dir)) != NULL) {
 
-		cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 1, 6, 2,
-			    tlmkb ? SP_VALUE(0, pstc->rss, tlmkb) : 0.0);
+		if (!isdigit(drp->d_name[0])) {
+			continue;
+		}
+
+		tid = atoi(drp->d_name);
+
+		tlist = add_list_pid(&pid_list, tid, pid);
+		if (!tlist)
+			continue;
+		add_scan_task(tlist);
 	}
+
+	__closedir(dir);
 }
 
 /*
- * **************************************************************************
- * Display stack size statistics data for current task.
+ ***************************************************************************
+ * Worker thread reading stats for tasks saved in @scan_tab.
+ * Tasks are taken by chunks using an atomic counter. Each task is read
+ * by only one worker, which writes only in its own st_pid structure:
+ * No lock is needed.
  *
  * IN:
- * @disp_avg	TRUE if average stats are displayed.
- * @plist	Pointer on current process in list.
- * @pstc	Pointer on current statistics data sample for current process.
+ * @arg		Pointer on the structure describing the scan.
+ *
+ * RETURNS:
+ * NULL.
  ***************************************************************************
  */
-void write_plain_pid_stack_data(int disp_avg, struct st_pid *plist,
-				struct pid_stats *pstc)
+void *scan_worker(void *arg)
 {
-	if (disp_avg) {
-		cprintf_f(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, FALSE, 2, 7, 0,
-			  (double) plist->total_stack_size / plist->sk_asum_count,
-			  (double) plist->total_stack_ref  / plist->sk_asum_count);
+	struct pid_scan *ps = (struct pid_scan *) arg;
+	struct st_pid *plist;
+	unsigned int thr_nr;
+	int i, n, ts_fd = -1;
+
+#ifdef HAVE_LINUX_TASKSTATS_H
+	if (taskstats_family >= 0) {
+		/* Each worker uses its own netlink socket */
+		ts_fd = taskstats_open();
 	}
-	else {
-		cprintf_u64(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, 2, 7,
-			    (unsigned long long) pstc->stack_size,
-			    (unsigned long long) pstc->stack_ref);
+#endif
+
+	while ((n = __atomic_fetch_add(&ps->next, PID_SCAN_CHUNK, __ATOMIC_RELAXED)) < scan_nr) {
+
+		for (i = n; (i < n + PID_SCAN_CHUNK) && (i < scan_nr); i++) {
+			plist = scan_tab[i];
+			plist->exist = !read_pid_stats(plist->pid, plist, &thr_nr,
+						       plist->tgid ? plist->tgid->pid : 0,
+						       ps->curr, ts_fd);
+		}
 	}
+
+	if (ts_fd >= 0) {
+		close(ts_fd);
+	}
+
+	return NULL;
 }
 
 /*
- * **************************************************************************
- * Display I/O statistics data for current task.
+ ***************************************************************************
+ * Read stats for the tasks saved in @scan_tab, using several worker
+ * threads if there are enough tasks to read.
  *
  * IN:
- * @disp_avg	TRUE if average stats are displayed.
- * @plist	Pointer on current process in list.
- * @pstc	Pointer on current statistics data sample for current process.
- * @pstp	Pointer on previous statistics data sampe for current process.
- * @itv		Interval of time in 1/100th of a second.
+ * @curr	Index in array for current sample statistics.
+ * @first	Index in @scan_tab of the first task to read.
  ***************************************************************************
  */
-void write_plain_pid_io_data(int disp_avg, struct st_pid *plist,
-			     struct pid_stats *pstc, struct pid_stats *pstp,
-			     unsigned long long itv)
+void read_scan_tasks(int curr, int first)
 {
-	char dstr[32];
-	double rbytes, wbytes, cbytes;
+	pthread_t tid[MAX_PID_WORKERS];
+	struct pid_scan ps;
+	sigset_t set, oldset;
+	int i, nr;
 
-	if (!NO_PID_IO(plist->flags)) {
-		rbytes = S_VALUE(pstp->read_bytes,  pstc->read_bytes, itv);
-		wbytes = S_VALUE(pstp->write_bytes, pstc->write_bytes, itv);
-		cbytes = S_VALUE(pstp->cancelled_write_bytes,
-				 pstc->cancelled_write_bytes, itv);
-		if (!DISPLAY_UNIT(pidflag)) {
-			rbytes /= 1024;
-			wbytes /= 1024;
-			cbytes /= 1024;
-		}
-		cprintf_f(DISPLAY_UNIT(pidflag) ? UNIT_BYTE : NO_UNIT, FALSE, 3, 9, 2,
-			  rbytes, wbytes, cbytes);
+	ps.next = first;
+	ps.curr = curr;
+
+	/* Don't start more threads than needed */
+	nr = (scan_nr - first) / PID_SCAN_CHUNK;
+	if (nr > workers_nr) {
+		nr = workers_nr;
 	}
-	else {
-		/* I/O file not readable (permission denied or file non existent) */
-		sprintf(dstr, " %9.2f %9.2f %9.2f", -1.0, -1.0, -1.0);
-		cprintf_s(IS_ZERO, "%s", dstr);
+
+	/*
+	 * Signals (SIGALRM, SIGINT...) must be delivered to the main thread,
+	 * which waits for them in pause(): Block them in worker threads.
+	 */
+	sigfillset(&set);
+	pthread_sigmask(SIG_BLOCK, &set, &oldset);
+
+	/* Current thread is also a worker */
+	for (i = 0; i < nr - 1; i++) {
+		if (pthread_create(&tid[i], NULL, scan_worker, &ps) != 0)
+			break;
 	}
-	/* I/O delays come from another file (/proc/#/stat) */
-	if (disp_avg) {
-		cprintf_f(NO_UNIT, FALSE, 1, 7, 0,
-			  (double) (pstc->blkio_swapin_delays - pstp->blkio_swapin_delays) /
-			  plist->delay_asum_count);
+	nr = i;
+
+	pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+
+	scan_worker(&ps);
+
+	for (i = 0; i < nr; i++) {
+		pthread_join(tid[i], NULL);
 	}
-	else {
-		cprintf_u64(NO_UNIT, 1, 7,
-			    (unsigned long long) (pstc->blkio_swapin_delays - pstp->blkio_swapin_delays));
+
+	/* Threads of a process which has terminated are ignored */
+	for (i = first; i < scan_nr; i++) {
+		if (scan_tab[i]->tgid && !scan_tab[i]->tgid->exist) {
+			scan_tab[i]->exist = FALSE;
+		}
 	}
 }
 
 /*
- * **************************************************************************
- * Display context switches statistics data for current task.
+ ***************************************************************************
+ * Read a flat keyed file of a cgroup (e.g. cpu.stat or memory.stat) where
+ * each line contains a key followed by its value.
  *
  * IN:
- * @pstc	Pointer on current statistics data sample for current process.
- * @pstp	Pointer on previous statistics data sampe for current process.
- * @itv		Interval of time in 1/100th of a second.
+ * @filename	Name of the file to read.
+ * @keys	Keys whose values are to be read.
+ * @nr		Number of keys.
+ *
+ * OUT:
+ * @values	Values of the keys. Left unchanged if the file doesn't exist
+ *		or if a key is not found.
  ***************************************************************************
  */
-void write_plain_pid_ctxswitch_data(struct pid_stats *pstc, struct pid_stats *pstp,
-				    unsigned long long itv)
+void read_cgroup_keyed(char *filename, const char *keys[],
+		       unsigned long long *values[], int nr)
 {
-	cprintf_f(NO_UNIT, FALSE, 2, 9, 2,
-		  S_VALUE(pstp->nvcsw,  pstc->nvcsw,  itv),
-		  S_VALUE(pstp->nivcsw, pstc->nivcsw, itv));
+	FILE *fp;
+	char line[256];
+	size_t len;
+	int i;
+
+	if ((fp = fopen(filename, "r")) == NULL)
+		/* Controller not enabled for this cgroup */
+		return;
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+
+		for (i = 0; i < nr; i++) {
+			len = strlen(keys[i]);
+			if (!strncmp(line, keys[i], len) && (line[len] == ' ')) {
+				sscanf(line + len + 1, "%llu", values[i]);
+				break;
+			}
+		}
+	}
+
+	fclose(fp);
 }
 
 /*
- * **************************************************************************
- * Display some kernel tables values for current task.
+ ***************************************************************************
+ * Read total stall times from a PSI file of a cgroup (cpu.pressure,
+ * memory.pressure or io.pressure).
  *
  * IN:
- * @disp_avg	TRUE if average stats are displayed.
- * @plist	Pointer on current process in list.
- * @pstc	Pointer on current statistics data sample for current process.
+ * @filename	Name of the file to read.
+ *
+ * OUT:
+ * @some	Total time (in us) during which at least some tasks were stalled.
+ * @full	Total time (in us) during which all tasks were stalled.
+ *		May be NULL if not needed.
  ***************************************************************************
  */
-void write_plain_pid_ktab_data(int disp_avg, struct st_pid *plist,
-			       struct pid_stats *pstc)
+void read_cgroup_pressure(char *filename, unsigned long long *some,
+			  unsigned long long *full)
 {
-	if (disp_avg) {
-		cprintf_f(NO_UNIT, FALSE, 2, 7, 0,
-			  (double) plist->total_threads / plist->tf_asum_count,
-			  NO_PID_FD(plist->flags) ?
-			  -1.0 :
-			  (double) plist->total_fd_nr / plist->tf_asum_count);
-	}
-	else {
-		cprintf_u64(NO_UNIT, 1, 7,
-			    (unsigned long long) pstc->threads);
-		if (NO_PID_FD(plist->flags)) {
-			/* /proc/#/fd directory not readable */
-			cprintf_s(IS_ZERO, " %7s", "-1");
+	FILE *fp;
+	char line[256], *p;
+
+	if ((fp = fopen(filename, "r")) == NULL)
+		/* PSI not enabled */
+		return;
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+
+		if ((p = strstr(line, " total=")) == NULL)
+			continue;
+
+		if (!strncmp(line, "some ", 5)) {
+			sscanf(p + 7, "%llu", some);
 		}
-		else {
-			cprintf_u64(NO_UNIT, 1, 7,
-				    (unsigned long long) pstc->fd_nr);
+		else if (full && !strncmp(line, "full ", 5)) {
+			sscanf(p + 7, "%llu", full);
 		}
 	}
-}
+
+	fclose(fp);
+}
+
+/*
+ ***************************************************************************
+ * Read io.stat file of a cgroup and sum the number of bytes read and
+ * written for all the devices.
+ *
+ * IN:
+ * @filename	Name of the file to read.
+ * @cgs		Structure where stats are to be saved.
+ ***************************************************************************
+ */
+void read_cgroup_io(char *filename, struct cg_stats *cgs)
+{
+	FILE *fp;
+	char line[1024], *p;
+	unsigned long long val;
+
+	if ((fp = fopen(filename, "r")) == NULL)
+		/* I/O controller not enabled for this cgroup */
+		return;
+
+	/* Lines look like: "8:0 rbytes=... wbytes=... rios=... wios=... ..." */
+	while (fgets(line, sizeof(line), fp) != NULL) {
+
+		if (((p = strstr(line, " rbytes=")) != NULL) &&
+		    (sscanf(p + 8, "%llu", &val) == 1)) {
+			cgs->rbytes += val;
+		}
+		if (((p = strstr(line, " wbytes=")) != NULL) &&
+		    (sscanf(p + 8, "%llu", &val) == 1)) {
+			cgs->wbytes += val;
+		}
+	}
+
+	fclose(fp);
+}
+
+/*
+ ***************************************************************************
+ * Read the stats of a cgroup needed to display requested activities.
+ *
+ * IN:
+ * @dirpath	Directory of the cgroup.
+ * @cgs		Structure where stats are to be saved.
+ ***************************************************************************
+ */
+void read_cgroup(char *dirpath, struct cg_stats *cgs)
+{
+	FILE *fp;
+	char filename[MAX_PF_NAME];
+	unsigned long long pgfault = 0, pgmajfault = 0, mem_bytes;
+
+	if (DISPLAY_CPU(actflag)) {
+		const char *keys[] = {"usage_usec", "user_usec", "system_usec"};
+		unsigned long long *values[] = {&cgs->usage_usec, &cgs->user_usec,
+						&cgs->system_usec};
+
+		snprintf(filename, sizeof(filename), "%s/%s", dirpath, CG_CPU_STAT);
+		read_cgroup_keyed(filename, keys, values, 3);
+
+		snprintf(filename, sizeof(filename), "%s/%s", dirpath, CG_CPU_PRESSURE);
+		read_cgroup_pressure(filename, &cgs->cpu_some, NULL);
+	}
+
+	if (DISPLAY_MEM(actflag)) {
+		const char *keys[] = {"pgfault", "pgmajfault"};
+		unsigned long long *values[] = {&pgfault, &pgmajfault};
+
+		/* memory.current doesn't exist for the root cgroup */
+		snprintf(filename, sizeof(filename), "%s/%s", dirpath, CG_MEM_CURRENT);
+		if ((fp = fopen(filename, "r")) != NULL) {
+			if (fscanf(fp, "%llu", &mem_bytes) == 1) {
+				cgs->mem_kb = mem_bytes >> 10;
+			}
+			fclose(fp);
+		}
+
+		/* pgfault includes major faults */
+		snprintf(filename, sizeof(filename), "%s/%s", dirpath, CG_MEM_STAT);
+		read_cgroup_keyed(filename, keys, values, 2);
+		cgs->majflt = pgmajfault;
+		cgs->minflt = (pgfault > pgmajfault) ? pgfault - pgmajfault : 0;
+
+		snprintf(filename, sizeof(filename), "%s/%s", dirpath, CG_MEM_PRESSURE);
+		read_cgroup_pressure(filename, &cgs->mem_some, &cgs->mem_full);
+	}
+
+	if (DISPLAY_IO(actflag)) {
+		snprintf(filename, sizeof(filename), "%s/%s", dirpath, CG_IO_STAT);
+		read_cgroup_io(filename, cgs);
+
+		snprintf(filename, sizeof(filename), "%s/%s", dirpath, CG_IO_PRESSURE);
+		read_cgroup_pressure(filename, &cgs->io_some, &cgs->io_full);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Look for a cgroup in the hash table and add it if not found.
+ *
+ * IN:
+ * @path	Path of the cgroup, relative to the cgroup root.
+ *
+ * RETURNS:
+ * Pointer on the st_cgroup structure of the cgroup.
+ ***************************************************************************
+ */
+struct st_cgroup *add_cgroup(char *path)
+{
+	struct st_cgroup *cg, **bucket;
+	unsigned int hash;
+
+	hash = hash_str(path, strlen(path));
+
+	bucket = &cg_htab[hash & (CG_HASH_SIZE - 1)];
+	for (cg = *bucket; cg != NULL; cg = cg->hnext) {
+		if ((cg->hash == hash) && !strcmp(cg->path, path))
+			return cg;
+	}
+
+	/* Counters of a new cgroup start from 0 */
+	if ((cg = (struct st_cgroup *) calloc(1, sizeof(struct st_cgroup) +
+					       strlen(path) + 1)) == NULL) {
+		perror("calloc");
+		exit(4);
+	}
+	cg->hash = hash;
+	strcpy(cg->path, path);
+	cg->hnext = *bucket;
+	*bucket = cg;
+
+	return cg;
+}
+
+/*
+ ***************************************************************************
+ * Walk the cgroup hierarchy from a given cgroup, and read the stats of
+ * the cgroups which match the pattern entered with option --cgroup and
+ * whose depth is not greater than that entered with option --cgroup-depth.
+ *
+ * IN:
+ * @dirpath	Directory of the cgroup. Its contents are restored before
+ *		the function returns.
+ * @len		Length of @dirpath.
+ * @depth	Depth of the cgroup (0 for the root cgroup).
+ * @curr	Index in array for current sample statistics.
+ ***************************************************************************
+ */
+void walk_cgroups(char *dirpath, size_t len, int depth, int curr)
+{
+	DIR *dir;
+	struct dirent *drp;
+	struct st_cgroup *cg;
+	char *path;
+	size_t nlen;
+
+	if ((dir = __opendir(dirpath)) == NULL)
+		/* Cgroup removed in the meantime, or not a directory */
+		return;
+
+	path = (len > strlen(cg_root)) ? dirpath + strlen(cg_root) : "/";
+
+	if (!cg_pattern || !fnmatch(cg_pattern, path, FNM_PATHNAME)) {
+		cg = add_cgroup(path);
+		cg->exist = TRUE;
+		memset(&cg->cgstats[curr], 0, CG_STATS_SIZE);
+		read_cgroup(dirpath, &cg->cgstats[curr]);
+
+		if (cg_nr >= cg_alloc) {
+			cg_alloc += CG_TAB_CHUNK;
+			SREALLOC(cg_tab, struct st_cgroup *,
+				 cg_alloc * sizeof(struct st_cgroup *));
+		}
+		cg_tab[cg_nr++] = cg;
+	}
+
+	if ((cg_depth < 0) || (depth < cg_depth)) {
+		/* Child cgroups are the subdirectories of current one */
+		while ((drp = __readdir(dir)) != NULL) {
+
+			if (((drp->d_type != DT_DIR) && (drp->d_type != DT_UNKNOWN)) ||
+			    !strcmp(drp->d_name, ".") || !strcmp(drp->d_name, ".."))
+				continue;
+
+			nlen = strlen(drp->d_name);
+			if (len + nlen + 2 > MAX_PF_NAME)
+				continue;
+
+			dirpath[len] = '/';
+			strcpy(dirpath + len + 1, drp->d_name);
+			walk_cgroups(dirpath, len + nlen + 1, depth + 1, curr);
+			dirpath[len] = '\0';
+		}
+	}
+
+	__closedir(dir);
+}
+
+/*
+ ***************************************************************************
+ * Compare the paths of two cgroups. Used by qsort() to sort the cgroups
+ * to display.
+ *
+ * IN:
+ * @a	Pointer on first cgroup.
+ * @b	Pointer on second cgroup.
+ *
+ * RETURNS:
+ * An integer less than, equal to, or greater than zero if the path of the
+ * first cgroup is found to be less than, to match, or be greater than that
+ * of the second one.
+ ***************************************************************************
+ */
+int compare_cgroups(const void *a, const void *b)
+{
+	return strcmp((*(struct st_cgroup **) a)->path,
+		      (*(struct st_cgroup **) b)->path);
+}
+
+/*
+ ***************************************************************************
+ * Read the stats of the cgroups to display (option --cgroup).
+ * Only the files of the cgroup v2 hierarchy are read, so that the cost
+ * doesn't depend on the number of tasks running in the cgroups.
+ *
+ * IN:
+ * @curr	Index in array for current sample statistics.
+ ***************************************************************************
+ */
+void read_cgroup_stats(int curr)
+{
+	char dirpath[MAX_PF_NAME];
+	struct st_cgroup *cg, **pcg;
+	int i;
+
+	/* Every cgroup is potentially nonexistent */
+	for (i = 0; i < CG_HASH_SIZE; i++) {
+		for (cg = cg_htab[i]; cg != NULL; cg = cg->hnext) {
+			cg->exist = FALSE;
+		}
+	}
+
+	cg_nr = 0;
+	strcpy(dirpath, cg_root);
+	walk_cgroups(dirpath, strlen(dirpath), 0, curr);
+
+	/* Free cgroups which have been removed */
+	for (i = 0; i < CG_HASH_SIZE; i++) {
+		pcg = &cg_htab[i];
+		while ((cg = *pcg) != NULL) {
+			if (!cg->exist) {
+				*pcg = cg->hnext;
+				free(cg);
+			}
+			else {
+				pcg = &cg->hnext;
+			}
+		}
+	}
+
+	/* Cgroups are displayed sorted by path */
+	qsort(cg_tab, cg_nr, sizeof(struct st_cgroup *), compare_cgroups);
+}
+
+/*
+ ***************************************************************************
+ * Free the structures used to save cgroups stats.
+ ***************************************************************************
+ */
+void sfree_cgroups(void)
+{
+	struct st_cgroup *cg;
+	int i;
+
+	for (i = 0; i < CG_HASH_SIZE; i++) {
+		while ((cg = cg_htab[i]) != NULL) {
+			cg_htab[i] = cg->hnext;
+			free(cg);
+		}
+	}
+	free(cg_tab);
+}
+
+/*
+ ***************************************************************************
+ * Read various stats.
+ *
+ * IN:
+ * @curr	Index in array for current sample statistics.
+ ***************************************************************************
+ */
+void read_stats(int curr)
+{
+	pid_t pid;
+	struct st_pid *plist;
+	struct stats_cpu *st_cpu;
+	int i, proc_nr, first = 0;
+
+	/*
+	 * Allocate two structures for CPU statistics.
+	 * No need to init them (done by read_stat_cpu() function).
+	 */
+	if ((st_cpu = (struct stats_cpu *) malloc(STATS_CPU_SIZE * 2)) == NULL) {
+		perror("malloc");
+		exit(4);
+	}
+	/* Read statistics for CPUs "all" */
+	read_stat_cpu(st_cpu, 1);
+
+	/*
+	 * Compute the total number of jiffies spent by all processors.
+	 * NB: Don't add cpu_guest/cpu_guest_nice because cpu_user/cpu_nice
+	 * already include them.
+	 */
+	tot_jiffies[curr] = st_cpu->cpu_user + st_cpu->cpu_nice +
+			    st_cpu->cpu_sys + st_cpu->cpu_idle +
+			    st_cpu->cpu_iowait + st_cpu->cpu_hardirq +
+			    st_cpu->cpu_steal + st_cpu->cpu_softirq;
+	free(st_cpu);
+
+	if (DISPLAY_CGROUP(pidflag)) {
+		/* Read cgroups stats instead of tasks ones */
+		read_cgroup_stats(curr);
+		return;
+	}
+
+	/*
+	 * First look for the tasks whose stats are to be read.
+	 * Stats are then read in parallel.
+	 */
+	scan_nr = 0;
+
+	if (DISPLAY_ALL_PID(pidflag)) {
+		DIR *dir;
+		struct dirent *drp;
+
+		/* Open /proc directory */
+		if ((dir = __opendir(PROC)) == NULL) {
+			perror("opendir");
+			exit(4);
+		}
+
+		/* Get directory entries */
+		while ((drp = __readdir(dir)) != NULL) {
+
+			if (!isdigit(drp->d_name[0])) {
+				continue;
+			}
+
+			pid = atoi(drp->d_name);
+
+			plist = add_list_pid(&pid_list, pid, 0);
+			if (!plist)
+				continue;
+			add_scan_task(plist);
+		}
+
+		/* Close /proc directory */
+		__closedir(dir);
+	}
+
+	else {
+		/* Read stats for each PID in the list */
+		for (plist = pid_list; plist != NULL; plist = plist->next) {
+
+			if (plist->tgid)
+				/*
+				 * Ignore TIDs.
+				 * The user can only enter PIDs on the command line.
+				 * If there is a TID then this is because the user has
+				 * used option -t, and the TID has been inserted in the
+				 * list by add_scan_threads() function below.
+				 */
+				continue;
+
+			add_scan_task(plist);
+		}
+	}
+
+	if (DISPLAY_TID(pidflag)) {
+		proc_nr = scan_nr;
+
+		if (PROCESS_STRING(pidflag) || DISPLAY_STACK(actflag)) {
+			/*
+			 * Read processes first: With option -G threads are
+			 * displayed only if their process is, so there is no
+			 * need to read threads of processes which don't match.
+			 * With option -s threads get their stack sizes from
+			 * their process.
+			 */
+			read_scan_tasks(curr, 0);
+			first = proc_nr;
+		}
+
+		/* Read stats for threads in task subdirectory */
+		for (i = 0; i < proc_nr; i++) {
+			if (first && PROCESS_STRING(pidflag) &&
+			    (!scan_tab[i]->exist || IS_PID_REJECTED(scan_tab[i]->flags)))
+				continue;
+			add_scan_threads(scan_tab[i]->pid);
+		}
+	}
+
+	tgid_read_first = (first > 0);
+	read_scan_tasks(curr, first);
+	tgid_read_first = FALSE;
+
+	/* Free unused PID structures */
+	sfree_pid(&pid_list, FALSE);
+
+	/* Sort list again if new tasks have been added */
+	sort_pid_list(&pid_list);
+}
+
+/*
+ ***************************************************************************
+ * Get current PID to display.
+ * First, check that PID exists and that it has not been rejected by
+ * options -C, -G or -U when its stats were read. *Then* check that it's
+ * an active process and, with option -G, that the thread leader has been
+ * displayed (in case PID is a thread).
+ *
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @activity	Current activity to display (CPU, memory...).
+ * 		Can be more than one if stats are displayed on one line.
+ * @pflag	Flag indicating whether stats are to be displayed for
+ * 		individual tasks or for all their children.
+ * @plist	Pointer on the linked list where PID is saved.
+ *
+ * RETURNS:
+ *  0 if PID no longer exists.
+ * -1 if PID exists but should not be displayed.
+ *  1 if PID can be displayed.
+ ***************************************************************************
+ */
+int get_pid_to_display(int prev, int curr, unsigned int activity, unsigned int pflag,
+		       struct st_pid *plist)
+{
+	struct pid_stats *pstc = plist->pstats[curr], *pstp = plist->pstats[prev];
+
+	if (!plist->exist)
+		/* PID no longer exists */
+		return 0;
+
+	if (!plist->tgid) {
+		/* This is group leader: Set it as not displayed by default */
+		plist->flags &= ~F_PID_DISPLAYED;
+	}
+
+	if (IS_PID_REJECTED(plist->flags))
+		/* Task doesn't match options -C, -G or -U */
+		return -1;
+
+	if (IS_PID_PREV_REJECTED(plist->flags))
+		/*
+		 * Task was rejected at previous sample: Not all its stats
+		 * were read then. Wait for next sample to display it.
+		 */
+		return -1;
+
+	if (top_nr && !IS_PID_TOP(plist->flags))
+		/* Task is not among those with the highest values (option --top) */
+		return -1;
+
+	if ((DISPLAY_ALL_PID(pidflag) || DISPLAY_TID(pidflag)) &&
+		DISPLAY_ACTIVE_PID(pidflag)) {
+		int isActive = FALSE;
+
+		/* Check that it's an "active" process */
+		if (DISPLAY_CPU(activity)) {
+			/* User time already includes guest time */
+			if ((pstc->utime != pstp->utime) ||
+			    (pstc->stime != pstp->stime)) {
+				isActive = TRUE;
+			}
+			else {
+				/*
+				 * Process is not active but if we are showing
+				 * child stats then we need to look there.
+				 */
+				if (DISPLAY_CHILD_STATS(pflag)) {
+					/* User time already includes guest time */
+					if ((pstc->cutime != pstp->cutime) ||
+					    (pstc->cstime != pstp->cstime)) {
+						isActive = TRUE;
+					}
+				}
+			}
+		}
+
+		if (DISPLAY_MEM(activity) && !isActive) {
+			if ((pstc->minflt != pstp->minflt) ||
+			    (pstc->majflt != pstp->majflt)) {
+				isActive = TRUE;
+			}
+			else {
+				if (DISPLAY_TASK_STATS(pflag)) {
+					if ((pstc->vsz != pstp->vsz) ||
+					    (pstc->rss != pstp->rss)) {
+						isActive = TRUE;
+					}
+				}
+				else if (DISPLAY_CHILD_STATS(pflag)) {
+					if ((pstc->cminflt != pstp->cminflt) ||
+					    (pstc->cmajflt != pstp->cmajflt)) {
+						isActive = TRUE;
+					}
+				}
+			}
+		}
+
+		if (DISPLAY_STACK(activity) && !isActive) {
+			if ((pstc->stack_size != pstp->stack_size) ||
+			    (pstc->stack_ref != pstp->stack_ref)) {
+				isActive = TRUE;
+			}
+		}
+
+		if (DISPLAY_IO(activity) && !isActive) {
+			if (pstc->blkio_swapin_delays !=
+			     pstp->blkio_swapin_delays) {
+				isActive = TRUE;
+			}
+			if (!(NO_PID_IO(plist->flags)) && !isActive) {
+				/* /proc/#/io file should exist to check I/O stats */
+				if ((pstc->read_bytes  != pstp->read_bytes)  ||
+				    (pstc->write_bytes != pstp->write_bytes) ||
+				    (pstc->cancelled_write_bytes !=
+				     pstp->cancelled_write_bytes)) {
+					isActive = TRUE;
+				}
+			}
+		}
+
+		if (DISPLAY_CTXSW(activity) && !isActive) {
+			if ((pstc->nvcsw  != pstp->nvcsw) ||
+			    (pstc->nivcsw != pstp->nivcsw)) {
+				isActive = TRUE;
+			}
+		}
+
+		if (DISPLAY_RT(activity) && !isActive) {
+			if ((pstc->priority != pstp->priority) ||
+			    (pstc->policy != pstp->policy)) {
+				isActive = TRUE;
+			}
+		}
+
+		if (DISPLAY_KTAB(activity) && !isActive &&
+			!(NO_PID_FD(plist->flags))) {	/* /proc/#/fd directory should be readable */
+			if ((pstc->threads != pstp->threads) ||
+			    (pstc->fd_nr != pstp->fd_nr)) {
+				isActive = TRUE;
+			}
+		}
+
+		/* If PID isn't active for any of the activities then return */
+		if (!isActive)
+			return -1;
+	}
+
+	/* Options -C, -G and -U have already been checked when stats were read */
+	if (PROCESS_STRING(pidflag) && plist->tgid && !IS_PID_DISPLAYED(plist->tgid->flags))
+		/* This pid is a thread and is not part of a process to display */
+		return -1;
+
+	plist->flags |= F_PID_DISPLAYED;
+	return 1;
+}
+
+/*
+ ***************************************************************************
+ * Display UID/username, PID and TID.
+ *
+ * IN:
+ * @plist	Pointer on the linked list where PID is saved.
+ * @c		No-op character.
+ ***************************************************************************
+ */
+void __print_line_id(struct st_pid *plist, char c)
+{
+	char format[32];
+	char *name;
+
+	if (DISPLAY_USERNAME(pidflag) && ((name = get_user_name(plist->uid)) != NULL)) {
+		cprintf_in(IS_STR, " %8s", name, 0);
+	}
+	else {
+		cprintf_in(IS_INT, " %5d", "", plist->uid);
+	}
+
+	if (DISPLAY_TID(pidflag)) {
+		if (plist->tgid) {
+			/* This is a TID */
+			if (IS_PID_DISPLAYED(plist->tgid->flags)) {
+				/*
+				 * Its TGID has previously been displayed.
+				 * We can just display a dash for the TGID then
+				 * the TID number, i.e. "   -     <TID> "
+				 */
+				sprintf(format, "         %c %%9u", c);
+			}
+			else {
+				/*
+				 * Its TGID didn't meet the conditions to be displayed.
+				 * So we have to specify to which TGID the current TID is
+				 * linked, i.e. " <TGID>   <TID> "
+				 */
+				strcpy(format, " %9u");
+				cprintf_in(IS_INT, format, "", plist->tgid->pid);
+			}
+		}
+		else {
+			/* This is a PID (TGID) */
+			sprintf(format, " %%9u         %c", c);
+		}
+	}
+	else {
+		strcpy(format, " %9u");
+	}
+
+	cprintf_in(IS_INT, format, "", plist->pid);
+}
+
+/*
+ ***************************************************************************
+ * Display timestamp, PID and TID.
+ *
+ * IN:
+ * @timestamp	Current timestamp.
+ * @plist	Pointer on the linked list where PID is saved.
+ ***************************************************************************
+ */
+void print_line_id(char *timestamp, struct st_pid *plist)
+{
+	printf("%-11s", timestamp);
+	__print_line_id(plist, '-');
+}
+
+/*
+ * **************************************************************************
+ * Display UID/username, PID and TID in JSON format.
+ *
+ * IN:
+ * @tab		Number of tabs to print.
+ * @plist	Pointer on the linked list where PID is saved.
+ ***************************************************************************
+ */
+void print_json_line_id(int tab, struct st_pid *plist)
+{
+	char format[32];
+	char *name;
+
+	xprintf0(tab, "{\"");
+
+	if (DISPLAY_USERNAME(pidflag)) {
+		printf("USER");
+	}
+	else {
+		printf("UID");
+	}
+	printf("\": \"");
+
+	if (DISPLAY_USERNAME(pidflag) && ((name = get_user_name(plist->uid)) != NULL)) {
+		printf("%s", name);
+	}
+	else {
+		printf("%d", plist->uid);
+	}
+	printf("\", \"");
+
+	if (DISPLAY_TID(pidflag)) {
+		printf("TGID");
+	}
+	else {
+		printf("PID");
+	}
+	printf("\": \"");
+
+	strcpy(format, "%u");
+	if (DISPLAY_TID(pidflag)) {
+		if (plist->tgid) {
+			/* This is a TID */
+			printf("%u\", \"TID\": \"", plist->tgid->pid);
+		}
+		else {
+			/* This is a PID (TGID) */
+			strcpy(format, "%u\", \"TID\": \"");
+		}
+	}
+
+	printf(format, plist->pid);
+	printf("\", ");
+}
+
+/*
+ * **************************************************************************
+ * Display CPU statistics data for current task.
+ *
+ * IN:
+ * @disp_avg	TRUE if average stats are displayed.
+ * @pstc	Pointer on current statistics data sample for current process.
+ * @pstp	Pointer on previous statistics data sampe for current process.
+ * @itv		Interval of time in 1/100th of a second.
+ * @deltot_jiffies
+ *		Number of jiffies spent on the interval by all processors.
+ ***************************************************************************
+ */
+void write_plain_pid_task_cpu_data(int disp_avg,
+				   struct pid_stats *pstc, struct pid_stats *pstp,
+				   unsigned long long itv,
+				   unsigned long long deltot_jiffies)
+{
+	cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 5, 7, 2,
+		    (pstc->utime - pstc->gtime) < (pstp->utime - pstp->gtime) ||
+		    (pstc->utime < pstc->gtime) || (pstp->utime < pstp->gtime) ?
+		    0.0 :
+		    SP_VALUE(pstp->utime - pstp->gtime,
+			     pstc->utime - pstc->gtime, itv * HZ / 100),
+		    SP_VALUE(pstp->stime, pstc->stime, itv * HZ / 100),
+		    SP_VALUE(pstp->gtime, pstc->gtime, itv * HZ / 100),
+		    SP_VALUE(pstp->wtime, pstc->wtime, itv * HZ / 100),
+		    /* User time already includes guest time */
+		    IRIX_MODE_OFF(pidflag) ?
+		    SP_VALUE(pstp->utime + pstp->stime,
+			     pstc->utime + pstc->stime, deltot_jiffies) :
+			     SP_VALUE(pstp->utime + pstp->stime,
+				      pstc->utime + pstc->stime, itv * HZ / 100));
+
+	if (!disp_avg) {
+		cprintf_in(IS_INT, "   %3d", "", pstc->processor);
+	}
+	else {
+		cprintf_in(IS_STR, "%s", "     -", 0);
+	}
+}
+
+/*
+ * **************************************************************************
+ * Display memory statistics data for current task.
+ *
+ * IN:
+ * @disp_avg	TRUE if average stats are displayed.
+ * @plist	Pointer on current process in list.
+ * @pstc	Pointer on current statistics data sample for current process.
+ * @pstp	Pointer on previous statistics data sampe for current process.
+ * @itv		Interval of time in 1/100th of a second.
+ ***************************************************************************
+ */
+void write_plain_pid_task_memory_data(int disp_avg, struct st_pid *plist,
+				      struct pid_stats *pstc, struct pid_stats *pstp,
+				      unsigned long long itv)
+{
+	cprintf_f(NO_UNIT, FALSE, 2, 9, 2,
+		  S_VALUE(pstp->minflt, pstc->minflt, itv),
+		  S_VALUE(pstp->majflt, pstc->majflt, itv));
+
+	if (disp_avg) {
+		cprintf_f(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, FALSE, 2, 7, 0,
+			  (double) plist->total_vsz / plist->rt_asum_count,
+			  (double) plist->total_rss / plist->rt_asum_count);
+
+		cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 1, 6, 2,
+			    tlmkb ?
+			    SP_VALUE(0, plist->total_rss / plist->rt_asum_count, tlmkb)
+			    : 0.0);
+	}
+	else {
+		cprintf_u64(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, 2, 7,
+			    (unsigned long long) pstc->vsz,
+			    (unsigned long long) pstc->rss);
+
+		cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 1, 6, 2,
+			    tlmkb ? SP_VALUE(0, pstc->rss, tlmkb) : 0.0);
+	}
+}
+
+/*
+ * **************************************************************************
+ * Display stack size statistics data for current task.
+ *
+ * IN:
+ * @disp_avg	TRUE if average stats are displayed.
+ * @plist	Pointer on current process in list.
+ * @pstc	Pointer on current statistics data sample for current process.
+ ***************************************************************************
+ */
+void write_plain_pid_stack_data(int disp_avg, struct st_pid *plist,
+				struct pid_stats *pstc)
+{
+	if (disp_avg) {
+		cprintf_f(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, FALSE, 2, 7, 0,
+			  (double) plist->total_stack_size / plist->sk_asum_count,
+			  (double) plist->total_stack_ref  / plist->sk_asum_count);
+	}
+	else {
+		cprintf_u64(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, 2, 7,
+			    (unsigned long long) pstc->stack_size,
+			    (unsigned long long) pstc->stack_ref);
+	}
+}
+
+/*
+ * **************************************************************************
+ * Display I/O statistics data for current task.
+ *
+ * IN:
+ * @disp_avg	TRUE if average stats are displayed.
+ * @plist	Pointer on current process in list.
+ * @pstc	Pointer on current statistics data sample for current process.
+ * @pstp	Pointer on previous statistics data sampe for current process.
+ * @itv		Interval of time in 1/100th of a second.
+ ***************************************************************************
+ */
+void write_plain_pid_io_data(int disp_avg, struct st_pid *plist,
+			     struct pid_stats *pstc, struct pid_stats *pstp,
+			     unsigned long long itv)
+{
+	char dstr[32];
+	double rbytes, wbytes, cbytes;
+
+	if (!NO_PID_IO(plist->flags)) {
+		rbytes = S_VALUE(pstp->read_bytes,  pstc->read_bytes, itv);
+		wbytes = S_VALUE(pstp->write_bytes, pstc->write_bytes, itv);
+		cbytes = S_VALUE(pstp->cancelled_write_bytes,
+				 pstc->cancelled_write_bytes, itv);
+		if (!DISPLAY_UNIT(pidflag)) {
+			rbytes /= 1024;
+			wbytes /= 1024;
+			cbytes /= 1024;
+		}
+		cprintf_f(DISPLAY_UNIT(pidflag) ? UNIT_BYTE : NO_UNIT, FALSE, 3, 9, 2,
+			  rbytes, wbytes, cbytes);
+	}
+	else {
+		/* I/O file not readable (permission denied or file non existent) */
+		sprintf(dstr, " %9.2f %9.2f %9.2f", -1.0, -1.0, -1.0);
+		cprintf_s(IS_ZERO, "%s", dstr);
+	}
+	/* I/O delays come from another file (/proc/#/stat) */
+	if (disp_avg) {
+		cprintf_f(NO_UNIT, FALSE, 1, 7, 0,
+			  (double) (pstc->blkio_swapin_delays - pstp->blkio_swapin_delays) /
+			  plist->delay_asum_count);
+	}
+	else {
+		cprintf_u64(NO_UNIT, 1, 7,
+			    (unsigned long long) (pstc->blkio_swapin_delays - pstp->blkio_swapin_delays));
+	}
+}
+
+/*
+ * **************************************************************************
+ * Display context switches statistics data for current task.
+ *
+ * IN:
+ * @pstc	Pointer on current statistics data sample for current process.
+ * @pstp	Pointer on previous statistics data sampe for current process.
+ * @itv		Interval of time in 1/100th of a second.
+ ***************************************************************************
+ */
+void write_plain_pid_ctxswitch_data(struct pid_stats *pstc, struct pid_stats *pstp,
+				    unsigned long long itv)
+{
+	cprintf_f(NO_UNIT, FALSE, 2, 9, 2,
+		  S_VALUE(pstp->nvcsw,  pstc->nvcsw,  itv),
+		  S_VALUE(pstp->nivcsw, pstc->nivcsw, itv));
+}
+
+/*
+ * **************************************************************************
+ * Display some kernel tables values for current task.
+ *
+ * IN:
+ * @disp_avg	TRUE if average stats are displayed.
+ * @plist	Pointer on current process in list.
+ * @pstc	Pointer on current statistics data sample for current process.
+ ***************************************************************************
+ */
+void write_plain_pid_ktab_data(int disp_avg, struct st_pid *plist,
+			       struct pid_stats *pstc)
+{
+	if (disp_avg) {
+		cprintf_f(NO_UNIT, FALSE, 2, 7, 0,
+			  (double) plist->total_threads / plist->tf_asum_count,
+			  NO_PID_FD(plist->flags) ?
+			  -1.0 :
+			  (double) plist->total_fd_nr / plist->tf_asum_count);
+	}
+	else {
+		cprintf_u64(NO_UNIT, 1, 7,
+			    (unsigned long long) pstc->threads);
+		if (NO_PID_FD(plist->flags)) {
+			/* /proc/#/fd directory not readable */
+			cprintf_s(IS_ZERO, " %7s", "-1");
+		}
+		else {
+			cprintf_u64(NO_UNIT, 1, 7,
+				    (unsigned long long) pstc->fd_nr);
+		}
+	}
+}
+
+/*
+ * **************************************************************************
+ * Display scheduling priority and policy information for current task.
+ *
+ * IN:
+ * @pstc	Pointer on current statistics data sample for current process.
+ ***************************************************************************
+ */
+void write_plain_pid_rt_data(struct pid_stats *pstc)
+{
+	cprintf_u64(NO_UNIT, 1, 4,
+		    (unsigned long long) pstc->priority);
+	cprintf_s(IS_STR, " %6s", GET_POLICY(pstc->policy));
+}
+
+/*
+ ***************************************************************************
+ * Display all statistics for tasks in one line format.
+ *
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @dis		TRUE if a header line must be printed.
+ * @prev_string	String displayed at the beginning of a header line. This is
+ * 		the timestamp of the previous sample.
+ * @curr_string	String displayed at the beginning of current sample stats.
+ * 		This is the timestamp of the current sample.
+ * @itv		Interval of time in jiffies.
+ * @deltot_jiffies
+ *		Number of jiffies spent on the interval by all processors.
+ *
+ * RETURNS:
+ * 0 if all the processes to display have terminated.
+ * <> 0 if there are still some processes left to display.
+ ***************************************************************************
+ */
+int write_pid_task_all_stats(int prev, int curr, int dis,
+			     char *prev_string, char *curr_string,
+			     unsigned long long itv,
+			     unsigned long long deltot_jiffies)
+{
+	struct pid_stats *pstc, *pstp;
+	struct st_pid *plist;
+	int again = 0;
+
+	if (dis) {
+		PRINT_ID_HDR(prev_string, pidflag);
+		if (DISPLAY_CPU(actflag)) {
+			printf("    %%usr %%system  %%guest   %%wait    %%CPU   CPU");
+		}
+		if (DISPLAY_MEM(actflag)) {
+			printf("  minflt/s  majflt/s     VSZ     RSS   %%MEM");
+		}
+		if (DISPLAY_STACK(actflag)) {
+			printf(" StkSize  StkRef");
+		}
+		if (DISPLAY_IO(actflag)) {
+			printf("   kB_rd/s   kB_wr/s kB_ccwr/s iodelay");
+		}
+		if (DISPLAY_CTXSW(actflag)) {
+			printf("   cswch/s nvcswch/s");
+		}
+		if (DISPLAY_KTAB(actflag)) {
+			printf(" threads   fd-nr");
+		}
+		if (DISPLAY_RT(actflag)) {
+			printf(" prio policy");
+		}
+		printf("  Command\n");
+	}
+
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+
+		if (get_pid_to_display(prev, curr, actflag, P_TASK, plist) <= 0)
+			continue;
+
+		print_line_id(curr_string, plist);
+
+		pstc = plist->pstats[curr];
+		pstp = plist->pstats[prev];
+
+		if (DISPLAY_CPU(actflag)) {
+			write_plain_pid_task_cpu_data(FALSE, pstc, pstp, itv,
+						      deltot_jiffies);
+		}
+
+		if (DISPLAY_MEM(actflag)) {
+			write_plain_pid_task_memory_data(FALSE, plist,
+							 pstc, pstp, itv);
+		}
+
+		if (DISPLAY_STACK(actflag)) {
+			write_plain_pid_stack_data(FALSE, plist, pstc);
+		}
+
+		if (DISPLAY_IO(actflag)) {
+			write_plain_pid_io_data(FALSE, plist, pstc, pstp, itv);
+		}
+
+		if (DISPLAY_CTXSW(actflag)) {
+			write_plain_pid_ctxswitch_data(pstc, pstp, itv);
+		}
+
+		if (DISPLAY_KTAB(actflag)) {
+			write_plain_pid_ktab_data(FALSE, plist, pstc);
+		}
+
+		if (DISPLAY_RT(actflag)) {
+			write_plain_pid_rt_data(pstc);
+		}
+
+		print_comm(plist);
+		again = 1;
+	}
+
+	return again;
+}
+
+/*
+ * **************************************************************************
+ * Display CPU statistics for the children of current task.
+ *
+ * IN:
+ * @disp_avg	TRUE if average stats are displayed.
+ * @plist	Pointer on current process in list.
+ * @pstc	Pointer on current statistics data sample for current process.
+ * @pstp	Pointer on previous statistics data sampe for current process.
+ ***************************************************************************
+ */
+void write_plain_pid_child_cpu_data(int disp_avg, struct st_pid *plist,
+				    struct pid_stats *pstc, struct pid_stats *pstp)
+{
+	if (disp_avg) {
+		cprintf_f(NO_UNIT, FALSE, 3, 9, 0,
+			  (pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) <
+			  (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime) ||
+			  (pstc->utime + pstc->cutime < pstc->gtime + pstc->cgtime) ||
+			  (pstp->utime + pstp->cutime < pstp->gtime + pstp->cgtime) ?
+			  0.0 :
+			  (double) ((pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) -
+				    (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime)) /
+				   (HZ * plist->uc_asum_count) * 1000,
+			  (double) ((pstc->stime + pstc->cstime) -
+				    (pstp->stime + pstp->cstime)) /
+				   (HZ * plist->uc_asum_count) * 1000,
+			  (double) ((pstc->gtime + pstc->cgtime) -
+				    (pstp->gtime + pstp->cgtime)) /
+				   (HZ * plist->uc_asum_count) * 1000);
+	}
+	else {
+		cprintf_f(NO_UNIT, FALSE, 3, 9, 0,
+			  (pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) <
+			  (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime) ||
+			  (pstc->utime + pstc->cutime < pstc->gtime + pstc->cgtime) ||
+			  (pstp->utime + pstp->cutime < pstp->gtime + pstp->cgtime) ?
+			  0.0 :
+			  (double) ((pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) -
+				    (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime)) /
+				   HZ * 1000,
+			  (double) ((pstc->stime + pstc->cstime) -
+				    (pstp->stime + pstp->cstime)) / HZ * 1000,
+			  (double) ((pstc->gtime + pstc->cgtime) -
+				    (pstp->gtime + pstp->cgtime)) / HZ * 1000);
+	}
+}
+
+/*
+ * **************************************************************************
+ * Display memory statistics for the children of current task.
+ *
+ * IN:
+ * @disp_avg	TRUE if average stats are displayed.
+ * @plist	Pointer on current process in list.
+ * @pstc	Pointer on current statistics data sample for current process.
+ * @pstp	Pointer on previous statistics data sampe for current process.
+ ***************************************************************************
+ */
+void write_plain_pid_child_memory_data(int disp_avg, struct st_pid *plist,
+				       struct pid_stats *pstc, struct pid_stats *pstp)
+{
+	if (disp_avg) {
+		cprintf_f(NO_UNIT, FALSE, 2, 9, 0,
+			  (double) ((pstc->minflt + pstc->cminflt) -
+				    (pstp->minflt + pstp->cminflt)) / plist->rc_asum_count,
+			  (double) ((pstc->majflt + pstc->cmajflt) -
+				    (pstp->majflt + pstp->cmajflt)) / plist->rc_asum_count);
+	}
+	else {
+		cprintf_u64(NO_UNIT, 2, 9,
+			    (unsigned long long) ((pstc->minflt + pstc->cminflt) - (pstp->minflt + pstp->cminflt)),
+			    (unsigned long long) ((pstc->majflt + pstc->cmajflt) - (pstp->majflt + pstp->cmajflt)));
+	}
+}
+
+/*
+ ***************************************************************************
+ * Display all statistics for tasks' children in one line format.
+ *
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @dis		TRUE if a header line must be printed.
+ * @prev_string	String displayed at the beginning of a header line. This is
+ * 		the timestamp of the previous sample.
+ * @curr_string	String displayed at the beginning of current sample stats.
+ * 		This is the timestamp of the current sample.
+ *
+ * RETURNS:
+ * 0 if all the processes to display have terminated.
+ * <> 0 if there are still some processes left to display.
+ ***************************************************************************
+ */
+int write_pid_child_all_stats(int prev, int curr, int dis,
+			      char *prev_string, char *curr_string)
+{
+	struct pid_stats *pstc, *pstp;
+	struct st_pid *plist;
+	int again = 0;
+
+	if (dis) {
+		PRINT_ID_HDR(prev_string, pidflag);
+		if (DISPLAY_CPU(actflag))
+			printf("    usr-ms system-ms  guest-ms");
+		if (DISPLAY_MEM(actflag))
+			printf(" minflt-nr majflt-nr");
+		printf("  Command\n");
+	}
+
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+
+		if (get_pid_to_display(prev, curr, actflag, P_CHILD, plist) <= 0)
+			continue;
+
+		print_line_id(curr_string, plist);
+
+		pstc = plist->pstats[curr];
+		pstp = plist->pstats[prev];
+
+		if (DISPLAY_CPU(actflag)) {
+			write_plain_pid_child_cpu_data(FALSE, plist, pstc, pstp);
+		}
+
+		if (DISPLAY_MEM(actflag)) {
+			write_plain_pid_child_memory_data(FALSE, plist, pstc, pstp);
+		}
+
+		print_comm(plist);
+		again = 1;
+	}
+
+	return again;
+}
+
+/*
+ ***************************************************************************
+ * Display CPU statistics for tasks.
+ *
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @dis		TRUE if a header line must be printed.
+ * @disp_avg	TRUE if average stats are displayed.
+ * @prev_string	String displayed at the beginning of a header line. This is
+ * 		the timestamp of the previous sample, or "Average" when
+ * 		displaying average stats.
+ * @curr_string	String displayed at the beginning of current sample stats.
+ * 		This is the timestamp of the current sample, or "Average"
+ * 		when displaying average stats.
+ * @itv		Interval of time in 1/100th of a second.
+ * @deltot_jiffies
+ *		Number of jiffies spent on the interval by all processors.
+ *
+ * RETURNS:
+ * 0 if all the processes to display have terminated.
+ * <> 0 if there are still some processes left to display.
+ ***************************************************************************
+ */
+int write_plain_pid_task_cpu_stats(int prev, int curr, int dis, int disp_avg,
+				   char *prev_string, char *curr_string,
+				   unsigned long long itv,
+				   unsigned long long deltot_jiffies)
+{
+	struct pid_stats *pstc, *pstp;
+	struct st_pid *plist;
+	int again = 0;
+
+	if (dis) {
+		PRINT_ID_HDR(prev_string, pidflag);
+		printf("    %%usr %%system  %%guest   %%wait    %%CPU   CPU  Command\n");
+	}
+
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+
+		if (get_pid_to_display(prev, curr, P_A_CPU, P_TASK, plist) <= 0)
+			continue;
+
+		print_line_id(curr_string, plist);
+
+		pstc = plist->pstats[curr];
+		pstp = plist->pstats[prev];
+
+		/* Write current process data */
+		write_plain_pid_task_cpu_data(disp_avg, pstc, pstp, itv,
+					      deltot_jiffies);
+
+		print_comm(plist);
+		again = 1;
+	}
+
+	return again;
+}
+
+/*
+ * **************************************************************************
+ * Display CPU statistics for tasks.
+ *
+ * IN:
+ * @tab		Number of tabs to print.
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @itv		Interval of time in 1/100th of a second.
+ * @deltot_jiffies
+ *		Number of jiffies spent on the interval by all processors.
+ * @follow	True if a previous set of stats has been displayed and should
+ *		be followed by a coma.
+ *
+ * OUT:
+ * @follow	Set to TRUE to indicate that a coma should be displayed
+ *		before next set of stats (if any).
+ *
+ * RETURNS:
+ * 0 if all the processes to display have terminated.
+ * <> 0 if there are still some processes left to display.
+ ***************************************************************************
+ */
+int write_json_pid_task_cpu_stats(int tab, int prev, int curr, unsigned long long itv,
+				  unsigned long long deltot_jiffies, int *follow)
+{
+	struct pid_stats *pstc, *pstp;
+	struct st_pid *plist;
+	int again = 0, next = FALSE;
+
+	if (*follow) {
+		printf(",\n");
+	}
+	xprintf(tab++, "\"task-cpu-load\": [");
+
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+
+		if (get_pid_to_display(prev, curr, P_A_CPU, P_TASK, plist) <= 0)
+			continue;
+
+		if (next) {
+			printf(",\n");
+		}
+		next = TRUE;
+
+		print_json_line_id(tab, plist);
+
+		pstc = plist->pstats[curr];
+		pstp = plist->pstats[prev];
+
+		printf("\"usr\": %.2f, \"system\": %.2f, \"guest\": %.2f, \"wait\": %.2f, "
+		       "\"cpu\": %.2f, \"cpu_nr\": %d, ",
+		       (pstc->utime - pstc->gtime) < (pstp->utime - pstp->gtime) ||
+		       (pstc->utime < pstc->gtime) || (pstp->utime < pstp->gtime) ?
+		       0.0 :
+		       SP_VALUE(pstp->utime - pstp->gtime,
+				pstc->utime - pstc->gtime, itv * HZ / 100),
+		       SP_VALUE(pstp->stime, pstc->stime, itv * HZ / 100),
+		       SP_VALUE(pstp->gtime, pstc->gtime, itv * HZ / 100),
+		       SP_VALUE(pstp->wtime, pstc->wtime, itv * HZ / 100),
+		       /* User time already includes guest time */
+		       IRIX_MODE_OFF(pidflag) ?
+		       SP_VALUE(pstp->utime + pstp->stime,
+				pstc->utime + pstc->stime, deltot_jiffies) :
+		       SP_VALUE(pstp->utime + pstp->stime,
+				 pstc->utime + pstc->stime, itv * HZ / 100),
+		       pstc->processor);
+
+		print_json_comm(plist);
+		again = 1;
+	}
+
+	printf("\n");
+	xprintf0(--tab, "]");
+	*follow = TRUE;
+
+	return again;
+}
 
 /*
  * **************************************************************************
- * Display scheduling priority and policy information for current task.
+ * Display CPU statistics for tasks.
  *
  * IN:
- * @pstc	Pointer on current statistics data sample for current process.
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @dis		TRUE if a header line must be printed.
+ * @disp_avg	TRUE if average stats are displayed.
+ * @prev_string	String displayed at the beginning of a header line. This is
+ * 		the timestamp of the previous sample, or "Average" when
+ * 		displaying average stats.
+ * @curr_string	String displayed at the beginning of current sample stats.
+ * 		This is the timestamp of the current sample, or "Average"
+ * 		when displaying average stats.
+ * @itv		Interval of time in 1/100th of a second.
+ * @deltot_jiffies
+ *		Number of jiffies spent on the interval by all processors.
+ * @tab		Number of tabs to print (JSON format only).
+ * @follow	True if a previous set of stats has been displayed and should
+ *		be followed by a coma (JSON format only).
+ *
+ * OUT:
+ * @follow	Set to TRUE to indicate that a coma should be displayed
+ *		before next set of stats (if any). JSON format only.
+ *
+ * RETURNS:
+ * 0 if all the processes to display have terminated.
+ * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-void write_plain_pid_rt_data(struct pid_stats *pstc)
+int write_pid_task_cpu_stats(int prev, int curr, int dis, int disp_avg,
+			     char *prev_string, char *curr_string,
+			     unsigned long long itv,
+			     unsigned long long deltot_jiffies, int tab, int *follow)
 {
-	cprintf_u64(NO_UNIT, 1, 4,
-		    (unsigned long long) pstc->priority);
-	cprintf_s(IS_STR, " %6s", GET_POLICY(pstc->policy));
+	if (DISPLAY_JSON_OUTPUT(xflags)) {
+		return write_json_pid_task_cpu_stats(tab, prev, curr, itv,
+						     deltot_jiffies, follow);
+	}
+	else {
+		return write_plain_pid_task_cpu_stats(prev, curr, dis, disp_avg,
+						      prev_string, curr_string, itv,
+						      deltot_jiffies);
+	}
 }
 
 /*
  ***************************************************************************
- * Display all statistics for tasks in one line format.
+ * Display CPU statistics for tasks' children.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
  * @dis		TRUE if a header line must be printed.
+ * @disp_avg	TRUE if average stats are displayed.
  * @prev_string	String displayed at the beginning of a header line. This is
- * 		the timestamp of the previous sample.
+ * 		the timestamp of the previous sample, or "Average" when
+ * 		displaying average stats.
  * @curr_string	String displayed at the beginning of current sample stats.
- * 		This is the timestamp of the current sample.
- * @itv		Interval of time in jiffies.
- * @deltot_jiffies
- *		Number of jiffies spent on the interval by all processors.
+ * 		This is the timestamp of the current sample, or "Average"
+ * 		when displaying average stats.
  *
  * RETURNS:
  * 0 if all the processes to display have terminated.
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_pid_task_all_stats(int prev, int curr, int dis,
-			     char *prev_string, char *curr_string,
-			     unsigned long long itv,
-			     unsigned long long deltot_jiffies)
+int write_plain_pid_child_cpu_stats(int prev, int curr, int dis, int disp_avg,
+				    char *prev_string, char *curr_string)
 {
 	struct pid_stats *pstc, *pstp;
 	struct st_pid *plist;
-	int again = 0;
+	int rc, again = 0;
 
 	if (dis) {
 		PRINT_ID_HDR(prev_string, pidflag);
-		if (DISPLAY_CPU(actflag)) {
-			printf("    %%usr %%system  %%guest   %%wait    %%CPU   CPU");
-		}
-		if (DISPLAY_MEM(actflag)) {
-			printf("  minflt/s  majflt/s     VSZ     RSS   %%MEM");
-		}
-		if (DISPLAY_STACK(actflag)) {
-			printf(" StkSize  StkRef");
-		}
-		if (DISPLAY_IO(actflag)) {
-			printf("   kB_rd/s   kB_wr/s kB_ccwr/s iodelay");
-		}
-		if (DISPLAY_CTXSW(actflag)) {
-			printf("   cswch/s nvcswch/s");
-		}
-		if (DISPLAY_KTAB(actflag)) {
-			printf(" threads   fd-nr");
-		}
-		if (DISPLAY_RT(actflag)) {
-			printf(" prio policy");
-		}
-		printf("  Command\n");
+		printf("    usr-ms system-ms  guest-ms  Command\n");
 	}
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if (get_pid_to_display(prev, curr, actflag, P_TASK, plist) <= 0)
+		if ((rc = get_pid_to_display(prev, curr, P_A_CPU, P_CHILD, plist)) == 0)
+			/* PID no longer exists */
 			continue;
 
-		print_line_id(curr_string, plist);
-
-		pstc = plist->pstats[curr];
-		pstp = plist->pstats[prev];
-
-		if (DISPLAY_CPU(actflag)) {
-			write_plain_pid_task_cpu_data(FALSE, pstc, pstp, itv,
-						      deltot_jiffies);
-		}
-
-		if (DISPLAY_MEM(actflag)) {
-			write_plain_pid_task_memory_data(FALSE, plist,
-							 pstc, pstp, itv);
-		}
-
-		if (DISPLAY_STACK(actflag)) {
-			write_plain_pid_stack_data(FALSE, plist, pstc);
+		/* This will be used to compute average */
+		if (!disp_avg) {
+			plist->uc_asum_count += 1;
 		}
 
-		if (DISPLAY_IO(actflag)) {
-			write_plain_pid_io_data(FALSE, plist, pstc, pstp, itv);
-		}
+		if (rc < 0)
+			/* PID should not be displayed */
+			continue;
 
-		if (DISPLAY_CTXSW(actflag)) {
-			write_plain_pid_ctxswitch_data(pstc, pstp, itv);
-		}
+		print_line_id(curr_string, plist);
 
-		if (DISPLAY_KTAB(actflag)) {
-			write_plain_pid_ktab_data(FALSE, plist, pstc);
-		}
+		pstc = plist->pstats[curr];
+		pstp = plist->pstats[prev];
 
-		if (DISPLAY_RT(actflag)) {
-			write_plain_pid_rt_data(pstc);
-		}
+		/* Write data for children of current task */
+		write_plain_pid_child_cpu_data(disp_avg, plist, pstc, pstp);
 
 		print_comm(plist);
 		again = 1;
@@ -1707,131 +3778,177 @@ int write_pid_task_all_stats(int prev, int curr, int dis,
 
 /*
  * **************************************************************************
- * Display CPU statistics for the children of current task.
+ * Display CPU statistics for tasks' children in JSON format.
  *
  * IN:
- * @disp_avg	TRUE if average stats are displayed.
- * @plist	Pointer on current process in list.
- * @pstc	Pointer on current statistics data sample for current process.
- * @pstp	Pointer on previous statistics data sampe for current process.
+ * @tab		Number of tabs to print.
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @follow	True if a previous set of stats has been displayed and should
+ *		be followed by a coma.
+ *
+ * OUT:
+ * @follow	Set to TRUE to indicate that a coma should be displayed
+ *		before next set of stats (if any).
+ *
+ * RETURNS:
+ * 0 if all the processes to display have terminated.
+ * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-void write_plain_pid_child_cpu_data(int disp_avg, struct st_pid *plist,
-				    struct pid_stats *pstc, struct pid_stats *pstp)
+int write_json_pid_child_cpu_stats(int tab, int prev, int curr, int *follow)
 {
-	if (disp_avg) {
-		cprintf_f(NO_UNIT, FALSE, 3, 9, 0,
-			  (pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) <
-			  (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime) ||
-			  (pstc->utime + pstc->cutime < pstc->gtime + pstc->cgtime) ||
-			  (pstp->utime + pstp->cutime < pstp->gtime + pstp->cgtime) ?
-			  0.0 :
-			  (double) ((pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) -
-				    (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime)) /
-				   (HZ * plist->uc_asum_count) * 1000,
-			  (double) ((pstc->stime + pstc->cstime) -
-				    (pstp->stime + pstp->cstime)) /
-				   (HZ * plist->uc_asum_count) * 1000,
-			  (double) ((pstc->gtime + pstc->cgtime) -
-				    (pstp->gtime + pstp->cgtime)) /
-				   (HZ * plist->uc_asum_count) * 1000);
+	struct pid_stats *pstc, *pstp;
+	struct st_pid *plist;
+	int rc, again = 0, next = FALSE;
+
+	if (*follow) {
+		printf(",\n");
 	}
-	else {
-		cprintf_f(NO_UNIT, FALSE, 3, 9, 0,
-			  (pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) <
-			  (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime) ||
-			  (pstc->utime + pstc->cutime < pstc->gtime + pstc->cgtime) ||
-			  (pstp->utime + pstp->cutime < pstp->gtime + pstp->cgtime) ?
-			  0.0 :
-			  (double) ((pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) -
-				    (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime)) /
-				   HZ * 1000,
-			  (double) ((pstc->stime + pstc->cstime) -
-				    (pstp->stime + pstp->cstime)) / HZ * 1000,
-			  (double) ((pstc->gtime + pstc->cgtime) -
-				    (pstp->gtime + pstp->cgtime)) / HZ * 1000);
+	xprintf(tab++, "\"child-cpu-load\": [");
+
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+
+		if ((rc = get_pid_to_display(prev, curr, P_A_CPU, P_CHILD, plist)) <= 0)
+			/* PID no longer exists or should not be displayed */
+			continue;
+
+		if (next) {
+			printf(",\n");
+		}
+		next = TRUE;
+
+		print_json_line_id(tab, plist);
+
+		pstc = plist->pstats[curr];
+		pstp = plist->pstats[prev];
+
+		printf("\"usr-ms\": %.0f, \"system-ms\": %.0f, \"guest-ms\": %.0f, ",
+		       (pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) <
+		       (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime) ||
+		       (pstc->utime + pstc->cutime < pstc->gtime + pstc->cgtime) ||
+		       (pstp->utime + pstp->cutime < pstp->gtime + pstp->cgtime) ?
+		       0.0 :
+		       (double) ((pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) -
+		       (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime)) /
+		       HZ * 1000,
+		       (double) ((pstc->stime + pstc->cstime) -
+				 (pstp->stime + pstp->cstime)) / HZ * 1000,
+		       (double) ((pstc->gtime + pstc->cgtime) -
+				 (pstp->gtime + pstp->cgtime)) / HZ * 1000);
+
+		print_json_comm(plist);
+		again = 1;
 	}
+
+	printf("\n");
+	xprintf0(--tab, "]");
+	*follow = TRUE;
+
+	return again;
 }
 
 /*
  * **************************************************************************
- * Display memory statistics for the children of current task.
+ * Display CPU statistics for tasks' children.
  *
  * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @dis		TRUE if a header line must be printed.
  * @disp_avg	TRUE if average stats are displayed.
- * @plist	Pointer on current process in list.
- * @pstc	Pointer on current statistics data sample for current process.
- * @pstp	Pointer on previous statistics data sampe for current process.
+ * @prev_string	String displayed at the beginning of a header line. This is
+ * 		the timestamp of the previous sample, or "Average" when
+ * 		displaying average stats.
+ * @curr_string	String displayed at the beginning of current sample stats.
+ * 		This is the timestamp of the current sample, or "Average"
+ * 		when displaying average stats.
+ * @tab		Number of tabs to print (JSON format only).
+ * @follow	True if a previous set of stats has been displayed and should
+ *		be followed by a coma (JSON format only).
+ *
+ * OUT:
+ * @follow	Set to TRUE to indicate that a coma should be displayed
+ *		before next set of stats (if any). JSON format only.
+ *
+ * RETURNS:
+ * 0 if all the processes to display have terminated.
+ * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-void write_plain_pid_child_memory_data(int disp_avg, struct st_pid *plist,
-				       struct pid_stats *pstc, struct pid_stats *pstp)
+int write_pid_child_cpu_stats(int prev, int curr, int dis, int disp_avg,
+			      char *prev_string, char *curr_string, int tab,
+			      int *follow)
 {
-	if (disp_avg) {
-		cprintf_f(NO_UNIT, FALSE, 2, 9, 0,
-			  (double) ((pstc->minflt + pstc->cminflt) -
-				    (pstp->minflt + pstp->cminflt)) / plist->rc_asum_count,
-			  (double) ((pstc->majflt + pstc->cmajflt) -
-				    (pstp->majflt + pstp->cmajflt)) / plist->rc_asum_count);
+	if (DISPLAY_JSON_OUTPUT(xflags)) {
+		return write_json_pid_child_cpu_stats(tab, prev, curr, follow);
 	}
 	else {
-		cprintf_u64(NO_UNIT, 2, 9,
-			    (unsigned long long) ((pstc->minflt + pstc->cminflt) - (pstp->minflt + pstp->cminflt)),
-			    (unsigned long long) ((pstc->majflt + pstc->cmajflt) - (pstp->majflt + pstp->cmajflt)));
+		return write_plain_pid_child_cpu_stats(prev, curr, dis, disp_avg,
+						       prev_string, curr_string);
 	}
 }
 
 /*
  ***************************************************************************
- * Display all statistics for tasks' children in one line format.
+ * Display memory statistics for tasks.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
  * @dis		TRUE if a header line must be printed.
+ * @disp_avg	TRUE if average stats are displayed.
  * @prev_string	String displayed at the beginning of a header line. This is
- * 		the timestamp of the previous sample.
+ * 		the timestamp of the previous sample, or "Average" when
+ * 		displaying average stats.
  * @curr_string	String displayed at the beginning of current sample stats.
- * 		This is the timestamp of the current sample.
+ * 		This is the timestamp of the current sample, or "Average"
+ * 		when displaying average stats.
+ * @itv		Interval of time in 1/100th of a second.
  *
  * RETURNS:
  * 0 if all the processes to display have terminated.
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_pid_child_all_stats(int prev, int curr, int dis,
-			      char *prev_string, char *curr_string)
+int write_plain_pid_task_memory_stats(int prev, int curr, int dis, int disp_avg,
+				      char *prev_string, char *curr_string,
+				      unsigned long long itv)
 {
 	struct pid_stats *pstc, *pstp;
 	struct st_pid *plist;
-	int again = 0;
+	int rc, again = 0;
 
 	if (dis) {
 		PRINT_ID_HDR(prev_string, pidflag);
-		if (DISPLAY_CPU(actflag))
-			printf("    usr-ms system-ms  guest-ms");
-		if (DISPLAY_MEM(actflag))
-			printf(" minflt-nr majflt-nr");
-		printf("  Command\n");
+		printf("  minflt/s  majflt/s     VSZ     RSS   %%MEM  Command\n");
 	}
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if (get_pid_to_display(prev, curr, actflag, P_CHILD, plist) <= 0)
+		if ((rc = get_pid_to_display(prev, curr, P_A_MEM, P_TASK, plist)) == 0)
+			/* PID no longer exists */
 			continue;
 
-		print_line_id(curr_string, plist);
-
 		pstc = plist->pstats[curr];
 		pstp = plist->pstats[prev];
 
-		if (DISPLAY_CPU(actflag)) {
-			write_plain_pid_child_cpu_data(FALSE, plist, pstc, pstp);
+		/* This will be used to compute average */
+		if (!disp_avg) {
+			plist->total_vsz += pstc->vsz;
+			plist->total_rss += pstc->rss;
+			plist->rt_asum_count += 1;
 		}
 
-		if (DISPLAY_MEM(actflag)) {
-			write_plain_pid_child_memory_data(FALSE, plist, pstc, pstp);
-		}
+		if (rc < 0)
+			/* PID should not be displayed */
+			continue;
+
+		print_line_id(curr_string, plist);
+
+		/* Write current process data */
+		write_plain_pid_task_memory_data(disp_avg, plist,
+						 pstc, pstp, itv);
 
 		print_comm(plist);
 		again = 1;
@@ -1841,8 +3958,84 @@ int write_pid_child_all_stats(int prev, int curr, int dis,
 }
 
 /*
+ * **************************************************************************
+ * Display memory statistics for tasks in JSON format.
+ *
+ * IN:
+ * @tab		Number of tabs to print.
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @dis		TRUE if a header line must be printed.
+ * @disp_avg	TRUE if average stats are displayed.
+ * @prev_string	String displayed at the beginning of a header line. This is
+ * 		the timestamp of the previous sample, or "Average" when
+ * 		displaying average stats.
+ * @curr_string	String displayed at the beginning of current sample stats.
+ * 		This is the timestamp of the current sample, or "Average"
+ * 		when displaying average stats.
+ * @itv		Interval of time in 1/100th of a second.
+ * @follow	True if a previous set of stats has been displayed and should
+ *		be followed by a coma.
+ *
+ * OUT:
+ * @follow	Set to TRUE to indicate that a coma should be displayed
+ *		before next set of stats (if any).
+ *
+ * RETURNS:
+ * 0 if all the processes to display have terminated.
+ * <> 0 if there are still some processes left to display.
  ***************************************************************************
- * Display CPU statistics for tasks.
+ */
+int write_json_pid_task_memory_stats(int tab, int prev, int curr,
+				     unsigned long long itv, int *follow)
+{
+	struct pid_stats *pstc, *pstp;
+	struct st_pid *plist;
+	int rc, again = 0, next = FALSE;
+
+	if (*follow) {
+		printf(",\n");
+	}
+	xprintf(tab++, "\"task-memory\": [");
+
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+
+		if ((rc = get_pid_to_display(prev, curr, P_A_MEM, P_TASK, plist)) <= 0)
+			/* PID no longer exists or should not be displayed */
+			continue;
+
+		if (next) {
+			printf(",\n");
+		}
+		next = TRUE;
+
+		print_json_line_id(tab, plist);
+
+		pstc = plist->pstats[curr];
+		pstp = plist->pstats[prev];
+
+		printf("\"minflt/s\": %.2f, \"majflt/s\": %.2f, "
+		       "\"VSZ\": %llu, \"RSS\": %llu, \"MEM\": %.2f, ",
+		       S_VALUE(pstp->minflt, pstc->minflt, itv),
+		       S_VALUE(pstp->majflt, pstc->majflt, itv),
+		       (unsigned long long) pstc->vsz,
+		       (unsigned long long) pstc->rss,
+		       tlmkb ? SP_VALUE(0, pstc->rss, tlmkb) : 0.0);
+
+		print_json_comm(plist);
+		again = 1;
+	}
+
+	printf("\n");
+	xprintf0(--tab, "]");
+	*follow = TRUE;
+
+	return again;
+}
+
+/*
+ * **************************************************************************
+ * Display memory statistics for tasks.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
@@ -1856,31 +4049,79 @@ int write_pid_child_all_stats(int prev, int curr, int dis,
  * 		This is the timestamp of the current sample, or "Average"
  * 		when displaying average stats.
  * @itv		Interval of time in 1/100th of a second.
- * @deltot_jiffies
- *		Number of jiffies spent on the interval by all processors.
+ * @tab		Number of tabs to print (JSON format only).
+ * @follow	True if a previous set of stats has been displayed and should
+ *		be followed by a coma (JSON format only).
+ *
+ * OUT:
+ * @follow	Set to TRUE to indicate that a coma should be displayed
+ *		before next set of stats (if any). JSON format only.
  *
  * RETURNS:
  * 0 if all the processes to display have terminated.
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_plain_pid_task_cpu_stats(int prev, int curr, int dis, int disp_avg,
-				   char *prev_string, char *curr_string,
-				   unsigned long long itv,
-				   unsigned long long deltot_jiffies)
+int write_pid_task_memory_stats(int prev, int curr, int dis, int disp_avg,
+				char *prev_string, char *curr_string,
+				unsigned long long itv, int tab, int *follow)
+{
+	if (DISPLAY_JSON_OUTPUT(xflags)) {
+		return write_json_pid_task_memory_stats(tab, prev, curr,
+							itv, follow);
+	}
+	else {
+		return write_plain_pid_task_memory_stats(prev, curr, dis, disp_avg,
+							 prev_string, curr_string, itv);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Display memory statistics for tasks' children.
+ *
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @dis		TRUE if a header line must be printed.
+ * @disp_avg	TRUE if average stats are displayed.
+ * @prev_string	String displayed at the beginning of a header line. This is
+ * 		the timestamp of the previous sample, or "Average" when
+ * 		displaying average stats.
+ * @curr_string	String displayed at the beginning of current sample stats.
+ * 		This is the timestamp of the current sample, or "Average"
+ * 		when displaying average stats.
+ *
+ * RETURNS:
+ * 0 if all the processes to display have terminated.
+ * <> 0 if there are still some processes left to display.
+ ***************************************************************************
+ */
+int write_plain_pid_child_memory_stats(int prev, int curr, int dis, int disp_avg,
+				       char *prev_string, char *curr_string)
 {
 	struct pid_stats *pstc, *pstp;
 	struct st_pid *plist;
-	int again = 0;
+	int rc, again = 0;
 
 	if (dis) {
 		PRINT_ID_HDR(prev_string, pidflag);
-		printf("    %%usr %%system  %%guest   %%wait    %%CPU   CPU  Command\n");
+		printf(" minflt-nr majflt-nr  Command\n");
 	}
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if (get_pid_to_display(prev, curr, P_A_CPU, P_TASK, plist) <= 0)
+		if ((rc = get_pid_to_display(prev, curr, P_A_MEM, P_CHILD, plist)) == 0)
+			/* PID no longer exists */
+			continue;
+
+		/* This will be used to compute average */
+		if (!disp_avg) {
+			plist->rc_asum_count += 1;
+		}
+
+		if (rc < 0)
+			/* PID should not be displayed */
 			continue;
 
 		print_line_id(curr_string, plist);
@@ -1888,9 +4129,8 @@ int write_plain_pid_task_cpu_stats(int prev, int curr, int dis, int disp_avg,
 		pstc = plist->pstats[curr];
 		pstp = plist->pstats[prev];
 
-		/* Write current process data */
-		write_plain_pid_task_cpu_data(disp_avg, pstc, pstp, itv,
-					      deltot_jiffies);
+		/* Write data for current task */
+		write_plain_pid_child_memory_data(disp_avg, plist, pstc, pstp);
 
 		print_comm(plist);
 		again = 1;
@@ -1901,15 +4141,12 @@ int write_plain_pid_task_cpu_stats(int prev, int curr, int dis, int disp_avg,
 
 /*
  * **************************************************************************
- * Display CPU statistics for tasks.
+ * Display memory statistics for tasks' children in JSON format.
  *
  * IN:
  * @tab		Number of tabs to print.
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
- * @itv		Interval of time in 1/100th of a second.
- * @deltot_jiffies
- *		Number of jiffies spent on the interval by all processors.
  * @follow	True if a previous set of stats has been displayed and should
  *		be followed by a coma.
  *
@@ -1922,21 +4159,21 @@ int write_plain_pid_task_cpu_stats(int prev, int curr, int dis, int disp_avg,
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_json_pid_task_cpu_stats(int tab, int prev, int curr, unsigned long long itv,
-				  unsigned long long deltot_jiffies, int *follow)
+int write_json_pid_child_memory_stats(int tab, int prev, int curr, int *follow)
 {
 	struct pid_stats *pstc, *pstp;
 	struct st_pid *plist;
-	int again = 0, next = FALSE;
+	int rc, again = 0, next = FALSE;
 
 	if (*follow) {
 		printf(",\n");
 	}
-	xprintf(tab++, "\"task-cpu-load\": [");
+	xprintf(tab++, "\"child-memory\": [");
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if (get_pid_to_display(prev, curr, P_A_CPU, P_TASK, plist) <= 0)
+		if ((rc = get_pid_to_display(prev, curr, P_A_MEM, P_CHILD, plist)) <= 0)
+			/* PID no longer exists or should not be displayed */
 			continue;
 
 		if (next) {
@@ -1949,23 +4186,9 @@ int write_json_pid_task_cpu_stats(int tab, int prev, int curr, unsigned long lon
 		pstc = plist->pstats[curr];
 		pstp = plist->pstats[prev];
 
-		printf("\"usr\": %.2f, \"system\": %.2f, \"guest\": %.2f, \"wait\": %.2f, "
-		       "\"cpu\": %.2f, \"cpu_nr\": %d, ",
-		       (pstc->utime - pstc->gtime) < (pstp->utime - pstp->gtime) ||
-		       (pstc->utime < pstc->gtime) || (pstp->utime < pstp->gtime) ?
-		       0.0 :
-		       SP_VALUE(pstp->utime - pstp->gtime,
-				pstc->utime - pstc->gtime, itv * HZ / 100),
-		       SP_VALUE(pstp->stime, pstc->stime, itv * HZ / 100),
-		       SP_VALUE(pstp->gtime, pstc->gtime, itv * HZ / 100),
-		       SP_VALUE(pstp->wtime, pstc->wtime, itv * HZ / 100),
-		       /* User time already includes guest time */
-		       IRIX_MODE_OFF(pidflag) ?
-		       SP_VALUE(pstp->utime + pstp->stime,
-				pstc->utime + pstc->stime, deltot_jiffies) :
-		       SP_VALUE(pstp->utime + pstp->stime,
-				 pstc->utime + pstc->stime, itv * HZ / 100),
-		       pstc->processor);
+		printf("\"minflt-nr\": %llu, \"majflt-nr\": %llu, ",
+		       (unsigned long long) ((pstc->minflt + pstc->cminflt) - (pstp->minflt + pstp->cminflt)),
+		       (unsigned long long) ((pstc->majflt + pstc->cmajflt) - (pstp->majflt + pstp->cmajflt)));
 
 		print_json_comm(plist);
 		again = 1;
@@ -1980,7 +4203,7 @@ int write_json_pid_task_cpu_stats(int tab, int prev, int curr, unsigned long lon
 
 /*
  * **************************************************************************
- * Display CPU statistics for tasks.
+ * Display memory statistics for tasks' children.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
@@ -1993,9 +4216,6 @@ int write_json_pid_task_cpu_stats(int tab, int prev, int curr, unsigned long lon
  * @curr_string	String displayed at the beginning of current sample stats.
  * 		This is the timestamp of the current sample, or "Average"
  * 		when displaying average stats.
- * @itv		Interval of time in 1/100th of a second.
- * @deltot_jiffies
- *		Number of jiffies spent on the interval by all processors.
  * @tab		Number of tabs to print (JSON format only).
  * @follow	True if a previous set of stats has been displayed and should
  *		be followed by a coma (JSON format only).
@@ -2009,25 +4229,22 @@ int write_json_pid_task_cpu_stats(int tab, int prev, int curr, unsigned long lon
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_pid_task_cpu_stats(int prev, int curr, int dis, int disp_avg,
-			     char *prev_string, char *curr_string,
-			     unsigned long long itv,
-			     unsigned long long deltot_jiffies, int tab, int *follow)
+int write_pid_child_memory_stats(int prev, int curr, int dis, int disp_avg,
+				 char *prev_string, char *curr_string, int tab,
+				 int *follow)
 {
 	if (DISPLAY_JSON_OUTPUT(xflags)) {
-		return write_json_pid_task_cpu_stats(tab, prev, curr, itv,
-						     deltot_jiffies, follow);
+		return write_json_pid_child_memory_stats(tab, prev, curr, follow);
 	}
 	else {
-		return write_plain_pid_task_cpu_stats(prev, curr, dis, disp_avg,
-						      prev_string, curr_string, itv,
-						      deltot_jiffies);
+		return write_plain_pid_child_memory_stats(prev, curr, dis, disp_avg,
+							  prev_string, curr_string);
 	}
 }
 
 /*
  ***************************************************************************
- * Display CPU statistics for tasks' children.
+ * Display stack size statistics for tasks.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
@@ -2046,27 +4263,31 @@ int write_pid_task_cpu_stats(int prev, int curr, int dis, int disp_avg,
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_plain_pid_child_cpu_stats(int prev, int curr, int dis, int disp_avg,
-				    char *prev_string, char *curr_string)
+int write_plain_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
+				char *prev_string, char *curr_string)
 {
-	struct pid_stats *pstc, *pstp;
+	struct pid_stats *pstc;
 	struct st_pid *plist;
 	int rc, again = 0;
 
 	if (dis) {
 		PRINT_ID_HDR(prev_string, pidflag);
-		printf("    usr-ms system-ms  guest-ms  Command\n");
+		printf(" StkSize  StkRef  Command\n");
 	}
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if ((rc = get_pid_to_display(prev, curr, P_A_CPU, P_CHILD, plist)) == 0)
+		if ((rc = get_pid_to_display(prev, curr, P_A_STACK, P_NULL, plist)) == 0)
 			/* PID no longer exists */
 			continue;
 
+		pstc = plist->pstats[curr];
+
 		/* This will be used to compute average */
 		if (!disp_avg) {
-			plist->uc_asum_count += 1;
+			plist->total_stack_size += pstc->stack_size;
+			plist->total_stack_ref  += pstc->stack_ref;
+			plist->sk_asum_count += 1;
 		}
 
 		if (rc < 0)
@@ -2075,11 +4296,8 @@ int write_plain_pid_child_cpu_stats(int prev, int curr, int dis, int disp_avg,
 
 		print_line_id(curr_string, plist);
 
-		pstc = plist->pstats[curr];
-		pstp = plist->pstats[prev];
-
-		/* Write data for children of current task */
-		write_plain_pid_child_cpu_data(disp_avg, plist, pstc, pstp);
+		/* Write current process data */
+		write_plain_pid_stack_data(disp_avg, plist, pstc);
 
 		print_comm(plist);
 		again = 1;
@@ -2090,7 +4308,7 @@ int write_plain_pid_child_cpu_stats(int prev, int curr, int dis, int disp_avg,
 
 /*
  * **************************************************************************
- * Display CPU statistics for tasks' children in JSON format.
+ * Display stack size statistics for tasks in JSON format.
  *
  * IN:
  * @tab		Number of tabs to print.
@@ -2108,20 +4326,20 @@ int write_plain_pid_child_cpu_stats(int prev, int curr, int dis, int disp_avg,
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_json_pid_child_cpu_stats(int tab, int prev, int curr, int *follow)
+int write_json_pid_stack_stats(int tab, int prev, int curr, int *follow)
 {
-	struct pid_stats *pstc, *pstp;
+	struct pid_stats *pstc;
 	struct st_pid *plist;
 	int rc, again = 0, next = FALSE;
 
 	if (*follow) {
 		printf(",\n");
 	}
-	xprintf(tab++, "\"child-cpu-load\": [");
+	xprintf(tab++, "\"stack\": [");
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if ((rc = get_pid_to_display(prev, curr, P_A_CPU, P_CHILD, plist)) <= 0)
+		if ((rc = get_pid_to_display(prev, curr, P_A_STACK, P_NULL, plist)) <= 0)
 			/* PID no longer exists or should not be displayed */
 			continue;
 
@@ -2133,21 +4351,10 @@ int write_json_pid_child_cpu_stats(int tab, int prev, int curr, int *follow)
 		print_json_line_id(tab, plist);
 
 		pstc = plist->pstats[curr];
-		pstp = plist->pstats[prev];
 
-		printf("\"usr-ms\": %.0f, \"system-ms\": %.0f, \"guest-ms\": %.0f, ",
-		       (pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) <
-		       (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime) ||
-		       (pstc->utime + pstc->cutime < pstc->gtime + pstc->cgtime) ||
-		       (pstp->utime + pstp->cutime < pstp->gtime + pstp->cgtime) ?
-		       0.0 :
-		       (double) ((pstc->utime + pstc->cutime - pstc->gtime - pstc->cgtime) -
-		       (pstp->utime + pstp->cutime - pstp->gtime - pstp->cgtime)) /
-		       HZ * 1000,
-		       (double) ((pstc->stime + pstc->cstime) -
-				 (pstp->stime + pstp->cstime)) / HZ * 1000,
-		       (double) ((pstc->gtime + pstc->cgtime) -
-				 (pstp->gtime + pstp->cgtime)) / HZ * 1000);
+		printf("\"StkSize\": %llu, \"StkRef\": %llu, ",
+		       (unsigned long long) pstc->stack_size,
+		       (unsigned long long) pstc->stack_ref);
 
 		print_json_comm(plist);
 		again = 1;
@@ -2162,7 +4369,7 @@ int write_json_pid_child_cpu_stats(int tab, int prev, int curr, int *follow)
 
 /*
  * **************************************************************************
- * Display CPU statistics for tasks' children.
+ * Display stack size statistics for tasks.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
@@ -2188,22 +4395,21 @@ int write_json_pid_child_cpu_stats(int tab, int prev, int curr, int *follow)
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_pid_child_cpu_stats(int prev, int curr, int dis, int disp_avg,
-			      char *prev_string, char *curr_string, int tab,
-			      int *follow)
+int write_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
+			  char *prev_string, char *curr_string, int tab, int *follow)
 {
 	if (DISPLAY_JSON_OUTPUT(xflags)) {
-		return write_json_pid_child_cpu_stats(tab, prev, curr, follow);
+		return write_json_pid_stack_stats(tab, prev, curr, follow);
 	}
 	else {
-		return write_plain_pid_child_cpu_stats(prev, curr, dis, disp_avg,
-						       prev_string, curr_string);
+		return write_plain_pid_stack_stats(prev, curr, dis, disp_avg,
+						   prev_string, curr_string);
 	}
 }
 
 /*
  ***************************************************************************
- * Display memory statistics for tasks.
+ * Display I/O statistics.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
@@ -2223,9 +4429,9 @@ int write_pid_child_cpu_stats(int prev, int curr, int dis, int disp_avg,
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_plain_pid_task_memory_stats(int prev, int curr, int dis, int disp_avg,
-				      char *prev_string, char *curr_string,
-				      unsigned long long itv)
+int write_plain_pid_io_stats(int prev, int curr, int dis, int disp_avg,
+			     char *prev_string, char *curr_string,
+			     unsigned long long itv)
 {
 	struct pid_stats *pstc, *pstp;
 	struct st_pid *plist;
@@ -2233,23 +4439,18 @@ int write_plain_pid_task_memory_stats(int prev, int curr, int dis, int disp_avg,
 
 	if (dis) {
 		PRINT_ID_HDR(prev_string, pidflag);
-		printf("  minflt/s  majflt/s     VSZ     RSS   %%MEM  Command\n");
+		printf("   kB_rd/s   kB_wr/s kB_ccwr/s iodelay  Command\n");
 	}
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if ((rc = get_pid_to_display(prev, curr, P_A_MEM, P_TASK, plist)) == 0)
+		if ((rc = get_pid_to_display(prev, curr, P_A_IO, P_NULL, plist)) == 0)
 			/* PID no longer exists */
 			continue;
 
-		pstc = plist->pstats[curr];
-		pstp = plist->pstats[prev];
-
-		/* This will be used to compute average */
+		/* This will be used to compute average delays */
 		if (!disp_avg) {
-			plist->total_vsz += pstc->vsz;
-			plist->total_rss += pstc->rss;
-			plist->rt_asum_count += 1;
+			plist->delay_asum_count += 1;
 		}
 
 		if (rc < 0)
@@ -2258,9 +4459,11 @@ int write_plain_pid_task_memory_stats(int prev, int curr, int dis, int disp_avg,
 
 		print_line_id(curr_string, plist);
 
-		/* Write current process data */
-		write_plain_pid_task_memory_data(disp_avg, plist,
-						 pstc, pstp, itv);
+		pstc = plist->pstats[curr];
+		pstp = plist->pstats[prev];
+
+		/* Write statistics for current task */
+		write_plain_pid_io_data(disp_avg, plist, pstc, pstp, itv);
 
 		print_comm(plist);
 		again = 1;
@@ -2271,20 +4474,12 @@ int write_plain_pid_task_memory_stats(int prev, int curr, int dis, int disp_avg,
 
 /*
  * **************************************************************************
- * Display memory statistics for tasks in JSON format.
+ * Display I/O statistics in JSON format.
  *
  * IN:
  * @tab		Number of tabs to print.
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
- * @dis		TRUE if a header line must be printed.
- * @disp_avg	TRUE if average stats are displayed.
- * @prev_string	String displayed at the beginning of a header line. This is
- * 		the timestamp of the previous sample, or "Average" when
- * 		displaying average stats.
- * @curr_string	String displayed at the beginning of current sample stats.
- * 		This is the timestamp of the current sample, or "Average"
- * 		when displaying average stats.
  * @itv		Interval of time in 1/100th of a second.
  * @follow	True if a previous set of stats has been displayed and should
  *		be followed by a coma.
@@ -2298,21 +4493,22 @@ int write_plain_pid_task_memory_stats(int prev, int curr, int dis, int disp_avg,
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_json_pid_task_memory_stats(int tab, int prev, int curr,
-				     unsigned long long itv, int *follow)
+int write_json_pid_io_stats(int tab, int prev, int curr, unsigned long long itv,
+			    int *follow)
 {
 	struct pid_stats *pstc, *pstp;
 	struct st_pid *plist;
-	int rc, again = 0, next = FALSE;
+	int rc, again = 0,  next = FALSE;
+	double rbytes, wbytes, cbytes;
 
 	if (*follow) {
 		printf(",\n");
 	}
-	xprintf(tab++, "\"task-memory\": [");
+	xprintf(tab++, "\"io\": [");
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if ((rc = get_pid_to_display(prev, curr, P_A_MEM, P_TASK, plist)) <= 0)
+		if ((rc = get_pid_to_display(prev, curr, P_A_IO, P_NULL, plist)) <= 0)
 			/* PID no longer exists or should not be displayed */
 			continue;
 
@@ -2326,13 +4522,23 @@ int write_json_pid_task_memory_stats(int tab, int prev, int curr,
 		pstc = plist->pstats[curr];
 		pstp = plist->pstats[prev];
 
-		printf("\"minflt/s\": %.2f, \"majflt/s\": %.2f, "
-		       "\"VSZ\": %llu, \"RSS\": %llu, \"MEM\": %.2f, ",
-		       S_VALUE(pstp->minflt, pstc->minflt, itv),
-		       S_VALUE(pstp->majflt, pstc->majflt, itv),
-		       (unsigned long long) pstc->vsz,
-		       (unsigned long long) pstc->rss,
-		       tlmkb ? SP_VALUE(0, pstc->rss, tlmkb) : 0.0);
+		if (!NO_PID_IO(plist->flags)) {
+			rbytes = S_VALUE(pstp->read_bytes,  pstc->read_bytes, itv);
+			wbytes = S_VALUE(pstp->write_bytes, pstc->write_bytes, itv);
+			cbytes = S_VALUE(pstp->cancelled_write_bytes,
+					 pstc->cancelled_write_bytes, itv);
+			printf("\"kB_rd/s\": %.2f, \"kB_wr/s\": %.2f, \"kB_ccwr/s\": %.2f, ",
+			       rbytes / 1024,
+			       wbytes / 1024,
+			       cbytes / 1024);
+		}
+		else {
+			/* I/O file not readable (permission denied or file non existent) */
+			printf("\"kB_rd/s\": -1.00, \"kB_wr/s\": -1.00, \"kB_ccwr/s\": -1.00, ");
+		}
+		/* I/O delays come from another file (/proc/#/stat) */
+		printf("\"iodelay\": %llu, ",
+		       (unsigned long long) (pstc->blkio_swapin_delays - pstp->blkio_swapin_delays));
 
 		print_json_comm(plist);
 		again = 1;
@@ -2347,7 +4553,7 @@ int write_json_pid_task_memory_stats(int tab, int prev, int curr,
 
 /*
  * **************************************************************************
- * Display memory statistics for tasks.
+ * Display I/O statistics.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
@@ -2374,66 +4580,57 @@ int write_json_pid_task_memory_stats(int tab, int prev, int curr,
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_pid_task_memory_stats(int prev, int curr, int dis, int disp_avg,
-				char *prev_string, char *curr_string,
-				unsigned long long itv, int tab, int *follow)
+int write_pid_io_stats(int prev, int curr, int dis, int disp_avg,
+		       char *prev_string, char *curr_string,
+		       unsigned long long itv, int tab, int *follow)
 {
 	if (DISPLAY_JSON_OUTPUT(xflags)) {
-		return write_json_pid_task_memory_stats(tab, prev, curr,
-							itv, follow);
+		return write_json_pid_io_stats(tab, prev, curr, itv, follow);
 	}
 	else {
-		return write_plain_pid_task_memory_stats(prev, curr, dis, disp_avg,
-							 prev_string, curr_string, itv);
+		return write_plain_pid_io_stats(prev, curr, dis, disp_avg,
+						prev_string, curr_string, itv);
 	}
 }
 
 /*
  ***************************************************************************
- * Display memory statistics for tasks' children.
+ * Display context switches statistics.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
  * @dis		TRUE if a header line must be printed.
- * @disp_avg	TRUE if average stats are displayed.
  * @prev_string	String displayed at the beginning of a header line. This is
  * 		the timestamp of the previous sample, or "Average" when
  * 		displaying average stats.
  * @curr_string	String displayed at the beginning of current sample stats.
  * 		This is the timestamp of the current sample, or "Average"
  * 		when displaying average stats.
+ * @itv		Interval of time in 1/100th of a second.
  *
  * RETURNS:
  * 0 if all the processes to display have terminated.
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_plain_pid_child_memory_stats(int prev, int curr, int dis, int disp_avg,
-				       char *prev_string, char *curr_string)
+int write_plain_pid_ctxswitch_stats(int prev, int curr, int dis,
+				    char *prev_string, char *curr_string,
+				    unsigned long long itv)
 {
 	struct pid_stats *pstc, *pstp;
+
 	struct st_pid *plist;
-	int rc, again = 0;
+	int again = 0;
 
 	if (dis) {
 		PRINT_ID_HDR(prev_string, pidflag);
-		printf(" minflt-nr majflt-nr  Command\n");
+		printf("   cswch/s nvcswch/s  Command\n");
 	}
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if ((rc = get_pid_to_display(prev, curr, P_A_MEM, P_CHILD, plist)) == 0)
-			/* PID no longer exists */
-			continue;
-
-		/* This will be used to compute average */
-		if (!disp_avg) {
-			plist->rc_asum_count += 1;
-		}
-
-		if (rc < 0)
-			/* PID should not be displayed */
+		if (get_pid_to_display(prev, curr, P_A_CTXSW, P_NULL, plist) <= 0)
 			continue;
 
 		print_line_id(curr_string, plist);
@@ -2441,8 +4638,8 @@ int write_plain_pid_child_memory_stats(int prev, int curr, int dis, int disp_avg
 		pstc = plist->pstats[curr];
 		pstp = plist->pstats[prev];
 
-		/* Write data for current task */
-		write_plain_pid_child_memory_data(disp_avg, plist, pstc, pstp);
+		/* Write statistics for current task */
+		write_plain_pid_ctxswitch_data(pstc, pstp, itv);
 
 		print_comm(plist);
 		again = 1;
@@ -2453,12 +4650,13 @@ int write_plain_pid_child_memory_stats(int prev, int curr, int dis, int disp_avg
 
 /*
  * **************************************************************************
- * Display memory statistics for tasks' children in JSON format.
+ * Display context switches statistics in JSON format.
  *
  * IN:
  * @tab		Number of tabs to print.
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
+ * @itv		Interval of time in 1/100th of a second.
  * @follow	True if a previous set of stats has been displayed and should
  *		be followed by a coma.
  *
@@ -2471,20 +4669,21 @@ int write_plain_pid_child_memory_stats(int prev, int curr, int dis, int disp_avg
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_json_pid_child_memory_stats(int tab, int prev, int curr, int *follow)
+int write_json_pid_ctxswitch_stats(int tab, int prev, int curr,
+				   unsigned long long itv, int *follow)
 {
 	struct pid_stats *pstc, *pstp;
 	struct st_pid *plist;
-	int rc, again = 0, next = FALSE;
+	int again = 0, next = FALSE;
 
 	if (*follow) {
 		printf(",\n");
 	}
-	xprintf(tab++, "\"child-memory\": [");
+	xprintf(tab++, "\"context-switch\": [");
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if ((rc = get_pid_to_display(prev, curr, P_A_MEM, P_CHILD, plist)) <= 0)
+		if (get_pid_to_display(prev, curr, P_A_CTXSW, P_NULL, plist) <= 0)
 			/* PID no longer exists or should not be displayed */
 			continue;
 
@@ -2498,9 +4697,9 @@ int write_json_pid_child_memory_stats(int tab, int prev, int curr, int *follow)
 		pstc = plist->pstats[curr];
 		pstp = plist->pstats[prev];
 
-		printf("\"minflt-nr\": %llu, \"majflt-nr\": %llu, ",
-		       (unsigned long long) ((pstc->minflt + pstc->cminflt) - (pstp->minflt + pstp->cminflt)),
-		       (unsigned long long) ((pstc->majflt + pstc->cmajflt) - (pstp->majflt + pstp->cmajflt)));
+		printf("\"cswch/s\": %.2f, \"nvcswch/s\": %.2f, ",
+		       S_VALUE(pstp->nvcsw,  pstc->nvcsw,  itv),
+		       S_VALUE(pstp->nivcsw, pstc->nivcsw, itv));
 
 		print_json_comm(plist);
 		again = 1;
@@ -2515,19 +4714,19 @@ int write_json_pid_child_memory_stats(int tab, int prev, int curr, int *follow)
 
 /*
  * **************************************************************************
- * Display memory statistics for tasks' children.
+ * Display context switches statistics.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
  * @dis		TRUE if a header line must be printed.
- * @disp_avg	TRUE if average stats are displayed.
  * @prev_string	String displayed at the beginning of a header line. This is
  * 		the timestamp of the previous sample, or "Average" when
  * 		displaying average stats.
  * @curr_string	String displayed at the beginning of current sample stats.
  * 		This is the timestamp of the current sample, or "Average"
  * 		when displaying average stats.
+ * @itv		Interval of time in 1/100th of a second.
  * @tab		Number of tabs to print (JSON format only).
  * @follow	True if a previous set of stats has been displayed and should
  *		be followed by a coma (JSON format only).
@@ -2541,22 +4740,22 @@ int write_json_pid_child_memory_stats(int tab, int prev, int curr, int *follow)
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_pid_child_memory_stats(int prev, int curr, int dis, int disp_avg,
-				 char *prev_string, char *curr_string, int tab,
-				 int *follow)
+int write_pid_ctxswitch_stats(int prev, int curr, int dis,
+			      char *prev_string, char *curr_string,
+			      unsigned long long itv, int tab, int *follow)
 {
 	if (DISPLAY_JSON_OUTPUT(xflags)) {
-		return write_json_pid_child_memory_stats(tab, prev, curr, follow);
+		return write_json_pid_ctxswitch_stats(tab, prev, curr, itv, follow);
 	}
 	else {
-		return write_plain_pid_child_memory_stats(prev, curr, dis, disp_avg,
-							  prev_string, curr_string);
+		return write_plain_pid_ctxswitch_stats(prev, curr, dis,
+						       prev_string, curr_string, itv);
 	}
 }
 
 /*
  ***************************************************************************
- * Display stack size statistics for tasks.
+ * Display some kernel tables values for tasks.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
@@ -2575,8 +4774,8 @@ int write_pid_child_memory_stats(int prev, int curr, int dis, int disp_avg,
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_plain_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
-				char *prev_string, char *curr_string)
+int write_plain_pid_ktab_stats(int prev, int curr, int dis, int disp_avg,
+			       char *prev_string, char *curr_string)
 {
 	struct pid_stats *pstc;
 	struct st_pid *plist;
@@ -2584,12 +4783,13 @@ int write_plain_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
 
 	if (dis) {
 		PRINT_ID_HDR(prev_string, pidflag);
-		printf(" StkSize  StkRef  Command\n");
+		printf(" threads   fd-nr");
+		printf("  Command\n");
 	}
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if ((rc = get_pid_to_display(prev, curr, P_A_STACK, P_NULL, plist)) == 0)
+		if ((rc = get_pid_to_display(prev, curr, P_A_KTAB, P_NULL, plist)) == 0)
 			/* PID no longer exists */
 			continue;
 
@@ -2597,9 +4797,9 @@ int write_plain_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
 
 		/* This will be used to compute average */
 		if (!disp_avg) {
-			plist->total_stack_size += pstc->stack_size;
-			plist->total_stack_ref  += pstc->stack_ref;
-			plist->sk_asum_count += 1;
+			plist->total_threads += pstc->threads;
+			plist->total_fd_nr   += pstc->fd_nr;
+			plist->tf_asum_count += 1;
 		}
 
 		if (rc < 0)
@@ -2608,8 +4808,8 @@ int write_plain_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
 
 		print_line_id(curr_string, plist);
 
-		/* Write current process data */
-		write_plain_pid_stack_data(disp_avg, plist, pstc);
+		/* Write data for current task */
+		write_plain_pid_ktab_data(disp_avg, plist, pstc);
 
 		print_comm(plist);
 		again = 1;
@@ -2620,7 +4820,7 @@ int write_plain_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
 
 /*
  * **************************************************************************
- * Display stack size statistics for tasks in JSON format.
+ * Display some kernel tables values for tasks in JSON format.
  *
  * IN:
  * @tab		Number of tabs to print.
@@ -2638,7 +4838,7 @@ int write_plain_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_json_pid_stack_stats(int tab, int prev, int curr, int *follow)
+int write_json_pid_ktab_stats(int tab, int prev, int curr, int *follow)
 {
 	struct pid_stats *pstc;
 	struct st_pid *plist;
@@ -2647,11 +4847,11 @@ int write_json_pid_stack_stats(int tab, int prev, int curr, int *follow)
 	if (*follow) {
 		printf(",\n");
 	}
-	xprintf(tab++, "\"stack\": [");
+	xprintf(tab++, "\"kernel\": [");
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if ((rc = get_pid_to_display(prev, curr, P_A_STACK, P_NULL, plist)) <= 0)
+		if ((rc = get_pid_to_display(prev, curr, P_A_KTAB, P_NULL, plist)) <= 0)
 			/* PID no longer exists or should not be displayed */
 			continue;
 
@@ -2664,9 +4864,14 @@ int write_json_pid_stack_stats(int tab, int prev, int curr, int *follow)
 
 		pstc = plist->pstats[curr];
 
-		printf("\"StkSize\": %llu, \"StkRef\": %llu, ",
-		       (unsigned long long) pstc->stack_size,
-		       (unsigned long long) pstc->stack_ref);
+		printf("\"threads\": %llu, \"fd-nr\": ",
+		       (unsigned long long) pstc->threads);
+		if (NO_PID_FD(plist->flags)) {
+			printf("-1, ");
+		}
+		else {
+			printf("%llu, ", (unsigned long long) pstc->fd_nr);
+		}
 
 		print_json_comm(plist);
 		again = 1;
@@ -2681,7 +4886,7 @@ int write_json_pid_stack_stats(int tab, int prev, int curr, int *follow)
 
 /*
  * **************************************************************************
- * Display stack size statistics for tasks.
+ * Display some kernel tables values for tasks.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
@@ -2707,75 +4912,61 @@ int write_json_pid_stack_stats(int tab, int prev, int curr, int *follow)
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_pid_stack_stats(int prev, int curr, int dis, int disp_avg,
-			  char *prev_string, char *curr_string, int tab, int *follow)
+int write_pid_ktab_stats(int prev, int curr, int dis, int disp_avg,
+			 char *prev_string, char *curr_string, int tab, int *follow)
 {
 	if (DISPLAY_JSON_OUTPUT(xflags)) {
-		return write_json_pid_stack_stats(tab, prev, curr, follow);
+		return write_json_pid_ktab_stats(tab, prev, curr, follow);
 	}
 	else {
-		return write_plain_pid_stack_stats(prev, curr, dis, disp_avg,
-						   prev_string, curr_string);
+		return write_plain_pid_ktab_stats(prev, curr, dis, disp_avg,
+						  prev_string, curr_string);
 	}
 }
 
 /*
- ***************************************************************************
- * Display I/O statistics.
+ * **************************************************************************
+ * Display scheduling priority and policy information.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
  * @dis		TRUE if a header line must be printed.
- * @disp_avg	TRUE if average stats are displayed.
  * @prev_string	String displayed at the beginning of a header line. This is
  * 		the timestamp of the previous sample, or "Average" when
  * 		displaying average stats.
  * @curr_string	String displayed at the beginning of current sample stats.
  * 		This is the timestamp of the current sample, or "Average"
  * 		when displaying average stats.
- * @itv		Interval of time in 1/100th of a second.
  *
  * RETURNS:
  * 0 if all the processes to display have terminated.
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_plain_pid_io_stats(int prev, int curr, int dis, int disp_avg,
-			     char *prev_string, char *curr_string,
-			     unsigned long long itv)
+int write_plain_pid_rt_stats(int prev, int curr, int dis,
+			     char *prev_string, char *curr_string)
 {
-	struct pid_stats *pstc, *pstp;
+	struct pid_stats *pstc;
 	struct st_pid *plist;
-	int rc, again = 0;
+	int again = 0;
 
 	if (dis) {
 		PRINT_ID_HDR(prev_string, pidflag);
-		printf("   kB_rd/s   kB_wr/s kB_ccwr/s iodelay  Command\n");
+		printf(" prio policy  Command\n");
 	}
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if ((rc = get_pid_to_display(prev, curr, P_A_IO, P_NULL, plist)) == 0)
-			/* PID no longer exists */
-			continue;
-
-		/* This will be used to compute average delays */
-		if (!disp_avg) {
-			plist->delay_asum_count += 1;
-		}
-
-		if (rc < 0)
-			/* PID should not be displayed */
+		if (get_pid_to_display(prev, curr, P_A_RT, P_NULL, plist) <= 0)
 			continue;
 
 		print_line_id(curr_string, plist);
 
 		pstc = plist->pstats[curr];
-		pstp = plist->pstats[prev];
 
-		/* Write statistics for current task */
-		write_plain_pid_io_data(disp_avg, plist, pstc, pstp, itv);
+		/* Write data for current task */
+		write_plain_pid_rt_data(pstc);
 
 		print_comm(plist);
 		again = 1;
@@ -2786,13 +4977,12 @@ int write_plain_pid_io_stats(int prev, int curr, int dis, int disp_avg,
 
 /*
  * **************************************************************************
- * Display I/O statistics in JSON format.
+ * Display scheduling priority and policy information in JSON format.
  *
  * IN:
  * @tab		Number of tabs to print.
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
- * @itv		Interval of time in 1/100th of a second.
  * @follow	True if a previous set of stats has been displayed and should
  *		be followed by a coma.
  *
@@ -2805,22 +4995,20 @@ int write_plain_pid_io_stats(int prev, int curr, int dis, int disp_avg,
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_json_pid_io_stats(int tab, int prev, int curr, unsigned long long itv,
-			    int *follow)
+int write_json_pid_rt_stats(int tab, int prev, int curr, int *follow)
 {
-	struct pid_stats *pstc, *pstp;
+	struct pid_stats *pstc;
 	struct st_pid *plist;
-	int rc, again = 0,  next = FALSE;
-	double rbytes, wbytes, cbytes;
+	int again = 0, next = FALSE;
 
 	if (*follow) {
 		printf(",\n");
 	}
-	xprintf(tab++, "\"io\": [");
+	xprintf(tab++, "\"realtime\": [");
 
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 
-		if ((rc = get_pid_to_display(prev, curr, P_A_IO, P_NULL, plist)) <= 0)
+		if (get_pid_to_display(prev, curr, P_A_RT, P_NULL, plist) <= 0)
 			/* PID no longer exists or should not be displayed */
 			continue;
 
@@ -2832,25 +5020,10 @@ int write_json_pid_io_stats(int tab, int prev, int curr, unsigned long long itv,
 		print_json_line_id(tab, plist);
 
 		pstc = plist->pstats[curr];
-		pstp = plist->pstats[prev];
 
-		if (!NO_PID_IO(plist->flags)) {
-			rbytes = S_VALUE(pstp->read_bytes,  pstc->read_bytes, itv);
-			wbytes = S_VALUE(pstp->write_bytes, pstc->write_bytes, itv);
-			cbytes = S_VALUE(pstp->cancelled_write_bytes,
-					 pstc->cancelled_write_bytes, itv);
-			printf("\"kB_rd/s\": %.2f, \"kB_wr/s\": %.2f, \"kB_ccwr/s\": %.2f, ",
-			       rbytes / 1024,
-			       wbytes / 1024,
-			       cbytes / 1024);
-		}
-		else {
-			/* I/O file not readable (permission denied or file non existent) */
-			printf("\"kB_rd/s\": -1.00, \"kB_wr/s\": -1.00, \"kB_ccwr/s\": -1.00, ");
-		}
-		/* I/O delays come from another file (/proc/#/stat) */
-		printf("\"iodelay\": %llu, ",
-		       (unsigned long long) (pstc->blkio_swapin_delays - pstp->blkio_swapin_delays));
+		printf("\"prio\": %llu, \"policy\": \"%s\", ",
+		       (unsigned long long) pstc->priority,
+		       GET_POLICY(pstc->policy));
 
 		print_json_comm(plist);
 		again = 1;
@@ -2865,20 +5038,18 @@ int write_json_pid_io_stats(int tab, int prev, int curr, unsigned long long itv,
 
 /*
  * **************************************************************************
- * Display I/O statistics.
+ * Display scheduling priority and policy information.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
  * @dis		TRUE if a header line must be printed.
- * @disp_avg	TRUE if average stats are displayed.
  * @prev_string	String displayed at the beginning of a header line. This is
  * 		the timestamp of the previous sample, or "Average" when
  * 		displaying average stats.
  * @curr_string	String displayed at the beginning of current sample stats.
  * 		This is the timestamp of the current sample, or "Average"
  * 		when displaying average stats.
- * @itv		Interval of time in 1/100th of a second.
  * @tab		Number of tabs to print (JSON format only).
  * @follow	True if a previous set of stats has been displayed and should
  *		be followed by a coma (JSON format only).
@@ -2892,22 +5063,21 @@ int write_json_pid_io_stats(int tab, int prev, int curr, unsigned long long itv,
  * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_pid_io_stats(int prev, int curr, int dis, int disp_avg,
-		       char *prev_string, char *curr_string,
-		       unsigned long long itv, int tab, int *follow)
+int write_pid_rt_stats(int prev, int curr, int dis,
+		       char *prev_string, char *curr_string, int tab, int *follow)
 {
 	if (DISPLAY_JSON_OUTPUT(xflags)) {
-		return write_json_pid_io_stats(tab, prev, curr, itv, follow);
+		return write_json_pid_rt_stats(tab, prev, curr, follow);
 	}
 	else {
-		return write_plain_pid_io_stats(prev, curr, dis, disp_avg,
-						prev_string, curr_string, itv);
+		return write_plain_pid_rt_stats(prev, curr, dis,
+						prev_string, curr_string);
 	}
 }
 
 /*
  ***************************************************************************
- * Display context switches statistics.
+ * Display CPU statistics for cgroups.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
@@ -2920,154 +5090,134 @@ int write_pid_io_stats(int prev, int curr, int dis, int disp_avg,
  * 		This is the timestamp of the current sample, or "Average"
  * 		when displaying average stats.
  * @itv		Interval of time in 1/100th of a second.
- *
- * RETURNS:
- * 0 if all the processes to display have terminated.
- * <> 0 if there are still some processes left to display.
+ * @deltot_jiffies
+ *		Number of jiffies spent on the interval by all processors.
  ***************************************************************************
  */
-int write_plain_pid_ctxswitch_stats(int prev, int curr, int dis,
-				    char *prev_string, char *curr_string,
-				    unsigned long long itv)
+void write_plain_cgroup_cpu_stats(int prev, int curr, int dis,
+				  char *prev_string, char *curr_string,
+				  unsigned long long itv,
+				  unsigned long long deltot_jiffies)
 {
-	struct pid_stats *pstc, *pstp;
-
-	struct st_pid *plist;
-	int again = 0;
+	struct cg_stats *cgc, *cgp;
+	int i;
 
 	if (dis) {
-		PRINT_ID_HDR(prev_string, pidflag);
-		printf("   cswch/s nvcswch/s  Command\n");
+		printf("\n%-11s", prev_string);
+		printf("    %%usr %%system    %%CPU   %%scpu  Cgroup\n");
 	}
 
-	for (plist = pid_list; plist != NULL; plist = plist->next) {
-
-		if (get_pid_to_display(prev, curr, P_A_CTXSW, P_NULL, plist) <= 0)
-			continue;
+	for (i = 0; i < cg_nr; i++) {
 
-		print_line_id(curr_string, plist);
+		cgc = &cg_tab[i]->cgstats[curr];
+		cgp = &cg_tab[i]->cgstats[prev];
 
-		pstc = plist->pstats[curr];
-		pstp = plist->pstats[prev];
+		printf("%-11s", curr_string);
 
-		/* Write statistics for current task */
-		write_plain_pid_ctxswitch_data(pstc, pstp, itv);
+		/* Times are in us, whereas interval is in 1/100th of a second */
+		cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 4, 7, 2,
+			    CG_SP_VALUE(cgp->user_usec, cgc->user_usec, itv * 10000),
+			    CG_SP_VALUE(cgp->system_usec, cgc->system_usec, itv * 10000),
+			    IRIX_MODE_OFF(pidflag) ?
+			    CG_SP_VALUE(cgp->usage_usec, cgc->usage_usec,
+					deltot_jiffies * 1000000 / HZ) :
+			    CG_SP_VALUE(cgp->usage_usec, cgc->usage_usec, itv * 10000),
+			    CG_SP_VALUE(cgp->cpu_some, cgc->cpu_some, itv * 10000));
 
-		print_comm(plist);
-		again = 1;
+		cprintf_s(IS_STR, "  %s", cg_tab[i]->path);
+		printf("\n");
 	}
-
-	return again;
 }
 
 /*
- * **************************************************************************
- * Display context switches statistics in JSON format.
+ ***************************************************************************
+ * Display the path of a cgroup in JSON format. Characters which cannot
+ * appear as is in a JSON string are escaped. No intermediate buffer is
+ * used since the path may be longer than MAX_NAME_LEN.
  *
  * IN:
- * @tab		Number of tabs to print.
- * @prev	Index in array where stats used as reference are.
- * @curr	Index in array for current sample statistics.
- * @itv		Interval of time in 1/100th of a second.
- * @follow	True if a previous set of stats has been displayed and should
- *		be followed by a coma.
- *
- * OUT:
- * @follow	Set to TRUE to indicate that a coma should be displayed
- *		before next set of stats (if any).
- *
- * RETURNS:
- * 0 if all the processes to display have terminated.
- * <> 0 if there are still some processes left to display.
+ * @path	Path of the cgroup.
  ***************************************************************************
  */
-int write_json_pid_ctxswitch_stats(int tab, int prev, int curr,
-				   unsigned long long itv, int *follow)
+void print_json_cg_path(const char *path)
 {
-	struct pid_stats *pstc, *pstp;
-	struct st_pid *plist;
-	int again = 0, next = FALSE;
-
-	if (*follow) {
-		printf(",\n");
-	}
-	xprintf(tab++, "\"context-switch\": [");
-
-	for (plist = pid_list; plist != NULL; plist = plist->next) {
+	const unsigned char *c;
 
-		if (get_pid_to_display(prev, curr, P_A_CTXSW, P_NULL, plist) <= 0)
-			/* PID no longer exists or should not be displayed */
-			continue;
-
-		if (next) {
-			printf(",\n");
+	printf("\"cgroup\": \"");
+	for (c = (const unsigned char *) path; *c; c++) {
+		if ((*c == '"') || (*c == '\\')) {
+			printf("\\%c", *c);
+		}
+		else if (*c < 0x20) {
+			printf("\\u%04x", *c);
+		}
+		else {
+			putchar(*c);
 		}
-		next = TRUE;
-
-		print_json_line_id(tab, plist);
-
-		pstc = plist->pstats[curr];
-		pstp = plist->pstats[prev];
-
-		printf("\"cswch/s\": %.2f, \"nvcswch/s\": %.2f, ",
-		       S_VALUE(pstp->nvcsw,  pstc->nvcsw,  itv),
-		       S_VALUE(pstp->nivcsw, pstc->nivcsw, itv));
-
-		print_json_comm(plist);
-		again = 1;
 	}
-
-	printf("\n");
-	xprintf0(--tab, "]");
-	*follow = TRUE;
-
-	return again;
+	printf("\", ");
 }
 
 /*
- * **************************************************************************
- * Display context switches statistics.
+ ***************************************************************************
+ * Display CPU statistics for cgroups in JSON format.
  *
  * IN:
+ * @tab		Number of tabs to print.
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
- * @dis		TRUE if a header line must be printed.
- * @prev_string	String displayed at the beginning of a header line. This is
- * 		the timestamp of the previous sample, or "Average" when
- * 		displaying average stats.
- * @curr_string	String displayed at the beginning of current sample stats.
- * 		This is the timestamp of the current sample, or "Average"
- * 		when displaying average stats.
  * @itv		Interval of time in 1/100th of a second.
- * @tab		Number of tabs to print (JSON format only).
+ * @deltot_jiffies
+ *		Number of jiffies spent on the interval by all processors.
  * @follow	True if a previous set of stats has been displayed and should
- *		be followed by a coma (JSON format only).
+ *		be followed by a coma.
  *
  * OUT:
  * @follow	Set to TRUE to indicate that a coma should be displayed
- *		before next set of stats (if any). JSON format only.
- *
- * RETURNS:
- * 0 if all the processes to display have terminated.
- * <> 0 if there are still some processes left to display.
+ *		before next set of stats (if any).
  ***************************************************************************
  */
-int write_pid_ctxswitch_stats(int prev, int curr, int dis,
-			      char *prev_string, char *curr_string,
-			      unsigned long long itv, int tab, int *follow)
+void write_json_cgroup_cpu_stats(int tab, int prev, int curr, unsigned long long itv,
+				 unsigned long long deltot_jiffies, int *follow)
 {
-	if (DISPLAY_JSON_OUTPUT(xflags)) {
-		return write_json_pid_ctxswitch_stats(tab, prev, curr, itv, follow);
+	struct cg_stats *cgc, *cgp;
+	int i;
+
+	if (*follow) {
+		printf(",\n");
 	}
-	else {
-		return write_plain_pid_ctxswitch_stats(prev, curr, dis,
-						       prev_string, curr_string, itv);
+	xprintf(tab++, "\"cgroup-cpu-load\": [");
+
+	for (i = 0; i < cg_nr; i++) {
+
+		if (i) {
+			printf(",\n");
+		}
+
+		cgc = &cg_tab[i]->cgstats[curr];
+		cgp = &cg_tab[i]->cgstats[prev];
+
+		xprintf0(tab, "{");
+		print_json_cg_path(cg_tab[i]->path);
+		printf("\"%%usr\": %.2f, \"%%system\": %.2f, \"%%CPU\": %.2f, "
+		       "\"%%scpu\": %.2f}",
+		       CG_SP_VALUE(cgp->user_usec, cgc->user_usec, itv * 10000),
+		       CG_SP_VALUE(cgp->system_usec, cgc->system_usec, itv * 10000),
+		       IRIX_MODE_OFF(pidflag) ?
+		       CG_SP_VALUE(cgp->usage_usec, cgc->usage_usec,
+				   deltot_jiffies * 1000000 / HZ) :
+		       CG_SP_VALUE(cgp->usage_usec, cgc->usage_usec, itv * 10000),
+		       CG_SP_VALUE(cgp->cpu_some, cgc->cpu_some, itv * 10000));
 	}
+
+	printf("\n");
+	xprintf0(--tab, "]");
+	*follow = TRUE;
 }
 
 /*
  ***************************************************************************
- * Display some kernel tables values for tasks.
+ * Display memory statistics for cgroups.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
@@ -3080,165 +5230,128 @@ int write_pid_ctxswitch_stats(int prev, int curr, int dis,
  * @curr_string	String displayed at the beginning of current sample stats.
  * 		This is the timestamp of the current sample, or "Average"
  * 		when displaying average stats.
- *
- * RETURNS:
- * 0 if all the processes to display have terminated.
- * <> 0 if there are still some processes left to display.
+ * @itv		Interval of time in 1/100th of a second.
  ***************************************************************************
  */
-int write_plain_pid_ktab_stats(int prev, int curr, int dis, int disp_avg,
-			       char *prev_string, char *curr_string)
+void write_plain_cgroup_memory_stats(int prev, int curr, int dis, int disp_avg,
+				     char *prev_string, char *curr_string,
+				     unsigned long long itv)
 {
-	struct pid_stats *pstc;
-	struct st_pid *plist;
-	int rc, again = 0;
+	struct st_cgroup *cg;
+	struct cg_stats *cgc, *cgp;
+	unsigned long long mem_kb;
+	int i;
 
 	if (dis) {
-		PRINT_ID_HDR(prev_string, pidflag);
-		printf(" threads   fd-nr");
-		printf("  Command\n");
+		printf("\n%-11s", prev_string);
+		printf("  minflt/s  majflt/s     kB_mem   %%MEM   %%smem   %%fmem  Cgroup\n");
 	}
 
-	for (plist = pid_list; plist != NULL; plist = plist->next) {
-
-		if ((rc = get_pid_to_display(prev, curr, P_A_KTAB, P_NULL, plist)) == 0)
-			/* PID no longer exists */
-			continue;
+	for (i = 0; i < cg_nr; i++) {
 
-		pstc = plist->pstats[curr];
+		cg = cg_tab[i];
+		cgc = &cg->cgstats[curr];
+		cgp = &cg->cgstats[prev];
 
-		/* This will be used to compute average */
-		if (!disp_avg) {
-			plist->total_threads += pstc->threads;
-			plist->total_fd_nr   += pstc->fd_nr;
-			plist->tf_asum_count += 1;
+		if (disp_avg) {
+			mem_kb = cg->mem_asum_count ? cg->total_mem / cg->mem_asum_count : 0;
+		}
+		else {
+			mem_kb = cgc->mem_kb;
+			/* This will be used to compute average memory usage */
+			cg->total_mem += mem_kb;
+			cg->mem_asum_count += 1;
 		}
 
-		if (rc < 0)
-			/* PID should not be displayed */
-			continue;
-
-		print_line_id(curr_string, plist);
+		printf("%-11s", curr_string);
 
-		/* Write data for current task */
-		write_plain_pid_ktab_data(disp_avg, plist, pstc);
+		cprintf_f(NO_UNIT, FALSE, 2, 9, 2,
+			  CG_S_VALUE(cgp->minflt, cgc->minflt, itv),
+			  CG_S_VALUE(cgp->majflt, cgc->majflt, itv));
+		cprintf_u64(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, 1, 10, mem_kb);
+		cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 1, 6, 2,
+			    tlmkb ? SP_VALUE(0, mem_kb, tlmkb) : 0.0);
+		cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 2, 7, 2,
+			    CG_SP_VALUE(cgp->mem_some, cgc->mem_some, itv * 10000),
+			    CG_SP_VALUE(cgp->mem_full, cgc->mem_full, itv * 10000));
 
-		print_comm(plist);
-		again = 1;
+		cprintf_s(IS_STR, "  %s", cg->path);
+		printf("\n");
 	}
-
-	return again;
 }
 
 /*
- * **************************************************************************
- * Display some kernel tables values for tasks in JSON format.
+ ***************************************************************************
+ * Display memory statistics for cgroups in JSON format.
  *
  * IN:
  * @tab		Number of tabs to print.
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
+ * @itv		Interval of time in 1/100th of a second.
+ * @disp_avg	TRUE if average stats are displayed.
  * @follow	True if a previous set of stats has been displayed and should
  *		be followed by a coma.
  *
  * OUT:
  * @follow	Set to TRUE to indicate that a coma should be displayed
  *		before next set of stats (if any).
- *
- * RETURNS:
- * 0 if all the processes to display have terminated.
- * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_json_pid_ktab_stats(int tab, int prev, int curr, int *follow)
+void write_json_cgroup_memory_stats(int tab, int prev, int curr,
+				    unsigned long long itv, int disp_avg, int *follow)
 {
-	struct pid_stats *pstc;
-	struct st_pid *plist;
-	int rc, again = 0, next = FALSE;
+	struct st_cgroup *cg;
+	struct cg_stats *cgc, *cgp;
+	unsigned long long mem_kb;
+	int i;
 
 	if (*follow) {
 		printf(",\n");
 	}
-	xprintf(tab++, "\"kernel\": [");
-
-	for (plist = pid_list; plist != NULL; plist = plist->next) {
+	xprintf(tab++, "\"cgroup-memory\": [");
 
-		if ((rc = get_pid_to_display(prev, curr, P_A_KTAB, P_NULL, plist)) <= 0)
-			/* PID no longer exists or should not be displayed */
-			continue;
+	for (i = 0; i < cg_nr; i++) {
 
-		if (next) {
+		if (i) {
 			printf(",\n");
 		}
-		next = TRUE;
-
-		print_json_line_id(tab, plist);
 
-		pstc = plist->pstats[curr];
+		cg = cg_tab[i];
+		cgc = &cg->cgstats[curr];
+		cgp = &cg->cgstats[prev];
 
-		printf("\"threads\": %llu, \"fd-nr\": ",
-		       (unsigned long long) pstc->threads);
-		if (NO_PID_FD(plist->flags)) {
-			printf("-1, ");
+		if (disp_avg) {
+			mem_kb = cg->mem_asum_count ? cg->total_mem / cg->mem_asum_count : 0;
 		}
 		else {
-			printf("%llu, ", (unsigned long long) pstc->fd_nr);
+			mem_kb = cgc->mem_kb;
+			/* This will be used to compute average memory usage */
+			cg->total_mem += mem_kb;
+			cg->mem_asum_count += 1;
 		}
 
-		print_json_comm(plist);
-		again = 1;
+		xprintf0(tab, "{");
+		print_json_cg_path(cg->path);
+		printf("\"minflt/s\": %.2f, \"majflt/s\": %.2f, "
+		       "\"kB_mem\": %llu, \"MEM\": %.2f, "
+		       "\"%%smem\": %.2f, \"%%fmem\": %.2f}",
+		       CG_S_VALUE(cgp->minflt, cgc->minflt, itv),
+		       CG_S_VALUE(cgp->majflt, cgc->majflt, itv),
+		       mem_kb,
+		       tlmkb ? SP_VALUE(0, mem_kb, tlmkb) : 0.0,
+		       CG_SP_VALUE(cgp->mem_some, cgc->mem_some, itv * 10000),
+		       CG_SP_VALUE(cgp->mem_full, cgc->mem_full, itv * 10000));
 	}
 
 	printf("\n");
 	xprintf0(--tab, "]");
 	*follow = TRUE;
-
-	return again;
 }
 
 /*
- * **************************************************************************
- * Display some kernel tables values for tasks.
- *
- * IN:
- * @prev	Index in array where stats used as reference are.
- * @curr	Index in array for current sample statistics.
- * @dis		TRUE if a header line must be printed.
- * @disp_avg	TRUE if average stats are displayed.
- * @prev_string	String displayed at the beginning of a header line. This is
- * 		the timestamp of the previous sample, or "Average" when
- * 		displaying average stats.
- * @curr_string	String displayed at the beginning of current sample stats.
- * 		This is the timestamp of the current sample, or "Average"
- * 		when displaying average stats.
- * @tab		Number of tabs to print (JSON format only).
- * @follow	True if a previous set of stats has been displayed and should
- *		be followed by a coma (JSON format only).
- *
- * OUT:
- * @follow	Set to TRUE to indicate that a coma should be displayed
- *		before next set of stats (if any). JSON format only.
- *
- * RETURNS:
- * 0 if all the processes to display have terminated.
- * <> 0 if there are still some processes left to display.
  ***************************************************************************
- */
-int write_pid_ktab_stats(int prev, int curr, int dis, int disp_avg,
-			 char *prev_string, char *curr_string, int tab, int *follow)
-{
-	if (DISPLAY_JSON_OUTPUT(xflags)) {
-		return write_json_pid_ktab_stats(tab, prev, curr, follow);
-	}
-	else {
-		return write_plain_pid_ktab_stats(prev, curr, dis, disp_avg,
-						  prev_string, curr_string);
-	}
-}
-
-/*
- * **************************************************************************
- * Display scheduling priority and policy information.
+ * Display I/O statistics for cgroups.
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
@@ -3250,118 +5363,110 @@ int write_pid_ktab_stats(int prev, int curr, int dis, int disp_avg,
  * @curr_string	String displayed at the beginning of current sample stats.
  * 		This is the timestamp of the current sample, or "Average"
  * 		when displaying average stats.
- *
- * RETURNS:
- * 0 if all the processes to display have terminated.
- * <> 0 if there are still some processes left to display.
+ * @itv		Interval of time in 1/100th of a second.
  ***************************************************************************
  */
-int write_plain_pid_rt_stats(int prev, int curr, int dis,
-			     char *prev_string, char *curr_string)
+void write_plain_cgroup_io_stats(int prev, int curr, int dis,
+				 char *prev_string, char *curr_string,
+				 unsigned long long itv)
 {
-	struct pid_stats *pstc;
-	struct st_pid *plist;
-	int again = 0;
+	struct cg_stats *cgc, *cgp;
+	int i;
 
 	if (dis) {
-		PRINT_ID_HDR(prev_string, pidflag);
-		printf(" prio policy  Command\n");
+		printf("\n%-11s", prev_string);
+		printf("   kB_rd/s   kB_wr/s    %%sio    %%fio  Cgroup\n");
 	}
 
-	for (plist = pid_list; plist != NULL; plist = plist->next) {
-
-		if (get_pid_to_display(prev, curr, P_A_RT, P_NULL, plist) <= 0)
-			continue;
+	for (i = 0; i < cg_nr; i++) {
 
-		print_line_id(curr_string, plist);
+		cgc = &cg_tab[i]->cgstats[curr];
+		cgp = &cg_tab[i]->cgstats[prev];
 
-		pstc = plist->pstats[curr];
+		printf("%-11s", curr_string);
 
-		/* Write data for current task */
-		write_plain_pid_rt_data(pstc);
+		cprintf_f(DISPLAY_UNIT(pidflag) ? UNIT_KILOBYTE : NO_UNIT, FALSE, 2, 9, 2,
+			  CG_S_VALUE(cgp->rbytes, cgc->rbytes, itv) / 1024,
+			  CG_S_VALUE(cgp->wbytes, cgc->wbytes, itv) / 1024);
+		cprintf_xpc(DISPLAY_UNIT(pidflag), XHIGH, 2, 7, 2,
+			    CG_SP_VALUE(cgp->io_some, cgc->io_some, itv * 10000),
+			    CG_SP_VALUE(cgp->io_full, cgc->io_full, itv * 10000));
 
-		print_comm(plist);
-		again = 1;
+		cprintf_s(IS_STR, "  %s", cg_tab[i]->path);
+		printf("\n");
 	}
-
-	return again;
 }
 
 /*
- * **************************************************************************
- * Display scheduling priority and policy information in JSON format.
+ ***************************************************************************
+ * Display I/O statistics for cgroups in JSON format.
  *
  * IN:
  * @tab		Number of tabs to print.
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
+ * @itv		Interval of time in 1/100th of a second.
  * @follow	True if a previous set of stats has been displayed and should
  *		be followed by a coma.
  *
  * OUT:
  * @follow	Set to TRUE to indicate that a coma should be displayed
  *		before next set of stats (if any).
- *
- * RETURNS:
- * 0 if all the processes to display have terminated.
- * <> 0 if there are still some processes left to display.
  ***************************************************************************
  */
-int write_json_pid_rt_stats(int tab, int prev, int curr, int *follow)
+void write_json_cgroup_io_stats(int tab, int prev, int curr,
+				unsigned long long itv, int *follow)
 {
-	struct pid_stats *pstc;
-	struct st_pid *plist;
-	int again = 0, next = FALSE;
+	struct cg_stats *cgc, *cgp;
+	int i;
 
 	if (*follow) {
 		printf(",\n");
 	}
-	xprintf(tab++, "\"realtime\": [");
-
-	for (plist = pid_list; plist != NULL; plist = plist->next) {
+	xprintf(tab++, "\"cgroup-io\": [");
 
-		if (get_pid_to_display(prev, curr, P_A_RT, P_NULL, plist) <= 0)
-			/* PID no longer exists or should not be displayed */
-			continue;
+	for (i = 0; i < cg_nr; i++) {
 
-		if (next) {
+		if (i) {
 			printf(",\n");
 		}
-		next = TRUE;
-
-		print_json_line_id(tab, plist);
 
-		pstc = plist->pstats[curr];
-
-		printf("\"prio\": %llu, \"policy\": \"%s\", ",
-		       (unsigned long long) pstc->priority,
-		       GET_POLICY(pstc->policy));
+		cgc = &cg_tab[i]->cgstats[curr];
+		cgp = &cg_tab[i]->cgstats[prev];
 
-		print_json_comm(plist);
-		again = 1;
+		xprintf0(tab, "{");
+		print_json_cg_path(cg_tab[i]->path);
+		printf("\"kB_rd/s\": %.2f, \"kB_wr/s\": %.2f, "
+		       "\"%%sio\": %.2f, \"%%fio\": %.2f}",
+		       CG_S_VALUE(cgp->rbytes, cgc->rbytes, itv) / 1024,
+		       CG_S_VALUE(cgp->wbytes, cgc->wbytes, itv) / 1024,
+		       CG_SP_VALUE(cgp->io_some, cgc->io_some, itv * 10000),
+		       CG_SP_VALUE(cgp->io_full, cgc->io_full, itv * 10000));
 	}
 
 	printf("\n");
 	xprintf0(--tab, "]");
 	*follow = TRUE;
-
-	return again;
 }
 
 /*
- * **************************************************************************
- * Display scheduling priority and policy information.
+ ***************************************************************************
+ * Display statistics for cgroups (option --cgroup).
  *
  * IN:
  * @prev	Index in array where stats used as reference are.
  * @curr	Index in array for current sample statistics.
  * @dis		TRUE if a header line must be printed.
+ * @disp_avg	TRUE if average stats are displayed.
  * @prev_string	String displayed at the beginning of a header line. This is
  * 		the timestamp of the previous sample, or "Average" when
  * 		displaying average stats.
  * @curr_string	String displayed at the beginning of current sample stats.
  * 		This is the timestamp of the current sample, or "Average"
  * 		when displaying average stats.
+ * @itv		Interval of time in 1/100th of a second.
+ * @deltot_jiffies
+ *		Number of jiffies spent on the interval by all processors.
  * @tab		Number of tabs to print (JSON format only).
  * @follow	True if a previous set of stats has been displayed and should
  *		be followed by a coma (JSON format only).
@@ -3369,21 +5474,149 @@ int write_json_pid_rt_stats(int tab, int prev, int curr, int *follow)
  * OUT:
  * @follow	Set to TRUE to indicate that a coma should be displayed
  *		before next set of stats (if any). JSON format only.
+ ***************************************************************************
+ */
+void write_cgroup_stats(int prev, int curr, int dis, int disp_avg,
+			char *prev_string, char *curr_string,
+			unsigned long long itv, unsigned long long deltot_jiffies,
+			int tab, int *follow)
+{
+	if (DISPLAY_CPU(actflag)) {
+		if (DISPLAY_JSON_OUTPUT(xflags)) {
+			write_json_cgroup_cpu_stats(tab, prev, curr, itv,
+						    deltot_jiffies, follow);
+		}
+		else {
+			write_plain_cgroup_cpu_stats(prev, curr, dis, prev_string,
+						     curr_string, itv, deltot_jiffies);
+		}
+	}
+
+	if (DISPLAY_MEM(actflag)) {
+		if (DISPLAY_JSON_OUTPUT(xflags)) {
+			write_json_cgroup_memory_stats(tab, prev, curr, itv, disp_avg, follow);
+		}
+		else {
+			write_plain_cgroup_memory_stats(prev, curr, dis, disp_avg,
+							prev_string, curr_string, itv);
+		}
+	}
+
+	if (DISPLAY_IO(actflag)) {
+		if (DISPLAY_JSON_OUTPUT(xflags)) {
+			write_json_cgroup_io_stats(tab, prev, curr, itv, follow);
+		}
+		else {
+			write_plain_cgroup_io_stats(prev, curr, dis, prev_string,
+						    curr_string, itv);
+		}
+	}
+}
+
+/*
+ ***************************************************************************
+ * Get the value used to rank a task with option --top.
+ *
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
+ * @plist	Pointer on the linked list where PID is saved.
+ *
+ * RETURNS:
+ * Value of the key for the task.
+ ***************************************************************************
+ */
+unsigned long long get_top_key(int prev, int curr, struct st_pid *plist)
+{
+	struct pid_stats *pstc = plist->pstats[curr], *pstp = plist->pstats[prev];
+	unsigned long long c, p;
+
+	switch (top_key) {
+
+		case TOP_RSS:
+			return pstc->rss;
+
+		case TOP_IO:
+			if (NO_PID_IO(plist->flags))
+				return 0;
+			c = pstc->read_bytes + pstc->write_bytes;
+			p = pstp->read_bytes + pstp->write_bytes;
+			break;
+
+		case TOP_CSW:
+			c = pstc->nvcsw + pstc->nivcsw;
+			p = pstp->nvcsw + pstp->nivcsw;
+			break;
+
+		default:
+			/* User time already includes guest time */
+			c = pstc->utime + pstc->stime;
+			p = pstp->utime + pstp->stime;
+	}
+
+	return (c > p ? c - p : 0);
+}
+
+/*
+ ***************************************************************************
+ * Select the tasks with the highest values for the key entered with option
+ * --top. A min-heap of @top_nr entries is used, so that the whole list of
+ * tasks needn't be sorted. Selected tasks are flagged, and only them will
+ * be displayed.
  *
- * RETURNS:
- * 0 if all the processes to display have terminated.
- * <> 0 if there are still some processes left to display.
+ * IN:
+ * @prev	Index in array where stats used as reference are.
+ * @curr	Index in array for current sample statistics.
  ***************************************************************************
  */
-int write_pid_rt_stats(int prev, int curr, int dis,
-		       char *prev_string, char *curr_string, int tab, int *follow)
+void select_top_pids(int prev, int curr)
 {
-	if (DISPLAY_JSON_OUTPUT(xflags)) {
-		return write_json_pid_rt_stats(tab, prev, curr, follow);
+	struct st_pid *plist;
+	unsigned long long key;
+	int i, j, nr = 0;
+
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+
+		plist->flags &= ~F_PID_TOP;
+
+		if (!plist->exist || IS_PID_REJECTED(plist->flags) ||
+		    IS_PID_PREV_REJECTED(plist->flags))
+			continue;
+
+		/* Tasks with a null value are not worth being displayed */
+		if ((key = get_top_key(prev, curr, plist)) == 0)
+			continue;
+
+		if (nr < top_nr) {
+			/* Heap not full yet: Add the task then sift it up */
+			i = nr++;
+			while (i && (top_heap[(i - 1) / 2].key > key)) {
+				top_heap[i] = top_heap[(i - 1) / 2];
+				i = (i - 1) / 2;
+			}
+		}
+		else if (key > top_heap[0].key) {
+			/* Replace the task with the smallest value then sift it down */
+			i = 0;
+			while ((j = 2 * i + 1) < nr) {
+				if ((j + 1 < nr) && (top_heap[j + 1].key < top_heap[j].key)) {
+					j++;
+				}
+				if (top_heap[j].key >= key)
+					break;
+				top_heap[i] = top_heap[j];
+				i = j;
+			}
+		}
+		else
+			continue;
+
+		top_heap[i].key = key;
+		top_heap[i].plist = plist;
 	}
-	else {
-		return write_plain_pid_rt_stats(prev, curr, dis,
-						prev_string, curr_string);
+
+	for (i = 0; i < nr; i++) {
+		top_heap[i].plist->flags |= F_PID_TOP;
 	}
 }
 
@@ -3427,7 +5660,16 @@ int write_stats_core(int prev, int curr, int dis, int disp_avg,
 
 	itv = get_interval(uptime_cs[prev], uptime_cs[curr]);
 
-	if (DISPLAY_ONELINE(pidflag)) {
+	if (top_nr) {
+		/* Select the tasks to display (option --top) */
+		select_top_pids(prev, curr);
+	}
+
+	if (DISPLAY_CGROUP(pidflag)) {
+		write_cgroup_stats(prev, curr, dis, disp_avg, prev_string, curr_string,
+				   itv, deltot_jiffies, tab, &follow);
+	}
+	else if (DISPLAY_ONELINE(pidflag)) {
 		if (DISPLAY_TASK_STATS(tskflag)) {
 			again += write_pid_task_all_stats(prev, curr, dis,
 							  prev_string, curr_string,
@@ -3523,62 +5765,567 @@ int write_stats_core(int prev, int curr, int dis, int disp_avg,
  * @dis		TRUE if a header line must be printed.
  ***************************************************************************
  */
-void write_stats_avg(int curr, int dis)
+void write_stats_avg(int curr, int dis)
+{
+	char string[16];
+
+	snprintf(string, sizeof(string), "%s", _("Average:"));
+	write_stats_core(2, curr, dis, TRUE, string, string);
+}
+
+/*
+ ***************************************************************************
+ * Get previous and current timestamps, then display statistics.
+ *
+ * IN:
+ * @curr	Index in array for current sample statistics.
+ * @dis		TRUE if a header line must be printed.
+ *
+ * RETURNS:
+ * 0 if all the processes to display have terminated.
+ * <> 0 if there are still some processes left to display.
+ ***************************************************************************
+ */
+int write_stats(int curr, int dis)
+{
+	char cur_time[2][TIMESTAMP_LEN];
+	int again;
+
+	/* Get previous timestamp */
+	if (DISPLAY_ONELINE(pidflag)) {
+		strcpy(cur_time[!curr], "# Time     ");
+	}
+	else if (PRINT_SEC_EPOCH(pidflag)) {
+		snprintf(cur_time[!curr], sizeof(cur_time[!curr]), "%ld", (long) mktime(&ps_tstamp[!curr]));
+	}
+	else if (is_iso_time_fmt()) {
+		strftime(cur_time[!curr], sizeof(cur_time[!curr]), "%H:%M:%S", &ps_tstamp[!curr]);
+	}
+	else {
+		strftime(cur_time[!curr], sizeof(cur_time[!curr]), "%X", &ps_tstamp[!curr]);
+	}
+
+	/* Get current timestamp */
+	if (PRINT_SEC_EPOCH(pidflag)) {
+		snprintf(cur_time[curr], sizeof(cur_time[curr]), "%ld", (long) mktime(&ps_tstamp[curr]));
+	}
+	else if (is_iso_time_fmt()) {
+		strftime(cur_time[curr], sizeof(cur_time[curr]), "%H:%M:%S", &ps_tstamp[curr]);
+	}
+	else {
+		strftime(cur_time[curr], sizeof(cur_time[curr]), "%X", &ps_tstamp[curr]);
+	}
+
+	/* Make sure timestamp is null-terminated */
+	cur_time[!curr][sizeof(cur_time[!curr]) - 1] = '\0';
+	cur_time[curr][sizeof(cur_time[curr]) - 1] = '\0';
+
+	again = write_stats_core(!curr, curr, dis, FALSE,
+				 cur_time[!curr], cur_time[curr]);
+
+#ifdef HAVE_LINUX_TASKSTATS_H
+	if (DISPLAY_EXITED(pidflag)) {
+		/* Display tasks which have exited during the interval */
+		write_exited_stats(!curr, curr, cur_time[curr]);
+	}
+#endif
+
+	return again;
+}
+
+/*
+ ***************************************************************************
+ * Fields of the pid_stats structure saved in pidstat data files, in the
+ * order of the bits of the bitmap saved for each task.
+ ***************************************************************************
+ */
+#define PS_FIELD(f)	{offsetof(struct pid_stats, f), sizeof(((struct pid_stats *) 0)->f)}
+
+static const struct {
+	size_t off;
+	size_t size;
+} pid_stats_fields[] = {
+	PS_FIELD(read_bytes),	PS_FIELD(write_bytes),	PS_FIELD(cancelled_write_bytes),
+	PS_FIELD(blkio_swapin_delays),	PS_FIELD(minflt),	PS_FIELD(cminflt),
+	PS_FIELD(majflt),	PS_FIELD(cmajflt),	PS_FIELD(utime),
+	PS_FIELD(cutime),	PS_FIELD(stime),	PS_FIELD(cstime),
+	PS_FIELD(gtime),	PS_FIELD(cgtime),	PS_FIELD(wtime),
+	PS_FIELD(vsz),		PS_FIELD(rss),		PS_FIELD(nvcsw),
+	PS_FIELD(nivcsw),	PS_FIELD(stack_size),	PS_FIELD(stack_ref),
+	PS_FIELD(processor),	PS_FIELD(priority),	PS_FIELD(policy),
+	PS_FIELD(threads),	PS_FIELD(fd_nr)
+};
+
+#define PID_STATS_FIELDS_NR	(sizeof(pid_stats_fields) / sizeof(pid_stats_fields[0]))
+
+/*
+ ***************************************************************************
+ * Get the value of a field of a pid_stats structure.
+ *
+ * IN:
+ * @pst		Pointer on the pid_stats structure.
+ * @i		Index of the field in @pid_stats_fields.
+ *
+ * RETURNS:
+ * Value of the field (signed values are returned as their bit pattern).
+ ***************************************************************************
+ */
+unsigned long long get_pid_stats_field(struct pid_stats *pst, int i)
+{
+	unsigned char *f = (unsigned char *) pst + pid_stats_fields[i].off;
+	unsigned long long v64;
+	unsigned int v32;
+
+	if (pid_stats_fields[i].size == sizeof(v64)) {
+		memcpy(&v64, f, sizeof(v64));
+		return v64;
+	}
+	memcpy(&v32, f, sizeof(v32));
+	return v32;
+}
+
+/*
+ ***************************************************************************
+ * Set the value of a field of a pid_stats structure.
+ *
+ * IN:
+ * @pst		Pointer on the pid_stats structure.
+ * @i		Index of the field in @pid_stats_fields.
+ * @val		Value of the field.
+ ***************************************************************************
+ */
+void set_pid_stats_field(struct pid_stats *pst, int i, unsigned long long val)
+{
+	unsigned char *f = (unsigned char *) pst + pid_stats_fields[i].off;
+	unsigned int v32 = (unsigned int) val;
+
+	if (pid_stats_fields[i].size == sizeof(val)) {
+		memcpy(f, &val, sizeof(val));
+	}
+	else {
+		memcpy(f, &v32, sizeof(v32));
+	}
+}
+
+/*
+ ***************************************************************************
+ * Save a number in the data file (option -o) as a variable-length integer:
+ * 7 bits per byte, least significant bits first, the high bit of each byte
+ * being set if more bytes follow.
+ *
+ * IN:
+ * @val		Number to save.
+ ***************************************************************************
+ */
+void put_pid_varint(unsigned long long val)
+{
+	while (val >= 0x80) {
+		putc((int) (val & 0x7f) | 0x80, pid_ofp);
+		val >>= 7;
+	}
+	putc((int) val, pid_ofp);
+}
+
+/*
+ ***************************************************************************
+ * Save a string in the data file (option -o), preceded by its length.
+ *
+ * IN:
+ * @str		String to save.
+ ***************************************************************************
+ */
+void put_pid_string(char *str)
+{
+	size_t len = strlen(str);
+
+	put_pid_varint(len);
+	fwrite(str, 1, len, pid_ofp);
+}
+
+/*
+ ***************************************************************************
+ * Display an error message and exit when the data file read with option
+ * -f is invalid or truncated.
+ ***************************************************************************
+ */
+void pid_file_error(void)
+{
+	fprintf(stderr, _("Invalid pidstat data file: %s\n"), pid_ifile);
+	exit(3);
+}
+
+/*
+ ***************************************************************************
+ * Read a variable-length integer from the data file (option -f).
+ *
+ * RETURNS:
+ * Value of the number.
+ ***************************************************************************
+ */
+unsigned long long get_pid_varint(void)
+{
+	unsigned long long val = 0;
+	int c, shift = 0;
+
+	do {
+		if (((c = getc(pid_ifp)) == EOF) || (shift > 63)) {
+			pid_file_error();
+		}
+		val |= ((unsigned long long) (c & 0x7f)) << shift;
+		shift += 7;
+	}
+	while (c & 0x80);
+
+	return val;
+}
+
+/*
+ ***************************************************************************
+ * Read a string from the data file (option -f) and intern it.
+ *
+ * RETURNS:
+ * Pointer on the interned string.
+ ***************************************************************************
+ */
+char *get_pid_string(void)
+{
+	char buf[MAX_CMDLINE_LEN > MAX_COMM_LEN ? MAX_CMDLINE_LEN : MAX_COMM_LEN];
+	unsigned long long len;
+
+	len = get_pid_varint();
+	if ((len >= sizeof(buf)) || (fread(buf, 1, len, pid_ifp) != len)) {
+		pid_file_error();
+	}
+
+	return intern_str(buf, len);
+}
+
+/*
+ ***************************************************************************
+ * Create the data file where stats are to be saved (option -o) and write
+ * its header.
+ ***************************************************************************
+ */
+void open_pid_ofile(void)
+{
+	struct pid_file_header hdr;
+	struct utsname header;
+
+	if ((pid_ofp = fopen(pid_ofile, "w")) == NULL) {
+		fprintf(stderr, _("Cannot open %s: %s\n"), pid_ofile, strerror(errno));
+		exit(2);
+	}
+
+	memset(&hdr, 0, PID_FILE_HEADER_SIZE);
+	hdr.pf_magic = PID_FILE_MAGIC;
+	hdr.pf_format = PID_FORMAT_MAGIC;
+	hdr.pf_hdr_size = PID_FILE_HEADER_SIZE;
+	hdr.pf_tlmkb = tlmkb;
+	hdr.pf_hz = HZ;
+	hdr.pf_cpu_nr = cpu_nr;
+	hdr.pf_actflag = actflag;
+	if (top_nr && (top_key == TOP_IO)) {
+		/* I/O stats have been read to rank tasks: They are saved too */
+		hdr.pf_actflag |= P_A_IO;
+	}
+	hdr.pf_pidflag = pidflag & (P_D_TID + P_D_CMDLINE);
+
+	__uname(&header);
+	snprintf(hdr.pf_sysname, sizeof(hdr.pf_sysname), "%s", header.sysname);
+	snprintf(hdr.pf_release, sizeof(hdr.pf_release), "%s", header.release);
+	snprintf(hdr.pf_nodename, sizeof(hdr.pf_nodename), "%s", header.nodename);
+	snprintf(hdr.pf_machine, sizeof(hdr.pf_machine), "%s", header.machine);
+
+	if (fwrite(&hdr, PID_FILE_HEADER_SIZE, 1, pid_ofp) != 1) {
+		perror("fwrite");
+		exit(2);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Save current sample in the data file (option -o).
+ * Only the fields which have changed since previous sample are saved, as
+ * deltas. Tasks rejected by options -C, -G or -U are saved without stats
+ * so that their threads can still be displayed as when reading /proc.
+ *
+ * IN:
+ * @curr	Index in array for current sample statistics.
+ ***************************************************************************
+ */
+void write_pid_sample(int curr)
+{
+	struct st_pid *plist;
+	struct pid_stats *pstc, *pstp, pst0;
+	unsigned long long delta[PID_STATS_FIELDS_NR];
+	unsigned int mask;
+	unsigned int nr = 0;
+	unsigned char tflags;
+	int i;
+
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+		if (plist->exist) {
+			nr++;
+		}
+	}
+
+	putc(PID_REC_SAMPLE, pid_ofp);
+	put_pid_varint((unsigned long long) mktime(&ps_tstamp[curr]));
+	put_pid_varint(uptime_cs[curr]);
+	put_pid_varint(tot_jiffies[curr]);
+	put_pid_varint(nr);
+
+	memset(&pst0, 0, PID_STATS_SIZE);
+
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+
+		if (!plist->exist)
+			continue;
+
+		tflags = 0;
+		if (NO_PID_IO(plist->flags)) {
+			tflags |= PF_T_NO_IO;
+		}
+		if (NO_PID_FD(plist->flags)) {
+			tflags |= PF_T_NO_FD;
+		}
+		if (IS_PID_REJECTED(plist->flags)) {
+			tflags |= PF_T_REJECTED;
+		}
+		/* Names are saved once, unless they change */
+		if (IS_PID_NEWNAME(plist->flags) ||
+		    (!IS_PID_RECORDED(plist->flags) && !IS_PID_REJECTED(plist->flags))) {
+			tflags |= PF_T_NAME;
+		}
+		/* So is the UID, which may change independently of the name */
+		if ((tflags & PF_T_NAME) || IS_PID_NEWUID(plist->flags)) {
+			tflags |= PF_T_UID;
+		}
+
+		put_pid_varint(plist->pid);
+		put_pid_varint(plist->tgid ? plist->tgid->pid : 0);
+		putc(tflags, pid_ofp);
+
+		if (tflags & PF_T_UID) {
+			put_pid_varint(plist->uid);
+			plist->flags &= ~F_PID_NEWUID;
+		}
+		if (tflags & PF_T_NAME) {
+			put_pid_string(plist->comm);
+			put_pid_string(plist->cmdline);
+			plist->flags &= ~F_PID_NEWNAME;
+		}
+
+		if (IS_PID_REJECTED(plist->flags)) {
+			/* Stats have not been entirely read */
+			plist->flags &= ~F_PID_RECORDED;
+			continue;
+		}
+
+		/* Deltas are computed against the stats saved in previous sample, if any */
+		pstc = plist->pstats[curr];
+		pstp = IS_PID_RECORDED(plist->flags) ? plist->pstats[!curr] : &pst0;
+
+		mask = 0;
+		for (i = 0; i < PID_STATS_FIELDS_NR; i++) {
+			delta[i] = get_pid_stats_field(pstc, i) - get_pid_stats_field(pstp, i);
+			if (delta[i]) {
+				mask |= 1U << i;
+			}
+		}
+
+		put_pid_varint(mask);
+		for (i = 0; i < PID_STATS_FIELDS_NR; i++) {
+			if (mask & (1U << i)) {
+				/* Zigzag encoding so that small negative deltas remain small */
+				put_pid_varint((delta[i] << 1) ^ (unsigned long long) ((long long) delta[i] >> 63));
+			}
+		}
+
+		plist->flags |= F_PID_RECORDED;
+	}
+
+	if (fflush(pid_ofp) == EOF) {
+		perror("fwrite");
+		exit(2);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Open the data file read with option -f and read its header.
+ ***************************************************************************
+ */
+void open_pid_ifile(void)
 {
-	char string[16];
+	if ((pid_ifp = fopen(pid_ifile, "r")) == NULL) {
+		fprintf(stderr, _("Cannot open %s: %s\n"), pid_ifile, strerror(errno));
+		exit(2);
+	}
 
-	snprintf(string, sizeof(string), "%s", _("Average:"));
-	write_stats_core(2, curr, dis, TRUE, string, string);
+	if ((fread(&pid_fhdr, PID_FILE_HEADER_SIZE, 1, pid_ifp) != 1) ||
+	    (pid_fhdr.pf_magic != PID_FILE_MAGIC) ||
+	    (pid_fhdr.pf_format != PID_FORMAT_MAGIC) ||
+	    (pid_fhdr.pf_hdr_size != PID_FILE_HEADER_SIZE)) {
+		pid_file_error();
+	}
+
+	/* Make sure strings are null-terminated */
+	pid_fhdr.pf_sysname[PID_UTSNAME_LEN - 1] = '\0';
+	pid_fhdr.pf_release[PID_UTSNAME_LEN - 1] = '\0';
+	pid_fhdr.pf_nodename[PID_UTSNAME_LEN - 1] = '\0';
+	pid_fhdr.pf_machine[PID_UTSNAME_LEN - 1] = '\0';
 }
 
 /*
  ***************************************************************************
- * Get previous and current timestamps, then display statistics.
+ * Read next sample from the data file (option -f). Tasks are added to the
+ * list as if their stats had been read from /proc.
  *
  * IN:
- * @curr	Index in array for current sample statistics.
- * @dis		TRUE if a header line must be printed.
+ * @curr	Index in array where stats are to be saved.
  *
  * RETURNS:
- * 0 if all the processes to display have terminated.
- * <> 0 if there are still some processes left to display.
+ * TRUE if a sample has been read, and FALSE if the end of file has been
+ * reached.
  ***************************************************************************
  */
-int write_stats(int curr, int dis)
+int read_pid_sample(int curr)
 {
-	char cur_time[2][TIMESTAMP_LEN];
+	struct st_pid *plist;
+	struct pid_stats *pstc = NULL, *pstp = NULL, pst0;
+	unsigned long long val;
+	unsigned int mask, nr, j;
+	char *comm = NULL, *cmdline = NULL;
+	uid_t uid = 0;
+	pid_t pid, tgid;
+	time_t t;
+	int c, i;
+
+	if ((c = getc(pid_ifp)) == EOF)
+		return FALSE;
+	if (c != PID_REC_SAMPLE) {
+		pid_file_error();
+	}
+
+	t = (time_t) get_pid_varint();
+	localtime_r(&t, &ps_tstamp[curr]);
+	uptime_cs[curr] = get_pid_varint();
+	tot_jiffies[curr] = get_pid_varint();
+	nr = (unsigned int) get_pid_varint();
+
+	/* Every PID is potentially nonexistent */
+	set_pid_nonexistent(pid_list);
+	memset(&pst0, 0, PID_STATS_SIZE);
+
+	for (j = 0; j < nr; j++) {
+
+		pid = (pid_t) get_pid_varint();
+		tgid = (pid_t) get_pid_varint();
+		if ((c = getc(pid_ifp)) == EOF) {
+			pid_file_error();
+		}
 
-	/* Get previous timestamp */
-	if (DISPLAY_ONELINE(pidflag)) {
-		strcpy(cur_time[!curr], "# Time     ");
-	}
-	else if (PRINT_SEC_EPOCH(pidflag)) {
-		snprintf(cur_time[!curr], sizeof(cur_time[!curr]), "%ld", (long) mktime(&ps_tstamp[!curr]));
-	}
-	else if (is_iso_time_fmt()) {
-		strftime(cur_time[!curr], sizeof(cur_time[!curr]), "%H:%M:%S", &ps_tstamp[!curr]);
-	}
-	else {
-		strftime(cur_time[!curr], sizeof(cur_time[!curr]), "%X", &ps_tstamp[!curr]);
-	}
+		if (c & PF_T_UID) {
+			uid = (uid_t) get_pid_varint();
+		}
+		if (c & PF_T_NAME) {
+			comm = get_pid_string();
+			cmdline = get_pid_string();
+		}
 
-	/* Get current timestamp */
-	if (PRINT_SEC_EPOCH(pidflag)) {
-		snprintf(cur_time[curr], sizeof(cur_time[curr]), "%ld", (long) mktime(&ps_tstamp[curr]));
-	}
-	else if (is_iso_time_fmt()) {
-		strftime(cur_time[curr], sizeof(cur_time[curr]), "%H:%M:%S", &ps_tstamp[curr]);
-	}
-	else {
-		strftime(cur_time[curr], sizeof(cur_time[curr]), "%X", &ps_tstamp[curr]);
+		plist = NULL;
+		if (!tgid || DISPLAY_TID(pidflag)) {
+			/*
+			 * Threads are added only if their process has been.
+			 * Processes are added only if all of them are to be
+			 * displayed, or if they have been entered with option -p.
+			 */
+			if (DISPLAY_ALL_PID(pidflag) || tgid) {
+				plist = add_list_pid(&pid_list, pid, tgid);
+			}
+			else {
+				plist = lookup_pid(pid, 0);
+			}
+		}
+
+		if (plist) {
+			plist->exist = TRUE;
+			if (c & PF_T_UID) {
+				plist->uid = uid;
+			}
+			if (c & PF_T_NAME) {
+				release_str(plist->comm);
+				release_str(plist->cmdline);
+				plist->comm = comm;
+				plist->cmdline = cmdline;
+			}
+			/*
+			 * Tasks rejected when the file was created have no
+			 * stats saved for that sample (flag PF_T_REJECTED).
+			 */
+			if (IS_PID_REJECTED(plist->flags) && !IS_PID_RECORDED(plist->flags)) {
+				plist->flags |= F_PID_PREV_REJECTED;
+			}
+			else {
+				plist->flags &= ~F_PID_PREV_REJECTED;
+			}
+			plist->flags &= ~(F_NO_PID_IO + F_NO_PID_FD + F_PID_REJECTED);
+			if (c & PF_T_NO_IO) {
+				plist->flags |= F_NO_PID_IO;
+			}
+			if (c & PF_T_NO_FD) {
+				plist->flags |= F_NO_PID_FD;
+			}
+		}
+		else if (c & PF_T_NAME) {
+			/* Task not to be displayed */
+			release_str(comm);
+			release_str(cmdline);
+		}
+
+		if (c & PF_T_REJECTED) {
+			if (plist) {
+				plist->flags |= F_PID_REJECTED;
+				plist->flags &= ~F_PID_RECORDED;
+			}
+			continue;
+		}
+
+		mask = (unsigned int) get_pid_varint();
+
+		if (plist) {
+			pstc = plist->pstats[curr];
+			pstp = IS_PID_RECORDED(plist->flags) ? plist->pstats[!curr] : &pst0;
+		}
+		for (i = 0; i < PID_STATS_FIELDS_NR; i++) {
+			val = 0;
+			if (mask & (1U << i)) {
+				val = get_pid_varint();
+				val = (val >> 1) ^ (~(val & 1) + 1);
+			}
+			if (plist) {
+				set_pid_stats_field(pstc, i, get_pid_stats_field(pstp, i) + val);
+			}
+		}
+
+		if (plist) {
+			plist->flags |= F_PID_RECORDED;
+
+			/* Options -C, -G and -U entered when reading the file */
+			if (!match_comm_filters(plist) || !match_user_filter(plist)) {
+				plist->flags |= F_PID_REJECTED;
+			}
+		}
 	}
 
-	/* Make sure timestamp is null-terminated */
-	cur_time[!curr][sizeof(cur_time[!curr]) - 1] = '\0';
-	cur_time[curr][sizeof(cur_time[curr]) - 1] = '\0';
+	/* Free unused PID structures */
+	sfree_pid(&pid_list, FALSE);
 
-	return (write_stats_core(!curr, curr, dis, FALSE,
-				 cur_time[!curr], cur_time[curr]));
+	/* Sort list again if new tasks have been added */
+	sort_pid_list(&pid_list);
+
+	return TRUE;
 }
 
 /*
@@ -3593,7 +6340,7 @@ int write_stats(int curr, int dis)
 void rw_pidstat_loop(int dis_hdr, int rows)
 {
 	int curr = 1, dis = 1;
-	int again;
+	int again, i;
 	unsigned long lines = rows;
 	struct st_pid *plist;
 
@@ -3601,6 +6348,11 @@ void rw_pidstat_loop(int dis_hdr, int rows)
 	read_uptime(&uptime_cs[0]);
 	read_stats(0);
 
+	if (USE_OFILE(pidflag)) {
+		/* Save stats in data file */
+		write_pid_sample(0);
+	}
+
 	if (DISPLAY_MEM(actflag)) {
 		/* Get total memory */
 		read_proc_meminfo();
@@ -3631,6 +6383,9 @@ void rw_pidstat_loop(int dis_hdr, int rows)
 	for (plist = pid_list; plist != NULL; plist = plist->next) {
 		memcpy(plist->pstats[2], plist->pstats[0], PID_STATS_SIZE);
 	}
+	for (i = 0; i < cg_nr; i++) {
+		cg_tab[i]->cgstats[2] = cg_tab[i]->cgstats[0];
+	}
 
 	/* Set a handler for SIGINT and SIGTERM */
 	memset(&int_act, 0, sizeof(int_act));
@@ -3661,6 +6416,10 @@ void rw_pidstat_loop(int dis_hdr, int rows)
 		/* Read stats */
 		read_stats(curr);
 
+		if (USE_OFILE(pidflag)) {
+			write_pid_sample(curr);
+		}
+
 		if (!dis_hdr) {
 			dis = lines / rows;
 			if (dis) {
@@ -3720,6 +6479,80 @@ terminate:
 	}
 }
 
+/*
+ ***************************************************************************
+ * Replay loop: Read PID stats from a data file (option -f) and display
+ * them. The first sample has already been read.
+ *
+ * IN:
+ * @dis_hdr	Set to TRUE if the header line must always be printed.
+ * @rows	Number of rows of screen.
+ ***************************************************************************
+ */
+void replay_pidstat_loop(int dis_hdr, int rows)
+{
+	int curr = 1, dis = 1;
+	int again, more;
+	unsigned long lines = rows;
+	struct st_pid *plist;
+
+	if (!read_pid_sample(1)) {
+		/* Only one sample in file: Display stats since boot time */
+		ps_tstamp[1] = ps_tstamp[0];
+		write_stats(0, DISP_HDR);
+		if (DISPLAY_JSON_OUTPUT(xflags)) {
+			printf("\n");
+		}
+		goto terminate;
+	}
+
+	/* Save the first stats. Will be used to compute the average */
+	ps_tstamp[2] = ps_tstamp[0];
+	tot_jiffies[2] = tot_jiffies[0];
+	uptime_cs[2] = uptime_cs[0];
+	for (plist = pid_list; plist != NULL; plist = plist->next) {
+		memcpy(plist->pstats[2], plist->pstats[0], PID_STATS_SIZE);
+	}
+
+	do {
+		if (!dis_hdr) {
+			dis = lines / rows;
+			if (dis) {
+				lines %= rows;
+			}
+			lines++;
+		}
+
+		/* Print results */
+		again = write_stats(curr, dis);
+
+		if (!again)
+			return;
+
+		if ((more = read_pid_sample(!curr))) {
+			if (DISPLAY_JSON_OUTPUT(xflags)) {
+				printf(",");
+			}
+			curr ^= 1;
+		}
+		if (DISPLAY_JSON_OUTPUT(xflags)) {
+			printf("\n");
+		}
+	}
+	while (more);
+
+	if (!DISPLAY_ONELINE(pidflag) && !DISPLAY_JSON_OUTPUT(xflags)) {
+		/* Write stats average */
+		write_stats_avg(curr, dis_hdr);
+	}
+
+terminate:
+	if (DISPLAY_JSON_OUTPUT(xflags)) {
+		printf("\t\t\t]\n\t\t}\n\t]\n}}\n");
+		fflush(stdout);
+	}
+}
+
 /*
  ***************************************************************************
  * Start a program that will be monitored by pidstat.
@@ -3847,22 +6680,32 @@ int main(int argc, char **argv)
 			if (!argv[++opt]) {
 				usage(argv[0]);
 			}
+			if (COMMAND_STRING(pidflag)) {
+				/* Option entered more than once: Only last pattern is used */
+				regfree(&comm_regex);
+			}
 			snprintf(commstr, sizeof(commstr), "%s", argv[opt++]);
-			pidflag |= P_F_COMMSTR;
 			if (!strlen(commstr)) {
 				usage(argv[0]);
 			}
+			compile_pattern(&comm_regex, commstr);
+			pidflag |= P_F_COMMSTR;
 		}
 
 		else if (!strcmp(argv[opt], "-G")) {
 			if (!argv[++opt]) {
 				usage(argv[0]);
 			}
+			if (PROCESS_STRING(pidflag)) {
+				/* Option entered more than once: Only last pattern is used */
+				regfree(&proc_regex);
+			}
 			snprintf(procstr, sizeof(procstr), "%s", argv[opt++]);
-			pidflag |= P_F_PROCSTR;
 			if (!strlen(procstr)) {
 				usage(argv[0]);
 			}
+			compile_pattern(&proc_regex, procstr);
+			pidflag |= P_F_PROCSTR;
 		}
 
 		else if (!strcmp(argv[opt], "--human")) {
@@ -3877,6 +6720,87 @@ int main(int argc, char **argv)
 		}
 #endif
 
+		else if (!strncmp(argv[opt], "--top=", 6)) {
+			/* Get number of tasks to display and key used to rank them */
+			t = argv[opt] + 6;
+			i = strspn(t, DIGITS);
+			if (!i || ((top_nr = atoi(t)) < 1)) {
+				usage(argv[0]);
+			}
+			t += i;
+			if (*t == ',') {
+				t++;
+				if (!strcmp(t, K_TOP_CPU)) {
+					top_key = TOP_CPU;
+				}
+				else if (!strcmp(t, K_TOP_RSS)) {
+					top_key = TOP_RSS;
+				}
+				else if (!strcmp(t, K_TOP_IO)) {
+					top_key = TOP_IO;
+				}
+				else if (!strcmp(t, K_TOP_CSW)) {
+					top_key = TOP_CSW;
+				}
+				else {
+					usage(argv[0]);
+				}
+			}
+			else if (*t) {
+				usage(argv[0]);
+			}
+			SREALLOC(top_heap, struct pid_top, top_nr * sizeof(struct pid_top));
+			opt++;
+		}
+
+		else if (!strcmp(argv[opt], "--cgroup") ||
+			 !strncmp(argv[opt], "--cgroup=", 9)) {
+			/* Display stats for cgroups, possibly only those matching a pattern */
+			pidflag |= P_F_CGROUP;
+			if (argv[opt][8] == '=') {
+				cg_pattern = argv[opt] + 9;
+				if (!strlen(cg_pattern)) {
+					usage(argv[0]);
+				}
+			}
+			opt++;
+		}
+
+		else if (!strncmp(argv[opt], "--cgroup-depth=", 15)) {
+			/* Get maximum depth of cgroups to display */
+			t = argv[opt] + 15;
+			if (!strlen(t) || (strspn(t, DIGITS) != strlen(t))) {
+				usage(argv[0]);
+			}
+			cg_depth = atoi(t);
+			pidflag |= P_F_CGROUP;
+			opt++;
+		}
+
+		else if (!strcmp(argv[opt], "--exited")) {
+			/* Display tasks started and terminated during the interval */
+			pidflag |= P_F_EXITED;
+			opt++;
+		}
+
+		else if (!strcmp(argv[opt], "--taskstats")) {
+			/* Read stats using taskstats interface when possible */
+			pidflag |= P_F_TASKSTATS;
+			opt++;
+		}
+
+		else if (!strncmp(argv[opt], "--workers=", 10)) {
+			/* Get number of worker threads used to read tasks stats */
+			if (strspn(argv[opt] + 10, DIGITS) != strlen(argv[opt] + 10)) {
+				usage(argv[0]);
+			}
+			workers_nr = atoi(argv[opt] + 10);
+			if ((workers_nr < 1) || (workers_nr > MAX_PID_WORKERS)) {
+				usage(argv[0]);
+			}
+			opt++;
+		}
+
 		else if (!strncmp(argv[opt], "--dec=", 6) && (strlen(argv[opt]) == 7)) {
 			/* Check that the argument is a digit */
 			if (!isdigit(argv[opt][6])) {
@@ -3929,14 +6853,35 @@ int main(int argc, char **argv)
 		}
 
 		else if (!strcmp(argv[opt], "-o")) {
-			/* Select output format */
-			if (argv[++opt] && !strcmp(argv[opt], K_JSON)) {
+			/* Select output format, or save stats in a data file */
+			if (!argv[++opt]) {
+				usage(argv[0]);
+			}
+			if (!strcmp(argv[opt], K_JSON)) {
 				xflags |= X_D_JSON_OUTPUT;
-				opt++;
 			}
 			else {
+				/*
+				 * Don't silently create a data file when the
+				 * user meant JSON output (e.g. "-o json").
+				 */
+				if (!strlen(argv[opt]) || USE_OFILE(pidflag) ||
+				    !strcasecmp(argv[opt], K_JSON)) {
+					usage(argv[0]);
+				}
+				snprintf(pid_ofile, sizeof(pid_ofile), "%s", argv[opt]);
+				pidflag |= P_F_OFILE;
+			}
+			opt++;
+		}
+
+		else if (!strcmp(argv[opt], "-f")) {
+			/* Read stats from a data file */
+			if (!argv[++opt] || !strlen(argv[opt]) || USE_IFILE(pidflag)) {
 				usage(argv[0]);
 			}
+			snprintf(pid_ifile, sizeof(pid_ifile), "%s", argv[opt++]);
+			pidflag |= P_F_IFILE;
 		}
 
 		else if (!strncmp(argv[opt], "-", 1)) {
@@ -4060,14 +7005,32 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (USE_IFILE(pidflag) &&
+	    ((interval >= 0) || USE_OFILE(pidflag) || EXEC_PGM(pidflag) ||
+	     DISPLAY_EXITED(pidflag) || DISPLAY_CGROUP(pidflag))) {
+		/* Stats are read from a data file: They are displayed for every sample */
+		usage(argv[0]);
+	}
+
 	if (interval < 0) {
 		/* Interval not set => display stats since boot time */
 		interval = 0;
 	}
 
-	/* A non-zero value must be specified for interval when option -e is used */
-	if (!interval && EXEC_PGM(pidflag))
+	/* A non-zero value must be specified for interval when option -e or -o is used */
+	if (!interval && (EXEC_PGM(pidflag) || USE_OFILE(pidflag)))
+		usage(argv[0]);
+
+	/* Cgroups stats cannot be saved in a data file */
+	if (DISPLAY_CGROUP(pidflag) && USE_OFILE(pidflag))
+		usage(argv[0]);
+
+	/* Tasks selection options cannot be used with cgroups */
+	if (DISPLAY_CGROUP(pidflag) &&
+	    ((pidflag & (P_D_PID + P_D_TID + P_D_ONELINE + P_F_COMMSTR + P_F_USERSTR +
+			 P_F_PROCSTR + P_F_EXITED)) || tskflag || top_nr)) {
 		usage(argv[0]);
+	}
 
 	if (!DISPLAY_PID(pidflag)) {
 		dis_hdr = 1;
@@ -4076,9 +7039,73 @@ int main(int argc, char **argv)
 	/* Check flags and set default values */
 	check_flags();
 
+	if (DISPLAY_KTAB(actflag) && !USE_IFILE(pidflag)) {
+		/* Check if open files can be counted without reading fd directories */
+		check_fd_count_by_size();
+	}
+
 	/* Count nb of proc */
 	cpu_nr = get_cpu_nr(~0, FALSE);
 
+	if (USE_IFILE(pidflag)) {
+		open_pid_ifile();
+
+		/* Check that requested activities have been saved in file */
+		if ((actflag & ~pid_fhdr.pf_actflag) ||
+		    (top_nr && (top_key == TOP_IO) && !(pid_fhdr.pf_actflag & P_A_IO)) ||
+		    (DISPLAY_TID(pidflag) && !(pid_fhdr.pf_pidflag & P_D_TID)) ||
+		    (DISPLAY_CMDLINE(pidflag) && !(pid_fhdr.pf_pidflag & P_D_CMDLINE))) {
+			fprintf(stderr, _("Requested activities not available in file %s\n"),
+				pid_ifile);
+			exit(1);
+		}
+
+		/* Use values of the machine where stats have been collected */
+		hz = pid_fhdr.pf_hz;
+		cpu_nr = pid_fhdr.pf_cpu_nr;
+		tlmkb = pid_fhdr.pf_tlmkb;
+	}
+
+	if (!workers_nr) {
+		/* Use one worker thread per processor by default */
+		workers_nr = (cpu_nr > MAX_PID_WORKERS) ? MAX_PID_WORKERS : cpu_nr;
+	}
+
+#ifdef HAVE_LINUX_TASKSTATS_H
+	if (USE_TASKSTATS(pidflag) && !USE_IFILE(pidflag)) {
+		/* Check that taskstats can be used, else fall back to /proc files */
+		taskstats_init();
+	}
+#endif
+
+	if (DISPLAY_CGROUP(pidflag)) {
+		char filename[MAX_PF_NAME];
+
+		/* Look for the cgroup v2 hierarchy */
+		snprintf(filename, sizeof(filename), "%s/%s", CGROUP_ROOT, CG_CONTROLLERS);
+		if (access(filename, F_OK) < 0) {
+			cg_root = CGROUP_UNIFIED;
+			snprintf(filename, sizeof(filename), "%s/%s", cg_root, CG_CONTROLLERS);
+			if (access(filename, F_OK) < 0) {
+				fprintf(stderr, _("Cannot find cgroup v2 hierarchy\n"));
+				exit(1);
+			}
+		}
+	}
+
+	if (DISPLAY_EXITED(pidflag)) {
+		/* Exited tasks are displayed at the end of each interval, in plain format */
+		if (!interval || DISPLAY_JSON_OUTPUT(xflags)) {
+			usage(argv[0]);
+		}
+#ifdef HAVE_LINUX_TASKSTATS_H
+		exited_init();
+#else
+		fprintf(stderr, _("Requested activities not available\n"));
+		exit(1);
+#endif
+	}
+
 	if (dis_hdr < 0) {
 		dis_hdr = 0;
 	}
@@ -4091,8 +7118,22 @@ int main(int argc, char **argv)
 		}
 	}
 
-	/* Get time */
-	get_xtime(&(ps_tstamp[0]), 0, LOCAL_TIME);
+	if (USE_IFILE(pidflag)) {
+		/* Read first sample from data file */
+		if (!read_pid_sample(0)) {
+			pid_file_error();
+		}
+	}
+	else {
+		/* Get time */
+		get_xtime(&(ps_tstamp[0]), 0, LOCAL_TIME);
+	}
+
+	if (USE_OFILE(pidflag)) {
+		/* Total memory is saved in file header */
+		read_proc_meminfo();
+		open_pid_ofile();
+	}
 
 	if (DISPLAY_JSON_OUTPUT(xflags)) {
 		/* Use a decimal point to make JSON code compliant with RFC7159 */
@@ -4108,17 +7149,46 @@ int main(int argc, char **argv)
 	 */
 	setbuf(stdout, NULL);
 
-	/* Get system name, release number and hostname */
-	__uname(&header);
-	print_gal_header(&(ps_tstamp[0]), header.sysname, header.release,
-			 header.nodename, header.machine, cpu_nr,
-			 DISPLAY_JSON_OUTPUT(xflags));
+	if (USE_IFILE(pidflag)) {
+		/* Display system name, release number and hostname saved in file */
+		print_gal_header(&(ps_tstamp[0]), pid_fhdr.pf_sysname, pid_fhdr.pf_release,
+				 pid_fhdr.pf_nodename, pid_fhdr.pf_machine, cpu_nr,
+				 DISPLAY_JSON_OUTPUT(xflags));
+
+		/* Replay loop */
+		replay_pidstat_loop(dis_hdr, rows);
+		fclose(pid_ifp);
+	}
+	else {
+		/* Get system name, release number and hostname */
+		__uname(&header);
+		print_gal_header(&(ps_tstamp[0]), header.sysname, header.release,
+				 header.nodename, header.machine, cpu_nr,
+				 DISPLAY_JSON_OUTPUT(xflags));
+
+		/* Main loop */
+		rw_pidstat_loop(dis_hdr, rows);
+	}
 
-	/* Main loop */
-	rw_pidstat_loop(dis_hdr, rows);
+	if (USE_OFILE(pidflag)) {
+		fclose(pid_ofp);
+	}
 
 	/* Free structures */
 	sfree_pid(&pid_list, TRUE);
+	slab_destroy(&pid_slab);
+	slab_destroy(&pstats_slab);
+	slab_destroy(&uname_slab);
+	sfree_cgroups();
+	free(top_heap);
+	if (COMMAND_STRING(pidflag)) {
+		regfree(&comm_regex);
+	}
+	if (PROCESS_STRING(pidflag)) {
+		regfree(&proc_regex);
+	}
+	free_str_htab();
+	free(scan_tab);
 
 	/*
 	 * @status contains the exit code of the child process monitored with option -e,
@@ -12,12 +12,29 @@
 #endif
 #include "common.h"
 
+#ifdef HAVE_LINUX_TASKSTATS_H
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+#include <linux/taskstats.h>
+#endif
+
 #define K_SELF		"SELF"
 
 #define K_P_TASK	"TASK"
 #define K_P_CHILD	"CHILD"
 #define K_P_ALL		"ALL"
 
+#define K_TOP_CPU	"CPU"
+#define K_TOP_RSS	"RSS"
+#define K_TOP_IO	"IO"
+#define K_TOP_CSW	"CSW"
+
+/* Keys used to rank tasks with option --top */
+#define TOP_CPU		0
+#define TOP_RSS		1
+#define TOP_IO		2
+#define TOP_CSW		3
+
 #ifdef _POSIX_ARG_MAX
 #define MAX_COMM_LEN    _POSIX_ARG_MAX
 #define MAX_CMDLINE_LEN _POSIX_ARG_MAX
@@ -71,6 +88,11 @@
 #define P_D_UNIT	0x0800
 #define P_D_SEC_EPOCH	0x1000
 #define P_F_EXEC_PGM	0x2000
+#define P_F_TASKSTATS	0x4000
+#define P_F_EXITED	0x8000
+#define P_F_CGROUP	0x10000
+#define P_F_OFILE	0x20000
+#define P_F_IFILE	0x40000
 
 #define DISPLAY_PID(m)		(((m) & P_D_PID) == P_D_PID)
 #define DISPLAY_ALL_PID(m)	(((m) & P_D_ALL_PID) == P_D_ALL_PID)
@@ -86,16 +108,77 @@
 #define DISPLAY_UNIT(m)		(((m) & P_D_UNIT) == P_D_UNIT)
 #define PRINT_SEC_EPOCH(m)	(((m) & P_D_SEC_EPOCH) == P_D_SEC_EPOCH)
 #define EXEC_PGM(m)		(((m) & P_F_EXEC_PGM) == P_F_EXEC_PGM)
+#define USE_TASKSTATS(m)	(((m) & P_F_TASKSTATS) == P_F_TASKSTATS)
+#define DISPLAY_EXITED(m)	(((m) & P_F_EXITED) == P_F_EXITED)
+#define DISPLAY_CGROUP(m)	(((m) & P_F_CGROUP) == P_F_CGROUP)
+#define USE_OFILE(m)		(((m) & P_F_OFILE) == P_F_OFILE)
+#define USE_IFILE(m)		(((m) & P_F_IFILE) == P_F_IFILE)
 
 /* Per-process flags */
 #define F_NO_PID_IO	0x01
 #define F_NO_PID_FD	0x02
 #define F_PID_DISPLAYED	0x04
+#define F_PID_REJECTED	0x08
+#define F_PID_TOP	0x10
+#define F_PID_RECORDED	0x20
+#define F_PID_NEWNAME	0x40
+/* Task was rejected at previous sample: Its previous stats are incomplete */
+#define F_PID_PREV_REJECTED	0x80
+#define F_PID_NEWUID	0x100
 
 #define NO_PID_IO(m)		(((m) & F_NO_PID_IO) == F_NO_PID_IO)
 #define NO_PID_FD(m)		(((m) & F_NO_PID_FD) == F_NO_PID_FD)
 #define IS_PID_DISPLAYED(m)	(((m) & F_PID_DISPLAYED) == F_PID_DISPLAYED)
+#define IS_PID_REJECTED(m)	(((m) & F_PID_REJECTED) == F_PID_REJECTED)
+#define IS_PID_TOP(m)		(((m) & F_PID_TOP) == F_PID_TOP)
+#define IS_PID_RECORDED(m)	(((m) & F_PID_RECORDED) == F_PID_RECORDED)
+#define IS_PID_NEWNAME(m)	(((m) & F_PID_NEWNAME) == F_PID_NEWNAME)
+#define IS_PID_PREV_REJECTED(m)	(((m) & F_PID_PREV_REJECTED) == F_PID_PREV_REJECTED)
+#define IS_PID_NEWUID(m)	(((m) & F_PID_NEWUID) == F_PID_NEWUID)
+
+/*
+ * Number of buckets in the hash table used to look up tasks.
+ * Must be a power of 2.
+ */
+#define PID_HASH_SIZE	8192
+/*
+ * Hash key for a task: @tgid is the TGID number if task is a TID,
+ * and 0 otherwise.
+ */
+#define PID_HASH(tgid, pid)	((((unsigned int) (pid)) ^ (((unsigned int) (tgid)) << 7)) & \
+				 (PID_HASH_SIZE - 1))
+
+/* Number of objects allocated at once by the slab allocator */
+#define PID_SLAB_NR	256
+/*
+ * Objects of the slab allocator are 8-byte aligned: Pointers are only
+ * 4-byte long on 32-bit platforms, and so may be the size of an object.
+ */
+#define PID_SLAB_ALIGN(size)	(((size) + 7) & ~((size_t) 7))
+/* Size of the header of a block of objects (pointer on the next block) */
+#define PID_SLAB_HDR_SIZE	PID_SLAB_ALIGN(sizeof(void *))
+
+/*
+ * Number of buckets in the hash table used to intern command strings.
+ * Must be a power of 2.
+ */
+#define STR_HASH_SIZE	4096
+
+/* Get the st_str structure containing string @str */
+#define STR_ENTRY(str)	((struct st_str *) ((str) - offsetof(struct st_str, s)))
 
+/* Number of buckets in the cache of user names. Must be a power of 2. */
+#define UNAME_HASH_SIZE	256
+
+/* Number of buckets in the hash table used to look up cgroups. Must be a power of 2. */
+#define CG_HASH_SIZE	1024
+/* Number of cgroups for which room is added at once in the table of cgroups */
+#define CG_TAB_CHUNK	256
+
+/* Maximum number of worker threads used to read tasks stats */
+#define MAX_PID_WORKERS	64
+/* Number of tasks taken at once by a worker thread */
+#define PID_SCAN_CHUNK	32
 
 #define PROC		PRE "/proc"
 
@@ -116,6 +199,28 @@
 #define TASK_SMAP	PRE "/proc/%u/task/%u/smaps"
 #define TASK_FD		PRE "/proc/%u/task/%u/fd"
 
+/*
+ * Mount points of the cgroup v2 hierarchy (the second one is used in
+ * hybrid mode) and files read in each cgroup.
+ */
+#define CGROUP_ROOT	PRE "/sys/fs/cgroup"
+#define CGROUP_UNIFIED	PRE "/sys/fs/cgroup/unified"
+#define CG_CONTROLLERS	"cgroup.controllers"
+#define CG_CPU_STAT	"cpu.stat"
+#define CG_CPU_PRESSURE	"cpu.pressure"
+#define CG_MEM_CURRENT	"memory.current"
+#define CG_MEM_STAT	"memory.stat"
+#define CG_MEM_PRESSURE	"memory.pressure"
+#define CG_IO_STAT	"io.stat"
+#define CG_IO_PRESSURE	"io.pressure"
+
+/*
+ * Counters of a cgroup removed then created again with the same path
+ * restart from 0: Don't display negative values in this case.
+ */
+#define CG_S_VALUE(m,n,p)	((n) < (m) ? 0.0 : S_VALUE(m,n,p))
+#define CG_SP_VALUE(m,n,p)	((n) < (m) ? 0.0 : SP_VALUE(m,n,p))
+
 #define PRINT_ID_HDR(_timestamp_, _flag_)	do {						\
 							printf("\n%-11s", _timestamp_);	\
 							if (DISPLAY_USERNAME(_flag_)) {		\
@@ -212,9 +317,162 @@ struct st_pid {
 	unsigned int	   delay_asum_count;
 	struct pid_stats  *pstats[3];
 	struct st_pid	  *tgid;	/* If current task is a TID, pointer to its TGID. NULL otherwise. */
-	struct st_pid	  *next;
-	char		   comm[MAX_COMM_LEN];
-	char		   cmdline[MAX_CMDLINE_LEN];
+	struct st_pid	  *next;	/* Next task in list, sorted by PID, then TID */
+	struct st_pid	  *hnext;	/* Next task in the same hash bucket */
+	struct st_pid	 **hprev;	/* Pointer on the pointer to current task in its hash bucket */
+	char		  *comm;	/* See intern_str() and alloc_str() */
+	char		  *cmdline;	/* Interned (see intern_str()) */
 };
 
+/*
+ * Slab allocator used for st_pid structures and pid_stats arrays.
+ * Objects are allocated by blocks of PID_SLAB_NR and freed objects
+ * are kept in a free list to be reused.
+ */
+struct pid_slab {
+	size_t	size;		/* Size of an object */
+	void	*free;		/* First free object */
+	void	*blocks;	/* First block of objects */
+};
+
+/* Command string, either interned or owned by a single task */
+struct st_str {
+	struct st_str	*next;	/* Next string in the same hash bucket */
+	unsigned int	 hash;
+	unsigned int	 refcnt;	/* Number of references. 0 if not interned */
+	char		 s[];
+};
+
+/* Entry of the cache of user names */
+struct st_uname {
+	struct st_uname	*next;	/* Next entry in the same hash bucket */
+	uid_t		 uid;
+	char		*name;	/* Interned (see intern_str()). NULL if uid is unknown */
+};
+
+/* Entry of the heap used to select the tasks to display with option --top */
+struct pid_top {
+	unsigned long long key;
+	struct st_pid	  *plist;
+};
+
+/* Statistics read from the files of a cgroup (option --cgroup) */
+struct cg_stats {
+	unsigned long long usage_usec;
+	unsigned long long user_usec;
+	unsigned long long system_usec;
+	unsigned long long minflt;
+	unsigned long long majflt;
+	unsigned long long mem_kb;	/* memory.current in kB */
+	unsigned long long rbytes;	/* Sum for all the devices */
+	unsigned long long wbytes;
+	/* Total stall times in us read from *.pressure files */
+	unsigned long long cpu_some;
+	unsigned long long mem_some;
+	unsigned long long mem_full;
+	unsigned long long io_some;
+	unsigned long long io_full;
+};
+
+#define CG_STATS_SIZE	(sizeof(struct cg_stats))
+
+struct st_cgroup {
+	unsigned long long total_mem;
+	unsigned int	   mem_asum_count;
+	unsigned int	   hash;
+	int		   exist;	/* TRUE if cgroup has been found during last scan */
+	struct cg_stats	   cgstats[3];
+	struct st_cgroup  *hnext;	/* Next cgroup in the same hash bucket */
+	char		   path[];	/* Relative to the cgroup root. "/" for the root cgroup */
+};
+
+/*
+ * pidstat data files (option -o).
+ * A file begins with a pid_file_header structure, followed by one record
+ * per sample. A record is made of a PID_REC_SAMPLE byte, then of the
+ * timestamp, uptime and total number of jiffies, and of the number of
+ * tasks saved. Each task is then saved as its PID and TGID numbers, a
+ * flags byte, the UID and the name of the task (only when it is seen for
+ * the first time or when they have changed), and a bitmap of the pid_stats
+ * fields which have changed since previous sample followed by their
+ * deltas. All the numbers in the records are saved as variable-length
+ * integers, so that the format doesn't depend on the byte order.
+ */
+#define PID_FILE_MAGIC		0xd59a
+/* Changes whenever the format of pidstat data files changes */
+#define PID_FORMAT_MAGIC	0x0002
+
+#define PID_UTSNAME_LEN		65
+
+struct pid_file_header {
+	unsigned short	   pf_magic;
+	unsigned short	   pf_format;
+	unsigned int	   pf_hdr_size;
+	unsigned long long pf_tlmkb;
+	unsigned int	   pf_hz;
+	unsigned int	   pf_cpu_nr;
+	/* Activities whose stats have been saved */
+	unsigned int	   pf_actflag;
+	/* P_D_TID if threads have been saved, P_D_CMDLINE if command lines have */
+	unsigned int	   pf_pidflag;
+	char		   pf_sysname[PID_UTSNAME_LEN];
+	char		   pf_release[PID_UTSNAME_LEN];
+	char		   pf_nodename[PID_UTSNAME_LEN];
+	char		   pf_machine[PID_UTSNAME_LEN];
+};
+
+#define PID_FILE_HEADER_SIZE	(sizeof(struct pid_file_header))
+
+/* Record types */
+#define PID_REC_SAMPLE	1
+
+/* Flags saved for each task */
+#define PF_T_NO_IO	0x01
+#define PF_T_NO_FD	0x02
+#define PF_T_NAME	0x04
+#define PF_T_REJECTED	0x08
+#define PF_T_UID	0x10
+
+/* Scan of tasks shared by worker threads */
+struct pid_scan {
+	int next;	/* Index in @scan_tab of next task to read */
+	int curr;	/* Index in array for current sample statistics */
+};
+
+#ifdef HAVE_LINUX_TASKSTATS_H
+/* Size of the buffer for generic netlink attributes */
+#define NL_MSG_BUF_SIZE	2048
+
+/* Generic netlink message used to read taskstats */
+struct nl_msg {
+	struct nlmsghdr		n;
+	struct genlmsghdr	g;
+	char			buf[NL_MSG_BUF_SIZE];
+};
+
+#define NL_MSG_HDR_SIZE	(sizeof(struct nlmsghdr) + sizeof(struct genlmsghdr))
+
+/* Maximum number of exited tasks saved between two reports (option --exited) */
+#define MAX_EXITED_TASKS	4096
+/* Size of the receive buffer of the socket used to get exit events */
+#define EXITED_RCVBUF_SIZE	(1024 * 1024)
+
+#define CPU_POSSIBLE	"/sys/devices/system/cpu/possible"
+
+/* Final stats of a task which has exited, as sent by taskstats */
+struct st_exited {
+	unsigned long long utime;	/* User time in us */
+	unsigned long long stime;	/* System time in us */
+	unsigned long long minflt;
+	unsigned long long majflt;
+	unsigned long long hiwater_rss;	/* High-watermark of RSS usage in kB */
+	unsigned long long read_bytes;
+	unsigned long long write_bytes;
+	pid_t		   pid;
+	pid_t		   ppid;
+	uid_t		   uid;
+	char		   comm[TS_COMM_LEN];
+};
+#endif
+
 #endif  /* _PIDSTAT_H */
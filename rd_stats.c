@@ -51,8 +51,8 @@ struct stats_psi {
 
 /*
  ***************************************************************************
- * Read CPU statistics.
- * Remember that this function is used by several sysstat commands!
+ * Read CPU statistics. Same as read_stat_cpu() but doesn't exit if
+ * /proc/stat cannot be opened.
  *
  * IN:
  * @st_cpu	Buffer where structures containing stats will be saved.
@@ -62,18 +62,14 @@ struct stats_psi {
  * @st_cpu	Buffer with statistics.
  *
  * RETURNS:
- * Highest CPU number(*) for which statistics have been read.
- * 1 means CPU "all", 2 means CPU 0, 3 means CPU 1, etc.
- * Or -1 if the buffer was too small and needs to be reallocated.
- *
- * (*)This doesn't account for all processors in the machine in the case
- * where some CPU are offline and located at the end of the list.
+ * Same values as read_stat_cpu(), or -2 if /proc/stat cannot be opened
+ * (errno is then set).
  *
  * USED BY:
- * sadc, iostat, mpstat, pidstat
+ * libsysstat
  ***************************************************************************
  */
-__nr_t read_stat_cpu(struct stats_cpu *st_cpu, __nr_t nr_alloc)
+__nr_t __read_stat_cpu(struct stats_cpu *st_cpu, __nr_t nr_alloc)
 {
 	FILE *fp;
 	struct stats_cpu *st_cpu_i;
@@ -82,10 +78,8 @@ __nr_t read_stat_cpu(struct stats_cpu *st_cpu, __nr_t nr_alloc)
 	int proc_nr;
 	__nr_t cpu_read = 0;
 
-	if ((fp = fopen(STAT, "r")) == NULL) {
-		fprintf(stderr, _("Cannot open %s: %s\n"), STAT, strerror(errno));
-		exit(2);
-	}
+	if ((fp = fopen(STAT, "r")) == NULL)
+		return -2;
 
 	while (fgets(line, sizeof(line), fp) != NULL) {
 
@@ -162,17 +156,56 @@ __nr_t read_stat_cpu(struct stats_cpu *st_cpu, __nr_t nr_alloc)
 	return cpu_read;
 }
 
+/*
+ ***************************************************************************
+ * Read CPU statistics.
+ * Remember that this function is used by several sysstat commands!
+ *
+ * IN:
+ * @st_cpu	Buffer where structures containing stats will be saved.
+ * @nr_alloc	Total number of structures allocated. Value is >= 1.
+ *
+ * OUT:
+ * @st_cpu	Buffer with statistics.
+ *
+ * RETURNS:
+ * Highest CPU number(*) for which statistics have been read.
+ * 1 means CPU "all", 2 means CPU 0, 3 means CPU 1, etc.
+ * Or -1 if the buffer was too small and needs to be reallocated.
+ *
+ * (*)This doesn't account for all processors in the machine in the case
+ * where some CPU are offline and located at the end of the list.
+ *
+ * USED BY:
+ * sadc, iostat, mpstat, pidstat
+ ***************************************************************************
+ */
+__nr_t read_stat_cpu(struct stats_cpu *st_cpu, __nr_t nr_alloc)
+{
+	__nr_t cpu_read;
+
+	if ((cpu_read = __read_stat_cpu(st_cpu, nr_alloc)) == -2) {
+		fprintf(stderr, _("Cannot open %s: %s\n"), STAT, strerror(errno));
+		exit(2);
+	}
+
+	return cpu_read;
+}
+
 /*
  ***************************************************************************
  * Read interrupts statistics from /proc/interrupts.
+ * Per-CPU counters are saved in a sparse matrix: See struct stats_irq_csr.
  *
  * IN:
- * @st_irq	Structure where stats will be saved.
- * @nr_alloc	Number of CPU structures allocated. Value is >= 1.
- * @nr_int	Number of interrupts, including sum. value is >= 1.
+ * @st_irq	Structure where stats will be saved. Its @nr_cpu field is the
+ *		number of CPU structures allocated (value is >= 1), and its
+ *		@nr_int field the number of interrupts, including sum (value
+ *		is >= 1).
  *
  * OUT:
- * @st_irq	Structure with statistics.
+ * @st_irq	Structure with statistics. Arrays of non-zero counters may
+ *		have been reallocated.
  *
  * RETURNS:
  * Highest CPU number for which stats have been successfully read (2 for CPU0,
@@ -185,15 +218,16 @@ __nr_t read_stat_cpu(struct stats_cpu *st_cpu, __nr_t nr_alloc)
  * saved in file preceding each sample, not the number of sub-items).
  ***************************************************************************
  */
-__nr_t read_stat_irq(struct stats_irq *st_irq, __nr_t nr_alloc, __nr_t nr_int)
+__nr_t read_stat_irq(struct stats_irq_csr *st_irq)
 {
 	FILE *fp;
-	struct stats_irq *st_cpuall_sum, *st_cpu_irq, *st_cpu_sum, *st_cpuall_irq;
+	struct stats_irq *st_cpuall_irq;
 	char *line = NULL, *li;
 	int rc = 0, irq_read = 0;
-	int cpu, len;
-	int cpu_nr = nr_alloc - 1;
+	int cpu, len, i;
+	int cpu_nr = st_irq->nr_cpu - 1;
 	int *cpu_index = NULL, index = 0;
+	unsigned int irq_nr;
 	char *cp, *next;
 
 	if (!cpu_nr) {
@@ -202,6 +236,11 @@ __nr_t read_stat_irq(struct stats_irq *st_irq, __nr_t nr_alloc, __nr_t nr_int)
 	}
 	SREALLOC(cpu_index, int, sizeof(int) * cpu_nr);
 
+	memset(st_irq->st_all, 0, STATS_IRQ_SIZE * (size_t) st_irq->nr_int);
+	memset(st_irq->cpu_sum, 0, sizeof(unsigned int) * (size_t) st_irq->nr_cpu);
+	st_irq->nnz = 0;
+	st_irq->row[0] = 0;
+
 	if ((fp = fopen(INTERRUPTS, "r")) != NULL) {
 
 		SREALLOC(line, char, INTERRUPTS_LINE + 11 * cpu_nr);
@@ -215,7 +254,7 @@ __nr_t read_stat_irq(struct stats_irq *st_irq, __nr_t nr_alloc, __nr_t nr_int)
 			while (((cp = strstr(next, "CPU")) != NULL) && (index < cpu_nr)) {
 				cpu = strtol(cp + 3, &next, 10);
 
-				if (cpu + 2 > nr_alloc) {
+				if (cpu + 2 > st_irq->nr_cpu) {
 					rc = -1;
 					goto out;
 				}
@@ -226,13 +265,12 @@ __nr_t read_stat_irq(struct stats_irq *st_irq, __nr_t nr_alloc, __nr_t nr_int)
 				break;
 		}
 
-		st_cpuall_sum = st_irq;
 		/* Save name "sum" for total number of interrupts */
-		strcpy(st_cpuall_sum->irq_name, K_LOWERSUM);
+		strcpy(st_irq->st_all->irq_name, K_LOWERSUM);
 
 		/* Parse each line of interrupts statistics data */
 		while ((fgets(line, INTERRUPTS_LINE + 11 * cpu_nr, fp) != NULL) &&
-		       (irq_read < nr_int - 1)) {
+		       (irq_read < st_irq->nr_int - 1)) {
 
 			/* Skip over "<irq>:" */
 			if ((cp = strchr(line, ':')) == NULL)
@@ -241,7 +279,8 @@ __nr_t read_stat_irq(struct stats_irq *st_irq, __nr_t nr_alloc, __nr_t nr_int)
 			cp++;
 
 			irq_read++;
-			st_cpuall_irq = st_irq + irq_read;
+			st_cpuall_irq = st_irq->st_all + irq_read;
+			st_irq->row[irq_read] = st_irq->nnz;
 
 			/* Remove possible heading spaces in interrupt's name... */
 			li = line;
@@ -258,26 +297,41 @@ __nr_t read_stat_irq(struct stats_irq *st_irq, __nr_t nr_alloc, __nr_t nr_int)
 
 			/* For each interrupt: Get number received by each CPU */
 			for (cpu = 0; cpu < index; cpu++) {
-				st_cpu_sum = st_irq + (cpu_index[cpu] + 1) * nr_int;
-				st_cpu_irq = st_irq + (cpu_index[cpu] + 1) * nr_int + irq_read;
+				irq_nr = strtoul(cp, &next, 10);
+				cp = next;
+				if (!irq_nr)
+					continue;
+
+				if (st_irq->nnz >= st_irq->nnz_alloc) {
+					/* Arrays of non-zero counters are too small */
+					st_irq->nnz_alloc *= 2;
+					SREALLOC(st_irq->cpu, int,
+						 sizeof(int) * (size_t) st_irq->nnz_alloc);
+					SREALLOC(st_irq->irq_nr, unsigned int,
+						 sizeof(unsigned int) * (size_t) st_irq->nnz_alloc);
+				}
 				/*
-				 * Interrupt name is saved only for CPU "all".
-				 * Now save current interrupt value for current CPU
+				 * Save current interrupt value for current CPU
 				 * and total number of interrupts received by current CPU
 				 * and number of current interrupt received by all CPU.
 				 */
-				st_cpu_irq->irq_nr = strtoul(cp, &next, 10);
-				st_cpuall_irq->irq_nr += st_cpu_irq->irq_nr;
-				st_cpu_sum->irq_nr += st_cpu_irq->irq_nr;
-				cp = next;
+				st_irq->cpu[st_irq->nnz] = cpu_index[cpu];
+				st_irq->irq_nr[st_irq->nnz++] = irq_nr;
+				st_cpuall_irq->irq_nr += irq_nr;
+				st_irq->cpu_sum[cpu_index[cpu] + 1] += irq_nr;
 			}
-			st_cpuall_sum->irq_nr += st_cpuall_irq->irq_nr;
+			st_irq->st_all->irq_nr += st_cpuall_irq->irq_nr;
 		}
 out:
 		free(line);
 		fclose(fp);
 	}
 
+	/* Interrupts which have not been read have no per-CPU counters */
+	for (i = irq_read + 1; i <= st_irq->nr_int; i++) {
+		st_irq->row[i] = st_irq->nnz;
+	}
+
 	if (index && !rc) {
 		rc = cpu_index[index - 1] + 2;
 	}
@@ -400,39 +454,54 @@ __nr_t read_meminfo(struct stats_memory *st_memory)
 /*
  ***************************************************************************
  * Read machine uptime, independently of the number of processors.
+ * Same as read_uptime() but doesn't exit on error.
  *
  * OUT:
  * @uptime	Uptime value in hundredths of a second.
  *
+ * RETURNS:
+ * 0 on success, -1 otherwise.
+ *
  * USED BY:
- * sadc, cifsiostat, iostat, mpstat, pidstat
+ * libsysstat
  ***************************************************************************
  */
-void read_uptime(unsigned long long *uptime)
+int __read_uptime(unsigned long long *uptime)
 {
-	FILE *fp = NULL;
+	FILE *fp;
 	char line[128];
 	unsigned long up_sec, up_cent;
-	int err = FALSE;
+	int rc = -1;
 
-	if ((fp = fopen(UPTIME, "r")) == NULL) {
-		err = TRUE;
-	}
-	else if (fgets(line, sizeof(line), fp) == NULL) {
-		err = TRUE;
-	}
-	else if (sscanf(line, "%lu.%lu", &up_sec, &up_cent) == 2) {
+	if ((fp = fopen(UPTIME, "r")) == NULL)
+		return -1;
+
+	if ((fgets(line, sizeof(line), fp) != NULL) &&
+	    (sscanf(line, "%lu.%lu", &up_sec, &up_cent) == 2)) {
 		*uptime = (unsigned long long) up_sec * 100 +
 			  (unsigned long long) up_cent;
-	}
-	else {
-		err = TRUE;
+		rc = 0;
 	}
 
-	if (fp != NULL) {
-		fclose(fp);
-	}
-	if (err) {
+	fclose(fp);
+
+	return rc;
+}
+
+/*
+ ***************************************************************************
+ * Read machine uptime, independently of the number of processors.
+ *
+ * OUT:
+ * @uptime	Uptime value in hundredths of a second.
+ *
+ * USED BY:
+ * sadc, cifsiostat, iostat, mpstat, pidstat
+ ***************************************************************************
+ */
+void read_uptime(unsigned long long *uptime)
+{
+	if (__read_uptime(uptime) < 0) {
 		fprintf(stderr, _("Cannot read %s\n"), UPTIME);
 		exit(2);
 	}
@@ -1290,7 +1359,7 @@ __nr_t read_net_edev(struct stats_net_edev *st_net_edev, __nr_t nr_alloc)
 {
 	FILE *fp;
 	struct stats_net_edev *st_net_edev_i;
-	static char line[256], aux[16];
+	char line[256], aux[16];
 	char iface[MAX_IFACE_LEN];
 	__nr_t dev_read = 0;
 	int pos;
@@ -1628,7 +1697,7 @@ __nr_t read_net_icmp(struct stats_net_icmp *st_net_icmp)
 {
 	FILE *fp;
 	char line[1024];
-	static char format[256] = "";
+	char format[256] = "";
 	int sw = FALSE;
 
 	if ((fp = fopen(NET_SNMP, "r")) == NULL)
@@ -1704,7 +1773,7 @@ __nr_t read_net_eicmp(struct stats_net_eicmp *st_net_eicmp)
 {
 	FILE *fp;
 	char line[1024];
-	static char format[256] = "";
+	char format[256] = "";
 	int sw = FALSE;
 
 	if ((fp = fopen(NET_SNMP, "r")) == NULL)
@@ -148,7 +148,7 @@ struct stats_pcsw {
 
 /*
  * Structure for interrupts statistics.
- * In activity buffer (sadc): First structures are for global CPU utilization ("all"):
+ * In data files: First structures are for global CPU utilization ("all"):
  * interrupts sum, 0, 1,...
  * Following structures are for each individual CPU (0, 1, etc.)
  *
@@ -165,6 +165,39 @@ struct stats_irq {
 #define STATS_IRQ_U	1
 #define STATS_IRQ_XNR	1
 
+/*
+ * Interrupts statistics as collected by sadc: Counters for CPU "all" are
+ * saved in @st_all (interrupts sum, 0, 1,...). Per-CPU counters are saved
+ * as a sparse matrix in CSR format, with one row for each interrupt: Only
+ * non-zero counters are kept, sorted by CPU number. Counters of interrupt
+ * #i are in @cpu and @irq_nr, from position @row[i] to @row[i + 1] - 1.
+ * The matrix is expanded into stats_irq structures only when it is
+ * written to file.
+ *
+ * Used by: sadc
+ */
+struct stats_irq_csr {
+	/* Number of interrupts (including sum) for which arrays have been allocated */
+	__nr_t		nr_int;
+	/* Number of CPU (including CPU "all") for which @cpu_sum has been allocated */
+	__nr_t		nr_cpu;
+	/* Number of non-zero per-CPU counters, and number of entries allocated for them */
+	__nr_t		nnz;
+	__nr_t		nnz_alloc;
+	/* Interrupts received by all CPU (@nr_int structures) */
+	struct stats_irq *st_all;
+	/* Total number of interrupts received by each CPU (@nr_cpu values, first one unused) */
+	unsigned int	*cpu_sum;
+	/* Position of the first counter of each interrupt (@nr_int + 1 values) */
+	__nr_t		*row;
+	/* CPU number and value of each non-zero counter (@nnz_alloc values) */
+	int		*cpu;
+	unsigned int	*irq_nr;
+	/* Buffers used to write the matrix to file: One row of structures, and one cursor per interrupt */
+	struct stats_irq *st_row;
+	__nr_t		*pos;
+};
+
 /* Structure for swapping statistics */
 struct stats_swap {
 	unsigned long pswpin	__attribute__ ((aligned (8)));
@@ -843,12 +876,16 @@ void compute_ext_disk_stats
 	 struct ext_disk_stats *);
 unsigned long long get_per_cpu_interval
 	(struct stats_cpu *, struct stats_cpu *);
+__nr_t __read_stat_cpu
+	(struct stats_cpu *, __nr_t);
 __nr_t read_stat_cpu
 	(struct stats_cpu *, __nr_t);
 __nr_t read_stat_irq
-	(struct stats_irq *, __nr_t, __nr_t);
+	(struct stats_irq_csr *);
 __nr_t read_meminfo
 	(struct stats_memory *);
+int __read_uptime
+	(unsigned long long *);
 void read_uptime
 	(unsigned long long *);
 #ifdef SOURCE_SADC
@@ -3513,3 +3513,94 @@ __print_funct_t render_pwr_bat_stats(struct activity *a, int isdb, char *pre,
 		       bat_status[(unsigned int) spbc->status]);
 	}
 }
+
+/*
+ ***************************************************************************
+ * Display sadc's own statistics in selected format.
+ *
+ * IN:
+ * @act		Array of activities.
+ * @isdb	Flag, true if db printing, false if ppc printing.
+ * @pre		Prefix string for output entries.
+ * @xself	sadc's own statistics for current record.
+ ***************************************************************************
+ */
+void render_self_stats(struct activity *act[], int isdb, char *pre,
+		       struct self_stats *xself)
+{
+	int i, p;
+	unsigned int skip_nr = 0;
+	double coll_us, read_us;
+	struct extra_self *xs = &xself->self;
+	int pt_newlin
+		= PT_NOFLAG + (DISPLAY_HORIZONTALLY(flags) ? 0 : PT_NEWLIN);
+
+	coll_us = (double) xs->coll_ns / 1000;
+
+	for (i = 0; i < xs->act_nr; i++) {
+		if (xself->self_act[i].flags & SELF_ACT_SKIPPED) {
+			skip_nr++;
+		}
+	}
+
+	render(isdb, pre, PT_NOFLAG,
+	       "all\tread-us", "-1",
+	       NULL, NOVAL, coll_us, NULL);
+
+	render(isdb, pre, PT_NOFLAG,
+	       "all\t%coll", NULL,
+	       NULL, NOVAL, 100.0, NULL);
+
+	render(isdb, pre, pt_newlin,
+	       "all\t%skip", NULL,
+	       NULL, NOVAL,
+	       xs->act_nr ? (double) skip_nr * 100 / xs->act_nr : 0.0,
+	       NULL);
+
+	for (i = 0; i < xs->act_nr; i++) {
+
+		if ((p = get_activity_position(act, xself->self_act[i].id,
+					       RESUME_IF_NOT_FOUND)) < 0)
+			continue;
+		read_us = (double) xself->self_act[i].read_ns / 1000;
+
+		render(isdb, pre, PT_NOFLAG,
+		       "%s\tread-us", "%s",
+		       cons(sv, act[p]->name, NOVAL),
+		       NOVAL, read_us, NULL);
+
+		render(isdb, pre, PT_NOFLAG,
+		       "%s\t%%coll", NULL,
+		       cons(sv, act[p]->name, NOVAL),
+		       NOVAL,
+		       coll_us ? read_us * 100 / coll_us : 0.0,
+		       NULL);
+
+		render(isdb, pre, pt_newlin,
+		       "%s\t%%skip", NULL,
+		       cons(sv, act[p]->name, NOVAL),
+		       NOVAL,
+		       xself->self_act[i].flags & SELF_ACT_SKIPPED ? 100.0 : 0.0,
+		       NULL);
+	}
+
+	render(isdb, pre, PT_NOFLAG,
+	       "-\tusr-ms", "-",
+	       NULL, NOVAL, (double) xs->utime_us / 1000, NULL);
+
+	render(isdb, pre, PT_NOFLAG,
+	       "-\tsys-ms", NULL,
+	       NULL, NOVAL, (double) xs->stime_us / 1000, NULL);
+
+	render(isdb, pre, PT_USEINT,
+	       "-\tminflt", NULL, NULL, xs->minflt, DNOVAL, NULL);
+
+	render(isdb, pre, PT_USEINT,
+	       "-\tmajflt", NULL, NULL, xs->majflt, DNOVAL, NULL);
+
+	render(isdb, pre, PT_USEINT,
+	       "-\tnvcsw", NULL, NULL, xs->nvcsw, DNOVAL, NULL);
+
+	render(isdb, pre, PT_USEINT | pt_newlin,
+	       "-\tnivcsw", NULL, NULL, xs->nivcsw, DNOVAL, NULL);
+}
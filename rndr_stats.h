@@ -133,4 +133,8 @@ __print_funct_t render_psimem_stats
 __print_funct_t render_pwr_bat_stats
 	(struct activity *, int, char *, int, unsigned long long);
 
+/* Functions used to display sadc's own statistics */
+void render_self_stats
+	(struct activity * [], int, char *, struct self_stats *);
+
 #endif /* _RNDR_STATS_H */
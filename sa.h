@@ -116,6 +116,9 @@ enum {
 #define S_F_OPTION_P		0x20000000
 #define S_F_OPTION_I		0x40000000
 #define S_F_DEBUG_MODE		0x80000000
+#define S_F_SELF_STATS		0x100000000ULL
+#define S_F_SCHED_IDLE		0x200000000ULL	/* Only used by sadc */
+#define S_F_MLOCK		0x400000000ULL	/* Only used by sadc */
 
 #define WANT_SINCE_BOOT(m)		(((m) & S_F_SINCE_BOOT)   == S_F_SINCE_BOOT)
 #define WANT_SA_ROTAT(m)		(((m) & S_F_SA_ROTAT)     == S_F_SA_ROTAT)
@@ -150,6 +153,9 @@ enum {
 #define USE_OPTION_P(m)			(((m) & S_F_OPTION_P)     == S_F_OPTION_P)
 #define USE_OPTION_I(m)			(((m) & S_F_OPTION_I)     == S_F_OPTION_I)
 #define DISPLAY_MINMAX(m)		(((m) & S_F_MINMAX)       == S_F_MINMAX)
+#define SELF_STATS(m)			(((m) & S_F_SELF_STATS)   == S_F_SELF_STATS)
+#define USE_SCHED_IDLE(m)		(((m) & S_F_SCHED_IDLE)   == S_F_SCHED_IDLE)
+#define USE_MLOCK(m)			(((m) & S_F_MLOCK)        == S_F_MLOCK)
 
 #define AO_F_NULL		0x00000000
 
@@ -306,6 +312,14 @@ enum {
 #define C_SAR			0
 #define C_SADF			1
 #define ALL_ACTIVITIES		~0U
+/*
+ * Number of samples during which an activity is not read when sadc
+ * exceeds its CPU budget.
+ */
+#define SHED_SAMPLES_NR		10
+
+/* Pseudo activity identifier used to display sadc's own statistics */
+#define SELF_STATS_ID		0U
 #define EXIT_IF_NOT_FOUND	1
 #define RESUME_IF_NOT_FOUND	0
 
@@ -763,6 +777,83 @@ struct extra_desc {
 #define MAX_EXTRA_NR		8192
 #define MAX_EXTRA_SIZE		1024
 
+/*
+ * sadc's own statistics (option --self).
+ * They are saved with each record of statistics as two extra structures:
+ * One extra_self structure, followed by @act_nr extra_self_act structures
+ * (one for each activity collected).
+ * The composition of these structures should not change in time.
+ */
+#define SELF_MAGIC	0x5e1f
+
+struct extra_self {
+	/*
+	 * Time spent reading all the activities for current sample
+	 * (in nanoseconds).
+	 */
+	unsigned long long coll_ns;
+	/*
+	 * sadc's resource usage since previous sample: User and system time
+	 * (in microseconds), minor and major page faults, voluntary and
+	 * involuntary context switches.
+	 */
+	unsigned long long utime_us;
+	unsigned long long stime_us;
+	unsigned long long minflt;
+	unsigned long long majflt;
+	unsigned long long nvcsw;
+	unsigned long long nivcsw;
+	/*
+	 * Magic number (SELF_MAGIC).
+	 */
+	unsigned int magic;
+	/*
+	 * Number of extra_self_act structures following this one.
+	 */
+	unsigned int act_nr;
+};
+
+#define EXTRA_SELF_SIZE		(sizeof(struct extra_self))
+#define EXTRA_SELF_ULL_NR	7	/* Nr of unsigned long long in extra_self structure */
+#define EXTRA_SELF_UL_NR	0	/* Nr of unsigned long in extra_self structure */
+#define EXTRA_SELF_U_NR		2	/* Nr of [unsigned] int in extra_self structure */
+
+struct extra_self_act {
+	/*
+	 * Time spent reading current activity (in nanoseconds).
+	 */
+	unsigned long long read_ns;
+	/*
+	 * Activity identification name.
+	 */
+	unsigned int id;
+	/*
+	 * SELF_ACT_* flags.
+	 */
+	unsigned int flags;
+};
+
+/*
+ * Activity not read for current sample because sadc was over its CPU budget
+ * (see option --budget). Values saved are those from previous sample.
+ */
+#define SELF_ACT_SKIPPED	0x01
+
+#define EXTRA_SELF_ACT_SIZE	(sizeof(struct extra_self_act))
+#define EXTRA_SELF_ACT_ULL_NR	1	/* Nr of unsigned long long in extra_self_act structure */
+#define EXTRA_SELF_ACT_UL_NR	0	/* Nr of unsigned long in extra_self_act structure */
+#define EXTRA_SELF_ACT_U_NR	2	/* Nr of [unsigned] int in extra_self_act structure */
+
+/* sadc's own statistics read from a record */
+struct self_stats {
+	/*
+	 * TRUE if current record contains sadc's own statistics.
+	 */
+	int valid;
+	struct extra_self self;
+	struct extra_self_act self_act[NR_ACT];
+};
+
 /* Record type */
 enum {
 	/*
@@ -831,6 +922,150 @@ struct record_header {
 #define RECORD_HEADER_UL_NR	0	/* Nr of unsigned long in record_header structure */
 #define RECORD_HEADER_U_NR	1	/* Nr of unsigned int in record_header structure */
 
+/*
+ ***************************************************************************
+ * Shared memory ring buffer where sadc publishes its records (option
+ * --shm). Its layout is:
+ * - one shm_ring structure,
+ * - the header area (file_magic, file_header and file_activity structures,
+ *   exactly as they would be sent to stdout),
+ * - @slot_nr slots, each made of a shm_slot structure followed by
+ *   @slot_size bytes containing one record (record header, extra structures
+ *   and statistics, exactly as they would be sent to stdout).
+ * The header area and each slot are protected by a sequence counter which
+ * is odd while sadc is updating them: Readers copy the data then check that
+ * the counter has not changed.
+ * The ring is created by sadc, which is the only writer, and is not
+ * portable: It is intended to be read by processes running on the same host.
+ ***************************************************************************
+ */
+#define SHM_RING_MAGIC		0x52494e47
+#define SHM_RING_SLOT_NR	8
+/* Time to wait before checking again if a new record is available (in ms) */
+#define SHM_RING_POLL_MS	50
+
+struct shm_ring {
+	/*
+	 * Number of records published so far. Record #n is in slot
+	 * n % @slot_nr until it is overwritten by record #n + @slot_nr.
+	 */
+	unsigned long long gen;
+	/*
+	 * Sequence counter for the header area.
+	 */
+	unsigned long long hdr_seq;
+	/*
+	 * Number of records that were not published because they were
+	 * larger than a slot.
+	 */
+	unsigned long long dropped;
+	/*
+	 * Magic number (SHM_RING_MAGIC).
+	 */
+	unsigned int magic;
+	/*
+	 * Number of slots and size of the data part of each slot.
+	 */
+	unsigned int slot_nr;
+	unsigned int slot_size;
+	/*
+	 * Size of the data saved in the header area.
+	 */
+	unsigned int hdr_len;
+	/*
+	 * TRUE once sadc has stopped publishing records.
+	 */
+	unsigned int closed;
+	unsigned int pad;
+};
+
+#define SHM_RING_SIZE		(sizeof(struct shm_ring))
+/* Size of the header area (rounded up to keep slots aligned) */
+#define SHM_HDR_AREA_SIZE	\
+	((FILE_MAGIC_SIZE + FILE_HEADER_SIZE + FILE_ACTIVITY_SIZE * NR_ACT + 7) & ~((size_t) 7))
+
+struct shm_slot {
+	/*
+	 * Sequence counter for this slot.
+	 */
+	unsigned long long seq;
+	/*
+	 * Number of the record saved in this slot.
+	 */
+	unsigned long long gen;
+	/*
+	 * Value of the header area sequence counter when the record was published.
+	 */
+	unsigned long long hdr_seq;
+	/*
+	 * Size of the record.
+	 */
+	unsigned int len;
+	unsigned int pad;
+};
+
+#define SHM_SLOT_SIZE		(sizeof(struct shm_slot))
+#define SHM_HDR_AREA_OFFSET	SHM_RING_SIZE
+#define SHM_SLOT_OFFSET(ring, i)	\
+	(SHM_RING_SIZE + SHM_HDR_AREA_SIZE + (size_t) (i) * (SHM_SLOT_SIZE + (ring)->slot_size))
+#define SHM_MAP_SIZE(ring)	SHM_SLOT_OFFSET(ring, (ring)->slot_nr)
+
+/*
+ ***************************************************************************
+ * Subscribers to the records sent by sadc on a Unix domain socket (option
+ * --socket). Each subscriber first receives header data, then the records
+ * of statistics, exactly as they would be sent to stdout.
+ * Data are sent with non-blocking writes: A subscriber that has not read
+ * the previous record yet when a new one is ready doesn't get it (records
+ * are never split). It is disconnected if it misses too many records in a
+ * row.
+ ***************************************************************************
+ */
+#define MAX_SUBSCRIBERS		32
+#define SOCK_MAX_DROPS		10
+/* Test mode: Max time to wait for a subscriber before collecting stats (ms) */
+#define SOCK_TEST_TIMEOUT	10000
+
+struct sa_subscriber {
+	int fd;
+	/*
+	 * Number of consecutive records not sent to this subscriber.
+	 */
+	unsigned int drops;
+	/*
+	 * Data not sent yet.
+	 */
+	char *buf;
+	size_t buf_size;
+	size_t len;
+	size_t pos;
+};
+
+/* Reader's view of a ring buffer */
+struct shm_reader {
+	struct shm_ring *ring;
+	size_t map_size;
+	/*
+	 * Number of the next record to deliver.
+	 */
+	unsigned long long next_gen;
+	/*
+	 * Header area sequence counter value of the last header delivered.
+	 */
+	unsigned long long hdr_seq;
+	/*
+	 * TRUE if the header area should be delivered before next record.
+	 */
+	int want_hdr;
+	/*
+	 * Data (header or record) being delivered.
+	 */
+	char *buf;
+	size_t buf_size;
+	size_t len;
+	size_t pos;
+};
+
 
 /*
  ***************************************************************************
@@ -907,6 +1142,13 @@ struct record_header {
  * their statistics structures in datafile.
  */
 #define AO_DETECTED		0x400
+/*
+ * Indicate that sadc doesn't save the statistics of this activity in a
+ * buffer of @nr x @nr2 structures, as they are written to file, but in a
+ * sparse structure which is expanded only when statistics are written.
+ * Exclusively used for A_IRQ at the present time (see struct stats_irq_csr).
+ */
+#define AO_SPARSE		0x800
 
 #define IS_COLLECTED(m)		(((m) & AO_COLLECTED)        == AO_COLLECTED)
 #define IS_SELECTED(m)		(((m) & AO_SELECTED)         == AO_SELECTED)
@@ -919,6 +1161,7 @@ struct record_header {
 #define IS_MATRIX(m)		(((m) & AO_MATRIX)           == AO_MATRIX)
 #define HAS_LIST_ON_CMDLINE(m)	(((m) & AO_LIST_ON_CMDLINE)  == AO_LIST_ON_CMDLINE)
 #define ALWAYS_COUNT_ITEMS(m)	(((m) & AO_ALWAYS_COUNTED)   == AO_ALWAYS_COUNTED)
+#define IS_SPARSE(m)		(((m) & AO_SPARSE)           == AO_SPARSE)
 
 #define _buf0	buf[0]
 #define _nr0	nr[0]
@@ -1458,6 +1701,12 @@ __nr_t wrap_detect_psi
 __nr_t wrap_get_bat_nr
 	(struct activity *);
 
+/* Functions used to manage sparse buffers (see AO_SPARSE) */
+void alloc_irq_csr
+	(struct activity *);
+void free_irq_csr
+	(struct activity *);
+
 /* Functions used to read activities statistics */
 __read_funct_t wrap_read_stat_cpu
 	(struct activity *);
@@ -1622,6 +1871,8 @@ void init_extrema_values
 	(struct activity *, int);
 void init_minmax_buf
 	(struct activity *, size_t, size_t);
+int match_extra_desc
+	(struct extra_desc *, unsigned int, unsigned int []);
 int next_slice
 	(unsigned long long, unsigned long long, int, long);
 void parse_sa_devices
@@ -1656,6 +1907,8 @@ int read_file_stat_bunch
 	 char *, struct file_magic *, enum on_eof, uint64_t);
 __nr_t read_nr_value
 	(int, char *, struct file_magic *, int, int, int, __nr_t);
+int read_extra_struct
+	(int, int, int, struct self_stats *);
 int read_record_hdr
 	(int, void *, struct record_header *, struct file_header *, int, int,
 	 int, size_t, uint64_t, struct report_format *);
@@ -1671,6 +1924,16 @@ int sa_get_record_timestamp_struct
 	(uint64_t, struct record_header *, struct tstamp_ext *);
 int sa_open_read_magic
 	(int *, char *, struct file_magic *, int, int *, int);
+int shm_ring_attach
+	(struct shm_reader *, const char *);
+int shm_ring_copy_hdr
+	(struct shm_reader *);
+int shm_ring_copy_rec
+	(struct shm_reader *);
+void shm_ring_detach
+	(struct shm_reader *);
+size_t shm_ring_read
+	(struct shm_reader *, void *, size_t, int *);
 void save_extrema
 	(const unsigned int [], void *, void *, unsigned long long,
 	 double *, double *, int []);
@@ -31,6 +31,7 @@
 #include <libgen.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <ctype.h>
 #include <float.h>
 
@@ -46,6 +47,8 @@
 #endif
 
 int default_file_used = FALSE;
+/* sadc's own statistics found in the last record header read */
+struct self_stats rec_self;
 extern struct act_bitmap cpu_bitmap;
 extern unsigned int dm_major;
 
@@ -53,6 +56,8 @@ unsigned int hdr_types_nr[] = {FILE_HEADER_ULL_NR, FILE_HEADER_UL_NR, FILE_HEADE
 unsigned int act_types_nr[] = {FILE_ACTIVITY_ULL_NR, FILE_ACTIVITY_UL_NR, FILE_ACTIVITY_U_NR};
 unsigned int rec_types_nr[] = {RECORD_HEADER_ULL_NR, RECORD_HEADER_UL_NR, RECORD_HEADER_U_NR};
 unsigned int extra_desc_types_nr[] = {EXTRA_DESC_ULL_NR, EXTRA_DESC_UL_NR, EXTRA_DESC_U_NR};
+unsigned int extra_self_types_nr[] = {EXTRA_SELF_ULL_NR, EXTRA_SELF_UL_NR, EXTRA_SELF_U_NR};
+unsigned int extra_self_act_types_nr[] = {EXTRA_SELF_ACT_ULL_NR, EXTRA_SELF_ACT_UL_NR, EXTRA_SELF_ACT_U_NR};
 
 /*
  ***************************************************************************
@@ -1607,21 +1612,51 @@ int sa_fread(int ifd, void *buffer, size_t size, enum size_mode mode, enum on_eo
 
 /*
  ***************************************************************************
- * Skip unknown extra structures present in file.
+ * Check whether an extra structure description matches given structure.
+ *
+ * IN:
+ * @xtra_d	Extra structure description read from file.
+ * @size	Expected size of the extra structure.
+ * @types_nr	Expected composition of the extra structure.
+ *
+ * RETURNS:
+ * TRUE if the description matches, FALSE otherwise.
+ ***************************************************************************
+ */
+int match_extra_desc(struct extra_desc *xtra_d, unsigned int size,
+		     unsigned int types_nr[])
+{
+	return ((xtra_d->extra_size == size) &&
+		(xtra_d->extra_types_nr[0] == types_nr[0]) &&
+		(xtra_d->extra_types_nr[1] == types_nr[1]) &&
+		(xtra_d->extra_types_nr[2] == types_nr[2]));
+}
+
+/*
+ ***************************************************************************
+ * Read extra structures present in file. sadc's own statistics are saved
+ * if requested, other (unknown) extra structures are skipped.
  *
  * IN:
  * @ifd		System activity data file descriptor.
  * @endian_mismatch
  *		TRUE if file's data don't match current machine's endianness.
  * @arch_64	TRUE if file's data come from a 64 bit machine.
+ * @xself	Structure where sadc's own statistics will be saved. May be
+ *		NULL, in which case they are skipped too.
+ *
+ * OUT:
+ * @xself	sadc's own statistics if present in file.
  *
  * RETURNS:
  * -1 on error, 0 otherwise.
  ***************************************************************************
  */
-int skip_extra_struct(int ifd, int endian_mismatch, int arch_64)
+int read_extra_struct(int ifd, int endian_mismatch, int arch_64,
+		      struct self_stats *xself)
 {
 	int i;
+	unsigned int self_act_nr = 0;
 	struct extra_desc xtra_d;
 
 	do {
@@ -1654,6 +1689,35 @@ int skip_extra_struct(int ifd, int endian_mismatch, int arch_64)
 			return -1;
 		}
 
+		if (xself && (xtra_d.extra_nr == 1) &&
+		    match_extra_desc(&xtra_d, EXTRA_SELF_SIZE, extra_self_types_nr)) {
+			/* sadc's own statistics: Header part */
+			sa_fread(ifd, &xself->self, EXTRA_SELF_SIZE, HARD_SIZE, UEOF_STOP);
+			if (endian_mismatch) {
+				swap_struct(extra_self_types_nr, &xself->self, arch_64);
+			}
+			if ((xself->self.magic == SELF_MAGIC) && (xself->self.act_nr <= NR_ACT)) {
+				self_act_nr = xself->self.act_nr;
+				xself->valid = !self_act_nr;
+			}
+			continue;
+		}
+
+		if (xself && self_act_nr && (xtra_d.extra_nr == self_act_nr) &&
+		    match_extra_desc(&xtra_d, EXTRA_SELF_ACT_SIZE, extra_self_act_types_nr)) {
+			/* sadc's own statistics: One structure per activity */
+			sa_fread(ifd, xself->self_act, EXTRA_SELF_ACT_SIZE * self_act_nr,
+				 HARD_SIZE, UEOF_STOP);
+			if (endian_mismatch) {
+				for (i = 0; i < self_act_nr; i++) {
+					swap_struct(extra_self_act_types_nr, &xself->self_act[i], arch_64);
+				}
+			}
+			xself->valid = TRUE;
+			self_act_nr = 0;
+			continue;
+		}
+
 		/* Ignore current unknown extra structures */
 		for (i = 0; i < xtra_d.extra_nr; i++) {
 			if (lseek(ifd, xtra_d.extra_size, SEEK_CUR) < xtra_d.extra_size)
@@ -1665,6 +1729,25 @@ int skip_extra_struct(int ifd, int endian_mismatch, int arch_64)
 	return 0;
 }
 
+/*
+ ***************************************************************************
+ * Skip unknown extra structures present in file.
+ *
+ * IN:
+ * @ifd		System activity data file descriptor.
+ * @endian_mismatch
+ *		TRUE if file's data don't match current machine's endianness.
+ * @arch_64	TRUE if file's data come from a 64 bit machine.
+ *
+ * RETURNS:
+ * -1 on error, 0 otherwise.
+ ***************************************************************************
+ */
+int skip_extra_struct(int ifd, int endian_mismatch, int arch_64)
+{
+	return read_extra_struct(ifd, endian_mismatch, arch_64, NULL);
+}
+
 /*
  ***************************************************************************
  * Read the record header of current sample and process it.
@@ -1737,13 +1820,23 @@ int read_record_hdr(int ifd, void *buffer, struct record_header *record_hdr,
 			goto invalid_data;
 		}
 
+		if (record_hdr->record_type == R_RESTART) {
+			/*
+			 * Devices may have been given other major and minor
+			 * numbers after the system was restarted.
+			 */
+			flush_device_name_cache();
+		}
+
 		/*
-		 * Skip unknown extra structures if present.
+		 * Read extra structures if present (sadc's own statistics are saved,
+		 * unknown ones are skipped).
 		 * This will be done later for R_COMMENT and R_RESTART records, as extra structures
 		 * are saved after the comment or the number of CPU.
 		 */
+		rec_self.valid = FALSE;
 		if ((record_hdr->record_type != R_COMMENT) && (record_hdr->record_type != R_RESTART) &&
-		    record_hdr->extra_next && (skip_extra_struct(ifd, endian_mismatch, arch_64) < 0))
+		    record_hdr->extra_next && (read_extra_struct(ifd, endian_mismatch, arch_64, &rec_self) < 0))
 			goto invalid_data;
 	}
 	while ((record_hdr->record_type >= R_EXTRA_MIN) && (record_hdr->record_type <= R_EXTRA_MAX)) ;
@@ -1867,6 +1960,7 @@ int read_file_stat_bunch(struct activity *act[], int curr, int ifd, int act_nr,
 	struct file_activity *fal = file_actlst;
 	off_t offset;
 	__nr_t nr_value;
+	static __nr_t disk_nr = -1;
 
 	for (i = 0; i < act_nr; i++, fal++) {
 
@@ -1914,6 +2008,18 @@ int read_file_stat_bunch(struct activity *act[], int curr, int ifd, int act_nr,
 		}
 		act[p]->nr[curr] = nr_value;
 
+		if (act[p]->id == A_DISK) {
+			if ((disk_nr >= 0) && (nr_value != disk_nr)) {
+				/*
+				 * The list of block devices has changed: The major and
+				 * minor numbers of a device which has been removed may
+				 * now belong to another one.
+				 */
+				flush_device_name_cache();
+			}
+			disk_nr = nr_value;
+		}
+
 		/* Reallocate buffers if needed */
 		if (nr_value > act[p]->nr_allocated) {
 			reallocate_buffers(act[p], nr_value, flags);
@@ -3832,4 +3938,260 @@ void print_minmax(int ismax)
 			      : _("Minimum:"));
 }
 
+/*
+ ***************************************************************************
+ * Attach to the shared memory ring buffer where sadc publishes its records
+ * (option --shm). The ring is mapped read-only.
+ * If sadc is still running, records are delivered starting with the latest
+ * one. Else all the records still present in the ring are delivered.
+ *
+ * IN:
+ * @rd		Reader structure.
+ * @name	Name of the shared memory object.
+ *
+ * OUT:
+ * @rd		Reader structure attached to the ring buffer.
+ *
+ * RETURNS:
+ * 0 on success, -1 otherwise (errno is then set).
+ ***************************************************************************
+ */
+int shm_ring_attach(struct shm_reader *rd, const char *name)
+{
+	struct shm_ring *ring;
+	struct stat st;
+	char shm_name[MAX_FILE_LEN];
+	unsigned long long gen;
+	int fd;
+
+	memset(rd, 0, sizeof(struct shm_reader));
+	snprintf(shm_name, sizeof(shm_name), "/%s", name + (name[0] == '/'));
+
+	if ((fd = shm_open(shm_name, O_RDONLY, 0)) < 0)
+		return -1;
+
+	if ((fstat(fd, &st) < 0) || (st.st_size < (off_t) SHM_RING_SIZE)) {
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+
+	ring = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ring == MAP_FAILED)
+		return -1;
+
+	if ((ring->magic != SHM_RING_MAGIC) || !ring->slot_nr ||
+	    ((size_t) st.st_size < SHM_MAP_SIZE(ring))) {
+		munmap(ring, st.st_size);
+		errno = EINVAL;
+		return -1;
+	}
+
+	rd->ring = ring;
+	rd->map_size = st.st_size;
+	rd->want_hdr = TRUE;
+
+	rd->buf_size = ring->slot_size > SHM_HDR_AREA_SIZE ? ring->slot_size : SHM_HDR_AREA_SIZE;
+	SREALLOC(rd->buf, char, rd->buf_size);
+
+	gen = __atomic_load_n(&ring->gen, __ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) {
+		/* Oldest record still available */
+		rd->next_gen = gen > ring->slot_nr ? gen - ring->slot_nr : 0;
+	}
+	else {
+		/* Latest record */
+		rd->next_gen = gen ? gen - 1 : 0;
+	}
+
+	return 0;
+}
+
+/*
+ ***************************************************************************
+ * Detach from a shared memory ring buffer.
+ *
+ * IN:
+ * @rd	Reader structure.
+ ***************************************************************************
+ */
+void shm_ring_detach(struct shm_reader *rd)
+{
+	if (rd->ring) {
+		munmap(rd->ring, rd->map_size);
+		rd->ring = NULL;
+	}
+	free(rd->buf);
+	rd->buf = NULL;
+}
+
+/*
+ ***************************************************************************
+ * Copy the header area of a ring buffer to the reader's buffer.
+ *
+ * IN:
+ * @rd	Reader structure.
+ *
+ * RETURNS:
+ * TRUE if a consistent copy has been made, FALSE if sadc has not published
+ * the header area yet or was updating it.
+ ***************************************************************************
+ */
+int shm_ring_copy_hdr(struct shm_reader *rd)
+{
+	struct shm_ring *ring = rd->ring;
+	unsigned long long seq;
+	unsigned int len;
+
+	seq = __atomic_load_n(&ring->hdr_seq, __ATOMIC_ACQUIRE);
+	if (!seq || (seq & 1))
+		/* Header not published yet, or being updated */
+		return FALSE;
+
+	len = __atomic_load_n(&ring->hdr_len, __ATOMIC_RELAXED);
+	if (len > SHM_HDR_AREA_SIZE)
+		return FALSE;
+	memcpy(rd->buf, (char *) ring + SHM_HDR_AREA_OFFSET, len);
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&ring->hdr_seq, __ATOMIC_RELAXED) != seq)
+		return FALSE;
+
+	rd->hdr_seq = seq;
+	rd->len = len;
+	rd->pos = 0;
+
+	return TRUE;
+}
+
+/*
+ ***************************************************************************
+ * Copy record #@next_gen of a ring buffer to the reader's buffer.
+ *
+ * IN:
+ * @rd	Reader structure.
+ *
+ * RETURNS:
+ * 1 if the record has been copied, 0 if it is not available yet,
+ * -1 if it has been overwritten by a more recent one.
+ ***************************************************************************
+ */
+int shm_ring_copy_rec(struct shm_reader *rd)
+{
+	struct shm_ring *ring = rd->ring;
+	struct shm_slot *slot;
+	unsigned long long seq, gen;
+	unsigned int len;
+
+	gen = __atomic_load_n(&ring->gen, __ATOMIC_ACQUIRE);
+	if (rd->next_gen >= gen)
+		return 0;
+	if (gen - rd->next_gen > ring->slot_nr)
+		return -1;
+
+	slot = (struct shm_slot *) ((char *) ring +
+				    SHM_SLOT_OFFSET(ring, rd->next_gen % ring->slot_nr));
+
+	seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+	if ((seq & 1) || (slot->gen != rd->next_gen))
+		return -1;
+
+	len = slot->len;
+	if ((len > ring->slot_size) || (slot->hdr_seq != rd->hdr_seq))
+		return -1;
+	memcpy(rd->buf, (char *) slot + SHM_SLOT_SIZE, len);
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+		return -1;
+
+	rd->len = len;
+	rd->pos = 0;
+	rd->next_gen++;
+
+	/* A file rotation is happening: Header data will be sent again */
+	if ((len >= RECORD_HEADER_SIZE) &&
+	    (((struct record_header *) rd->buf)->record_type == R_LAST_STATS)) {
+		rd->want_hdr = TRUE;
+	}
+
+	return 1;
+}
+
+/*
+ ***************************************************************************
+ * Read data published by sadc in a shared memory ring buffer. Data are
+ * delivered as a stream, exactly as if they were read from sadc's stdout:
+ * Header data first, then one record after the other. Wait for sadc to
+ * publish new data if necessary.
+ *
+ * IN:
+ * @rd		Reader structure.
+ * @size	Number of bytes of data to read.
+ * @stop	Pointer on a variable set to a non zero value (e.g. by a
+ *		signal handler) when the caller wants to stop waiting.
+ *
+ * OUT:
+ * @buffer	Buffer where data will be saved.
+ *
+ * RETURNS:
+ * 0 if all the data have been successfully read.
+ * Otherwise (no more data, or the reader has fallen too far behind sadc),
+ * return the number of bytes left to be read.
+ ***************************************************************************
+ */
+size_t shm_ring_read(struct shm_reader *rd, void *buffer, size_t size, int *stop)
+{
+	struct timespec ts = {0, SHM_RING_POLL_MS * 1000000L};
+	size_t n;
+	int rc;
+
+	while (size) {
+
+		if (rd->pos < rd->len) {
+			n = rd->len - rd->pos;
+			if (n > size) {
+				n = size;
+			}
+			memcpy(buffer, rd->buf + rd->pos, n);
+			rd->pos += n;
+			size -= n;
+			buffer = (char *) buffer + n;
+			continue;
+		}
+
+		if (rd->want_hdr) {
+			/*
+			 * Wait for the header area to be updated, unless
+			 * this is the first time we read it.
+			 */
+			if ((!rd->hdr_seq ||
+			     (__atomic_load_n(&rd->ring->hdr_seq, __ATOMIC_ACQUIRE) != rd->hdr_seq)) &&
+			    shm_ring_copy_hdr(rd)) {
+				rd->want_hdr = FALSE;
+				continue;
+			}
+		}
+		else {
+			if ((rc = shm_ring_copy_rec(rd)) > 0)
+				continue;
+			if (rc < 0)
+				/* Record lost: Data stream is broken */
+				return size;
+		}
+
+		if (*stop ||
+		    (__atomic_load_n(&rd->ring->closed, __ATOMIC_ACQUIRE) &&
+		     (rd->want_hdr ? (rd->hdr_seq == rd->ring->hdr_seq)
+				   : (rd->next_gen >= rd->ring->gen))))
+			/* No more data to come */
+			return size;
+
+		nanosleep(&ts, NULL);
+	}
+
+	return 0;
+}
+
 #endif /* SOURCE_SADC undefined */
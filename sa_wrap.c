@@ -53,6 +53,78 @@ void *reallocate_buffer(struct activity *a)
 	return a->_buf0;
 }
 
+/*
+ ***************************************************************************
+ * Allocate (or reallocate) the sparse matrix where sadc saves interrupts
+ * statistics, for @a->nr_allocated CPU structures and @a->nr2 interrupts.
+ * Statistics are not initialized: read_stat_irq() will do it.
+ *
+ * IN:
+ * @a	Activity structure.
+ *
+ * OUT:
+ * @a	Activity structure whose buffer is a stats_irq_csr structure.
+ ***************************************************************************
+ */
+void alloc_irq_csr(struct activity *a)
+{
+	struct stats_irq_csr *st_irq;
+
+	if (a->_buf0 == NULL) {
+		SREALLOC(a->_buf0, void, sizeof(struct stats_irq_csr));
+		memset(a->_buf0, 0, sizeof(struct stats_irq_csr));
+	}
+	st_irq = (struct stats_irq_csr *) a->_buf0;
+
+	if (st_irq->nr_int != a->nr2) {
+		SREALLOC(st_irq->st_all, struct stats_irq, STATS_IRQ_SIZE * (size_t) a->nr2);
+		SREALLOC(st_irq->st_row, struct stats_irq, STATS_IRQ_SIZE * (size_t) a->nr2);
+		SREALLOC(st_irq->row, __nr_t, sizeof(__nr_t) * ((size_t) a->nr2 + 1));
+		SREALLOC(st_irq->pos, __nr_t, sizeof(__nr_t) * (size_t) a->nr2);
+		st_irq->nr_int = a->nr2;
+	}
+
+	if (st_irq->nr_cpu != a->nr_allocated) {
+		SREALLOC(st_irq->cpu_sum, unsigned int,
+			 sizeof(unsigned int) * (size_t) a->nr_allocated);
+		st_irq->nr_cpu = a->nr_allocated;
+	}
+
+	if (!st_irq->nnz_alloc) {
+		/* Arrays of non-zero counters will grow as needed */
+		st_irq->nnz_alloc = a->nr2;
+		SREALLOC(st_irq->cpu, int, sizeof(int) * (size_t) st_irq->nnz_alloc);
+		SREALLOC(st_irq->irq_nr, unsigned int,
+			 sizeof(unsigned int) * (size_t) st_irq->nnz_alloc);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Free the sparse matrix where sadc saves interrupts statistics.
+ *
+ * IN:
+ * @a	Activity structure.
+ ***************************************************************************
+ */
+void free_irq_csr(struct activity *a)
+{
+	struct stats_irq_csr *st_irq = (struct stats_irq_csr *) a->_buf0;
+
+	if (st_irq == NULL)
+		return;
+
+	free(st_irq->st_all);
+	free(st_irq->st_row);
+	free(st_irq->cpu_sum);
+	free(st_irq->row);
+	free(st_irq->pos);
+	free(st_irq->cpu);
+	free(st_irq->irq_nr);
+	free(st_irq);
+	a->_buf0 = NULL;
+}
+
 /*
  ***************************************************************************
  * Read CPU statistics.
@@ -121,17 +193,16 @@ __read_funct_t wrap_read_stat_pcsw(struct activity *a)
  */
 __read_funct_t wrap_read_stat_irq(struct activity *a)
 {
-	struct stats_irq *st_irq
-		= (struct stats_irq *) a->_buf0;
 	__nr_t nr_read;
 
 	/* Read interrupts stats */
 	do {
-		nr_read = read_stat_irq(st_irq, a->nr_allocated, a->nr2);
+		nr_read = read_stat_irq((struct stats_irq_csr *) a->_buf0);
 
 		if (nr_read < 0) {
 			/* Buffer needs to be reallocated (for CPU, not interrupts) */
-			st_irq = (struct stats_irq *) reallocate_buffer(a);
+			a->nr_allocated *= 2;	/* NB: nr_allocated > 0 */
+			alloc_irq_csr(a);
 		}
 	}
 	while (nr_read < 0);
@@ -19,6 +19,7 @@
  ***************************************************************************
  */
 
+#define _GNU_SOURCE	/* For sched_setaffinity() and SCHED_IDLE */
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -29,9 +30,15 @@
 #include <errno.h>
 #include <signal.h>
 #include <dirent.h>
+#include <sched.h>
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/utsname.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
 
 #include "version.h"
 #include "sa.h"
@@ -74,6 +81,31 @@ char comment[MAX_COMMENT_LEN];
 
 unsigned int id_seq[NR_ACT];
 
+/* sadc's own statistics (option --self) */
+struct extra_self self_hdr;
+struct extra_self_act self_act[NR_ACT];
+struct rusage self_ru_prev;
+
+/* Low-intrusion mode (options --budget, --cpus, --idle and --mlock) */
+double cpu_budget = 0.0;
+cpu_set_t cpu_pin_set;
+int cpu_pin = FALSE;
+int act_shed[NR_ACT];
+
+/* Shared memory ring buffer (option --shm) */
+char shm_name[MAX_FILE_LEN];
+int shm_fd = -1;
+struct shm_ring *shm_ring = NULL;
+size_t shm_map_size = 0;
+
+/* Unix domain socket server (option --socket) */
+char sock_path[MAX_FILE_LEN];
+int sock_fd = -1, epoll_fd = -1, stage_fd = -1;
+struct sa_subscriber subscr[MAX_SUBSCRIBERS];
+char *sock_hdr = NULL, *sock_rec = NULL;
+size_t sock_hdr_size = 0, sock_rec_size = 0, sock_hdr_len = 0;
+sigset_t sock_wait_mask;
+
 extern unsigned int hdr_types_nr[];
 extern unsigned int act_types_nr[];
 extern unsigned int rec_types_nr[];
@@ -98,7 +130,9 @@ void usage(char *progname)
 		progname);
 
 	fprintf(stderr, _("Options are:\n"
-			  "[ -C <comment> ] [ -D ] [ -F ] [ -f ] [ -L ] [ -V ]\n"
+			  "[ -C <comment> ] [ -D ] [ -F ] [ -f ] [ -L ] [ -V ] [ --self ]\n"
+			  "[ --budget=<percent> ] [ --cpus=<cpu_list> ] [ --idle ] [ --mlock ]\n"
+			  "[ --shm=<name> ] [ --socket=<path> ]\n"
 			  "[ -S { INT | DISK | IPV6 | POWER | SNMP | XDISK | ALL | XALL } ]\n"));
 	exit(1);
 }
@@ -294,6 +328,12 @@ void reset_stats(void)
 	int i;
 
         for (i = 0; i < NR_ACT; i++) {
+		if (act_shed[i])
+			/* Activity won't be read: Keep values from previous sample */
+			continue;
+		if (IS_SPARSE(act[i]->options))
+			/* Sparse buffers are initialized by their read function */
+			continue;
 		if ((act[i]->_nr0 > 0) && act[i]->_buf0) {
 			memset(act[i]->_buf0, 0,
 			       (size_t) act[i]->msize * (size_t) act[i]->nr_allocated * (size_t) act[i]->nr2);
@@ -360,9 +400,14 @@ void sa_sys_init(void)
 		if (IS_COLLECTED(act[i]->options) && (act[i]->nr_ini > 0)) {
 
 			/* Allocate structures for current activity (using nr_ini and nr2 results) */
-			SREALLOC(act[i]->_buf0, void,
-				 mul_check_overflow3((size_t) act[i]->msize, (size_t) act[i]->nr_ini, (size_t) act[i]->nr2));
 			act[i]->nr_allocated = act[i]->nr_ini;
+			if (IS_SPARSE(act[i]->options)) {
+				alloc_irq_csr(act[i]);
+			}
+			else {
+				SREALLOC(act[i]->_buf0, void,
+					 mul_check_overflow3((size_t) act[i]->msize, (size_t) act[i]->nr_ini, (size_t) act[i]->nr2));
+			}
 		}
 
 		if (act[i]->nr_ini <= 0) {
@@ -400,7 +445,11 @@ void sa_sys_free(void)
 	for (i = 0; i < NR_ACT; i++) {
 
 		if (act[i]->nr_allocated > 0) {
-			if (act[i]->_buf0) {
+			if (IS_SPARSE(act[i]->options)) {
+				free_irq_csr(act[i]);
+				act[i]->nr_allocated = 0;
+			}
+			else if (act[i]->_buf0) {
 				free(act[i]->_buf0);
 				act[i]->_buf0 = NULL;
 				act[i]->nr_allocated = 0;
@@ -657,6 +706,97 @@ void write_special_record(int ofd, int rtype)
 	}
 }
 
+/*
+ ***************************************************************************
+ * Write sadc's own statistics for current sample. They are saved as extra
+ * structures following the record header.
+ *
+ * IN:
+ * @ofd		Output file descriptor. May be stdout.
+ ***************************************************************************
+ */
+void write_self_stats(int ofd)
+{
+	struct extra_desc xtra_d;
+	size_t size;
+
+	memset(&xtra_d, 0, EXTRA_DESC_SIZE);
+	xtra_d.extra_nr = 1;
+	xtra_d.extra_size = EXTRA_SELF_SIZE;
+	xtra_d.extra_next = (self_hdr.act_nr > 0);
+	xtra_d.extra_types_nr[0] = EXTRA_SELF_ULL_NR;
+	xtra_d.extra_types_nr[1] = EXTRA_SELF_UL_NR;
+	xtra_d.extra_types_nr[2] = EXTRA_SELF_U_NR;
+
+	if ((write_all(ofd, &xtra_d, EXTRA_DESC_SIZE) != EXTRA_DESC_SIZE) ||
+	    (write_all(ofd, &self_hdr, EXTRA_SELF_SIZE) != EXTRA_SELF_SIZE)) {
+		p_write_error();
+	}
+
+	if (!self_hdr.act_nr)
+		return;
+
+	xtra_d.extra_nr = self_hdr.act_nr;
+	xtra_d.extra_size = EXTRA_SELF_ACT_SIZE;
+	xtra_d.extra_next = FALSE;
+	xtra_d.extra_types_nr[0] = EXTRA_SELF_ACT_ULL_NR;
+	xtra_d.extra_types_nr[1] = EXTRA_SELF_ACT_UL_NR;
+	xtra_d.extra_types_nr[2] = EXTRA_SELF_ACT_U_NR;
+
+	size = EXTRA_SELF_ACT_SIZE * self_hdr.act_nr;
+	if ((write_all(ofd, &xtra_d, EXTRA_DESC_SIZE) != EXTRA_DESC_SIZE) ||
+	    (write_all(ofd, self_act, size) != size)) {
+		p_write_error();
+	}
+}
+
+/*
+ ***************************************************************************
+ * Write interrupts statistics saved in a sparse matrix by sadc. They are
+ * written as they are expected in file, i.e. as a matrix of stats_irq
+ * structures: One row for CPU "all" then one row for each CPU. Rows are
+ * expanded and written one at a time.
+ *
+ * IN:
+ * @ofd		Output file descriptor. May be stdout.
+ * @a		Activity structure.
+ ***************************************************************************
+ */
+void write_irq_csr(int ofd, struct activity *a)
+{
+	struct stats_irq_csr *st_irq = (struct stats_irq_csr *) a->_buf0;
+	int row_size = a->fsize * a->nr2;
+	int i, j;
+
+	if (a->_nr0 <= 0)
+		return;
+
+	/* Row for CPU "all" */
+	if (write_all(ofd, st_irq->st_all, row_size) != row_size) {
+		p_write_error();
+	}
+
+	/* Counters of each interrupt are sorted by CPU: Use one cursor per interrupt */
+	memcpy(st_irq->pos, st_irq->row, sizeof(__nr_t) * (size_t) a->nr2);
+
+	for (i = 1; i < a->_nr0; i++) {
+		/* Row for CPU i - 1: Interrupts sum then each interrupt */
+		memset(st_irq->st_row, 0, STATS_IRQ_SIZE * (size_t) a->nr2);
+		st_irq->st_row->irq_nr = st_irq->cpu_sum[i];
+
+		for (j = 1; j < a->nr2; j++) {
+			if ((st_irq->pos[j] < st_irq->row[j + 1]) &&
+			    (st_irq->cpu[st_irq->pos[j]] == i - 1)) {
+				st_irq->st_row[j].irq_nr = st_irq->irq_nr[st_irq->pos[j]++];
+			}
+		}
+
+		if (write_all(ofd, st_irq->st_row, row_size) != row_size) {
+			p_write_error();
+		}
+	}
+}
+
 /*
  ***************************************************************************
  * Write stats (or print them if stdout).
@@ -680,10 +820,16 @@ void write_stats(int ofd)
 	}
 
 	/* Write record header */
+	record_hdr.extra_next = SELF_STATS(flags);
 	if (write_all(ofd, &record_hdr, RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE) {
 		p_write_error();
 	}
 
+	if (SELF_STATS(flags)) {
+		/* Write sadc's own statistics as extra structures */
+		write_self_stats(ofd);
+	}
+
 	/* Then write all statistics */
 	for (i = 0; i < NR_ACT; i++) {
 
@@ -698,14 +844,622 @@ void write_stats(int ofd)
 					p_write_error();
 				}
 			}
-			if (write_all(ofd, act[p]->_buf0, act[p]->fsize * act[p]->_nr0 * act[p]->nr2) !=
-			    (act[p]->fsize * act[p]->_nr0 * act[p]->nr2)) {
+			if (IS_SPARSE(act[p]->options)) {
+				write_irq_csr(ofd, act[p]);
+			}
+			else if (write_all(ofd, act[p]->_buf0, act[p]->fsize * act[p]->_nr0 * act[p]->nr2) !=
+				 (act[p]->fsize * act[p]->_nr0 * act[p]->nr2)) {
 				p_write_error();
 			}
 		}
 	}
 }
 
+/*
+ ***************************************************************************
+ * Compute the size of a record of statistics as written by write_stats().
+ *
+ * IN:
+ * @max		TRUE if the maximum size of a record should be computed
+ *		instead, assuming that the buffers of activities with a
+ *		varying number of items may be doubled once.
+ *
+ * RETURNS:
+ * Size of the record.
+ ***************************************************************************
+ */
+size_t get_record_size(int max)
+{
+	int i, p;
+	size_t size = RECORD_HEADER_SIZE;
+
+	if (SELF_STATS(flags)) {
+		size += EXTRA_DESC_SIZE + EXTRA_SELF_SIZE;
+		if (max || self_hdr.act_nr) {
+			size += EXTRA_DESC_SIZE +
+				EXTRA_SELF_ACT_SIZE * (max ? NR_ACT : self_hdr.act_nr);
+		}
+	}
+
+	for (i = 0; i < NR_ACT; i++) {
+
+		if (!id_seq[i])
+			continue;
+		if ((p = get_activity_position(act, id_seq[i], RESUME_IF_NOT_FOUND)) < 0)
+			continue;
+
+		if (IS_COLLECTED(act[p]->options)) {
+			if (HAS_COUNT_FUNCTION(act[p]->options) && (act[p]->f_count_index >= 0)) {
+				size += sizeof(__nr_t);
+				if (max) {
+					size += (size_t) act[p]->fsize * act[p]->nr_allocated * 2 * act[p]->nr2;
+					continue;
+				}
+			}
+			size += (size_t) act[p]->fsize * (max ? act[p]->nr_allocated : act[p]->_nr0) *
+				act[p]->nr2;
+		}
+	}
+
+	return size;
+}
+
+/*
+ ***************************************************************************
+ * Write header data (file magic header, file header and activity list) in
+ * the header area of the shared memory ring buffer.
+ ***************************************************************************
+ */
+void shm_publish_hdr(void)
+{
+	off_t pos;
+
+	/* Odd sequence counter: Header area is being updated */
+	__atomic_store_n(&shm_ring->hdr_seq, shm_ring->hdr_seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	if (lseek(shm_fd, SHM_HDR_AREA_OFFSET, SEEK_SET) < 0) {
+		p_write_error();
+	}
+	setup_file_hdr(shm_fd);
+	if ((pos = lseek(shm_fd, 0, SEEK_CUR)) < 0) {
+		p_write_error();
+	}
+	shm_ring->hdr_len = pos - SHM_HDR_AREA_OFFSET;
+
+	__atomic_store_n(&shm_ring->hdr_seq, shm_ring->hdr_seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ ***************************************************************************
+ * Write current record of statistics in next slot of the shared memory
+ * ring buffer, overwriting the oldest record.
+ ***************************************************************************
+ */
+void shm_publish_stats(void)
+{
+	struct shm_slot *slot;
+	unsigned long long gen = shm_ring->gen;
+	uint64_t save_flags;
+	off_t pos;
+
+	if (get_record_size(FALSE) > shm_ring->slot_size) {
+		/* Record too big (many more items than when the ring was created) */
+		__atomic_store_n(&shm_ring->dropped, shm_ring->dropped + 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	slot = (struct shm_slot *) ((char *) shm_ring +
+				    SHM_SLOT_OFFSET(shm_ring, gen % shm_ring->slot_nr));
+
+	/* Odd sequence counter: Slot is being updated */
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	if (lseek(shm_fd, (char *) slot + SHM_SLOT_SIZE - (char *) shm_ring, SEEK_SET) < 0) {
+		p_write_error();
+	}
+	save_flags = flags;
+	flags &= ~S_F_LOCK_FILE;
+	write_stats(shm_fd);
+	flags = save_flags;
+	if ((pos = lseek(shm_fd, 0, SEEK_CUR)) < 0) {
+		p_write_error();
+	}
+
+	slot->len = pos - ((char *) slot + SHM_SLOT_SIZE - (char *) shm_ring);
+	slot->gen = gen;
+	slot->hdr_seq = shm_ring->hdr_seq;
+
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&shm_ring->gen, gen + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ ***************************************************************************
+ * Create the shared memory ring buffer where records are published, then
+ * write header data into it.
+ ***************************************************************************
+ */
+void shm_ring_create(void)
+{
+	struct shm_ring ring;
+	char name[MAX_FILE_LEN + 1];
+
+	snprintf(name, sizeof(name), "/%s", shm_name + (shm_name[0] == '/'));
+
+	memset(&ring, 0, SHM_RING_SIZE);
+	ring.magic = SHM_RING_MAGIC;
+	ring.slot_nr = SHM_RING_SLOT_NR;
+	ring.slot_size = (get_record_size(TRUE) + 7) & ~((size_t) 7);
+	shm_map_size = SHM_MAP_SIZE(&ring);
+
+	/*
+	 * Always create a new object: An existing one (left by a previous
+	 * sadc, or used by another one) may still be mapped by readers, and
+	 * truncating it would make them crash with SIGBUS. Unlinking it only
+	 * removes its name: Readers keep their mapping until they unmap it.
+	 */
+	while ((shm_fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR,
+				  S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) < 0) {
+		if ((errno != EEXIST) || ((shm_unlink(name) < 0) && (errno != ENOENT)))
+			goto shm_error;
+	}
+	if (ftruncate(shm_fd, shm_map_size) < 0)
+		goto shm_error;
+
+	if ((shm_ring = mmap(NULL, shm_map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			     shm_fd, 0)) == MAP_FAILED)
+		goto shm_error;
+
+	*shm_ring = ring;
+
+	shm_publish_hdr();
+	return;
+
+shm_error:
+	fprintf(stderr, _("Cannot open %s: %s\n"), name, strerror(errno));
+	exit(2);
+}
+
+/*
+ ***************************************************************************
+ * Tell readers that no more records will be published, then unmap the
+ * shared memory ring buffer. The ring is not removed so that its last
+ * records can still be read.
+ ***************************************************************************
+ */
+void shm_ring_close(void)
+{
+	if (!shm_ring)
+		return;
+
+	__atomic_store_n(&shm_ring->closed, TRUE, __ATOMIC_RELEASE);
+	munmap(shm_ring, shm_map_size);
+	shm_ring = NULL;
+	CLOSE(shm_fd);
+}
+
+/*
+ ***************************************************************************
+ * Serialize header data or current record of statistics, as they would be
+ * written to a file, into a buffer.
+ *
+ * IN:
+ * @rec		TRUE for a record of statistics, FALSE for header data.
+ * @buf		Buffer where data will be saved.
+ * @size	Size of the buffer.
+ *
+ * OUT:
+ * @buf		Buffer containing the data (may have been reallocated).
+ * @size	New size of the buffer.
+ *
+ * RETURNS:
+ * Size of the data.
+ ***************************************************************************
+ */
+size_t stage_data(int rec, char **buf, size_t *size)
+{
+	uint64_t save_flags;
+	off_t len;
+
+	/* Data are first written to the staging file */
+	if (lseek(stage_fd, 0, SEEK_SET) < 0) {
+		p_write_error();
+	}
+	if (rec) {
+		save_flags = flags;
+		flags &= ~S_F_LOCK_FILE;
+		write_stats(stage_fd);
+		flags = save_flags;
+	}
+	else {
+		setup_file_hdr(stage_fd);
+	}
+	if ((len = lseek(stage_fd, 0, SEEK_CUR)) < 0) {
+		p_write_error();
+	}
+
+	if ((size_t) len > *size) {
+		SREALLOC(*buf, char, len);
+		*size = len;
+	}
+	if (pread(stage_fd, *buf, len, 0) != len) {
+		p_write_error();
+	}
+
+	return len;
+}
+
+/*
+ ***************************************************************************
+ * Disconnect a subscriber.
+ *
+ * IN:
+ * @sub	Subscriber.
+ ***************************************************************************
+ */
+void sock_close_subscriber(struct sa_subscriber *sub)
+{
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sub->fd, NULL);
+	close(sub->fd);
+	sub->fd = -1;
+	sub->len = sub->pos = 0;
+	sub->drops = 0;
+}
+
+/*
+ ***************************************************************************
+ * Send as much pending data as possible to a subscriber without blocking.
+ * If some data remain, we'll be told by epoll when the subscriber is ready
+ * to receive them.
+ *
+ * IN:
+ * @sub	Subscriber.
+ ***************************************************************************
+ */
+void sock_flush(struct sa_subscriber *sub)
+{
+	struct epoll_event ev;
+	ssize_t n;
+
+	while (sub->pos < sub->len) {
+		if ((n = send(sub->fd, sub->buf + sub->pos, sub->len - sub->pos,
+			      MSG_NOSIGNAL | MSG_DONTWAIT)) < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				/* Wait for the subscriber to read its data */
+				ev.events = EPOLLIN | EPOLLOUT;
+				ev.data.ptr = sub;
+				epoll_ctl(epoll_fd, EPOLL_CTL_MOD, sub->fd, &ev);
+				return;
+			}
+			/* Subscriber has gone */
+			sock_close_subscriber(sub);
+			return;
+		}
+		sub->pos += n;
+	}
+
+	if (sub->len) {
+		/* All data sent */
+		sub->len = sub->pos = 0;
+		ev.events = EPOLLIN;
+		ev.data.ptr = sub;
+		epoll_ctl(epoll_fd, EPOLL_CTL_MOD, sub->fd, &ev);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Append data to those waiting to be sent to a subscriber.
+ *
+ * IN:
+ * @sub		Subscriber.
+ * @data	Data to send.
+ * @len		Size of the data.
+ ***************************************************************************
+ */
+void sock_queue(struct sa_subscriber *sub, char *data, size_t len)
+{
+	if (sub->pos) {
+		/* Move data not sent yet to the beginning of the buffer */
+		memmove(sub->buf, sub->buf + sub->pos, sub->len - sub->pos);
+		sub->len -= sub->pos;
+		sub->pos = 0;
+	}
+	if (sub->len + len > sub->buf_size) {
+		SREALLOC(sub->buf, char, sub->len + len);
+		sub->buf_size = sub->len + len;
+	}
+	memcpy(sub->buf + sub->len, data, len);
+	sub->len += len;
+}
+
+/*
+ ***************************************************************************
+ * Accept new subscribers and send them header data.
+ ***************************************************************************
+ */
+void sock_accept(void)
+{
+	struct epoll_event ev;
+	int i, fd;
+
+	while ((fd = accept4(sock_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+
+		for (i = 0; (i < MAX_SUBSCRIBERS) && (subscr[i].fd >= 0); i++);
+		if (i == MAX_SUBSCRIBERS) {
+			/* Too many subscribers */
+			close(fd);
+			continue;
+		}
+
+		ev.events = EPOLLIN;
+		ev.data.ptr = &subscr[i];
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			close(fd);
+			continue;
+		}
+		subscr[i].fd = fd;
+
+		sock_queue(&subscr[i], sock_hdr, sock_hdr_len);
+		sock_flush(&subscr[i]);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Send current record of statistics to all the subscribers. Subscribers
+ * still busy with previous data don't get it.
+ ***************************************************************************
+ */
+void sock_publish_stats(void)
+{
+	int i;
+	size_t len;
+
+	len = stage_data(TRUE, &sock_rec, &sock_rec_size);
+
+	for (i = 0; i < MAX_SUBSCRIBERS; i++) {
+
+		if (subscr[i].fd < 0)
+			continue;
+
+		if (subscr[i].pos < subscr[i].len) {
+			/*
+			 * Slow subscriber: Skip this record. But it cannot skip
+			 * the last record before a file rotation since header
+			 * data will follow.
+			 */
+			if ((record_hdr.record_type == R_LAST_STATS) ||
+			    (++subscr[i].drops > SOCK_MAX_DROPS)) {
+				sock_close_subscriber(&subscr[i]);
+			}
+			continue;
+		}
+
+		subscr[i].drops = 0;
+		sock_queue(&subscr[i], sock_rec, len);
+		sock_flush(&subscr[i]);
+	}
+}
+
+/*
+ ***************************************************************************
+ * Save header data then send them to all the subscribers.
+ *
+ * IN:
+ * @send	TRUE if header data should be sent to current subscribers.
+ ***************************************************************************
+ */
+void sock_publish_hdr(int send)
+{
+	int i;
+
+	sock_hdr_len = stage_data(FALSE, &sock_hdr, &sock_hdr_size);
+
+	if (!send)
+		return;
+
+	for (i = 0; i < MAX_SUBSCRIBERS; i++) {
+		if (subscr[i].fd >= 0) {
+			sock_queue(&subscr[i], sock_hdr, sock_hdr_len);
+			sock_flush(&subscr[i]);
+		}
+	}
+}
+
+/*
+ ***************************************************************************
+ * Wait for next sample (SIGALRM), serving subscribers in the meantime:
+ * Accept new ones, send them pending data and detect those that have gone.
+ * SIGALRM is blocked except while waiting for events, so that it cannot be
+ * missed.
+ ***************************************************************************
+ */
+void sock_wait(void)
+{
+	struct epoll_event ev[MAX_SUBSCRIBERS + 1];
+	struct sa_subscriber *sub;
+	char buf[256];
+	int i, n;
+
+#ifdef TEST
+	/* Don't wait in test mode */
+	__pause();
+	return;
+#endif
+
+	while (!sigint_caught) {
+
+		if ((n = epoll_pwait(epoll_fd, ev, MAX_SUBSCRIBERS + 1, -1, &sock_wait_mask)) < 0) {
+			if (errno == EINTR)
+				/* SIGALRM (or SIGINT/SIGTERM) received */
+				return;
+			perror("epoll_pwait");
+			exit(4);
+		}
+
+		for (i = 0; i < n; i++) {
+
+			if (!ev[i].data.ptr) {
+				/* New subscribers */
+				sock_accept();
+				continue;
+			}
+
+			sub = (struct sa_subscriber *) ev[i].data.ptr;
+			if (sub->fd < 0)
+				continue;
+
+			if (ev[i].events & (EPOLLERR | EPOLLHUP)) {
+				sock_close_subscriber(sub);
+				continue;
+			}
+			if (ev[i].events & EPOLLIN) {
+				/* Subscribers are not expected to send anything */
+				if (recv(sub->fd, buf, sizeof(buf), MSG_DONTWAIT) == 0) {
+					sock_close_subscriber(sub);
+					continue;
+				}
+			}
+			if (ev[i].events & EPOLLOUT) {
+				sock_flush(sub);
+			}
+		}
+	}
+}
+
+/*
+ ***************************************************************************
+ * Create the file where header data and records are serialized before
+ * being sent to the subscribers. This is an in-memory file if
+ * memfd_create() is available, else an unlinked temporary file.
+ *
+ * RETURNS:
+ * File descriptor of the staging file, or -1 on error (errno is then set).
+ ***************************************************************************
+ */
+int open_stage_file(void)
+{
+#ifdef HAVE_MEMFD_CREATE
+	return memfd_create("sadc", MFD_CLOEXEC);
+#else
+	char tmpl[] = "/tmp/sadcXXXXXX";
+	int fd;
+
+	if ((fd = mkstemp(tmpl)) >= 0) {
+		unlink(tmpl);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+
+	return fd;
+#endif
+}
+
+/*
+ ***************************************************************************
+ * Create the Unix domain socket on which subscribers may connect to get
+ * the records of statistics.
+ ***************************************************************************
+ */
+void sock_server_create(void)
+{
+	struct sockaddr_un addr;
+	struct epoll_event ev;
+	struct stat st;
+	sigset_t mask;
+	int i;
+
+	for (i = 0; i < MAX_SUBSCRIBERS; i++) {
+		subscr[i].fd = -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(sock_path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		goto sock_error;
+	}
+	strcpy(addr.sun_path, sock_path);
+
+	/* Remove socket left by a previous instance of sadc */
+	if (!stat(sock_path, &st) && S_ISSOCK(st.st_mode)) {
+		unlink(sock_path);
+	}
+
+	if (((stage_fd = open_stage_file()) < 0) ||
+	    ((sock_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) ||
+	    (bind(sock_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) ||
+	    (listen(sock_fd, MAX_SUBSCRIBERS) < 0) ||
+	    ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0))
+		goto sock_error;
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock_fd, &ev) < 0)
+		goto sock_error;
+
+	/* Save header data sent to new subscribers */
+	sock_publish_hdr(FALSE);
+
+#ifdef TEST
+	/*
+	 * sadc doesn't wait between samples in test mode: Wait for a
+	 * subscriber now, so that it gets all the records.
+	 */
+	if (epoll_wait(epoll_fd, &ev, 1, SOCK_TEST_TIMEOUT) > 0) {
+		sock_accept();
+	}
+#endif
+
+	/* SIGALRM will be delivered only while waiting in sock_wait() */
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGALRM);
+	sigprocmask(SIG_BLOCK, &mask, &sock_wait_mask);
+	sigdelset(&sock_wait_mask, SIGALRM);
+
+	return;
+
+sock_error:
+	fprintf(stderr, _("Cannot open %s: %s\n"), sock_path, strerror(errno));
+	exit(2);
+}
+
+/*
+ ***************************************************************************
+ * Disconnect all the subscribers and remove the Unix domain socket.
+ ***************************************************************************
+ */
+void sock_server_close(void)
+{
+	int i;
+
+	if (sock_fd < 0)
+		return;
+
+	for (i = 0; i < MAX_SUBSCRIBERS; i++) {
+		if (subscr[i].fd >= 0) {
+			/* Try to send last data before disconnecting */
+			sock_flush(&subscr[i]);
+			if (subscr[i].fd >= 0) {
+				sock_close_subscriber(&subscr[i]);
+			}
+		}
+		free(subscr[i].buf);
+		subscr[i].buf = NULL;
+	}
+
+	CLOSE(sock_fd);
+	unlink(sock_path);
+	CLOSE(epoll_fd);
+	CLOSE(stage_fd);
+	free(sock_hdr);
+	free(sock_rec);
+}
+
 /*
  ***************************************************************************
  * Create a system activity daily data file.
@@ -1006,8 +1760,13 @@ void open_ofile(int *ofd, char ofile[], int restart_mark)
 			act[p]->nr_allocated = act[p]->nr_ini;
 		}
 
-		SREALLOC(act[p]->_buf0, void,
-			 mul_check_overflow3((size_t) act[p]->msize, (size_t) act[p]->nr_allocated, (size_t) act[p]->nr2));
+		if (IS_SPARSE(act[p]->options)) {
+			alloc_irq_csr(act[p]);
+		}
+		else {
+			SREALLOC(act[p]->_buf0, void,
+				 mul_check_overflow3((size_t) act[p]->msize, (size_t) act[p]->nr_allocated, (size_t) act[p]->nr2));
+		}
 
 		/* Save activity sequence */
 		id_seq[i] = file_act[i].id;
@@ -1029,24 +1788,218 @@ append_error:
 	}
 }
 
+/*
+ ***************************************************************************
+ * Compute the time elapsed between two readings of the monotonic clock.
+ *
+ * IN:
+ * @ts_prev	Previous reading.
+ * @ts_curr	Current reading.
+ *
+ * RETURNS:
+ * Time elapsed in nanoseconds.
+ ***************************************************************************
+ */
+unsigned long long mono_diff_ns(struct timespec *ts_prev, struct timespec *ts_curr)
+{
+	return (ts_curr->tv_sec - ts_prev->tv_sec) * 1000000000ULL +
+	       ts_curr->tv_nsec - ts_prev->tv_nsec;
+}
+
+/*
+ ***************************************************************************
+ * Compute sadc's resource usage since previous sample.
+ ***************************************************************************
+ */
+void read_self_usage(void)
+{
+	struct rusage ru;
+
+	if (__getrusage(RUSAGE_SELF, &ru) < 0)
+		return;
+
+	self_hdr.utime_us = (ru.ru_utime.tv_sec - self_ru_prev.ru_utime.tv_sec) * 1000000ULL +
+			    ru.ru_utime.tv_usec - self_ru_prev.ru_utime.tv_usec;
+	self_hdr.stime_us = (ru.ru_stime.tv_sec - self_ru_prev.ru_stime.tv_sec) * 1000000ULL +
+			    ru.ru_stime.tv_usec - self_ru_prev.ru_stime.tv_usec;
+	self_hdr.minflt = ru.ru_minflt - self_ru_prev.ru_minflt;
+	self_hdr.majflt = ru.ru_majflt - self_ru_prev.ru_majflt;
+	self_hdr.nvcsw  = ru.ru_nvcsw - self_ru_prev.ru_nvcsw;
+	self_hdr.nivcsw = ru.ru_nivcsw - self_ru_prev.ru_nivcsw;
+
+	self_ru_prev = ru;
+}
+
+/*
+ ***************************************************************************
+ * Compare the CPU time used by sadc for current sample with its budget.
+ * If the budget has been exceeded, then the most expensive activity read
+ * during current sample won't be read for the next SHED_SAMPLES_NR samples.
+ * Skipped activities are recorded in sadc's own statistics.
+ ***************************************************************************
+ */
+void shed_activities(void)
+{
+	static int first_sample = TRUE;
+	unsigned long long cpu_us, max_ns = 0;
+	int i, p, shed = -1;
+
+	if (first_sample) {
+		/* Resource usage for first sample includes sadc's initialization */
+		first_sample = FALSE;
+		return;
+	}
+
+	cpu_us = self_hdr.utime_us + self_hdr.stime_us;
+	if (cpu_us <= (unsigned long long) (cpu_budget * interval * 10000))
+		return;
+
+	/* Look for the most expensive activity read during current sample */
+	for (i = 0; i < self_hdr.act_nr; i++) {
+		if ((self_act[i].flags & SELF_ACT_SKIPPED) || (self_act[i].read_ns <= max_ns))
+			continue;
+		if ((p = get_activity_position(act, self_act[i].id, RESUME_IF_NOT_FOUND)) < 0)
+			continue;
+		max_ns = self_act[i].read_ns;
+		shed = p;
+	}
+
+	if (shed >= 0) {
+		act_shed[shed] = SHED_SAMPLES_NR;
+	}
+}
+
+/*
+ ***************************************************************************
+ * Lower sadc's impact on the system: Use SCHED_IDLE scheduling policy (or
+ * lowest priority if not possible), pin sadc to selected CPU and lock its
+ * memory to avoid page faults.
+ ***************************************************************************
+ */
+void set_low_intrusion(void)
+{
+	struct sched_param sp;
+
+	if (USE_SCHED_IDLE(flags)) {
+		memset(&sp, 0, sizeof(sp));
+		if (sched_setscheduler(0, SCHED_IDLE, &sp) < 0) {
+			/* SCHED_IDLE not available: Use lowest priority instead */
+			if (setpriority(PRIO_PROCESS, 0, 19) < 0) {
+				perror("setpriority");
+			}
+		}
+	}
+
+	if (cpu_pin && (sched_setaffinity(0, sizeof(cpu_pin_set), &cpu_pin_set) < 0)) {
+		perror("sched_setaffinity");
+	}
+
+	if (USE_MLOCK(flags) && (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)) {
+		perror("mlockall");
+	}
+}
+
+/*
+ ***************************************************************************
+ * Parse a list of CPU entered with option --cpus (e.g. "0,2-3").
+ *
+ * IN:
+ * @list	List of CPU to parse.
+ *
+ * OUT:
+ * @cpu_pin_set	Set of CPU on which sadc is allowed to run.
+ *
+ * RETURNS:
+ * 0 on success, 1 otherwise.
+ ***************************************************************************
+ */
+int parse_cpu_list(char *list)
+{
+	char *t, *e;
+	long low, high;
+
+	CPU_ZERO(&cpu_pin_set);
+
+	for (t = strtok(list, ","); t; t = strtok(NULL, ",")) {
+		low = strtol(t, &e, 10);
+		if ((e == t) || (low < 0))
+			return 1;
+		high = low;
+		if (*e == '-') {
+			t = e + 1;
+			high = strtol(t, &e, 10);
+			if ((e == t) || (high < low))
+				return 1;
+		}
+		if (*e || (high >= CPU_SETSIZE))
+			return 1;
+		for (; low <= high; low++) {
+			CPU_SET(low, &cpu_pin_set);
+		}
+	}
+
+	return !CPU_COUNT(&cpu_pin_set);
+}
+
 /*
  ***************************************************************************
  * Read statistics from various system files.
+ * If requested, also measure the time spent reading each activity.
  ***************************************************************************
  */
 void read_stats(void)
 {
 	int i;
+	struct timespec ts_start = {0, 0}, ts_prev = {0, 0}, ts_curr;
+
+	if (SELF_STATS(flags)) {
+		memset(&self_hdr, 0, EXTRA_SELF_SIZE);
+		self_hdr.magic = SELF_MAGIC;
+		__clock_gettime(CLOCK_MONOTONIC, &ts_start);
+		ts_prev = ts_start;
+	}
 
 	/* Read system uptime in 1/100th of a second */
 	read_uptime(&(record_hdr.uptime_cs));
 
 	for (i = 0; i < NR_ACT; i++) {
 		if (IS_COLLECTED(act[i]->options)) {
+			if (act_shed[i]) {
+				/* Activity temporarily not read: sadc is over its CPU budget */
+				act_shed[i]--;
+				if (SELF_STATS(flags)) {
+					self_act[self_hdr.act_nr].read_ns = 0;
+					self_act[self_hdr.act_nr].id = act[i]->id;
+					self_act[self_hdr.act_nr].flags = SELF_ACT_SKIPPED;
+					self_hdr.act_nr++;
+				}
+				continue;
+			}
+
 			/* Read statistics for current activity */
 			(*act[i]->f_read)(act[i]);
+
+			if (SELF_STATS(flags)) {
+				/* Save time spent reading current activity */
+				__clock_gettime(CLOCK_MONOTONIC, &ts_curr);
+				self_act[self_hdr.act_nr].read_ns = mono_diff_ns(&ts_prev, &ts_curr);
+				self_act[self_hdr.act_nr].id = act[i]->id;
+				self_act[self_hdr.act_nr].flags = 0;
+				self_hdr.act_nr++;
+				ts_prev = ts_curr;
+			}
 		}
 	}
+
+	if (SELF_STATS(flags)) {
+		self_hdr.coll_ns = mono_diff_ns(&ts_start, &ts_prev);
+		read_self_usage();
+	}
+
+	if (cpu_budget > 0.0) {
+		/* Check that sadc didn't exceed its CPU budget */
+		shed_activities();
+	}
 }
 
 /*
@@ -1106,6 +2059,16 @@ void rw_sa_stat_loop(long count, int stdfd, int ofd, char ofile[],
 			flags = save_flags;
 		}
 
+		if (shm_ring) {
+			/* Publish stats in shared memory ring buffer */
+			shm_publish_stats();
+		}
+
+		if (sock_fd >= 0) {
+			/* Send stats to subscribers */
+			sock_publish_stats();
+		}
+
 		/* If the record type was R_LAST_STATS, tag it R_STATS before writing it */
 		record_hdr.record_type = R_STATS;
 		if (ofile[0]) {
@@ -1145,6 +2108,12 @@ void rw_sa_stat_loop(long count, int stdfd, int ofd, char ofile[],
 			if (stdfd >= 0) {
 				setup_file_hdr(stdfd);
 			}
+			if (shm_ring) {
+				shm_publish_hdr();
+			}
+			if (sock_fd >= 0) {
+				sock_publish_hdr(TRUE);
+			}
 
 			/* Write stats to file again */
 			write_stats(ofd);
@@ -1169,7 +2138,13 @@ void rw_sa_stat_loop(long count, int stdfd, int ofd, char ofile[],
 			 * Wait for a signal
 			 * (probably SIGALRM or SIGINT or even SIGTERM).
 			 */
-			__pause();
+			if (sock_fd >= 0) {
+				/* Serve subscribers while waiting */
+				sock_wait();
+			}
+			else {
+				__pause();
+			}
 		}
 
 		if (sigint_caught)
@@ -1192,6 +2167,8 @@ void rw_sa_stat_loop(long count, int stdfd, int ofd, char ofile[],
 	/* Close file descriptors if they have actually been used */
 	CLOSE(stdfd);
 	CLOSE(ofd);
+	shm_ring_close();
+	sock_server_close();
 }
 
 /*
@@ -1217,7 +2194,7 @@ int main(int argc, char **argv)
 	/* Compute page shift in kB */
 	get_kb_shift();
 
-	ofile[0] = sa_dir[0] = comment[0] = '\0';
+	ofile[0] = sa_dir[0] = comment[0] = shm_name[0] = sock_path[0] = '\0';
 
 #if (defined(HAVE_SENSORS) && !defined(ARCH32)) || (defined(ARCH32) && defined(HAVE_SENSORS32))
 	/* Initialize sensors, let it use the default cfg file */
@@ -1268,6 +2245,55 @@ int main(int argc, char **argv)
 			flags |= S_F_FDATASYNC;
 		}
 
+		else if (!strcmp(argv[opt], "--self")) {
+			/* Save sadc's own statistics with each record */
+			flags |= S_F_SELF_STATS;
+		}
+
+		else if (!strncmp(argv[opt], "--budget=", 9)) {
+			char *e;
+
+			/* Max percentage of CPU time that sadc may use */
+			cpu_budget = strtod(argv[opt] + 9, &e);
+			if (*e || (cpu_budget <= 0.0) || (cpu_budget > 100.0)) {
+				usage(argv[0]);
+			}
+			/* Skipped activities are recorded in sadc's own statistics */
+			flags |= S_F_SELF_STATS;
+		}
+
+		else if (!strncmp(argv[opt], "--cpus=", 7)) {
+			/* CPU on which sadc is allowed to run */
+			if (parse_cpu_list(argv[opt] + 7)) {
+				usage(argv[0]);
+			}
+			cpu_pin = TRUE;
+		}
+
+		else if (!strcmp(argv[opt], "--idle")) {
+			flags |= S_F_SCHED_IDLE;
+		}
+
+		else if (!strcmp(argv[opt], "--mlock")) {
+			flags |= S_F_MLOCK;
+		}
+
+		else if (!strncmp(argv[opt], "--socket=", 9)) {
+			/* Send records to subscribers connected to a Unix domain socket */
+			if (!argv[opt][9] ||
+			    (snprintf(sock_path, sizeof(sock_path), "%s", argv[opt] + 9) >= sizeof(sock_path))) {
+				usage(argv[0]);
+			}
+		}
+
+		else if (!strncmp(argv[opt], "--shm=", 6)) {
+			/* Publish records in a shared memory ring buffer */
+			if (!argv[opt][6] || strchr(argv[opt] + 7, '/') ||
+			    (snprintf(shm_name, sizeof(shm_name), "%s", argv[opt] + 6) >= sizeof(shm_name))) {
+				usage(argv[0]);
+			}
+		}
+
 		else if (!strcmp(argv[opt], "-C")) {
 			if (!argv[++opt]) {
 				usage(argv[0]);
@@ -1367,6 +2393,13 @@ int main(int argc, char **argv)
 	if (optz) {
 		stdfd = 0;
 	}
+	else if (shm_name[0] || sock_path[0]) {
+		/*
+		 * Records are published in shared memory or sent to subscribers:
+		 * Don't write them to STDOUT.
+		 */
+		stdfd = -1;
+	}
 
 	if (!ofile[0]) {
 		/* -L option ignored when writing to STDOUT */
@@ -1427,6 +2460,19 @@ int main(int argc, char **argv)
 		exit(0);
 	}
 
+	if (shm_name[0]) {
+		/* Create shared memory ring buffer and publish header data */
+		shm_ring_create();
+	}
+
+	if (sock_path[0]) {
+		/* Create Unix domain socket for subscribers */
+		sock_server_create();
+	}
+
+	/* Lower sadc's impact on the system if requested */
+	set_low_intrusion();
+
 	/* Set a handler for SIGALRM */
 	memset(&alrm_act, 0, sizeof(alrm_act));
 	alrm_act.sa_handler = alarm_handler;
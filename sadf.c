@@ -29,6 +29,7 @@
 
 #include "version.h"
 #include "sadf.h"
+#include "rndr_stats.h"
 
 # include <locale.h>	/* For setlocale() */
 #ifdef USE_NLS
@@ -95,6 +96,9 @@ char my_tzname[TZNAME_LEN];
 extern struct activity *act[];
 extern struct report_format *fmt[];
 
+/* sadc's own statistics for current record (option --self) */
+extern struct self_stats rec_self;
+
 /* Battery status */
 char bat_status[][16] = {
 	"Unknown",
@@ -122,7 +126,7 @@ void usage(char *progname)
 			  "[ -C ] [ -c | -d | -g | -j | -l | -p | -r | -x ] [ -H ] [ -h ] [ -T | -t | -U ] [ -V ]\n"
 			  "[ -O <opts> [,...] ] [ -P { <cpu> [,...] | ALL } ]\n"
 			  "[ --dev=<dev_list> ] [ --fs=<fs_list> ] [ --iface=<iface_list> ] [ --int=<int_list> ]\n"
-			  "[ -s [ <start_time> ] ] [ -e [ <end_time> ] ]\n"
+			  "[ --self ] [ -s [ <start_time> ] ] [ -e [ <end_time> ] ]\n"
 			  "[ -- <sar_options> ]\n"));
 	exit(1);
 }
@@ -352,6 +356,15 @@ void list_fields(unsigned int act_id)
 	char hline[HEADER_LINE_LEN] = "";
 	char out[256];
 
+	if (act_id == SELF_STATS_ID) {
+		/* sadc's own statistics */
+		cprintf_s(IS_COMMENT, "%s", "# hostname;interval;timestamp;ACTIVITY;read-us;%coll;%skip");
+		printf("\n");
+		cprintf_s(IS_COMMENT, "%s", "# hostname;interval;timestamp;-;usr-ms;sys-ms;minflt;majflt;nvcsw;nivcsw");
+		printf("\n");
+		return;
+	}
+
 	cprintf_s(IS_COMMENT, "%s", "# hostname;interval;timestamp");
 
 	for (i = 0; i < NR_ACT; i++) {
@@ -807,6 +820,12 @@ int generic_write_stats(int curr, enum time_mode use_tm_start, enum time_mode us
 		}
 	}
 
+	if ((act_id == SELF_STATS_ID) && rec_self.valid &&
+	    ((format == F_DB_OUTPUT) || (format == F_PPC_OUTPUT))) {
+		/* Display sadc's own statistics */
+		render_self_stats(act, (format == F_DB_OUTPUT), pre, &rec_self);
+	}
+
 	if (*fmt[f_position]->f_timestamp) {
 		(*fmt[f_position]->f_timestamp)(parm, F_END, cur_date, cur_time, NULL, dt,
 						&record_hdr[curr], &file_hdr, flags);
@@ -1453,6 +1472,13 @@ void logic2_display_loop(int ifd, char *file, struct file_activity *file_actlst,
 			}
 		}
 
+		if (SELF_STATS(flags) && ((format == F_DB_OUTPUT) || (format == F_PPC_OUTPUT))) {
+			/* Display sadc's own statistics saved in file */
+			rw_curr_act_stats(ifd, &curr, &cnt, &eosaf,
+					  SELF_STATS_ID, &reset, file_actlst,
+					  rectime, file, file_magic);
+		}
+
 		if (!cnt) {
 			/* Go to next Linux restart, if possible */
 			do {
@@ -1728,6 +1754,12 @@ int main(int argc, char **argv)
 			parse_sa_devices(argv[opt], act[p], MAX_SA_IRQ_LEN, &opt, 6, NR_IRQS);
 		}
 
+		else if (!strcmp(argv[opt], "--self")) {
+			/* Display data collector's own statistics */
+			flags |= S_F_SELF_STATS;
+			opt++;
+		}
+
 		else if (!strcmp(argv[opt], "-s")) {
 			/* Get time start */
 			if (parse_timestamp(argv, &opt, &tm_start, DEF_TMSTART, flags)) {
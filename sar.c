@@ -27,6 +27,8 @@
 #include <errno.h>
 #include <signal.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <ctype.h>
 
 #include "version.h"
@@ -97,6 +99,26 @@ char *args[MAX_ARGV_NR];
 extern struct activity *act[];
 extern struct report_format sar_fmt;
 
+/* sadc's own statistics for current record (option --self) */
+extern struct self_stats rec_self;
+extern unsigned int extra_self_types_nr[];
+extern unsigned int extra_self_act_types_nr[];
+
+/* Sums of sadc's own statistics, used to compute averages */
+struct extra_self self_sum;
+unsigned long long self_act_sum[NR_ACT];
+unsigned long self_act_count[NR_ACT];
+unsigned long self_act_skip[NR_ACT];
+unsigned long self_act_seen[NR_ACT];
+unsigned long self_count = 0;
+
+/* Shared memory ring buffer where sadc publishes its records (option --shm) */
+char shm_name[MAX_FILE_LEN];
+struct shm_reader shm_rd;
+
+/* Unix domain socket on which sadc sends its records (option --socket) */
+char sock_path[MAX_FILE_LEN];
+
 struct sigaction int_act;
 int sigint_caught = 0;
 
@@ -135,6 +157,7 @@ void usage(char *progname)
 			  "[ --dev=<dev_list> ] [ --fs=<fs_list> ] [ --iface=<iface_list> ] "
 			  "[ --int=<int_list> ]\n"
 			  "[ --dec={ 0 | 1 | 2 } ] [ --help ] [ --human ] [ --pretty ] [ --sadc ]\n"
+			  "[ --self ] [ --shm=<name> ] [ --socket=<path> ]\n"
 			  "[ -j { SID | ID | LABEL | PATH | UUID | ... } ]\n"
 			  "[ -f [ <filename> ] | -o [ <filename> ] | -[0-9]+ ]\n"
 			  "[ -i <interval> ] [ -s [ <start_time> ] ] [ -e [ <end_time> ] ]\n"));
@@ -210,6 +233,11 @@ void display_help(char *progname)
 	printf(_("\t-W\tSwapping statistics [A_SWAP]\n"));
 	printf(_("\t-w\tTask creation and system switching statistics [A_PCSW]\n"));
 	printf(_("\t-y\tTTY devices statistics [A_SERIAL]\n"));
+	printf(_("\t--self\tData collector's own statistics\n"));
+	printf(_("\t--shm=<name>\n"
+		 "\t\tRead records published by sadc in shared memory\n"));
+	printf(_("\t--socket=<path>\n"
+		 "\t\tRead records sent by sadc on a Unix domain socket\n"));
 	exit(0);
 }
 
@@ -343,7 +371,7 @@ int check_line_hdr(void)
 	int i, rc = FALSE;
 
 	/* Get number of options entered on the command line */
-	if (get_activity_nr(act, AO_SELECTED, COUNT_OUTPUTS) > 1)
+	if ((get_activity_nr(act, AO_SELECTED, COUNT_OUTPUTS) > 1) || SELF_STATS(flags))
 		return TRUE;
 
 	for (i = 0; i < NR_ACT; i++) {
@@ -366,6 +394,140 @@ int check_line_hdr(void)
 	return rc;
 }
 
+/*
+ ***************************************************************************
+ * Display sadc's own statistics: Time spent reading each activity and
+ * percentage of samples where it was skipped to meet the CPU budget, then
+ * resource usage of the data collector.
+ *
+ * IN:
+ * @prev	Set to 2 if average values should be displayed.
+ * @curr	Index in array for current sample statistics.
+ ***************************************************************************
+ */
+void print_self_stats(int prev, int curr)
+{
+	int i, p;
+	unsigned long skip_nr = 0, seen_nr;
+	double n = 1.0, read_us, coll_us;
+	struct extra_self *xs = &rec_self.self;
+	struct extra_self_act *xsa;
+
+	if (prev == 2) {
+		/* Display average values */
+		if (!self_count)
+			return;
+		xs = &self_sum;
+		n = (double) self_count;
+		for (p = 0; p < NR_ACT; p++) {
+			skip_nr += self_act_skip[p];
+		}
+		seen_nr = xs->act_nr;
+	}
+	else {
+		/* Save values used to compute the average */
+		self_sum.coll_ns  += xs->coll_ns;
+		self_sum.utime_us += xs->utime_us;
+		self_sum.stime_us += xs->stime_us;
+		self_sum.minflt   += xs->minflt;
+		self_sum.majflt   += xs->majflt;
+		self_sum.nvcsw    += xs->nvcsw;
+		self_sum.nivcsw   += xs->nivcsw;
+		self_sum.act_nr   += xs->act_nr;
+		for (i = 0; i < xs->act_nr; i++) {
+			xsa = &rec_self.self_act[i];
+			if (xsa->flags & SELF_ACT_SKIPPED) {
+				skip_nr++;
+			}
+			if ((p = get_activity_position(act, xsa->id, RESUME_IF_NOT_FOUND)) < 0)
+				continue;
+			self_act_seen[p]++;
+			if (xsa->flags & SELF_ACT_SKIPPED) {
+				self_act_skip[p]++;
+			}
+			else {
+				self_act_sum[p] += xsa->read_ns;
+				self_act_count[p]++;
+			}
+		}
+		self_count++;
+		seen_nr = xs->act_nr;
+	}
+
+	coll_us = (double) xs->coll_ns / 1000 / n;
+
+	printf("\n%-11s %12s %9s %9s %9s\n", timestamp[!curr],
+	       "ACTIVITY", "read-us", "%coll", "%skip");
+
+	printf("%-11s", timestamp[curr]);
+	cprintf_in(IS_STR, " %12s", "all", 0);
+	cprintf_f(NO_UNIT, FALSE, 1, 9, 2, coll_us);
+	cprintf_xpc(DISPLAY_UNIT(flags), FALSE, 2, 9, 2, 100.0,
+		    seen_nr ? (double) skip_nr * 100 / seen_nr : 0.0);
+	printf("\n");
+
+	if (prev == 2) {
+		for (p = 0; p < NR_ACT; p++) {
+			if (!self_act_seen[p])
+				continue;
+			read_us = self_act_count[p] ? (double) self_act_sum[p] / 1000 / self_act_count[p]
+						    : 0.0;
+
+			printf("%-11s", timestamp[curr]);
+			cprintf_in(IS_STR, " %12s", act[p]->name, 0);
+			cprintf_f(NO_UNIT, FALSE, 1, 9, 2, read_us);
+			cprintf_xpc(DISPLAY_UNIT(flags), FALSE, 2, 9, 2,
+				    xs->coll_ns ? (double) self_act_sum[p] * 100 / xs->coll_ns : 0.0,
+				    (double) self_act_skip[p] * 100 / self_act_seen[p]);
+			printf("\n");
+		}
+	}
+	else {
+		for (i = 0; i < xs->act_nr; i++) {
+			xsa = &rec_self.self_act[i];
+			if ((p = get_activity_position(act, xsa->id, RESUME_IF_NOT_FOUND)) < 0)
+				continue;
+			read_us = (double) xsa->read_ns / 1000;
+
+			printf("%-11s", timestamp[curr]);
+			cprintf_in(IS_STR, " %12s", act[p]->name, 0);
+			cprintf_f(NO_UNIT, FALSE, 1, 9, 2, read_us);
+			cprintf_xpc(DISPLAY_UNIT(flags), FALSE, 2, 9, 2,
+				    coll_us ? read_us * 100 / coll_us : 0.0,
+				    xsa->flags & SELF_ACT_SKIPPED ? 100.0 : 0.0);
+			printf("\n");
+		}
+	}
+
+	printf("\n%-11s %9s %9s %9s %9s %9s %9s\n", timestamp[!curr],
+	       "usr-ms", "sys-ms", "minflt", "majflt", "nvcsw", "nivcsw");
+
+	printf("%-11s", timestamp[curr]);
+	cprintf_f(NO_UNIT, FALSE, 6, 9, 2,
+		  (double) xs->utime_us / 1000 / n,
+		  (double) xs->stime_us / 1000 / n,
+		  (double) xs->minflt / n,
+		  (double) xs->majflt / n,
+		  (double) xs->nvcsw / n,
+		  (double) xs->nivcsw / n);
+	printf("\n");
+}
+
+/*
+ ***************************************************************************
+ * Reset sums of sadc's own statistics used to compute averages.
+ ***************************************************************************
+ */
+void reset_self_stats_sum(void)
+{
+	memset(&self_sum, 0, EXTRA_SELF_SIZE);
+	memset(self_act_sum, 0, sizeof(self_act_sum));
+	memset(self_act_count, 0, sizeof(self_act_count));
+	memset(self_act_skip, 0, sizeof(self_act_skip));
+	memset(self_act_seen, 0, sizeof(self_act_seen));
+	self_count = 0;
+}
+
 /*
  ***************************************************************************
  * Print statistics average.
@@ -409,12 +571,18 @@ void write_stats_avg(int curr, int read_from_file, unsigned int act_id)
 		}
 	}
 
+	if (SELF_STATS(flags) && ((act_id == ALL_ACTIVITIES) || (act_id == SELF_STATS_ID))) {
+		/* Display average sadc's own statistics */
+		print_self_stats(2, curr);
+	}
+
 	if (read_from_file) {
 		/*
 		 * Reset number of lines printed only if we read stats
 		 * from a system activity file.
 		 */
 		avg_count = 0;
+		reset_self_stats_sum();
 	}
 }
 
@@ -523,6 +691,13 @@ int write_stats(int curr, int read_from_file, long *cnt, enum time_mode use_tm_s
 		}
 	}
 
+	if (SELF_STATS(flags) && rec_self.valid &&
+	    ((act_id == ALL_ACTIVITIES) || (act_id == SELF_STATS_ID))) {
+		/* Display sadc's own statistics */
+		print_self_stats(!curr, curr);
+		rc = 1;
+	}
+
 	return rc;
 }
 
@@ -571,7 +746,8 @@ void write_stats_startup(int curr)
 
 /*
  ***************************************************************************
- * Read data sent by the data collector.
+ * Read data sent by the data collector, either through a pipe or through
+ * a shared memory ring buffer (option --shm).
  *
  * IN:
  * @size	Number of bytes of data to read.
@@ -588,6 +764,19 @@ size_t sa_read(void *buffer, size_t size)
 {
 	ssize_t n;
 
+	if (shm_rd.ring) {
+		/* Data are read from the shared memory ring buffer */
+		size = shm_ring_read(&shm_rd, buffer, size, &sigint_caught);
+		if (size && shm_rd.ring->closed) {
+			/*
+			 * sadc has stopped publishing records: Behave as if
+			 * it had sent us a SIGINT signal.
+			 */
+			sigint_caught = 1;
+		}
+		return size;
+	}
+
 	while (size) {
 
 		if ((n = read(STDIN_FILENO, buffer, size)) < 0) {
@@ -595,8 +784,16 @@ size_t sa_read(void *buffer, size_t size)
 			exit(2);
 		}
 
-		if (!n)
+		if (!n) {
+			if (sock_path[0]) {
+				/*
+				 * sadc has closed the connection: Behave as if
+				 * it had sent us a SIGINT signal.
+				 */
+				sigint_caught = 1;
+			}
 			return size;	/* EOF */
+		}
 
 		size -= n;
 		buffer = (char *) buffer + n;
@@ -657,6 +854,60 @@ __print_funct_t print_sar_comment(int *tab, int action, char *cur_date, char *cu
 	printf("\n");
 }
 
+/*
+ ***************************************************************************
+ * Read extra structures sent by sadc after current record header.
+ * sadc's own statistics are saved, other extra structures are ignored.
+ ***************************************************************************
+ */
+void read_sadc_extra_struct(void)
+{
+	struct extra_desc xtra_d;
+	char buf[MAX_EXTRA_SIZE];
+	unsigned int i, self_act_nr = 0;
+
+	do {
+		if (sa_read(&xtra_d, EXTRA_DESC_SIZE)) {
+#ifdef DEBUG
+			fprintf(stderr, "%s: Extra structure description\n", __FUNCTION__);
+#endif
+			print_read_error(END_OF_DATA_UNEXPECTED);
+		}
+		if ((xtra_d.extra_nr > MAX_EXTRA_NR) || (xtra_d.extra_size > MAX_EXTRA_SIZE)) {
+			print_read_error(INCONSISTENT_INPUT_DATA);
+		}
+
+		if ((xtra_d.extra_nr == 1) &&
+		    match_extra_desc(&xtra_d, EXTRA_SELF_SIZE, extra_self_types_nr)) {
+			if (sa_read(&rec_self.self, EXTRA_SELF_SIZE)) {
+				print_read_error(END_OF_DATA_UNEXPECTED);
+			}
+			if ((rec_self.self.magic != SELF_MAGIC) || (rec_self.self.act_nr > NR_ACT)) {
+				print_read_error(INCONSISTENT_INPUT_DATA);
+			}
+			self_act_nr = rec_self.self.act_nr;
+			rec_self.valid = !self_act_nr;
+		}
+		else if (self_act_nr && (xtra_d.extra_nr == self_act_nr) &&
+			 match_extra_desc(&xtra_d, EXTRA_SELF_ACT_SIZE, extra_self_act_types_nr)) {
+			if (sa_read(rec_self.self_act, EXTRA_SELF_ACT_SIZE * self_act_nr)) {
+				print_read_error(END_OF_DATA_UNEXPECTED);
+			}
+			rec_self.valid = TRUE;
+			self_act_nr = 0;
+		}
+		else {
+			/* Ignore unknown extra structures */
+			for (i = 0; i < xtra_d.extra_nr; i++) {
+				if (sa_read(buf, xtra_d.extra_size)) {
+					print_read_error(END_OF_DATA_UNEXPECTED);
+				}
+			}
+		}
+	}
+	while (xtra_d.extra_next);
+}
+
 /*
  ***************************************************************************
  * Read the various statistics sent by the data collector (sadc).
@@ -685,6 +936,12 @@ void read_sadc_stat_bunch(int curr)
 		print_read_error(END_OF_DATA_UNEXPECTED);
 	}
 
+	/* Read extra structures if present (e.g. sadc's own statistics) */
+	rec_self.valid = FALSE;
+	if (record_hdr[curr].extra_next) {
+		read_sadc_extra_struct();
+	}
+
 	for (i = 0; i < NR_ACT; i++) {
 
 		if (!id_seq[i])
@@ -782,10 +1039,17 @@ void handle_curr_act_stats(int ifd, off_t fpos, int *curr, long *cnt, int *eosaf
 	*cnt  = count;
 
 	/* Assess number of lines printed when a bitmap is used */
-	p = get_activity_position(act, act_id, EXIT_IF_NOT_FOUND);
-	if (act[p]->bitmap) {
-		inc = count_bits(act[p]->bitmap->b_array,
-				 BITMAP_SIZE(act[p]->bitmap->b_size));
+	if (act_id == SELF_STATS_ID) {
+		/* sadc's own statistics: Headers are always displayed */
+		p = -1;
+		inc = 1;
+	}
+	else {
+		p = get_activity_position(act, act_id, EXIT_IF_NOT_FOUND);
+		if (act[p]->bitmap) {
+			inc = count_bits(act[p]->bitmap->b_array,
+					 BITMAP_SIZE(act[p]->bitmap->b_size));
+		}
 	}
 	reset_cd = 1;
 
@@ -1139,6 +1403,15 @@ void read_stats_from_file(char from_file[])
 				}
 			}
 		}
+
+		if (SELF_STATS(flags)) {
+			/* Display sadc's own statistics saved in file */
+			handle_curr_act_stats(ifd, fpos, &curr, &cnt, &eosaf, rows,
+					      SELF_STATS_ID, &reset, file_actlst,
+					      from_file, &file_magic, rec_hdr_tmp,
+					      endian_mismatch, arch_64, sizeof(rec_hdr_tmp));
+		}
+
 		if (cnt == 0) {
 			/*
 			 * Go to next Linux restart, if possible.
@@ -1312,6 +1585,45 @@ void read_stats(void)
 	}
 }
 
+/*
+ ***************************************************************************
+ * Connect to the Unix domain socket on which a running sadc sends its
+ * records (option --socket). Data are then read on STDIN, as if they were
+ * sent through a pipe.
+ ***************************************************************************
+ */
+void connect_sadc_socket(void)
+{
+	struct sockaddr_un addr;
+	int sock;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(sock_path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		goto sock_error;
+	}
+	strcpy(addr.sun_path, sock_path);
+
+	if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		goto sock_error;
+	if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		close(sock);
+		goto sock_error;
+	}
+
+	if (dup2(sock, STDIN_FILENO) < 0) {
+		perror("dup2");
+		exit(4);
+	}
+	close(sock);
+	return;
+
+sock_error:
+	fprintf(stderr, _("Cannot open %s: %s\n"), sock_path, strerror(errno));
+	exit(2);
+}
+
 /*
  ***************************************************************************
  * Main entry to the sar program.
@@ -1328,7 +1640,7 @@ int main(int argc, char **argv)
 	/* Compute page shift in kB */
 	get_kb_shift();
 
-	from_file[0] = to_file[0] = '\0';
+	from_file[0] = to_file[0] = shm_name[0] = sock_path[0] = '\0';
 
 #ifdef USE_NLS
 	/* Init National Language Support */
@@ -1395,6 +1707,30 @@ int main(int argc, char **argv)
 			opt++;
 		}
 
+		else if (!strcmp(argv[opt], "--self")) {
+			/* Display data collector's own statistics */
+			flags |= S_F_SELF_STATS;
+			opt++;
+		}
+
+		else if (!strncmp(argv[opt], "--socket=", 9)) {
+			/* Read records sent by sadc on a Unix domain socket */
+			if (!argv[opt][9] ||
+			    (snprintf(sock_path, sizeof(sock_path), "%s", argv[opt] + 9) >= sizeof(sock_path))) {
+				usage(argv[0]);
+			}
+			opt++;
+		}
+
+		else if (!strncmp(argv[opt], "--shm=", 6)) {
+			/* Read records published by sadc in shared memory */
+			if (!argv[opt][6] ||
+			    (snprintf(shm_name, sizeof(shm_name), "%s", argv[opt] + 6) >= sizeof(shm_name))) {
+				usage(argv[0]);
+			}
+			opt++;
+		}
+
 		else if (!strncmp(argv[opt], "--dec=", 6) && (strlen(argv[opt]) == 7)) {
 			/* Check that the argument is a digit */
 			if (!isdigit(argv[opt][6])) {
@@ -1587,7 +1923,8 @@ int main(int argc, char **argv)
 
 	/* 'sar' is equivalent to 'sar -f' */
 	if ((argc == 1) ||
-	    (((interval < 0) || INTERVAL_SET(flags)) && !from_file[0] && !to_file[0])) {
+	    (((interval < 0) || INTERVAL_SET(flags)) && !from_file[0] && !to_file[0] &&
+	     !shm_name[0] && !sock_path[0])) {
 		set_default_file(from_file, day_offset, -1);
 	}
 
@@ -1603,6 +1940,16 @@ int main(int argc, char **argv)
 		fprintf(stderr, _("-f and -o options are mutually exclusive\n"));
 		exit(1);
 	}
+	/* ... or you read records published by sadc in shared memory */
+	if (shm_name[0] && (from_file[0] || to_file[0])) {
+		fprintf(stderr, _("--shm option cannot be used with -f or -o options\n"));
+		exit(1);
+	}
+	/* ... or you read records sent by sadc on a socket */
+	if (sock_path[0] && (from_file[0] || to_file[0] || shm_name[0])) {
+		fprintf(stderr, _("--socket option cannot be used with -f, -o or --shm options\n"));
+		exit(1);
+	}
 	if (USE_OPTION_A(flags)) {
 		/* Set -P ALL if needed */
 		set_bitmaps(act, &flags);
@@ -1656,6 +2003,44 @@ int main(int argc, char **argv)
 
 	/* Reading stats from sadc: */
 
+	if (shm_name[0]) {
+		/* Attach to the ring buffer where a running sadc publishes its records */
+		if (shm_ring_attach(&shm_rd, shm_name) < 0) {
+			fprintf(stderr, _("Cannot open %s: %s\n"), shm_name, strerror(errno));
+			exit(2);
+		}
+		if (interval < 0) {
+			/* Interval not set: Report continuously */
+			interval = 1;
+		}
+
+		/* Get now the statistics */
+		read_stats();
+
+		shm_ring_detach(&shm_rd);
+		free_bitmaps(act);
+		free_structures(act);
+
+		return 0;
+	}
+
+	if (sock_path[0]) {
+		/* Connect to a running sadc and read its records from the socket */
+		connect_sadc_socket();
+		if (interval < 0) {
+			/* Interval not set: Report continuously */
+			interval = 1;
+		}
+
+		/* Get now the statistics */
+		read_stats();
+
+		free_bitmaps(act);
+		free_structures(act);
+
+		return 0;
+	}
+
 	/* Create anonymous pipe */
 	if (pipe(fd) == -1) {
 		perror("pipe");
@@ -1715,6 +2100,11 @@ int main(int argc, char **argv)
 		/* Flags to be passed to sadc */
 		salloc(args_idx++, "-Z");
 
+		if (SELF_STATS(flags)) {
+			/* Tell sadc to save its own statistics */
+			salloc(args_idx++, "--self");
+		}
+
 		/* Writing data to a file (option -o) */
 		if (to_file[0]) {
 			/* Set option -D if entered */
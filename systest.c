@@ -35,6 +35,7 @@
 #include <sys/statvfs.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/resource.h>
 
 #include "systest.h"
 
@@ -362,5 +363,55 @@ pid_t get_known_pid(void)
 	return 8741;
 }
 
+/*
+ ***************************************************************************
+ * Replacement function for clock_gettime() system call. Time given by the
+ * monotonic clock is increased by a known step each time it is read.
+ *
+ * OUT:
+ * @ts	Current value of the (simulated) monotonic clock.
+ *
+ * RETURNS:
+ * 0 (success).
+ ***************************************************************************
+ */
+int get_mono_time(struct timespec *ts)
+{
+	static unsigned long long mono_ns = 0;
+
+	mono_ns += 12500;	/* 12.5 us */
+	ts->tv_sec = mono_ns / 1000000000;
+	ts->tv_nsec = mono_ns % 1000000000;
+
+	return 0;
+}
+
+/*
+ ***************************************************************************
+ * Replacement function for getrusage() system call. Resource usage is
+ * increased by known values each time it is read.
+ *
+ * OUT:
+ * @ru	Resource usage of current process.
+ *
+ * RETURNS:
+ * 0 (success).
+ ***************************************************************************
+ */
+int get_self_usage(struct rusage *ru)
+{
+	static int n = 0;
+
+	n++;
+	memset(ru, 0, sizeof(struct rusage));
+	ru->ru_utime.tv_usec = n * 1500;
+	ru->ru_stime.tv_usec = n * 2500;
+	ru->ru_minflt = n * 12;
+	ru->ru_nvcsw = n * 2;
+	ru->ru_nivcsw = n;
+
+	return 0;
+}
+
 #endif	/* TEST */
 
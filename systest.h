@@ -11,6 +11,7 @@
 #include <sys/utsname.h>
 #include <sys/statvfs.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 
 #ifndef MINORBITS
 #define MINORBITS	20
@@ -36,6 +37,8 @@
 #define __gettimeofday(m,n)	get_day_time(m)
 #define __getpwuid(m)		get_usrname(m)
 #define __fork(m)		get_known_pid(m)
+#define __clock_gettime(m,n)	get_mono_time(n)
+#define __getrusage(m,n)	get_self_usage(n)
 #define __major(m)		(m >> MINORBITS)
 #define __minor(m)		(m & S_MAXMINOR)
 
@@ -63,6 +66,8 @@
 #define __gettimeofday(m,n)	gettimeofday(m,n)
 #define __getpwuid(m)		getpwuid(m)
 #define __fork(m)		fork(m)
+#define __clock_gettime(m,n)	clock_gettime(m,n)
+#define __getrusage(m,n)	getrusage(m,n)
 #define __major(m)		major(m)
 #define __minor(m)		minor(m)
 
@@ -84,8 +89,12 @@ int get_fs_stat
 	(char *, struct statvfs *);
 pid_t get_known_pid
 	(void);
+int get_mono_time
+	(struct timespec *);
 char *get_realname
 	(char *, char *);
+int get_self_usage
+	(struct rusage *);
 void get_uname
 	(struct utsname *);
 time_t get_unix_time
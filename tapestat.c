@@ -26,6 +26,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <stddef.h>
 #include <time.h>
 #include <dirent.h>
 #define __DO_NOT_DEFINE_COMPILE
@@ -92,6 +95,24 @@ struct tape_stats *tape_new_stats = { NULL };
 struct tape_stats *tape_old_stats = { NULL };
 regex_t tape_reg;
 
+/*
+ * Descriptors on statistics files, TAPE_STAT_NR per tape. Files are opened
+ * once then re-read with pread() at each sample. -1 means not opened.
+ */
+int *tape_fd = NULL;
+
+struct tape_stat_file tape_stat_files[TAPE_STAT_NR] = {
+	{"read_ns",		offsetof(struct tape_stats, read_time)},
+	{"write_ns",		offsetof(struct tape_stats, write_time)},
+	{"io_ns",		offsetof(struct tape_stats, other_time)},
+	{"read_byte_cnt",	offsetof(struct tape_stats, read_bytes)},
+	{"write_byte_cnt",	offsetof(struct tape_stats, write_bytes)},
+	{"read_cnt",		offsetof(struct tape_stats, read_count)},
+	{"write_cnt",		offsetof(struct tape_stats, write_count)},
+	{"other_cnt",		offsetof(struct tape_stats, other_count)},
+	{"resid_cnt",		offsetof(struct tape_stats, resid_count)}
+};
+
 /*
  ***************************************************************************
  * Print usage and exit.
@@ -151,6 +172,109 @@ void tape_initialise(void)
         }
 }
 
+/*
+ ***************************************************************************
+ * Close statistics files opened for a tape.
+ *
+ * IN:
+ * @i		Index in array for current tape.
+ ***************************************************************************
+ */
+void tape_close_stat_files(int i)
+{
+	int k, *fd = &tape_fd[i * TAPE_STAT_NR];
+
+	for (k = 0; k < TAPE_STAT_NR; k++) {
+		if (fd[k] >= 0) {
+			close(fd[k]);
+			fd[k] = -1;
+		}
+	}
+}
+
+/*
+ ***************************************************************************
+ * Allocate descriptors for new tapes.
+ *
+ * IN:
+ * @old_nr	Number of tapes for which descriptors were already allocated.
+ * @new_nr	New number of tapes.
+ ***************************************************************************
+ */
+void tape_alloc_fd(int old_nr, int new_nr)
+{
+	int k;
+
+	SREALLOC(tape_fd, int, sizeof(int) * TAPE_STAT_NR * new_nr);
+
+	for (k = old_nr * TAPE_STAT_NR; k < new_nr * TAPE_STAT_NR; k++) {
+		tape_fd[k] = -1;
+	}
+}
+
+/*
+ ***************************************************************************
+ * Read statistics files for a tape. Files are opened the first time, then
+ * kept open and re-read from the start with pread().
+ *
+ * IN:
+ * @i		Index in array for current tape.
+ *
+ * OUT:
+ * @st		Statistics for current tape. Marked as invalid if a file
+ *		couldn't be opened or read.
+ ***************************************************************************
+ */
+void tape_read_stat_files(struct tape_stats *st, int i)
+{
+	int k, *fd = &tape_fd[i * TAPE_STAT_NR];
+	char filename[MAXPATHLEN + 1], buf[TAPE_STAT_VAL_LEN];
+	char *end;
+	uint64_t val;
+	ssize_t n;
+
+	/*
+	 * Everything starts out valid but failing to open
+	 * a file gets the tape drive marked invalid.
+	 */
+	st->valid = TAPE_STATS_VALID;
+
+	for (k = 0; k < TAPE_STAT_NR; k++) {
+		if (fd[k] < 0) {
+			snprintf(filename, sizeof(filename), TAPE_STAT_PATH "%s",
+				 i, tape_stat_files[k].name);
+			if ((fd[k] = open(filename, O_RDONLY)) < 0) {
+				st->valid = TAPE_STATS_INVALID;
+				break;
+			}
+		}
+
+		if ((n = pread(fd[k], buf, sizeof(buf) - 1, 0)) <= 0) {
+			/*
+			 * Tape has been removed: Its files will be
+			 * opened again if it comes back.
+			 */
+			tape_close_stat_files(i);
+			st->valid = TAPE_STATS_INVALID;
+			break;
+		}
+		buf[n] = '\0';
+
+		val = strtoull(buf, &end, 10);
+		if (end == buf) {
+			st->valid = TAPE_STATS_INVALID;
+		}
+		else {
+			*((uint64_t *) ((char *) st + tape_stat_files[k].offset)) = val;
+		}
+	}
+
+#ifdef TEST
+	/* Test root directory changes between samples: Don't keep files open */
+	tape_close_stat_files(i);
+#endif
+}
+
 /*
  ***************************************************************************
  * Free structures.
@@ -158,7 +282,15 @@ void tape_initialise(void)
  */
 void tape_uninitialise(void)
 {
+	int i;
+
 	regfree(&tape_reg);
+	if (tape_fd != NULL) {
+		for (i = 0; i < max_tape_drives; i++) {
+			tape_close_stat_files(i);
+		}
+		free(tape_fd);
+	}
 	if (tape_old_stats != NULL) {
 		free(tape_old_stats);
 	}
@@ -221,14 +353,38 @@ int get_max_tape_drives(void)
 /*
  ***************************************************************************
  * Check if new tapes have been added and reallocate structures accordingly.
+ * Only tape names are looked at here: Unlike get_max_tape_drives(), no
+ * regular expression is used and no stats directory is stat()'ed.
+ * Tapes that have been removed are detected when reading their
+ * statistics files.
  ***************************************************************************
  */
 void tape_check_tapes_and_realloc(void)
 {
-	int new_max_tape_drives;
+	DIR *dir;
+	struct dirent *entry;
+	int new_max_tape_drives, tmp;
+	char *end;
 
-	/* Count again number of tapes */
-	new_max_tape_drives = get_max_tape_drives();
+	new_max_tape_drives = max_tape_drives;
+
+	/* Look for tapes with a greater number */
+	if ((dir = opendir(SYSFS_CLASS_TAPE_DIR)) == NULL)
+		return;
+
+	while ((entry = readdir(dir)) != NULL) {
+
+		/* Tape names are "st<n>" */
+		if ((entry->d_name[0] != 's') || (entry->d_name[1] != 't') ||
+		    !isdigit((unsigned char) entry->d_name[2]))
+			continue;
+
+		tmp = (int) strtol(&entry->d_name[2], &end, 10) + 1;
+		if (!*end && (tmp > new_max_tape_drives)) {
+			new_max_tape_drives = tmp;
+		}
+	}
+	closedir(dir);
 
 	if (new_max_tape_drives > max_tape_drives && new_max_tape_drives > 0) {
 		int i;
@@ -265,6 +421,7 @@ void tape_check_tapes_and_realloc(void)
 			tape_old_stats[i].valid = TAPE_STATS_INVALID;
 			tape_new_stats[i].valid = TAPE_STATS_INVALID;
 		}
+		tape_alloc_fd(max_tape_drives, new_max_tape_drives);
 		max_tape_drives = new_max_tape_drives;
 	}
 }
@@ -278,8 +435,6 @@ void tape_check_tapes_and_realloc(void)
 void tape_gather_initial_stats(void)
 {
 	int new_max_tape_drives, i;
-	FILE *fp;
-	char filename[MAXPATHLEN + 1];
 
 	/* Get number of tapes in the system */
 	new_max_tape_drives = get_max_tape_drives();
@@ -306,6 +461,7 @@ void tape_gather_initial_stats(void)
 				tape_old_stats[i].valid = TAPE_STATS_INVALID;
 				tape_new_stats[i].valid = TAPE_STATS_INVALID;
 			}
+			tape_alloc_fd(0, new_max_tape_drives);
 		} else
 			/* This should only be called once */
 			return;
@@ -315,11 +471,6 @@ void tape_gather_initial_stats(void)
 
 	/* Read stats for each tape */
 	for (i = 0; i < max_tape_drives; i++) {
-		/*
-		 * Everything starts out valid but failing to open
-		 * a file gets the tape drive marked invalid.
-		 */
-		tape_new_stats[i].valid = TAPE_STATS_VALID;
 		tape_old_stats[i].valid = TAPE_STATS_VALID;
 
 		__gettimeofday(&tape_old_stats[i].tv, NULL);
@@ -327,15 +478,7 @@ void tape_gather_initial_stats(void)
 		tape_new_stats[i].tv.tv_sec = tape_old_stats[i].tv.tv_sec;
 		tape_new_stats[i].tv.tv_usec = tape_old_stats[i].tv.tv_usec;
 
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "read_ns", read_time)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "write_ns", write_time)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "io_ns", other_time)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "read_byte_cnt", read_bytes)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "write_byte_cnt", write_bytes)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "read_cnt", read_count)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "write_cnt", write_count)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "other_cnt", other_count)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "resid_cnt", resid_count)
+		tape_read_stat_files(&tape_new_stats[i], i);
 
 		tape_old_stats[i].read_time = 0;
 		tape_old_stats[i].write_time = 0;
@@ -357,29 +500,14 @@ void tape_gather_initial_stats(void)
 void tape_get_updated_stats(void)
 {
 	int i;
-	FILE *fp;
-	char filename[MAXPATHLEN + 1] = { 0 };
 
 	/* Check tapes and realloc structures if  needed */
 	tape_check_tapes_and_realloc();
 
 	for (i = 0; i < max_tape_drives; i++) {
-		/*
-		 * Everything starts out valid but failing
-		 * to open a file gets the tape drive marked invalid.
-		 */
-		tape_new_stats[i].valid = TAPE_STATS_VALID;
 		__gettimeofday(&tape_new_stats[i].tv, NULL);
 
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "read_ns", read_time)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "write_ns", write_time)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "io_ns", other_time)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "read_byte_cnt", read_bytes)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "write_byte_cnt", write_bytes)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "read_cnt", read_count)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "write_cnt", write_count)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "other_cnt", other_count)
-		TAPE_STAT_FILE_VAL(TAPE_STAT_PATH "resid_cnt", resid_count)
+		tape_read_stat_files(&tape_new_stats[i], i);
 
 		if ((tape_new_stats[i].read_time < tape_old_stats[i].read_time) ||
 		    (tape_new_stats[i].write_time < tape_old_stats[i].write_time) ||
@@ -35,18 +35,10 @@ enum {
 #define SYSFS_CLASS_TAPE_DIR 	PRE "/sys/class/scsi_tape"
 #define TAPE_STAT_PATH		PRE "/sys/class/scsi_tape/st%i/stats/"
 
-#define TAPE_STAT_FILE_VAL(A, B)					\
-	snprintf(filename, MAXPATHLEN, A, i);				\
-	if ((fp = fopen(filename, "r")) != NULL) {			\
-		if (fscanf(fp, "%"PRId64, &tape_new_stats[i].B) != 1) {	\
-			tape_new_stats[i].valid = TAPE_STATS_INVALID;	\
-		}							\
-		fclose(fp);						\
-	} else {							\
-		tape_new_stats[i].valid = TAPE_STATS_INVALID;		\
-		continue;						\
-	}
-
+/* Number of statistics files read for each tape */
+#define TAPE_STAT_NR		9
+/* Max length of the contents of a statistics file */
+#define TAPE_STAT_VAL_LEN	32
 
 /*
  * A - tape_stats structure member name, e.g. read_count
@@ -105,6 +97,12 @@ struct tape_stats {
         char valid;
         struct timeval tv;
 };
+
+/* Statistics file and corresponding member of the tape_stats structure */
+struct tape_stat_file {
+	char *name;
+	size_t offset;
+};
 struct calc_stats {
         uint64_t reads_per_second;
         uint64_t writes_per_second;
@@ -0,0 +1,165 @@
+/*
+ * libtest.c: Display statistics collected with libsysstat.a
+ * (C) 2025 by Sebastien GODARD (sysstat <at> orange.fr)
+ *
+ ***************************************************************************
+ * This program is free software; you can redistribute it and/or modify it *
+ * under the terms of the GNU General Public License as published  by  the *
+ * Free Software Foundation; either version 2 of the License, or (at  your *
+ * option) any later version.                                              *
+ *                                                                         *
+ * This program is distributed in the hope that it  will  be  useful,  but *
+ * WITHOUT ANY WARRANTY; without the implied warranty  of  MERCHANTABILITY *
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License *
+ * for more details.                                                       *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, write to the Free Software Foundation, Inc., *
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335 USA              *
+ ***************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "libsysstat.h"
+/* For __pause() */
+#include "systest.h"
+
+/*
+ * Two samples are read. When compiled with TEST defined, __pause() makes
+ * the second sample be read from the next root directory (see systest.c).
+ * Buffers are deliberately allocated too small, so that the way the
+ * library reports a buffer too small is tested too.
+ */
+
+/* Variables used by systest.c */
+long interval = 1;
+int sigint_caught = 0;
+
+void int_handler(int sig)
+{
+	sigint_caught = 1;
+}
+
+/* Reallocate a buffer, or exit */
+void *xrealloc(void *ptr, size_t size)
+{
+	if ((ptr = realloc(ptr, size)) == NULL) {
+		perror("realloc");
+		exit(4);
+	}
+
+	return ptr;
+}
+
+/* Read CPU statistics, reallocating the buffer as long as it is too small */
+int read_cpu(struct sysstat_ctx *ctx, struct sysstat_cpu **st_cpu, int *nr_alloc)
+{
+	int nr_read;
+
+	while ((nr_read = sysstat_read_cpu(ctx, *st_cpu, *nr_alloc)) == -1) {
+		*nr_alloc = ctx->cpu_nr > *nr_alloc ? ctx->cpu_nr : *nr_alloc * 2;
+		*st_cpu = xrealloc(*st_cpu, (size_t) *nr_alloc * sizeof(struct sysstat_cpu));
+	}
+
+	return nr_read;
+}
+
+/* Read block devices statistics, reallocating the buffer as needed */
+int read_disk(struct sysstat_ctx *ctx, struct sysstat_disk **st_disk, int *nr_alloc)
+{
+	int nr_read;
+
+	while ((nr_read = sysstat_read_disk(ctx, *st_disk, *nr_alloc, 0)) == -1) {
+		*nr_alloc = ctx->disk_nr > *nr_alloc ? ctx->disk_nr : *nr_alloc * 2;
+		*st_disk = xrealloc(*st_disk, (size_t) *nr_alloc * sizeof(struct sysstat_disk));
+	}
+
+	return nr_read;
+}
+
+int main(void)
+{
+	struct sysstat_ctx ctx;
+	struct sysstat_cpu *st_cpu[2] = {NULL, NULL};
+	struct sysstat_disk *st_disk[2] = {NULL, NULL};
+	struct sysstat_memory st_mem;
+	struct sysstat_cpu_util cu;
+	struct sysstat_mem_util mu;
+	struct sysstat_disk_rates dr;
+	unsigned long long uptime[2] = {0, 0}, itv;
+	int cpu_alloc[2] = {2, 2}, disk_alloc[2] = {1, 1};
+	int cpu_read[2], disk_read[2];
+	int i, j;
+
+	if (sysstat_init(&ctx) < 0) {
+		/* The library must return, not exit */
+		printf("sysstat_init: %s\n", strerror(errno));
+	}
+	else {
+		printf("CPU: %d  Disks: %d  Interfaces: %d\n",
+		       ctx.cpu_nr, ctx.disk_nr, ctx.iface_nr);
+	}
+
+	for (i = 0; i < 2; i++) {
+		st_cpu[i] = xrealloc(NULL, 2 * sizeof(struct sysstat_cpu));
+		st_disk[i] = xrealloc(NULL, sizeof(struct sysstat_disk));
+	}
+
+	for (i = 0; i < 2; i++) {
+		if (i) {
+			__pause();
+		}
+		if (sysstat_read_uptime(&uptime[i]) < 0) {
+			printf("sysstat_read_uptime: Error\n");
+		}
+		if ((cpu_read[i] = read_cpu(&ctx, &st_cpu[i], &cpu_alloc[i])) == -2) {
+			printf("sysstat_read_cpu: %s\n", strerror(errno));
+			goto end;
+		}
+		disk_read[i] = read_disk(&ctx, &st_disk[i], &disk_alloc[i]);
+	}
+
+	itv = sysstat_interval(uptime[0], uptime[1]);
+	printf("Interval: %llu\n", itv);
+
+	for (j = 0; (j < cpu_read[0]) && (j < cpu_read[1]); j++) {
+		sysstat_cpu_util(st_cpu[1] + j, st_cpu[0] + j, &cu);
+		printf("CPU %3d  %%user %6.2f  %%system %6.2f  %%iowait %6.2f  %%idle %6.2f\n",
+		       j - 1, cu.user, cu.system, cu.iowait, cu.idle);
+	}
+
+	for (i = 0; i < disk_read[1]; i++) {
+		/* Look for the same device in previous sample */
+		for (j = 0; j < disk_read[0]; j++) {
+			if ((st_disk[0][j].major == st_disk[1][i].major) &&
+			    (st_disk[0][j].minor == st_disk[1][i].minor))
+				break;
+		}
+		if (j == disk_read[0])
+			continue;
+		sysstat_disk_rates(st_disk[1] + i, st_disk[0] + j, itv, &dr);
+		printf("Disk %3u:%-3u  tps %9.2f  rkB/s %9.2f  wkB/s %9.2f  await %7.2f  %%util %6.2f\n",
+		       st_disk[1][i].major, st_disk[1][i].minor,
+		       dr.tps, dr.rkB, dr.wkB, dr.await, dr.util);
+	}
+
+	if (sysstat_read_memory(&st_mem)) {
+		sysstat_mem_util(&st_mem, &mu);
+		printf("kbmemused %llu  %%memused %6.2f  %%commit %6.2f\n",
+		       mu.kbmemused, mu.memused, mu.commit);
+	}
+
+end:
+	for (i = 0; i < 2; i++) {
+		free(st_cpu[i]);
+		free(st_disk[i]);
+	}
+	printf("Done\n");
+
+	return 0;
+}